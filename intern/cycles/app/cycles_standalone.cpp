@@ -19,8 +19,10 @@
 #include "render/buffers.h"
 #include "render/camera.h"
 #include "device/device.h"
+#include "render/film.h"
 #include "render/scene.h"
 #include "render/session.h"
+#include "render/stats.h"
 #include "render/integrator.h"
 
 #include "util/util_args.h"
@@ -46,12 +48,17 @@ struct Options {
 	Session *session;
 	Scene *scene;
 	string filepath;
+	/* Files with scene changes, each rendered as the next frame. */
+	vector<string> update_filepaths;
+	int frame;
 	int width, height;
 	SceneParams scene_params;
 	SessionParams session_params;
 	bool quiet;
 	bool show_help, interactive, pause;
 	string output_path;
+	bool adaptive_sampling;
+	float adaptive_threshold;
 } options;
 
 static void session_print(const string& str)
@@ -87,18 +94,48 @@ static void session_print_status()
 	session_print(status);
 }
 
+/* Output path of the current frame, when rendering update files a run of #
+ * is replaced by the frame number, or it is appended before the extension. */
+static string frame_output_path()
+{
+	if(options.update_filepaths.empty()) {
+		return options.output_path;
+	}
+
+	string filepath = options.output_path;
+	size_t begin = filepath.find('#');
+
+	if(begin == string::npos) {
+		size_t ext = filepath.rfind('.');
+		size_t sep = filepath.find_last_of("/\\");
+		if(ext == string::npos || (sep != string::npos && ext < sep)) {
+			ext = filepath.size();
+		}
+		return filepath.substr(0, ext) + string_printf("_%04d", options.frame) + filepath.substr(ext);
+	}
+
+	size_t end = filepath.find_first_not_of('#', begin);
+	if(end == string::npos) {
+		end = filepath.size();
+	}
+
+	string frame = string_printf("%0*d", (int)(end - begin), options.frame);
+	return filepath.substr(0, begin) + frame + filepath.substr(end);
+}
+
 static bool write_render(const uchar *pixels, int w, int h, int channels)
 {
-	string msg = string_printf("Writing image %s", options.output_path.c_str());
+	string filepath = frame_output_path();
+	string msg = string_printf("Writing image %s", filepath.c_str());
 	session_print(msg);
 
-	ImageOutput *out = ImageOutput::create(options.output_path);
+	ImageOutput *out = ImageOutput::create(filepath);
 	if(!out) {
 		return false;
 	}
 
 	ImageSpec spec(w, h, channels, TypeDesc::UINT8);
-	if(!out->open(options.output_path, spec)) {
+	if(!out->open(filepath, spec)) {
 		return false;
 	}
 
@@ -122,10 +159,38 @@ static BufferParams& session_buffer_params()
 	buffer_params.height = options.height;
 	buffer_params.full_width = options.width;
 	buffer_params.full_height = options.height;
+	buffer_params.adaptive_sampling_pass = options.adaptive_sampling;
 
 	return buffer_params;
 }
 
+static void scene_overrides()
+{
+	/* Camera resolution stays fixed when update files modify the camera. */
+	Camera *cam = options.scene->camera;
+	if(cam->width != options.width || cam->height != options.height) {
+		cam->width = options.width;
+		cam->height = options.height;
+		cam->compute_auto_viewplane();
+		cam->need_update = true;
+		cam->need_device_update = true;
+	}
+
+	Film *film = options.scene->film;
+	if(film->use_adaptive_sampling != options.adaptive_sampling) {
+		film->use_adaptive_sampling = options.adaptive_sampling;
+		film->tag_update(options.scene);
+	}
+
+	Integrator *integrator = options.scene->integrator;
+	if(options.adaptive_threshold > 0.0f &&
+	   integrator->adaptive_threshold != options.adaptive_threshold)
+	{
+		integrator->adaptive_threshold = options.adaptive_threshold;
+		integrator->tag_update(options.scene);
+	}
+}
+
 static void scene_init()
 {
 	options.scene = new Scene(options.scene_params, options.session->device);
@@ -133,6 +198,12 @@ static void scene_init()
 	/* Read XML */
 	xml_read_file(options.scene, options.filepath.c_str());
 
+	/* Objects change between frames when rendering update files, keep the
+	 * BVH of each object and only rebuild the top level. */
+	if(!options.update_filepaths.empty()) {
+		options.scene->params.bvh_type = SceneParams::BVH_DYNAMIC;
+	}
+
 	/* Camera width/height override? */
 	if(!(options.width == 0 || options.height == 0)) {
 		options.scene->camera->width = options.width;
@@ -145,11 +216,17 @@ static void scene_init()
 
 	/* Calculate Viewplane */
 	options.scene->camera->compute_auto_viewplane();
+
+	/* Adaptive sampling override. */
+	scene_overrides();
 }
 
 static void session_init()
 {
-	options.session_params.write_render_cb = write_render;
+	/* Streamed tiles are written by the session itself. */
+	if(options.session_params.tile_output_path.empty()) {
+		options.session_params.write_render_cb = write_render;
+	}
 	options.session = new Session(options.session_params);
 
 	if(options.session_params.background && !options.quiet)
@@ -167,8 +244,51 @@ static void session_init()
 	options.session->start();
 }
 
+/* Render each update file as the next frame, keeping the session with its
+ * device memory, images and object BVHs from the previous frame. */
+static void session_render_updates()
+{
+	foreach(const string& filepath, options.update_filepaths) {
+		if(options.session->progress.get_cancel() || options.session->progress.get_error())
+			break;
+
+		/* The last frame is written when the session is freed. */
+		if(options.session_params.write_render_cb)
+			options.session->write_render();
+
+		if(!options.quiet)
+			printf("\n");
+
+		options.frame++;
+		double start_time = time_dt();
+
+		{
+			thread_scoped_lock scene_lock(options.scene->mutex);
+			xml_update_file(options.scene, filepath.c_str());
+			scene_overrides();
+		}
+
+		options.session->progress.reset();
+		options.session->reset(session_buffer_params(), options.session_params.samples);
+		options.session->start();
+		options.session->wait();
+
+		VLOG(1) << "Frame " << options.frame << " from " << filepath
+		        << " rendered in " << time_dt() - start_time << " seconds.";
+	}
+}
+
 static void session_exit()
 {
+	if(options.session && options.session_params.background &&
+	   options.session_params.use_profiling)
+	{
+		/* Session thread finished already, so the profiler is stopped. */
+		RenderStats stats;
+		options.session->collect_statistics(&stats);
+		printf("\nRender statistics:\n%s", stats.full_report().c_str());
+	}
+
 	if(options.session) {
 		delete options.session;
 		options.session = NULL;
@@ -344,8 +464,12 @@ static void keyboard(unsigned char key)
 
 static int files_parse(int argc, const char *argv[])
 {
-	if(argc > 0)
-		options.filepath = argv[0];
+	for(int i = 0; i < argc; i++) {
+		if(options.filepath == "")
+			options.filepath = argv[i];
+		else
+			options.update_filepaths.push_back(argv[i]);
+	}
 
 	return 0;
 }
@@ -355,8 +479,11 @@ static void options_parse(int argc, const char **argv)
 	options.width = 0;
 	options.height = 0;
 	options.filepath = "";
+	options.frame = 1;
 	options.session = NULL;
 	options.quiet = false;
+	options.adaptive_sampling = false;
+	options.adaptive_threshold = 0.0f;
 
 	/* device names */
 	string device_names = "";
@@ -384,8 +511,9 @@ static void options_parse(int argc, const char **argv)
 	ArgParse ap;
 	bool help = false, debug = false, version = false;
 	int verbosity = 1;
+	int texture_cache_size = 0;
 
-	ap.options ("Usage: cycles [options] file.xml",
+	ap.options ("Usage: cycles [options] file.xml [update.xml ...]",
 		"%*", files_parse, "",
 		"--device %s", &devicename, ("Devices to use: " + device_names).c_str(),
 #ifdef WITH_OSL
@@ -394,12 +522,18 @@ static void options_parse(int argc, const char **argv)
 		"--background", &options.session_params.background, "Render in background, without user interface",
 		"--quiet", &options.quiet, "In background mode, don't print progress messages",
 		"--samples %d", &options.session_params.samples, "Number of samples to render",
-		"--output %s", &options.output_path, "File path to write output image",
+		"--output %s", &options.output_path, "File path to write output image, with # replaced by the frame number when rendering update files",
+		"--output-tiles %s", &options.session_params.tile_output_path, "Write tiles to a tiled multilayer OpenEXR file as they finish, without keeping the full frame in memory (background only)",
 		"--threads %d", &options.session_params.threads, "CPU Rendering Threads",
 		"--width  %d", &options.width, "Window width in pixel",
 		"--height %d", &options.height, "Window height in pixel",
 		"--tile-width %d", &options.session_params.tile_size.x, "Tile width in pixels",
 		"--tile-height %d", &options.session_params.tile_size.y, "Tile height in pixels",
+		"--texture-cache-size %d", &texture_cache_size, "Load image textures on demand within this memory budget in MB, CPU only",
+		"--bvh-cache-path %s", &options.scene_params.bvh_cache_path, "Directory to store built BVHs in, to reuse them in later renders",
+		"--adaptive-sampling", &options.adaptive_sampling, "Stop sampling pixels once they are below the noise threshold, CPU only",
+		"--adaptive-threshold %f", &options.adaptive_threshold, "Noise threshold for adaptive sampling, automatic if 0",
+		"--profile", &options.session_params.use_profiling, "Print render statistics with a profile of the CPU kernel after rendering",
 		"--list-devices", &list, "List information about all available devices",
 #ifdef WITH_CYCLES_LOGGING
 		"--debug", &debug, "Enable debug logging",
@@ -447,12 +581,15 @@ static void options_parse(int argc, const char **argv)
 	else if(ssname == "svm")
 		options.scene_params.shadingsystem = SHADINGSYSTEM_SVM;
 
+	options.scene_params.texture_cache_size = (size_t)max(texture_cache_size, 0) * 1024 * 1024;
+
 #ifndef WITH_CYCLES_STANDALONE_GUI
 	options.session_params.background = true;
 #endif
 
-	/* Use progressive rendering */
-	options.session_params.progressive = true;
+	/* Use progressive rendering, except when streaming tiles which need
+	 * all samples of a tile to be rendered at once. */
+	options.session_params.progressive = options.session_params.tile_output_path.empty();
 
 	/* find matching device */
 	DeviceType device_type = Device::type_from_string(devicename.c_str());
@@ -482,6 +619,18 @@ static void options_parse(int argc, const char **argv)
 		exit(EXIT_FAILURE);
 	}
 #endif
+	else if(options.adaptive_sampling && options.session_params.device.type != DEVICE_CPU) {
+		fprintf(stderr, "Adaptive sampling only works with CPU device\n");
+		exit(EXIT_FAILURE);
+	}
+	else if(!options.session_params.tile_output_path.empty() && !options.session_params.background) {
+		fprintf(stderr, "Tile output only works in background mode\n");
+		exit(EXIT_FAILURE);
+	}
+	else if(!options.session_params.tile_output_path.empty() && options.session_params.samples == INT_MAX) {
+		fprintf(stderr, "Tile output requires a number of samples to be specified\n");
+		exit(EXIT_FAILURE);
+	}
 	else if(options.session_params.samples < 0) {
 		fprintf(stderr, "Invalid number of samples: %d\n", options.session_params.samples);
 		exit(EXIT_FAILURE);
@@ -490,6 +639,14 @@ static void options_parse(int argc, const char **argv)
 		fprintf(stderr, "No file path specified\n");
 		exit(EXIT_FAILURE);
 	}
+	else if(!options.update_filepaths.empty() && !options.session_params.background) {
+		fprintf(stderr, "Update files only work in background mode\n");
+		exit(EXIT_FAILURE);
+	}
+	else if(!options.update_filepaths.empty() && !options.session_params.tile_output_path.empty()) {
+		fprintf(stderr, "Update files do not work with tile output\n");
+		exit(EXIT_FAILURE);
+	}
 
 	/* For smoother Viewport */
 	options.session_params.start_resolution = 64;
@@ -510,6 +667,7 @@ int main(int argc, const char **argv)
 #endif
 		session_init();
 		options.session->wait();
+		session_render_updates();
 		session_exit();
 #ifdef WITH_CYCLES_STANDALONE_GUI
 	}
@@ -39,6 +39,8 @@
 #include "subd/subd_split.h"
 
 #include "util/util_foreach.h"
+#include "util/util_map.h"
+#include "util/util_md5.h"
 #include "util/util_path.h"
 #include "util/util_projection.h"
 #include "util/util_transform.h"
@@ -57,12 +59,14 @@ struct XMLReadState : public XMLReader {
 	Shader *shader;		/* current shader */
 	string base;		/* base path to current file*/
 	float dicing_rate;	/* current dicing rate */
+	bool update;		/* modifying a scene read before */
 
 	XMLReadState()
 	  : scene(NULL),
 	    smooth(false),
 	    shader(NULL),
-	    dicing_rate(1.0f)
+	    dicing_rate(1.0f),
+	    update(false)
 	{
 		tfm = transform_identity();
 	}
@@ -193,6 +197,7 @@ static bool xml_equal_string(xml_node node, const char *name, const char *value)
 static void xml_read_camera(XMLReadState& state, xml_node node)
 {
 	Camera *cam = state.scene->camera;
+	Camera prev_cam = *cam;
 
 	xml_read_int(&cam->width, node, "width");
 	xml_read_int(&cam->height, node, "height");
@@ -204,14 +209,54 @@ static void xml_read_camera(XMLReadState& state, xml_node node)
 
 	cam->matrix = state.tfm;
 
-	cam->need_update = true;
-	cam->update(state.scene);
+	if(!state.update || cam->modified(prev_cam) ||
+	   cam->width != prev_cam.width || cam->height != prev_cam.height)
+	{
+		cam->need_update = true;
+		cam->update(state.scene);
+	}
+}
+
+/* Film and Integrator */
+
+template<typename T>
+static void xml_read_settings(XMLReadState& state, T *settings, xml_node node)
+{
+	T prev_settings = *settings;
+
+	xml_read_node(state, settings, node);
+
+	if(!settings->equals(prev_settings)) {
+		settings->tag_update(state.scene);
+	}
 }
 
 /* Shader */
 
+/* Hash of the XML every shader was last read from, so update files only
+ * replace the graphs of shaders that changed. */
+static map<Shader*, string> xml_shader_hashes;
+
+static string xml_shader_hash(XMLReadState& state, xml_node graph_node)
+{
+	/* Relative paths of images depend on the file the shader is read from. */
+	std::stringstream ss;
+	graph_node.print(ss, "", PUGIXML_NAMESPACE::format_raw);
+
+	MD5Hash md5;
+	md5.append(state.base);
+	md5.append(ss.str());
+	return md5.get_hex();
+}
+
 static void xml_read_shader_graph(XMLReadState& state, Shader *shader, xml_node graph_node)
 {
+	string hash = xml_shader_hash(state, graph_node);
+	if(state.update && xml_shader_hashes[shader] == hash) {
+		return;
+	}
+	xml_shader_hashes[shader] = hash;
+
 	xml_read_node(state, shader, graph_node);
 
 	ShaderGraph *graph = new ShaderGraph();
@@ -351,6 +396,20 @@ static void xml_read_shader_graph(XMLReadState& state, Shader *shader, xml_node
 
 static void xml_read_shader(XMLReadState& state, xml_node node)
 {
+	/* Updates replace the graph of the shader with the same name, when its
+	 * XML differs from what it was read from before. */
+	if(state.update) {
+		string name;
+		if(xml_read_string(&name, node, "name")) {
+			foreach(Shader *shader, state.scene->shaders) {
+				if(shader->name == name) {
+					xml_read_shader_graph(state, shader, node);
+					return;
+				}
+			}
+		}
+	}
+
 	Shader *shader = new Shader();
 	xml_read_shader_graph(state, shader, node);
 	state.scene->shaders.push_back(shader);
@@ -361,7 +420,7 @@ static void xml_read_shader(XMLReadState& state, xml_node node)
 static void xml_read_background(XMLReadState& state, xml_node node)
 {
 	/* Background Settings */
-	xml_read_node(state, state.scene->background, node);
+	xml_read_settings(state, state.scene->background, node);
 
 	/* Background Shader */
 	Shader *shader = state.scene->default_background;
@@ -385,11 +444,52 @@ static Mesh *xml_add_mesh(Scene *scene, const Transform& tfm)
 	return mesh;
 }
 
+static Object *xml_find_object(Scene *scene, const string& name)
+{
+	foreach(Object *object, scene->objects) {
+		if(object->name == name) {
+			return object;
+		}
+	}
+
+	return NULL;
+}
+
 static void xml_read_mesh(const XMLReadState& state, xml_node node)
 {
-	/* add mesh */
-	Mesh *mesh = xml_add_mesh(state.scene, state.tfm);
-	mesh->used_shaders.push_back(state.shader);
+	string name;
+	xml_read_string(&name, node, "name");
+
+	Mesh *mesh;
+	Object *object = (state.update && !name.empty())? xml_find_object(state.scene, name): NULL;
+
+	if(object) {
+		/* Update of a named mesh, only tag what changed so the geometry and
+		 * BVH of the object are kept when it is only moved. */
+		if(!(object->tfm == state.tfm)) {
+			object->tfm = state.tfm;
+			object->tag_update(state.scene);
+		}
+
+		if(!node.attribute("P")) {
+			return;
+		}
+
+		mesh = object->mesh;
+		mesh->clear();
+		mesh->used_shaders.push_back(state.shader);
+		mesh->tag_update(state.scene, true);
+	}
+	else {
+		/* add mesh */
+		mesh = xml_add_mesh(state.scene, state.tfm);
+		mesh->used_shaders.push_back(state.shader);
+
+		if(!name.empty()) {
+			mesh->name = ustring(name);
+			state.scene->objects.back()->name = ustring(name);
+		}
+	}
 
 	/* read state */
 	int shader = 0;
@@ -533,6 +633,26 @@ static void xml_read_mesh(const XMLReadState& state, xml_node node)
 
 static void xml_read_light(XMLReadState& state, xml_node node)
 {
+	/* Updates modify the light with the same name. */
+	if(state.update) {
+		string name;
+		if(xml_read_string(&name, node, "name")) {
+			foreach(Light *light, state.scene->lights) {
+				if(light->name == name) {
+					Light prev_light = *light;
+
+					light->shader = state.shader;
+					xml_read_node(state, light, node);
+
+					if(!light->equals(prev_light) || light->shader != prev_light.shader) {
+						light->tag_update(state.scene);
+					}
+					return;
+				}
+			}
+		}
+	}
+
 	Light *light = new Light();
 
 	light->shader = state.shader;
@@ -611,10 +731,10 @@ static void xml_read_scene(XMLReadState& state, xml_node scene_node)
 {
 	for(xml_node node = scene_node.first_child(); node; node = node.next_sibling()) {
 		if(string_iequals(node.name(), "film")) {
-			xml_read_node(state, state.scene->film, node);
+			xml_read_settings(state, state.scene->film, node);
 		}
 		else if(string_iequals(node.name(), "integrator")) {
-			xml_read_node(state, state.scene->integrator, node);
+			xml_read_settings(state, state.scene->integrator, node);
 		}
 		else if(string_iequals(node.name(), "camera")) {
 			xml_read_camera(state, node);
@@ -691,10 +811,26 @@ void xml_read_file(Scene *scene, const char *filepath)
 	state.dicing_rate = 1.0f;
 	state.base = path_dirname(filepath);
 
+	xml_shader_hashes.clear();
 	xml_read_include(state, path_filename(filepath));
 
 	scene->params.bvh_type = SceneParams::BVH_STATIC;
 }
 
+void xml_update_file(Scene *scene, const char *filepath)
+{
+	XMLReadState state;
+
+	state.scene = scene;
+	state.tfm = transform_identity();
+	state.shader = scene->default_surface;
+	state.smooth = false;
+	state.dicing_rate = 1.0f;
+	state.base = path_dirname(filepath);
+	state.update = true;
+
+	xml_read_include(state, path_filename(filepath));
+}
+
 CCL_NAMESPACE_END
 
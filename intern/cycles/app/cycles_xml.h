@@ -23,6 +23,11 @@ class Scene;
 
 void xml_read_file(Scene *scene, const char *filepath);
 
+/* Apply an XML file to a scene read before. Shaders, lights and meshes with
+ * the name of existing ones modify them instead of adding new ones, and only
+ * what changed is tagged for update. */
+void xml_update_file(Scene *scene, const char *filepath);
+
 /* macros for importing */
 #define RAD2DEGF(_rad) ((_rad) * (float)(180.0 / M_PI))
 #define DEG2RADF(_deg) ((_deg) * (float)(M_PI / 180.0))
@@ -65,6 +65,9 @@ def _configure_argument_parser():
     parser.add_argument("--cycles-resumable-end-chunk",
                         help="End chunk to render",
                         default=None)
+    parser.add_argument("--cycles-print-stats",
+                        help="Print rendering statistics and a CPU kernel profile after rendering",
+                        action='store_true')
     return parser
 
 
@@ -92,6 +95,10 @@ def _parse_command_line():
                     int(args.cycles_resumable_start_chunk),
                     int(args.cycles_resumable_end_chunk))
 
+    if args.cycles_print_stats:
+        import _cycles
+        _cycles.enable_print_stats()
+
 
 def init():
     import bpy
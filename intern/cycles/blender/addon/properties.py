@@ -48,8 +48,10 @@ enum_displacement_methods = (
     )
 
 enum_bvh_layouts = (
+    ('AUTO', "Auto", "Use the widest layout supported by the device", 8),
     ('BVH2', "BVH2", "", 1),
     ('BVH4', "BVH4", "", 2),
+    ('BVH8', "BVH8", "", 4),
     )
 
 enum_bvh_types = (
@@ -288,6 +290,27 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
                 description="Sample all lights (for indirect samples), rather than randomly picking one",
                 default=True,
                 )
+        cls.use_adaptive_sampling = BoolProperty(
+                name="Adaptive Sampling",
+                description="Stop sampling pixels once their noise level is below the threshold, "
+                            "only supported for final renders on the CPU",
+                default=False,
+                )
+        cls.adaptive_threshold = FloatProperty(
+                name="Adaptive Threshold",
+                description="Noise level at which pixels stop receiving samples, "
+                            "zero chooses it automatically from the number of samples",
+                min=0.0, max=1.0,
+                default=0.0,
+                precision=4,
+                )
+        cls.adaptive_min_samples = IntProperty(
+                name="Adaptive Min Samples",
+                description="Minimum number of samples before a pixel can stop, "
+                            "zero chooses it automatically from the number of samples",
+                min=0, max=4096,
+                default=0,
+                )
         cls.light_sampling_threshold = FloatProperty(
                 name="Light Sampling Threshold",
                 description="Probabilistically terminate light samples when the light contribution is below this threshold (more noise but faster rendering). "
@@ -295,6 +318,12 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
                 min=0.0, max=1.0,
                 default=0.01,
                 )
+        cls.use_light_tree = BoolProperty(
+                name="Light Tree",
+                description="Pick lights by their estimated contribution to the shading point rather than by power alone, "
+                            "reducing noise in scenes with many lights (not used when sampling all lights)",
+                default=False,
+                )
 
         cls.caustics_reflective = BoolProperty(
                 name="Reflective Caustics",
@@ -539,6 +568,21 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
                 description="Use special type BVH optimized for hair (uses more ram but renders faster)",
                 default=True,
                 )
+        cls.bvh_cache_path = StringProperty(
+                name="BVH Cache Directory",
+                description="Directory to store built BVHs in, to load them again when rendering the same "
+                            "geometry in later frames or renders. Only skips building the BVH, "
+                            "meshes are still synced (leave empty to disable)",
+                default="",
+                subtype='DIR_PATH',
+                )
+        cls.use_compressed_geometry = BoolProperty(
+                name="Compress Geometry",
+                description="Store vertex normals and UV maps quantized, using less memory "
+                            "with a small loss of precision (UV maps spanning more than one UDIM tile "
+                            "are kept at full precision)",
+                default=False,
+                )
         cls.debug_bvh_time_steps = IntProperty(
                 name="BVH Time Steps",
                 description="Split BVH primitives by this number of time steps to speed up render time in cost of memory",
@@ -650,6 +694,14 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
             items=enum_texture_limit
             )
 
+        cls.texture_cache_size = IntProperty(
+            name="Texture Cache Size",
+            description="Load image textures on demand in tiles, keeping at most this many megabytes "
+                        "in memory (CPU only, 0 to load images fully)",
+            min=0, max=1024 * 1024,
+            default=0,
+            )
+
         cls.ao_bounces = IntProperty(
             name="AO Bounces",
             default=0,
@@ -679,9 +731,22 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
         cls.debug_bvh_layout = EnumProperty(
                 name="BVH Layout",
                 items=enum_bvh_layouts,
-                default='BVH4',
+                default='AUTO',
                 )
         cls.debug_use_cpu_split_kernel = BoolProperty(name="Split Kernel", default=False)
+        cls.debug_use_cpu_packet_traversal = BoolProperty(name="Packet Traversal", default=False)
+        cls.debug_use_cpu_numa_pinning = BoolProperty(
+                name="NUMA Pinning",
+                description="Pin render threads to NUMA nodes, filling one node after the other",
+                default=False,
+                )
+        cls.debug_use_cpu_numa_replication = BoolProperty(
+                name="NUMA Replication",
+                description="Copy scene data to the memory of each NUMA node, "
+                            "using more memory to avoid reading it from other processor sockets "
+                            "(implies NUMA Pinning)",
+                default=False,
+                )
 
         cls.debug_use_cuda_adaptive_compile = BoolProperty(name="Adaptive Compile", default=False)
         cls.debug_use_cuda_split_kernel = BoolProperty(name="Split Kernel", default=False)
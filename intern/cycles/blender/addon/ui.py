@@ -173,6 +173,10 @@ class CYCLES_RENDER_PT_sampling(CyclesButtonsPanel, Panel):
         sub.prop(cscene, "sample_clamp_indirect")
         sub.prop(cscene, "light_sampling_threshold")
 
+        subsub = sub.row(align=True)
+        subsub.active = not (use_branched_path(context) and use_sample_all_lights(context))
+        subsub.prop(cscene, "use_light_tree")
+
         if cscene.progressive == 'PATH' or use_branched_path(context) is False:
             col = split.column()
             sub = col.column(align=True)
@@ -205,6 +209,13 @@ class CYCLES_RENDER_PT_sampling(CyclesButtonsPanel, Panel):
 
         layout.row().prop(cscene, "sampling_pattern", text="Pattern")
 
+        row = layout.row()
+        row.prop(cscene, "use_adaptive_sampling")
+        sub = row.row(align=True)
+        sub.active = cscene.use_adaptive_sampling
+        sub.prop(cscene, "adaptive_threshold", text="Threshold")
+        sub.prop(cscene, "adaptive_min_samples", text="Min Samples")
+
         for rl in scene.render.layers:
             if rl.samples > 0:
                 layout.separator()
@@ -425,6 +436,7 @@ class CYCLES_RENDER_PT_performance(CyclesButtonsPanel, Panel):
         col.label(text="Final Render:")
         col.prop(rd, "use_save_buffers")
         col.prop(rd, "use_persistent_data", text="Persistent Images")
+        col.prop(cscene, "texture_cache_size", text="Texture Cache (MB)")
 
         col.separator()
 
@@ -436,6 +448,9 @@ class CYCLES_RENDER_PT_performance(CyclesButtonsPanel, Panel):
         row.active = not cscene.debug_use_spatial_splits
         row.prop(cscene, "debug_bvh_time_steps")
 
+        col.prop(cscene, "bvh_cache_path", text="Cache")
+        col.prop(cscene, "use_compressed_geometry")
+
         col = layout.column()
         col.label(text="Viewport Resolution:")
         split = col.split()
@@ -1625,6 +1640,11 @@ class CYCLES_RENDER_PT_debug(CyclesButtonsPanel, Panel):
         row.prop(cscene, "debug_use_cpu_avx2", toggle=True)
         col.prop(cscene, "debug_bvh_layout")
         col.prop(cscene, "debug_use_cpu_split_kernel")
+        col.prop(cscene, "debug_use_cpu_packet_traversal")
+        sub = col.column()
+        sub.active = not cscene.debug_use_cpu_numa_replication
+        sub.prop(cscene, "debug_use_cpu_numa_pinning")
+        col.prop(cscene, "debug_use_cpu_numa_replication")
 
         col.separator()
 
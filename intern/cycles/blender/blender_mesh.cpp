@@ -18,6 +18,7 @@
 #include "render/object.h"
 #include "render/scene.h"
 #include "render/camera.h"
+#include "render/stats.h"
 
 #include "blender/blender_sync.h"
 #include "blender/blender_session.h"
@@ -30,6 +31,7 @@
 #include "util/util_foreach.h"
 #include "util/util_logging.h"
 #include "util/util_math.h"
+#include "util/util_md5.h"
 
 #include "mikktspace.h"
 
@@ -984,7 +986,8 @@ static void create_subd_mesh(Scene *scene,
                              BL::Mesh& b_mesh,
                              const vector<Shader*>& used_shaders,
                              float dicing_rate,
-                             int max_subdivisions)
+                             int max_subdivisions,
+                             bool preview)
 {
 	BL::SubsurfModifier subsurf_mod(b_ob.modifiers[b_ob.modifiers.length()-1]);
 	bool subdivide_uvs = subsurf_mod.use_subsurf_uv();
@@ -1028,6 +1031,77 @@ static void create_subd_mesh(Scene *scene,
 	scene->dicing_camera->update(scene);
 	sdparams.camera = scene->dicing_camera;
 	sdparams.objecttoworld = get_transform(b_ob.matrix_world());
+
+	/* The viewport tessellates again on every camera change. */
+	sdparams.use_cache = preview;
+}
+
+/* Deduplication */
+
+static void md5_append_attributes(MD5Hash& md5, const AttributeSet& attributes)
+{
+	md5_append_value(md5, attributes.attributes.size());
+	foreach(const Attribute& attr, attributes.attributes) {
+		md5.append(attr.name.string());
+		md5_append_value(md5, attr.std);
+		md5_append_value(md5, attr.type);
+		md5_append_value(md5, attr.element);
+		md5_append_value(md5, attr.flags);
+		md5_append_value(md5, attr.buffer.size());
+		if(attr.buffer.size()) {
+			md5_append_data(md5, attr.data(), attr.buffer.size());
+		}
+	}
+}
+
+/* Hash of everything synced into the mesh, meshes with the same hash can
+ * be shared by their objects. */
+static string mesh_content_hash(const Mesh *mesh)
+{
+	MD5Hash md5;
+
+	md5_append_value(md5, mesh->geometry_flags);
+	md5_append_value(md5, mesh->subdivision_type);
+	md5_append_value(md5, mesh->volume_isovalue);
+	md5_append_value(md5, mesh->used_shaders.size());
+	foreach(const Shader *shader, mesh->used_shaders) {
+		md5_append_value(md5, shader);
+	}
+
+	md5_append_array(md5, mesh->verts);
+	md5_append_array(md5, mesh->triangles);
+	md5_append_array(md5, mesh->shader);
+	md5_append_array(md5, mesh->smooth);
+	md5_append_attributes(md5, mesh->attributes);
+
+	md5_append_array(md5, mesh->curve_keys);
+	md5_append_array(md5, mesh->curve_radius);
+	md5_append_array(md5, mesh->curve_first_key);
+	md5_append_array(md5, mesh->curve_shader);
+	md5_append_attributes(md5, mesh->curve_attributes);
+
+	return md5.get_hex();
+}
+
+static size_t mesh_memory_size(const Mesh *mesh)
+{
+	size_t size = mesh->verts.size()*sizeof(float3) +
+	              mesh->triangles.size()*sizeof(int) +
+	              mesh->shader.size()*sizeof(int) +
+	              mesh->smooth.size()*sizeof(bool) +
+	              mesh->curve_keys.size()*sizeof(float3) +
+	              mesh->curve_radius.size()*sizeof(float) +
+	              mesh->curve_first_key.size()*sizeof(int) +
+	              mesh->curve_shader.size()*sizeof(int);
+
+	foreach(const Attribute& attr, mesh->attributes.attributes) {
+		size += attr.buffer.size();
+	}
+	foreach(const Attribute& attr, mesh->curve_attributes.attributes) {
+		size += attr.buffer.size();
+	}
+
+	return size;
 }
 
 /* Sync */
@@ -1117,6 +1191,10 @@ Mesh *BlenderSync::sync_mesh(BL::Object& b_ob,
 	}
 	Mesh *mesh;
 
+	/* Modified meshes may deform differently per object with motion blur. */
+	bool deform_motion = scene->need_motion() != Scene::MOTION_NONE &&
+	                     key.ptr.data != b_ob_data.ptr.data;
+
 	if(!mesh_map.sync(&mesh, key)) {
 		/* if transform was applied to mesh, need full update */
 		if(object_updated && mesh->transform_applied);
@@ -1133,14 +1211,26 @@ Mesh *BlenderSync::sync_mesh(BL::Object& b_ob,
 				if(shader->need_update_mesh)
 					attribute_recalc = true;
 
-			if(!attribute_recalc)
-				return mesh;
+			if(!attribute_recalc) {
+				map<Mesh*, string>::iterator it = mesh_deduplicated.find(mesh);
+				if(it == mesh_deduplicated.end())
+					return sync_mesh_deduplicate(mesh, false);
+
+				/* deduplicated meshes are empty, use the mesh synced with
+				 * their content if there is one already, otherwise sync
+				 * again to find it */
+				Mesh *instance = sync_mesh_deduplicate_find(mesh, it->second);
+				if(instance && !deform_motion)
+					return instance;
+			}
 		}
 	}
 
 	/* ensure we only sync instanced meshes once */
-	if(mesh_synced.find(mesh) != mesh_synced.end())
-		return mesh;
+	if(mesh_synced.find(mesh) != mesh_synced.end()) {
+		map<Mesh*, Mesh*>::iterator it = mesh_instances.find(mesh);
+		return (it != mesh_instances.end())? it->second: mesh;
+	}
 
 	mesh_synced.insert(mesh);
 
@@ -1196,7 +1286,7 @@ Mesh *BlenderSync::sync_mesh(BL::Object& b_ob,
 			if(render_layer.use_surfaces && !hide_tris) {
 				if(mesh->subdivision_type != Mesh::SUBDIVISION_NONE)
 					create_subd_mesh(scene, mesh, b_ob, b_mesh, used_shaders,
-					                 dicing_rate, max_subdivisions);
+					                 dicing_rate, max_subdivisions, preview);
 				else
 					create_mesh(scene, mesh, b_mesh, used_shaders, false);
 
@@ -1228,7 +1318,130 @@ Mesh *BlenderSync::sync_mesh(BL::Object& b_ob,
 
 	mesh->tag_update(scene, rebuild);
 
-	return mesh;
+	if(deform_motion) {
+		mesh_hashes.erase(mesh);
+		return mesh;
+	}
+
+	return sync_mesh_deduplicate(mesh, true);
+}
+
+/* Objects share meshes only when Blender shares the mesh datablock, while
+ * copies of a mesh often end up with identical content. For final renders
+ * meshes are hashed after sync, and a mesh identical to one synced before
+ * is replaced by it, so they share device memory and BVH. The replaced mesh
+ * stays in the mesh map without geometry. While it is unchanged, later syncs
+ * use the mesh synced with its content, see sync_mesh_deduplicate_find().
+ * Returns the mesh to use for the object. */
+Mesh *BlenderSync::sync_mesh_deduplicate(Mesh *mesh, bool synced)
+{
+	if(preview) {
+		return mesh;
+	}
+
+	string hash;
+
+	if(synced) {
+		mesh_deduplicated.erase(mesh);
+
+		/* Adaptive subdivision is diced for the object. */
+		if(mesh->subdivision_type != Mesh::SUBDIVISION_NONE) {
+			mesh_hashes.erase(mesh);
+			return mesh;
+		}
+
+		hash = mesh_content_hash(mesh);
+		mesh_hashes[mesh] = hash;
+	}
+	else {
+		/* Unchanged mesh from an earlier sync, only usable as instance when
+		 * the object transform was not applied to it. */
+		map<Mesh*, string>::iterator it = mesh_hashes.find(mesh);
+		if(it == mesh_hashes.end() || mesh->transform_applied) {
+			return mesh;
+		}
+		hash = it->second;
+	}
+
+	pair<map<string, Mesh*>::iterator, bool> result =
+	        mesh_hash_map.insert(std::make_pair(hash, mesh));
+	Mesh *instance = result.first->second;
+
+	if(result.second || instance == mesh || !synced) {
+		return mesh;
+	}
+
+	/* Free geometry of the identical mesh. */
+	num_deduplicated_meshes++;
+	deduplicated_size += mesh_memory_size(mesh);
+
+	/* Keep shaders and geometry flags, so the next sync can tell whether
+	 * the mesh is still unchanged. */
+	vector<Shader*> used_shaders = mesh->used_shaders;
+	int geometry_flags = mesh->geometry_flags;
+
+	mesh->clear();
+	mesh->used_shaders = used_shaders;
+	mesh->geometry_flags = geometry_flags;
+	mesh->tag_update(scene, true);
+
+	mesh_hashes.erase(mesh);
+	mesh_deduplicated[mesh] = hash;
+	mesh_instances[mesh] = instance;
+
+	return instance;
+}
+
+/* Find the mesh to use for an unchanged deduplicated mesh. Only a mesh synced
+ * before in this sync is known to still have the content, otherwise returns
+ * NULL and the mesh has to be synced again. */
+Mesh *BlenderSync::sync_mesh_deduplicate_find(Mesh *mesh, const string& hash)
+{
+	map<string, Mesh*>::iterator it = mesh_hash_map.find(hash);
+	if(it == mesh_hash_map.end()) {
+		return NULL;
+	}
+
+	Mesh *instance = it->second;
+
+	if(mesh_instances.find(mesh) == mesh_instances.end()) {
+		num_deduplicated_meshes++;
+		deduplicated_size += mesh_memory_size(instance);
+		mesh_instances[mesh] = instance;
+	}
+
+	return instance;
+}
+
+/* Forget meshes removed from the scene. */
+void BlenderSync::sync_mesh_deduplicate_post()
+{
+	set<Mesh*> meshes(scene->meshes.begin(), scene->meshes.end());
+
+	for(map<Mesh*, string>::iterator it = mesh_hashes.begin(); it != mesh_hashes.end(); ) {
+		if(meshes.find(it->first) == meshes.end())
+			mesh_hashes.erase(it++);
+		else
+			++it;
+	}
+
+	for(map<Mesh*, string>::iterator it = mesh_deduplicated.begin(); it != mesh_deduplicated.end(); ) {
+		if(meshes.find(it->first) == meshes.end())
+			mesh_deduplicated.erase(it++);
+		else
+			++it;
+	}
+
+	if(num_deduplicated_meshes) {
+		VLOG(1) << "Deduplicated " << num_deduplicated_meshes << " meshes, saved "
+		        << string_human_readable_size(deduplicated_size) << ".";
+	}
+}
+
+void BlenderSync::collect_statistics(RenderStats *stats)
+{
+	stats->num_deduplicated_meshes = num_deduplicated_meshes;
+	stats->deduplicated_size = deduplicated_size;
 }
 
 void BlenderSync::sync_mesh_motion(BL::Object& b_ob,
@@ -524,6 +524,8 @@ void BlenderSync::sync_objects(float motion_time)
 		object_map.pre_sync();
 		particle_system_map.pre_sync();
 		motion_times.clear();
+		num_deduplicated_meshes = 0;
+		deduplicated_size = 0;
 	}
 	else {
 		mesh_motion_synced.clear();
@@ -639,6 +641,7 @@ void BlenderSync::sync_objects(float motion_time)
 			scene->light_manager->tag_update(scene);
 		if(mesh_map.post_sync())
 			scene->mesh_manager->tag_update(scene);
+		sync_mesh_deduplicate_post();
 		if(object_map.post_sync())
 			scene->object_manager->tag_update(scene);
 		if(particle_system_map.post_sync())
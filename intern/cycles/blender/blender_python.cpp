@@ -71,6 +71,9 @@ bool debug_flags_sync_from_scene(BL::Scene b_scene)
 	flags.cpu.sse2 = get_boolean(cscene, "debug_use_cpu_sse2");
 	flags.cpu.bvh_layout = (BVHLayout)get_enum(cscene, "debug_bvh_layout");
 	flags.cpu.split_kernel = get_boolean(cscene, "debug_use_cpu_split_kernel");
+	flags.cpu.packet_traversal = get_boolean(cscene, "debug_use_cpu_packet_traversal");
+	flags.cpu.numa_pinning = get_boolean(cscene, "debug_use_cpu_numa_pinning");
+	flags.cpu.numa_replication = get_boolean(cscene, "debug_use_cpu_numa_replication");
 	/* Synchronize CUDA flags. */
 	flags.cuda.adaptive_compile = get_boolean(cscene, "debug_use_cuda_adaptive_compile");
 	flags.cuda.split_kernel = get_boolean(cscene, "debug_use_cuda_split_kernel");
@@ -730,6 +733,12 @@ static PyObject *set_resumable_chunk_range_func(PyObject * /*self*/, PyObject *a
 	Py_RETURN_NONE;
 }
 
+static PyObject *enable_print_stats_func(PyObject * /*self*/, PyObject * /*args*/)
+{
+	BlenderSession::print_render_stats = true;
+	Py_RETURN_NONE;
+}
+
 static PyObject *get_device_types_func(PyObject * /*self*/, PyObject * /*args*/)
 {
 	vector<DeviceInfo>& devices = Device::available_devices();
@@ -772,6 +781,9 @@ static PyMethodDef methods[] = {
 	{"set_resumable_chunk", set_resumable_chunk_func, METH_VARARGS, ""},
 	{"set_resumable_chunk_range", set_resumable_chunk_range_func, METH_VARARGS, ""},
 
+	/* Render statistics */
+	{"enable_print_stats", enable_print_stats_func, METH_NOARGS, ""},
+
 	/* Compute Device selection */
 	{"get_device_types", get_device_types_func, METH_VARARGS, ""},
 
@@ -28,6 +28,7 @@
 #include "render/scene.h"
 #include "render/session.h"
 #include "render/shader.h"
+#include "render/stats.h"
 
 #include "util/util_color.h"
 #include "util/util_foreach.h"
@@ -48,6 +49,7 @@ int BlenderSession::num_resumable_chunks = 0;
 int BlenderSession::current_resumable_chunk = 0;
 int BlenderSession::start_resumable_chunk = 0;
 int BlenderSession::end_resumable_chunk = 0;
+bool BlenderSession::print_render_stats = false;
 
 BlenderSession::BlenderSession(BL::RenderEngine& b_engine,
                                BL::UserPreferences& b_userpref,
@@ -115,7 +117,7 @@ void BlenderSession::create()
 void BlenderSession::create_session()
 {
 	SessionParams session_params = BlenderSync::get_session_params(b_engine, b_userpref, b_scene, background);
-	SceneParams scene_params = BlenderSync::get_scene_params(b_scene, background);
+	SceneParams scene_params = BlenderSync::get_scene_params(b_data, b_scene, background);
 	bool session_pause = BlenderSync::get_session_pause(b_scene, background);
 
 	/* reset status/progress */
@@ -180,7 +182,7 @@ void BlenderSession::reset_session(BL::BlendData& b_data_, BL::Scene& b_scene_)
 	b_scene = b_scene_;
 
 	SessionParams session_params = BlenderSync::get_session_params(b_engine, b_userpref, b_scene, background);
-	SceneParams scene_params = BlenderSync::get_scene_params(b_scene, background);
+	SceneParams scene_params = BlenderSync::get_scene_params(b_data, b_scene, background);
 
 	width = render_resolution_x(b_render);
 	height = render_resolution_y(b_render);
@@ -428,6 +430,14 @@ void BlenderSession::render()
 		session->params.denoising_feature_strength = get_float(crl, "denoising_feature_strength");
 		session->params.denoising_relative_pca = get_boolean(crl, "denoising_relative_pca");
 
+		/* Convergence is only tested by the CPU device, other devices render
+		 * all samples. */
+		PointerRNA cscene = RNA_pointer_get(&b_scene.ptr, "cycles");
+		bool use_adaptive_sampling = get_boolean(cscene, "use_adaptive_sampling") &&
+		                             session_params.device.type == DEVICE_CPU;
+		buffer_params.adaptive_sampling_pass = use_adaptive_sampling;
+		scene->film->use_adaptive_sampling = use_adaptive_sampling;
+
 		scene->film->pass_alpha_threshold = b_layer_iter->pass_alpha_threshold();
 		scene->film->tag_passes_update(scene, passes);
 		scene->film->tag_update(scene);
@@ -476,6 +486,13 @@ void BlenderSession::render()
 			session->start();
 			session->wait();
 
+			if(!b_engine.is_preview() && print_render_stats) {
+				RenderStats stats;
+				session->collect_statistics(&stats);
+				sync->collect_statistics(&stats);
+				printf("Render statistics:\n%s\n", stats.full_report().c_str());
+			}
+
 			if(session->progress.get_cancel())
 				break;
 		}
@@ -748,7 +765,7 @@ void BlenderSession::synchronize()
 
 	/* on session/scene parameter changes, we recreate session entirely */
 	SessionParams session_params = BlenderSync::get_session_params(b_engine, b_userpref, b_scene, background);
-	SceneParams scene_params = BlenderSync::get_scene_params(b_scene, background);
+	SceneParams scene_params = BlenderSync::get_scene_params(b_data, b_scene, background);
 	bool session_pause = BlenderSync::get_session_pause(b_scene, background);
 
 	if(session->params.modified(session_params) ||
@@ -143,6 +143,9 @@ public:
 	static int start_resumable_chunk;
 	static int end_resumable_chunk;
 
+	/* Print render statistics to the console after rendering each view. */
+	static bool print_render_stats;
+
 protected:
 	void do_write_update_render_result(BL::RenderResult& b_rr,
 	                                   BL::RenderLayer& b_rlay,
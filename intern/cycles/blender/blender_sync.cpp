@@ -56,6 +56,8 @@ BlenderSync::BlenderSync(BL::RenderEngine& b_engine,
   mesh_map(&scene->meshes),
   light_map(&scene->lights),
   particle_system_map(&scene->particle_systems),
+  num_deduplicated_meshes(0),
+  deduplicated_size(0),
   world_map(NULL),
   world_recalc(false),
   scene(scene),
@@ -203,6 +205,8 @@ void BlenderSync::sync_data(BL::RenderSettings& b_render,
 	sync_curve_settings();
 
 	mesh_synced.clear(); /* use for objects and motion sync */
+	mesh_instances.clear();
+	mesh_hash_map.clear();
 
 	if(scene->need_motion() == Scene::MOTION_PASS ||
 	   scene->need_motion() == Scene::MOTION_NONE ||
@@ -216,6 +220,8 @@ void BlenderSync::sync_data(BL::RenderSettings& b_render,
 	            python_thread_state);
 
 	mesh_synced.clear();
+	mesh_instances.clear();
+	mesh_hash_map.clear();
 }
 
 /* Integrator */
@@ -284,6 +290,10 @@ void BlenderSync::sync_integrator()
 	integrator->sample_all_lights_direct = get_boolean(cscene, "sample_all_lights_direct");
 	integrator->sample_all_lights_indirect = get_boolean(cscene, "sample_all_lights_indirect");
 	integrator->light_sampling_threshold = get_float(cscene, "light_sampling_threshold");
+	integrator->use_light_tree = get_boolean(cscene, "use_light_tree");
+
+	integrator->adaptive_threshold = get_float(cscene, "adaptive_threshold");
+	integrator->adaptive_min_samples = get_int(cscene, "adaptive_min_samples");
 
 	int diffuse_samples = get_int(cscene, "diffuse_samples");
 	int glossy_samples = get_int(cscene, "glossy_samples");
@@ -621,7 +631,8 @@ array<Pass> BlenderSync::sync_render_passes(BL::RenderLayer& b_rlay,
 
 /* Scene Parameters */
 
-SceneParams BlenderSync::get_scene_params(BL::Scene& b_scene,
+SceneParams BlenderSync::get_scene_params(BL::BlendData& b_data,
+                                          BL::Scene& b_scene,
                                           bool background)
 {
 	BL::RenderSettings r = b_scene.render();
@@ -642,6 +653,10 @@ SceneParams BlenderSync::get_scene_params(BL::Scene& b_scene,
 	params.use_bvh_spatial_split = RNA_boolean_get(&cscene, "debug_use_spatial_splits");
 	params.use_bvh_unaligned_nodes = RNA_boolean_get(&cscene, "debug_use_hair_bvh");
 	params.num_bvh_time_steps = RNA_int_get(&cscene, "debug_bvh_time_steps");
+	params.bvh_cache_path = blender_absolute_path(b_data,
+	                                              b_scene,
+	                                              get_string(cscene, "bvh_cache_path"));
+	params.use_compressed_geometry = RNA_boolean_get(&cscene, "use_compressed_geometry");
 
 	if(background && params.shadingsystem != SHADINGSYSTEM_OSL)
 		params.persistent_data = r.use_persistent_data();
@@ -662,6 +677,8 @@ SceneParams BlenderSync::get_scene_params(BL::Scene& b_scene,
 		params.texture_limit = 0;
 	}
 
+	params.texture_cache_size = (size_t)RNA_int_get(&cscene, "texture_cache_size") * 1024 * 1024;
+
 	params.bvh_layout = DebugFlags().cpu.bvh_layout;
 
 	return params;
@@ -696,6 +713,9 @@ SessionParams BlenderSync::get_session_params(BL::RenderEngine& b_engine,
 	/* Background */
 	params.background = background;
 
+	/* Profiling for the statistics printed after rendering. */
+	params.use_profiling = background && BlenderSession::print_render_stats;
+
 	/* device type */
 	vector<DeviceInfo>& devices = Device::available_devices();
 	
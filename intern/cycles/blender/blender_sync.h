@@ -42,6 +42,7 @@ class Light;
 class Mesh;
 class Object;
 class ParticleSystem;
+class RenderStats;
 class Scene;
 class Shader;
 class ShaderGraph;
@@ -81,7 +82,8 @@ public:
 	inline int get_layer_bound_samples() { return render_layer.bound_samples; }
 
 	/* get parameters */
-	static SceneParams get_scene_params(BL::Scene& b_scene,
+	static SceneParams get_scene_params(BL::BlendData& b_data,
+	                                    BL::Scene& b_scene,
 	                                    bool background);
 	static SessionParams get_session_params(BL::RenderEngine& b_engine,
 	                                        BL::UserPreferences& b_userpref,
@@ -97,6 +99,9 @@ public:
 	static PassType get_pass_type(BL::RenderPass& b_pass);
 	static int get_denoising_pass(BL::RenderPass& b_pass);
 
+	/* Statistics of the last sync, added to the render statistics. */
+	void collect_statistics(RenderStats *stats);
+
 private:
 	/* sync */
 	void sync_lamps(bool update_all);
@@ -114,6 +119,9 @@ private:
 
 	void sync_nodes(Shader *shader, BL::ShaderNodeTree& b_ntree);
 	Mesh *sync_mesh(BL::Object& b_ob, bool object_updated, bool hide_tris);
+	Mesh *sync_mesh_deduplicate(Mesh *mesh, bool synced);
+	Mesh *sync_mesh_deduplicate_find(Mesh *mesh, const string& hash);
+	void sync_mesh_deduplicate_post();
 	void sync_curves(Mesh *mesh,
 	                 BL::Mesh& b_mesh,
 	                 BL::Object& b_ob,
@@ -169,6 +177,14 @@ private:
 	id_map<ParticleSystemKey, ParticleSystem> particle_system_map;
 	set<Mesh*> mesh_synced;
 	set<Mesh*> mesh_motion_synced;
+	/* Meshes with identical content, which are replaced by the first one
+	 * synced with that content and kept empty, see sync_mesh_deduplicate(). */
+	map<string, Mesh*> mesh_hash_map;
+	map<Mesh*, Mesh*> mesh_instances;
+	map<Mesh*, string> mesh_hashes;
+	map<Mesh*, string> mesh_deduplicated;
+	int num_deduplicated_meshes;
+	size_t deduplicated_size;
 	set<float> motion_times;
 	void *world_map;
 	bool world_recalc;
@@ -22,6 +22,7 @@
 
 #include "bvh/bvh2.h"
 #include "bvh/bvh4.h"
+#include "bvh/bvh8.h"
 #include "bvh/bvh_build.h"
 #include "bvh/bvh_node.h"
 
@@ -38,6 +39,8 @@ const char *bvh_layout_name(BVHLayout layout)
 	switch(layout) {
 		case BVH_LAYOUT_BVH2: return "BVH2";
 		case BVH_LAYOUT_BVH4: return "BVH4";
+		case BVH_LAYOUT_BVH8: return "BVH8";
+		case BVH_LAYOUT_AUTO: return "AUTO";
 		case BVH_LAYOUT_NONE: return "NONE";
 		case BVH_LAYOUT_ALL:  return "ALL";
 	}
@@ -48,6 +51,12 @@ const char *bvh_layout_name(BVHLayout layout)
 BVHLayout BVHParams::best_bvh_layout(BVHLayout requested_layout,
                                      BVHLayoutMask supported_layouts)
 {
+	/* Automatic layout prefers the widest one, the same fallback as for an
+	 * explicitly requested layout the device does not support applies.
+	 */
+	if(requested_layout == BVH_LAYOUT_AUTO) {
+		requested_layout = BVH_LAYOUT_BVH8;
+	}
 	const BVHLayoutMask requested_layout_mask = (BVHLayoutMask)requested_layout;
 	/* Check whether requested layout is supported, if so -- no need to do
 	 * any extra computation.
@@ -81,7 +90,13 @@ int BVHStackEntry::encodeIdx() const
 /* BVH */
 
 BVH::BVH(const BVHParams& params_, const vector<Object*>& objects_)
-: params(params_), objects(objects_)
+: params(params_),
+  objects(objects_),
+  num_refits(0),
+  nodes_area(0.0f),
+  root_area(0.0f),
+  build_cost(0.0f),
+  refit_cost(0.0f)
 {
 }
 
@@ -92,6 +107,9 @@ BVH *BVH::create(const BVHParams& params, const vector<Object*>& objects)
 			return new BVH2(params, objects);
 		case BVH_LAYOUT_BVH4:
 			return new BVH4(params, objects);
+		case BVH_LAYOUT_BVH8:
+			return new BVH8(params, objects);
+		case BVH_LAYOUT_AUTO:
 		case BVH_LAYOUT_NONE:
 		case BVH_LAYOUT_ALL:
 			break;
@@ -121,6 +139,20 @@ void BVH::build(Progress& progress)
 		return;
 	}
 
+	/* Adjust primitive index to point to the triangle in the global array, for
+	 * meshes with transform applied and already in the top level BVH.
+	 */
+	if(params.top_level) {
+		for(size_t i = 0; i < pack.prim_index.size(); i++) {
+			if(pack.prim_index[i] != -1) {
+				if(pack.prim_type[i] & PRIMITIVE_ALL_CURVE)
+					pack.prim_index[i] += objects[pack.prim_object[i]]->mesh->curve_offset;
+				else
+					pack.prim_index[i] += objects[pack.prim_object[i]]->mesh->tri_offset;
+			}
+		}
+	}
+
 	/* pack triangles */
 	progress.set_substatus("Packing BVH triangles and strands");
 	pack_primitives();
@@ -132,8 +164,14 @@ void BVH::build(Progress& progress)
 
 	/* pack nodes */
 	progress.set_substatus("Packing BVH nodes");
+	nodes_area = 0.0f;
+	root_area = root->bounds.safe_area();
 	pack_nodes(root);
 
+	build_cost = nodes_cost();
+	refit_cost = build_cost;
+	num_refits = 0;
+
 	/* free build nodes */
 	root->deleteSubtree();
 }
@@ -148,7 +186,21 @@ void BVH::refit(Progress& progress)
 	if(progress.get_cancel()) return;
 
 	progress.set_substatus("Refitting BVH nodes");
+	nodes_area = 0.0f;
 	refit_nodes();
+
+	refit_cost = nodes_cost();
+	num_refits++;
+}
+
+float BVH::nodes_cost() const
+{
+	return (root_area > 0.0f)? nodes_area / root_area: 0.0f;
+}
+
+float BVH::refit_cost_ratio() const
+{
+	return (build_cost > 0.0f)? refit_cost / build_cost: 1.0f;
 }
 
 void BVH::refit_primitives(int start, int end, BoundBox& bbox, uint& visibility)
@@ -227,6 +279,9 @@ void BVH::pack_triangle(int idx, float4 tri_verts[3])
 	const Mesh *mesh = objects[tob]->mesh;
 
 	int tidx = pack.prim_index[idx];
+	if(params.top_level) {
+		tidx -= mesh->tri_offset;
+	}
 	Mesh::Triangle t = mesh->get_triangle(tidx);
 	const float3 *vpos = &mesh->verts[0];
 	float3 v0 = vpos[t.v[0]];
@@ -285,25 +340,28 @@ void BVH::pack_primitives()
 
 /* Pack Instances */
 
+bool BVH::pack_has_instances() const
+{
+	for(size_t i = 0; i < pack.object_node.size(); i++) {
+		if(pack.object_node[i] != 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
 void BVH::pack_instances(size_t nodes_size, size_t leaf_nodes_size)
 {
 	/* The BVH's for instances are built separately, but for traversal all
 	 * BVH's are stored in global arrays. This function merges them into the
 	 * top level BVH, adjusting indexes and offsets where appropriate.
 	 */
-	/* TODO(sergey): This code needs adjustment for wider BVH than 4. */
 	const bool use_qbvh = (params.bvh_layout == BVH_LAYOUT_BVH4);
+	const bool use_obvh = (params.bvh_layout == BVH_LAYOUT_BVH8);
 
-	/* Adjust primitive index to point to the triangle in the global array, for
-	 * meshes with transform applied and already in the top level BVH.
+	/* NOTE: Primitive indices of the top level BVH itself are already made
+	 * global in build(), so they are also valid for refit_primitives().
 	 */
-	for(size_t i = 0; i < pack.prim_index.size(); i++)
-		if(pack.prim_index[i] != -1) {
-			if(pack.prim_type[i] & PRIMITIVE_ALL_CURVE)
-				pack.prim_index[i] += objects[pack.prim_object[i]]->mesh->curve_offset;
-			else
-				pack.prim_index[i] += objects[pack.prim_object[i]]->mesh->tri_offset;
-		}
 
 	/* track offsets of instanced BVH data in global array */
 	size_t prim_offset = pack.prim_index.size();
@@ -469,14 +527,26 @@ void BVH::pack_instances(size_t nodes_size, size_t leaf_nodes_size)
 			for(size_t i = 0, j = 0; i < bvh_nodes_size; j++) {
 				size_t nsize, nsize_bbox;
 				if(bvh_nodes[i].x & PATH_RAY_NODE_UNALIGNED) {
-					nsize = use_qbvh
-					            ? BVH_UNALIGNED_QNODE_SIZE
-					            : BVH_UNALIGNED_NODE_SIZE;
-					nsize_bbox = (use_qbvh)? 13: 0;
+					if(use_obvh) {
+						nsize = BVH_UNALIGNED_ONODE_SIZE;
+						nsize_bbox = BVH_UNALIGNED_ONODE_SIZE-2;
+					}
+					else {
+						nsize = use_qbvh
+						            ? BVH_UNALIGNED_QNODE_SIZE
+						            : BVH_UNALIGNED_NODE_SIZE;
+						nsize_bbox = (use_qbvh)? 13: 0;
+					}
 				}
 				else {
-					nsize = (use_qbvh)? BVH_QNODE_SIZE: BVH_NODE_SIZE;
-					nsize_bbox = (use_qbvh)? 7: 0;
+					if(use_obvh) {
+						nsize = BVH_ONODE_SIZE;
+						nsize_bbox = BVH_ONODE_SIZE-2;
+					}
+					else {
+						nsize = (use_qbvh)? BVH_QNODE_SIZE: BVH_NODE_SIZE;
+						nsize_bbox = (use_qbvh)? 7: 0;
+					}
 				}
 
 				memcpy(pack_nodes + pack_nodes_offset,
@@ -489,9 +559,21 @@ void BVH::pack_instances(size_t nodes_size, size_t leaf_nodes_size)
 				data.z += (data.z < 0)? -noffset_leaf: noffset;
 				data.w += (data.w < 0)? -noffset_leaf: noffset;
 
-				if(use_qbvh) {
+				if(use_qbvh || use_obvh) {
+					data.x += (data.x < 0)? -noffset_leaf: noffset;
+					data.y += (data.y < 0)? -noffset_leaf: noffset;
+				}
+
+				if(use_obvh) {
+					/* Octo nodes store child indices in two int4. */
+					pack_nodes[pack_nodes_offset + nsize_bbox] = data;
+					nsize_bbox++;
+
+					data = bvh_nodes[i + nsize_bbox];
 					data.x += (data.x < 0)? -noffset_leaf: noffset;
 					data.y += (data.y < 0)? -noffset_leaf: noffset;
+					data.z += (data.z < 0)? -noffset_leaf: noffset;
+					data.w += (data.w < 0)? -noffset_leaf: noffset;
 				}
 
 				pack_nodes[pack_nodes_offset + nsize_bbox] = data;
@@ -88,9 +88,31 @@ public:
 	void build(Progress& progress);
 	void refit(Progress& progress);
 
+	/* Estimated cost of the tree after the last refit relative to the cost
+	 * right after build. Refitting keeps topology of the tree, so it gets
+	 * worse with every deformation, values above 1 mean degraded quality.
+	 */
+	float refit_cost_ratio() const;
+
+	/* Number of times the tree was refit since it was built. */
+	int num_refits;
+
 protected:
+	friend class BVHCache;
+
 	BVH(const BVHParams& params, const vector<Object*>& objects);
 
+	/* Tree cost estimation, which is the sum of surface areas of all children
+	 * of inner nodes relative to the surface area of the root. Children areas
+	 * are accumulated by the subclasses when packing and refitting nodes.
+	 */
+	float nodes_area;
+	float root_area;
+	float build_cost;
+	float refit_cost;
+
+	float nodes_cost() const;
+
 	/* Refit range of primitives. */
 	void refit_primitives(int start, int end, BoundBox& bbox, uint& visibility);
 
@@ -100,6 +122,7 @@ protected:
 
 	/* merge instance BVH's */
 	void pack_instances(size_t nodes_size, size_t leaf_nodes_size);
+	bool pack_has_instances() const;
 
 	/* for subclasses to implement */
 	virtual void pack_nodes(const BVHNode *root) = 0;
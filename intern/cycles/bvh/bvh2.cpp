@@ -65,6 +65,7 @@ void BVH2::pack_inner(const BVHStackEntry& e,
                       const BVHStackEntry& e0,
                       const BVHStackEntry& e1)
 {
+	nodes_area += e0.node->bounds.safe_area() + e1.node->bounds.safe_area();
 	if(e0.node->is_unaligned || e1.node->is_unaligned) {
 		pack_unaligned_inner(e, e0, e1);
 	} else {
@@ -237,11 +238,15 @@ void BVH2::pack_nodes(const BVHNode *root)
 
 void BVH2::refit_nodes()
 {
-	assert(!params.top_level);
+	/* Top level BVH can only be refit when there are no instances merged in,
+	 * their nodes are not refit here.
+	 */
+	assert(!params.top_level || !pack_has_instances());
 
 	BoundBox bbox = BoundBox::empty;
 	uint visibility = 0;
 	refit_node(0, (pack.root_index == -1)? true: false, bbox, visibility);
+	root_area = bbox.safe_area();
 }
 
 void BVH2::refit_node(int idx, bool leaf, BoundBox& bbox, uint& visibility)
@@ -276,6 +281,7 @@ void BVH2::refit_node(int idx, bool leaf, BoundBox& bbox, uint& visibility)
 
 		refit_node((c0 < 0)? -c0-1: c0, (c0 < 0), bbox0, visibility0);
 		refit_node((c1 < 0)? -c1-1: c1, (c1 < 0), bbox1, visibility1);
+		nodes_area += bbox0.safe_area() + bbox1.safe_area();
 
 		if(is_unaligned) {
 			Transform aligned_space = transform_identity();
@@ -84,6 +84,10 @@ void BVH4::pack_inner(const BVHStackEntry& e,
                       const BVHStackEntry *en,
                       int num)
 {
+	for(int i = 0; i < num; i++) {
+		nodes_area += en[i].node->bounds.safe_area();
+	}
+
 	bool has_unaligned = false;
 	/* Check whether we have to create unaligned node or all nodes are aligned
 	 * and we can cut some corner here.
@@ -365,11 +369,15 @@ void BVH4::pack_nodes(const BVHNode *root)
 
 void BVH4::refit_nodes()
 {
-	assert(!params.top_level);
+	/* Top level BVH can only be refit when there are no instances merged in,
+	 * their nodes are not refit here.
+	 */
+	assert(!params.top_level || !pack_has_instances());
 
 	BoundBox bbox = BoundBox::empty;
 	uint visibility = 0;
 	refit_node(0, (pack.root_index == -1)? true: false, bbox, visibility);
+	root_area = bbox.safe_area();
 }
 
 void BVH4::refit_node(int idx, bool leaf, BoundBox& bbox, uint& visibility)
@@ -421,6 +429,7 @@ void BVH4::refit_node(int idx, bool leaf, BoundBox& bbox, uint& visibility)
 				refit_node((c[i] < 0)? -c[i]-1: c[i], (c[i] < 0),
 				           child_bbox[i], child_visibility[i]);
 				++num_nodes;
+				nodes_area += child_bbox[i].safe_area();
 				bbox.grow(child_bbox[i]);
 				visibility |= child_visibility[i];
 			}
@@ -0,0 +1,459 @@
+/*
+ * Adapted from code copyright 2009-2010 NVIDIA Corporation
+ * Modifications Copyright 2011-2018, Blender Foundation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bvh/bvh8.h"
+
+#include "render/mesh.h"
+#include "render/object.h"
+
+#include "bvh/bvh_node.h"
+#include "bvh/bvh_unaligned.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Number of rows of 8 floats in the packed nodes, see BVH8 description. */
+#define BVH_ONODE_ALIGNED_ROWS   7
+#define BVH_ONODE_UNALIGNED_ROWS 13
+
+/* Collect children of the octo node, which are gathered from up to three
+ * levels of the binary tree.
+ *
+ * NOTE: Must be kept in sync with BVH_STAT_ONODE_COUNT.
+ */
+static int obvh_node_children(const BVHNode *node, const BVHNode *nodes[8])
+{
+	int num_nodes = 0;
+	for(int i = 0; i < node->num_children(); i++) {
+		const BVHNode *child = node->get_child(i);
+		if(child->is_leaf()) {
+			nodes[num_nodes++] = child;
+			continue;
+		}
+		for(int j = 0; j < child->num_children(); j++) {
+			const BVHNode *grandchild = child->get_child(j);
+			if(grandchild->is_leaf()) {
+				nodes[num_nodes++] = grandchild;
+			}
+			else {
+				nodes[num_nodes++] = grandchild->get_child(0);
+				nodes[num_nodes++] = grandchild->get_child(1);
+			}
+		}
+	}
+	return num_nodes;
+}
+
+static bool node_obvh_is_unaligned(const BVHNode *node)
+{
+	const BVHNode *nodes[8];
+	const int num_nodes = obvh_node_children(node, nodes);
+	for(int i = 0; i < num_nodes; i++) {
+		if(nodes[i]->is_unaligned) {
+			return true;
+		}
+	}
+	return false;
+}
+
+BVH8::BVH8(const BVHParams& params_, const vector<Object*>& objects_)
+: BVH(params_, objects_)
+{
+	params.bvh_layout = BVH_LAYOUT_BVH8;
+}
+
+void BVH8::pack_leaf(const BVHStackEntry& e, const LeafNode *leaf)
+{
+	float4 data[BVH_ONODE_LEAF_SIZE];
+	memset(data, 0, sizeof(data));
+	if(leaf->num_triangles() == 1 && pack.prim_index[leaf->lo] == -1) {
+		/* object */
+		data[0].x = __int_as_float(~(leaf->lo));
+		data[0].y = __int_as_float(0);
+	}
+	else {
+		/* triangle */
+		data[0].x = __int_as_float(leaf->lo);
+		data[0].y = __int_as_float(leaf->hi);
+	}
+	data[0].z = __uint_as_float(leaf->visibility);
+	if(leaf->num_triangles() != 0) {
+		data[0].w = __uint_as_float(pack.prim_type[leaf->lo]);
+	}
+
+	memcpy(&pack.leaf_nodes[e.idx], data, sizeof(float4)*BVH_ONODE_LEAF_SIZE);
+}
+
+void BVH8::pack_inner(const BVHStackEntry& e,
+                      const BVHStackEntry *en,
+                      int num)
+{
+	for(int i = 0; i < num; i++) {
+		nodes_area += en[i].node->bounds.safe_area();
+	}
+
+	bool has_unaligned = false;
+	/* Check whether we have to create unaligned node or all nodes are aligned
+	 * and we can cut some corner here.
+	 */
+	if(params.use_unaligned_nodes) {
+		for(int i = 0; i < num; i++) {
+			if(en[i].node->is_unaligned) {
+				has_unaligned = true;
+				break;
+			}
+		}
+	}
+	if(has_unaligned) {
+		/* Create unaligned node with orientation transform for each of the
+		 * children.
+		 */
+		pack_unaligned_inner(e, en, num);
+	}
+	else {
+		/* There's no unaligned children, pack into AABB node. */
+		pack_aligned_inner(e, en, num);
+	}
+}
+
+void BVH8::pack_aligned_inner(const BVHStackEntry& e,
+                              const BVHStackEntry *en,
+                              int num)
+{
+	BoundBox bounds[8];
+	int child[8];
+	for(int i = 0; i < num; ++i) {
+		bounds[i] = en[i].node->bounds;
+		child[i] = en[i].encodeIdx();
+	}
+	pack_aligned_node(e.idx,
+	                  bounds,
+	                  child,
+	                  e.node->visibility,
+	                  e.node->time_from,
+	                  e.node->time_to,
+	                  num);
+}
+
+void BVH8::pack_aligned_node(int idx,
+                             const BoundBox *bounds,
+                             const int *child,
+                             const uint visibility,
+                             const float time_from,
+                             const float time_to,
+                             const int num)
+{
+	float4 data[BVH_ONODE_SIZE];
+	memset(data, 0, sizeof(data));
+
+	data[0].x = __uint_as_float(visibility & ~PATH_RAY_NODE_UNALIGNED);
+	data[0].y = time_from;
+	data[0].z = time_to;
+
+	/* Rows of 8 floats, one value per child. */
+	float (*rows)[8] = (float (*)[8])&data[2];
+
+	for(int i = 0; i < num; i++) {
+		float3 bb_min = bounds[i].min;
+		float3 bb_max = bounds[i].max;
+
+		rows[0][i] = bb_min.x;
+		rows[1][i] = bb_max.x;
+		rows[2][i] = bb_min.y;
+		rows[3][i] = bb_max.y;
+		rows[4][i] = bb_min.z;
+		rows[5][i] = bb_max.z;
+
+		rows[6][i] = __int_as_float(child[i]);
+	}
+
+	for(int i = num; i < 8; i++) {
+		/* We store BB which would never be recorded as intersection
+		 * so kernel might safely assume there are always 8 child nodes.
+		 */
+		rows[0][i] = FLT_MAX;
+		rows[1][i] = -FLT_MAX;
+
+		rows[2][i] = FLT_MAX;
+		rows[3][i] = -FLT_MAX;
+
+		rows[4][i] = FLT_MAX;
+		rows[5][i] = -FLT_MAX;
+
+		rows[6][i] = __int_as_float(0);
+	}
+
+	memcpy(&pack.nodes[idx], data, sizeof(float4)*BVH_ONODE_SIZE);
+}
+
+void BVH8::pack_unaligned_inner(const BVHStackEntry& e,
+                                const BVHStackEntry *en,
+                                int num)
+{
+	Transform aligned_space[8];
+	BoundBox bounds[8];
+	int child[8];
+	for(int i = 0; i < num; ++i) {
+		aligned_space[i] = en[i].node->get_aligned_space();
+		bounds[i] = en[i].node->bounds;
+		child[i] = en[i].encodeIdx();
+	}
+	pack_unaligned_node(e.idx,
+	                    aligned_space,
+	                    bounds,
+	                    child,
+	                    e.node->visibility,
+	                    e.node->time_from,
+	                    e.node->time_to,
+	                    num);
+}
+
+void BVH8::pack_unaligned_node(int idx,
+                               const Transform *aligned_space,
+                               const BoundBox *bounds,
+                               const int *child,
+                               const uint visibility,
+                               const float time_from,
+                               const float time_to,
+                               const int num)
+{
+	float4 data[BVH_UNALIGNED_ONODE_SIZE];
+	memset(data, 0, sizeof(data));
+
+	data[0].x = __uint_as_float(visibility | PATH_RAY_NODE_UNALIGNED);
+	data[0].y = time_from;
+	data[0].z = time_to;
+
+	/* Rows of 8 floats, one value per child. */
+	float (*rows)[8] = (float (*)[8])&data[2];
+
+	for(int i = 0; i < num; i++) {
+		Transform space = BVHUnaligned::compute_node_transform(
+		        bounds[i],
+		        aligned_space[i]);
+
+		rows[0][i] = space.x.x;
+		rows[1][i] = space.x.y;
+		rows[2][i] = space.x.z;
+
+		rows[3][i] = space.y.x;
+		rows[4][i] = space.y.y;
+		rows[5][i] = space.y.z;
+
+		rows[6][i] = space.z.x;
+		rows[7][i] = space.z.y;
+		rows[8][i] = space.z.z;
+
+		rows[9][i] = space.x.w;
+		rows[10][i] = space.y.w;
+		rows[11][i] = space.z.w;
+
+		rows[12][i] = __int_as_float(child[i]);
+	}
+
+	for(int i = num; i < 8; i++) {
+		/* We store BB which would never be recorded as intersection
+		 * so kernel might safely assume there are always 8 child nodes.
+		 */
+		for(int row = 0; row < BVH_ONODE_UNALIGNED_ROWS - 1; row++) {
+			rows[row][i] = NAN;
+		}
+		rows[12][i] = __int_as_float(0);
+	}
+
+	memcpy(&pack.nodes[idx], data, sizeof(float4)*BVH_UNALIGNED_ONODE_SIZE);
+}
+
+/* Octo SIMD Nodes */
+
+void BVH8::pack_nodes(const BVHNode *root)
+{
+	/* Calculate size of the arrays required. */
+	const size_t num_nodes = root->getSubtreeSize(BVH_STAT_ONODE_COUNT);
+	const size_t num_leaf_nodes = root->getSubtreeSize(BVH_STAT_LEAF_COUNT);
+	assert(num_leaf_nodes <= num_nodes);
+	const size_t num_inner_nodes = num_nodes - num_leaf_nodes;
+	size_t node_size;
+	if(params.use_unaligned_nodes) {
+		const size_t num_unaligned_nodes =
+		        root->getSubtreeSize(BVH_STAT_UNALIGNED_INNER_ONODE_COUNT);
+		node_size = (num_unaligned_nodes * BVH_UNALIGNED_ONODE_SIZE) +
+		            (num_inner_nodes - num_unaligned_nodes) * BVH_ONODE_SIZE;
+	}
+	else {
+		node_size = num_inner_nodes * BVH_ONODE_SIZE;
+	}
+	/* Resize arrays. */
+	pack.nodes.clear();
+	pack.leaf_nodes.clear();
+	/* For top level BVH, first merge existing BVH's so we know the offsets. */
+	if(params.top_level) {
+		pack_instances(node_size, num_leaf_nodes*BVH_ONODE_LEAF_SIZE);
+	}
+	else {
+		pack.nodes.resize(node_size);
+		pack.leaf_nodes.resize(num_leaf_nodes*BVH_ONODE_LEAF_SIZE);
+	}
+
+	int nextNodeIdx = 0, nextLeafNodeIdx = 0;
+
+	vector<BVHStackEntry> stack;
+	stack.reserve(BVHParams::MAX_DEPTH*2);
+	if(root->is_leaf()) {
+		stack.push_back(BVHStackEntry(root, nextLeafNodeIdx++));
+	}
+	else {
+		stack.push_back(BVHStackEntry(root, nextNodeIdx));
+		nextNodeIdx += (params.use_unaligned_nodes &&
+		                node_obvh_is_unaligned(root))
+		                       ? BVH_UNALIGNED_ONODE_SIZE
+		                       : BVH_ONODE_SIZE;
+	}
+
+	while(stack.size()) {
+		BVHStackEntry e = stack.back();
+		stack.pop_back();
+
+		if(e.node->is_leaf()) {
+			/* leaf node */
+			const LeafNode *leaf = reinterpret_cast<const LeafNode*>(e.node);
+			pack_leaf(e, leaf);
+		}
+		else {
+			/* Inner node. */
+			/* Collect nodes. */
+			const BVHNode *nodes[8];
+			int numnodes = obvh_node_children(e.node, nodes);
+			/* Push entries on the stack. */
+			for(int i = 0; i < numnodes; ++i) {
+				int idx;
+				if(nodes[i]->is_leaf()) {
+					idx = nextLeafNodeIdx++;
+				}
+				else {
+					idx = nextNodeIdx;
+					nextNodeIdx += (params.use_unaligned_nodes &&
+					                node_obvh_is_unaligned(nodes[i]))
+					                       ? BVH_UNALIGNED_ONODE_SIZE
+					                       : BVH_ONODE_SIZE;
+				}
+				stack.push_back(BVHStackEntry(nodes[i], idx));
+			}
+			/* Set node. */
+			pack_inner(e, &stack[stack.size()-numnodes], numnodes);
+		}
+	}
+	assert(node_size == nextNodeIdx);
+	/* Root index to start traversal at, to handle case of single leaf node. */
+	pack.root_index = (root->is_leaf())? -1: 0;
+}
+
+void BVH8::refit_nodes()
+{
+	/* Top level BVH can only be refit when there are no instances merged in,
+	 * their nodes are not refit here.
+	 */
+	assert(!params.top_level || !pack_has_instances());
+
+	BoundBox bbox = BoundBox::empty;
+	uint visibility = 0;
+	refit_node(0, (pack.root_index == -1)? true: false, bbox, visibility);
+	root_area = bbox.safe_area();
+}
+
+void BVH8::refit_node(int idx, bool leaf, BoundBox& bbox, uint& visibility)
+{
+	if(leaf) {
+		/* Refit leaf node. */
+		int4 *data = &pack.leaf_nodes[idx];
+		int4 c = data[0];
+
+		BVH::refit_primitives(c.x, c.y, bbox, visibility);
+
+		/* TODO(sergey): This is actually a copy of pack_leaf(),
+		 * but this chunk of code only knows actual data and has
+		 * no idea about BVHNode.
+		 *
+		 * Would be nice to de-duplicate code, but trying to make
+		 * making code more general ends up in much nastier code
+		 * in my opinion so far.
+		 *
+		 * Same applies to the inner nodes case below.
+		 */
+		float4 leaf_data[BVH_ONODE_LEAF_SIZE];
+		leaf_data[0].x = __int_as_float(c.x);
+		leaf_data[0].y = __int_as_float(c.y);
+		leaf_data[0].z = __uint_as_float(visibility);
+		leaf_data[0].w = __uint_as_float(c.w);
+		memcpy(&pack.leaf_nodes[idx], leaf_data, sizeof(float4)*BVH_ONODE_LEAF_SIZE);
+	}
+	else {
+		int4 *data = &pack.nodes[idx];
+		bool is_unaligned = (data[0].x & PATH_RAY_NODE_UNALIGNED) != 0;
+		/* Child indices are stored in the last row of the node. */
+		int c[8];
+		if(is_unaligned) {
+			memcpy(c, &data[BVH_UNALIGNED_ONODE_SIZE - 2], sizeof(c));
+		}
+		else {
+			memcpy(c, &data[BVH_ONODE_SIZE - 2], sizeof(c));
+		}
+		/* Refit inner node, set bbox from children. */
+		BoundBox child_bbox[8] = {BoundBox::empty, BoundBox::empty,
+		                          BoundBox::empty, BoundBox::empty,
+		                          BoundBox::empty, BoundBox::empty,
+		                          BoundBox::empty, BoundBox::empty};
+		uint child_visibility[8] = {0};
+		int num_nodes = 0;
+
+		for(int i = 0; i < 8; ++i) {
+			if(c[i] != 0) {
+				refit_node((c[i] < 0)? -c[i]-1: c[i], (c[i] < 0),
+				           child_bbox[i], child_visibility[i]);
+				++num_nodes;
+				nodes_area += child_bbox[i].safe_area();
+				bbox.grow(child_bbox[i]);
+				visibility |= child_visibility[i];
+			}
+		}
+
+		if(is_unaligned) {
+			Transform aligned_space[8] = {transform_identity(), transform_identity(),
+			                              transform_identity(), transform_identity(),
+			                              transform_identity(), transform_identity(),
+			                              transform_identity(), transform_identity()};
+			pack_unaligned_node(idx,
+			                    aligned_space,
+			                    child_bbox,
+			                    c,
+			                    visibility,
+			                    0.0f,
+			                    1.0f,
+			                    8);
+		}
+		else {
+			pack_aligned_node(idx,
+			                  child_bbox,
+			                  c,
+			                  visibility,
+			                  0.0f,
+			                  1.0f,
+			                  8);
+		}
+	}
+}
+
+CCL_NAMESPACE_END
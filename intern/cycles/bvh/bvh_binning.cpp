@@ -23,6 +23,7 @@
 
 #include "util/util_algorithm.h"
 #include "util/util_boundbox.h"
+#include "util/util_task.h"
 #include "util/util_types.h"
 
 CCL_NAMESPACE_BEGIN
@@ -82,56 +83,43 @@ BVHObjectBinning::BVHObjectBinning(const BVHRange& job,
 	num_bins = min(size_t(MAX_BINS), size_t(4.0f + 0.05f*size()));
 	scale = rcp(cent_bounds_.size()) * make_float3((float)num_bins);
 
-	/* initialize binning counter and bounds */
-	BoundBox bin_bounds[MAX_BINS][4];	/* bounds for every bin in every dimension */
-	int4 bin_count[MAX_BINS];			/* number of primitives mapped to bin */
-
-	for(size_t i = 0; i < num_bins; i++) {
-		bin_count[i] = make_int4(0);
-		bin_bounds[i][0] = bin_bounds[i][1] = bin_bounds[i][2] = BoundBox::empty;
+	/* Map geometry to bins. Big ranges, which happen at the top levels of the
+	 * tree, are binned in parallel with every task filling in its own bins,
+	 * which are merged afterwards.
+	 */
+	Bins bins;
+	if(size() < PARALLEL_BINNING_SIZE) {
+		bin_primitives(prims, 0, size(), &bins);
 	}
-
-	/* map geometry to bins, unrolled once */
-	{
-		ssize_t i;
-
-		for(i = 0; i < ssize_t(size()) - 1; i += 2) {
-			prefetch_L2(&prims[start() + i + 8]);
-
-			/* map even and odd primitive to bin */
-			const BVHReference& prim0 = prims[start() + i + 0];
-			const BVHReference& prim1 = prims[start() + i + 1];
-
-			BoundBox bounds0 = get_prim_bounds(prim0);
-			BoundBox bounds1 = get_prim_bounds(prim1);
-
-			int4 bin0 = get_bin(bounds0);
-			int4 bin1 = get_bin(bounds1);
-
-			/* increase bounds for bins for even primitive */
-			int b00 = (int)extract<0>(bin0); bin_count[b00][0]++; bin_bounds[b00][0].grow(bounds0);
-			int b01 = (int)extract<1>(bin0); bin_count[b01][1]++; bin_bounds[b01][1].grow(bounds0);
-			int b02 = (int)extract<2>(bin0); bin_count[b02][2]++; bin_bounds[b02][2].grow(bounds0);
-
-			/* increase bounds of bins for odd primitive */
-			int b10 = (int)extract<0>(bin1); bin_count[b10][0]++; bin_bounds[b10][0].grow(bounds1);
-			int b11 = (int)extract<1>(bin1); bin_count[b11][1]++; bin_bounds[b11][1].grow(bounds1);
-			int b12 = (int)extract<2>(bin1); bin_count[b12][2]++; bin_bounds[b12][2].grow(bounds1);
+	else {
+		const size_t num_tasks = divide_up(size(), PARALLEL_BINNING_TASK_SIZE);
+		vector<Bins> task_bins(num_tasks);
+		TaskPool pool;
+		for(size_t i = 0; i < num_tasks; i++) {
+			const size_t begin = i * PARALLEL_BINNING_TASK_SIZE;
+			const size_t end = min(begin + PARALLEL_BINNING_TASK_SIZE, size_t(size()));
+			pool.push(function_bind(&BVHObjectBinning::bin_primitives,
+			                        this,
+			                        prims,
+			                        begin,
+			                        end,
+			                        &task_bins[i]));
 		}
-
-		/* for uneven number of primitives */
-		if(i < ssize_t(size())) {
-			/* map primitive to bin */
-			const BVHReference& prim0 = prims[start() + i];
-			BoundBox bounds0 = get_prim_bounds(prim0);
-			int4 bin0 = get_bin(bounds0);
-
-			/* increase bounds of bins */
-			int b00 = (int)extract<0>(bin0); bin_count[b00][0]++; bin_bounds[b00][0].grow(bounds0);
-			int b01 = (int)extract<1>(bin0); bin_count[b01][1]++; bin_bounds[b01][1].grow(bounds0);
-			int b02 = (int)extract<2>(bin0); bin_count[b02][2]++; bin_bounds[b02][2].grow(bounds0);
+		pool.wait_work();
+
+		for(size_t i = 0; i < num_bins; i++) {
+			bins.count[i] = make_int4(0);
+			bins.bounds[i][0] = bins.bounds[i][1] = bins.bounds[i][2] = BoundBox::empty;
+			for(size_t j = 0; j < num_tasks; j++) {
+				bins.count[i] = bins.count[i] + task_bins[j].count[i];
+				bins.bounds[i][0].grow(task_bins[j].bounds[i][0]);
+				bins.bounds[i][1].grow(task_bins[j].bounds[i][1]);
+				bins.bounds[i][2].grow(task_bins[j].bounds[i][2]);
+			}
 		}
 	}
+	BoundBox (*bin_bounds)[4] = bins.bounds;
+	int4 *bin_count = bins.count;
 
 	/* sweep from right to left and compute parallel prefix of merged bounds */
 	float4 r_area[MAX_BINS];	/* area of bounds of primitives on the right */
@@ -188,6 +176,63 @@ BVHObjectBinning::BVHObjectBinning(const BVHRange& job,
 	leafSAH = bounds_.half_area() * blocks(size());
 }
 
+void BVHObjectBinning::bin_primitives(const BVHReference *prims,
+                                      size_t begin,
+                                      size_t end,
+                                      Bins *bins) const
+{
+	BoundBox (*bin_bounds)[4] = bins->bounds;
+	int4 *bin_count = bins->count;
+
+	/* initialize binning counter and bounds */
+	for(size_t i = 0; i < num_bins; i++) {
+		bin_count[i] = make_int4(0);
+		bin_bounds[i][0] = bin_bounds[i][1] = bin_bounds[i][2] = BoundBox::empty;
+	}
+
+	/* map geometry to bins, unrolled once */
+	{
+		ssize_t i;
+
+		for(i = begin; i < ssize_t(end) - 1; i += 2) {
+			prefetch_L2(&prims[start() + i + 8]);
+
+			/* map even and odd primitive to bin */
+			const BVHReference& prim0 = prims[start() + i + 0];
+			const BVHReference& prim1 = prims[start() + i + 1];
+
+			BoundBox bounds0 = get_prim_bounds(prim0);
+			BoundBox bounds1 = get_prim_bounds(prim1);
+
+			int4 bin0 = get_bin(bounds0);
+			int4 bin1 = get_bin(bounds1);
+
+			/* increase bounds for bins for even primitive */
+			int b00 = (int)extract<0>(bin0); bin_count[b00][0]++; bin_bounds[b00][0].grow(bounds0);
+			int b01 = (int)extract<1>(bin0); bin_count[b01][1]++; bin_bounds[b01][1].grow(bounds0);
+			int b02 = (int)extract<2>(bin0); bin_count[b02][2]++; bin_bounds[b02][2].grow(bounds0);
+
+			/* increase bounds of bins for odd primitive */
+			int b10 = (int)extract<0>(bin1); bin_count[b10][0]++; bin_bounds[b10][0].grow(bounds1);
+			int b11 = (int)extract<1>(bin1); bin_count[b11][1]++; bin_bounds[b11][1].grow(bounds1);
+			int b12 = (int)extract<2>(bin1); bin_count[b12][2]++; bin_bounds[b12][2].grow(bounds1);
+		}
+
+		/* for uneven number of primitives */
+		if(i < ssize_t(end)) {
+			/* map primitive to bin */
+			const BVHReference& prim0 = prims[start() + i];
+			BoundBox bounds0 = get_prim_bounds(prim0);
+			int4 bin0 = get_bin(bounds0);
+
+			/* increase bounds of bins */
+			int b00 = (int)extract<0>(bin0); bin_count[b00][0]++; bin_bounds[b00][0].grow(bounds0);
+			int b01 = (int)extract<1>(bin0); bin_count[b01][1]++; bin_bounds[b01][1].grow(bounds0);
+			int b02 = (int)extract<2>(bin0); bin_count[b02][2]++; bin_bounds[b02][2].grow(bounds0);
+		}
+	}
+}
+
 void BVHObjectBinning::split(BVHReference* prims,
                              BVHObjectBinning& left_o,
                              BVHObjectBinning& right_o) const
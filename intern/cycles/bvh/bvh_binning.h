@@ -69,6 +69,23 @@ protected:
 	enum { MAX_BINS = 32 };
 	enum { LOG_BLOCK_SIZE = 2 };
 
+	/* Ranges of at least this size are binned using multiple threads, with
+	 * every task binning the given number of primitives.
+	 */
+	enum { PARALLEL_BINNING_SIZE = 65536 };
+	enum { PARALLEL_BINNING_TASK_SIZE = 16384 };
+
+	/* Bin counters and bounds for every dimension. */
+	struct Bins {
+		BoundBox bounds[MAX_BINS][4];
+		int4 count[MAX_BINS];
+	};
+
+	void bin_primitives(const BVHReference *prims,
+	                    size_t begin,
+	                    size_t end,
+	                    Bins *bins) const;
+
 	/* computes the bin numbers for each dimension for a box. */
 	__forceinline int4 get_bin(const BoundBox& box) const
 	{
@@ -104,6 +104,8 @@ BVHBuild::BVHBuild(const vector<Object*>& objects_,
    params(params_),
    progress(progress_),
    progress_start_time(0.0),
+   progress_current_phase(PHASE_NUM),
+   progress_phase_start_time(0.0),
    unaligned_heuristic(objects_)
 {
 	spatial_min_overlap = 0.0f;
@@ -115,14 +117,20 @@ BVHBuild::~BVHBuild()
 
 /* Adding References */
 
-void BVHBuild::add_reference_triangles(BoundBox& root, BoundBox& center, Mesh *mesh, int i)
+void BVHBuild::add_reference_triangles(BVHReferenceArena& arena,
+                                       Mesh *mesh,
+                                       int i,
+                                       size_t start,
+                                       size_t end)
 {
+	vector<BVHReference>& references = arena.references;
+	BoundBox& root = arena.bounds;
+	BoundBox& center = arena.center;
 	const Attribute *attr_mP = NULL;
 	if(mesh->has_motion_blur()) {
 		attr_mP = mesh->attributes.find(ATTR_STD_MOTION_VERTEX_POSITION);
 	}
-	const size_t num_triangles = mesh->num_triangles();
-	for(uint j = 0; j < num_triangles; j++) {
+	for(uint j = start; j < end; j++) {
 		Mesh::Triangle t = mesh->get_triangle(j);
 		const float3 *verts = &mesh->verts[0];
 		if(attr_mP == NULL) {
@@ -223,14 +231,20 @@ void BVHBuild::add_reference_triangles(BoundBox& root, BoundBox& center, Mesh *m
 	}
 }
 
-void BVHBuild::add_reference_curves(BoundBox& root, BoundBox& center, Mesh *mesh, int i)
+void BVHBuild::add_reference_curves(BVHReferenceArena& arena,
+                                    Mesh *mesh,
+                                    int i,
+                                    size_t start,
+                                    size_t end)
 {
+	vector<BVHReference>& references = arena.references;
+	BoundBox& root = arena.bounds;
+	BoundBox& center = arena.center;
 	const Attribute *curve_attr_mP = NULL;
 	if(mesh->has_motion_blur()) {
 		curve_attr_mP = mesh->curve_attributes.find(ATTR_STD_MOTION_VERTEX_POSITION);
 	}
-	const size_t num_curves = mesh->num_curves();
-	for(uint j = 0; j < num_curves; j++) {
+	for(uint j = start; j < end; j++) {
 		const Mesh::Curve curve = mesh->get_curve(j);
 		const float *curve_radius = &mesh->curve_radius[0];
 		for(int k = 0; k < curve.num_keys - 1; k++) {
@@ -336,21 +350,45 @@ void BVHBuild::add_reference_curves(BoundBox& root, BoundBox& center, Mesh *mesh
 	}
 }
 
-void BVHBuild::add_reference_mesh(BoundBox& root, BoundBox& center, Mesh *mesh, int i)
+void BVHBuild::add_reference_mesh(vector<BVHReferenceArena>& arenas,
+                                  Mesh *mesh,
+                                  int i)
 {
+	/* Only schedule arenas here, references are created by the tasks. Big
+	 * meshes are split into multiple arenas, so scenes with a single huge
+	 * mesh still make use of all threads.
+	 */
 	if(params.primitive_mask & PRIMITIVE_ALL_TRIANGLE) {
-		add_reference_triangles(root, center, mesh, i);
+		const size_t num_triangles = mesh->num_triangles();
+		for(size_t start = 0; start < num_triangles; start += REFERENCE_TASK_SIZE) {
+			BVHReferenceArena arena;
+			arena.mesh = mesh;
+			arena.object_index = i;
+			arena.prim_type = PRIMITIVE_ALL_TRIANGLE;
+			arena.prim_start = start;
+			arena.prim_end = min(start + REFERENCE_TASK_SIZE, num_triangles);
+			arenas.push_back(arena);
+		}
 	}
 	if(params.primitive_mask & PRIMITIVE_ALL_CURVE) {
-		add_reference_curves(root, center, mesh, i);
+		const size_t num_curves = mesh->num_curves();
+		for(size_t start = 0; start < num_curves; start += REFERENCE_TASK_SIZE) {
+			BVHReferenceArena arena;
+			arena.mesh = mesh;
+			arena.object_index = i;
+			arena.prim_type = PRIMITIVE_ALL_CURVE;
+			arena.prim_start = start;
+			arena.prim_end = min(start + REFERENCE_TASK_SIZE, num_curves);
+			arenas.push_back(arena);
+		}
 	}
 }
 
-void BVHBuild::add_reference_object(BoundBox& root, BoundBox& center, Object *ob, int i)
+void BVHBuild::add_reference_object(BVHReferenceArena& arena, Object *ob, int i)
 {
-	references.push_back(BVHReference(ob->bounds, -1, i, 0));
-	root.grow(ob->bounds);
-	center.grow(ob->bounds.center2());
+	arena.references.push_back(BVHReference(ob->bounds, -1, i, 0));
+	arena.bounds.grow(ob->bounds);
+	arena.center.grow(ob->bounds.center2());
 }
 
 static size_t count_curve_segments(Mesh *mesh)
@@ -394,10 +432,8 @@ void BVHBuild::add_references(BVHRange& root)
 		}
 	}
 
-	references.reserve(num_alloc_references);
-
-	/* add references from objects */
-	BoundBox bounds = BoundBox::empty, center = BoundBox::empty;
+	/* Schedule arenas for all objects. */
+	vector<BVHReferenceArena> arenas;
 	int i = 0;
 
 	foreach(Object *ob, objects) {
@@ -406,17 +442,51 @@ void BVHBuild::add_references(BVHRange& root)
 				++i;
 				continue;
 			}
-			if(!ob->mesh->is_instanced())
-				add_reference_mesh(bounds, center, ob->mesh, i);
-			else
-				add_reference_object(bounds, center, ob, i);
+			if(!ob->mesh->is_instanced()) {
+				add_reference_mesh(arenas, ob->mesh, i);
+			}
+			else {
+				/* Instances are cheap to add, so they go to an arena which
+				 * does not need a task.
+				 */
+				if(arenas.empty() || arenas.back().prim_type != 0) {
+					arenas.push_back(BVHReferenceArena());
+				}
+				add_reference_object(arenas.back(), ob, i);
+			}
 		}
 		else
-			add_reference_mesh(bounds, center, ob->mesh, i);
+			add_reference_mesh(arenas, ob->mesh, i);
 
 		i++;
+	}
+
+	/* Fill in arenas in parallel. */
+	foreach(BVHReferenceArena& arena, arenas) {
+		if(arena.prim_type != 0) {
+			task_pool.push(function_bind(&BVHBuild::thread_add_references,
+			                             this,
+			                             &arena));
+		}
+	}
+	task_pool.wait_work();
+
+	if(progress.get_cancel()) return;
+
+	/* Merge arenas into the main references array. Arenas are freed as soon
+	 * as they are merged to keep peak memory usage down.
+	 */
+	references.reserve(num_alloc_references);
+
+	BoundBox bounds = BoundBox::empty, center = BoundBox::empty;
 
-		if(progress.get_cancel()) return;
+	foreach(BVHReferenceArena& arena, arenas) {
+		references.insert(references.end(),
+		                  arena.references.begin(),
+		                  arena.references.end());
+		bounds.grow(arena.bounds);
+		center.grow(arena.center);
+		vector<BVHReference>().swap(arena.references);
 	}
 
 	/* happens mostly on empty meshes */
@@ -426,13 +496,42 @@ void BVHBuild::add_references(BVHRange& root)
 	root = BVHRange(bounds, center, 0, references.size());
 }
 
+void BVHBuild::thread_add_references(BVHReferenceArena *arena)
+{
+	if(progress.get_cancel()) {
+		return;
+	}
+
+	arena->references.reserve(arena->prim_end - arena->prim_start);
+	if(arena->prim_type == PRIMITIVE_ALL_TRIANGLE) {
+		add_reference_triangles(*arena,
+		                        arena->mesh,
+		                        arena->object_index,
+		                        arena->prim_start,
+		                        arena->prim_end);
+	}
+	else {
+		add_reference_curves(*arena,
+		                     arena->mesh,
+		                     arena->object_index,
+		                     arena->prim_start,
+		                     arena->prim_end);
+	}
+}
+
 /* Build */
 
 BVHNode* BVHBuild::run()
 {
 	BVHRange root;
 
+	progress_start_time = time_dt();
+	for(int i = 0; i < PHASE_NUM; i++) {
+		progress_phase_time[i] = 0.0;
+	}
+
 	/* add references */
+	progress_phase(PHASE_ADD_REFERENCES);
 	add_references(root);
 
 	if(progress.get_cancel())
@@ -450,18 +549,17 @@ BVHNode* BVHBuild::run()
 
 	spatial_min_overlap = root.bounds().safe_area() * params.spatial_split_alpha;
 	if(params.use_spatial_split) {
-		/* NOTE: The API here tries to be as much ready for multi-threaded build
-		 * as possible, but at the same time it tries not to introduce any
-		 * changes in behavior for until all refactoring needed for threading is
-		 * finished.
-		 *
-		 * So we currently allocate single storage for now, which is only used by
-		 * the only thread working on the spatial BVH build.
+		/* Every thread has its own storage, indexed by the thread ID passed to
+		 * the build tasks, so there is no locking needed during the build.
 		 */
 		spatial_storage.resize(TaskScheduler::num_threads() + 1);
 		size_t num_bins = max(root.size(), (int)BVHParams::NUM_SPATIAL_BINS) - 1;
 		foreach(BVHSpatialStorage &storage, spatial_storage) {
 			storage.right_bounds.clear();
+			/* Allocated upfront, so references to the per-level storage stay
+			 * valid during the build.
+			 */
+			storage.right_references.resize(BVHParams::MAX_DEPTH);
 		}
 		spatial_storage[0].right_bounds.resize(num_bins);
 	}
@@ -471,8 +569,7 @@ BVHNode* BVHBuild::run()
 	                 params.num_motion_triangle_steps > 0;
 
 	/* init progress updates */
-	double build_start_time;
-	build_start_time = progress_start_time = time_dt();
+	progress_phase(PHASE_BUILD_NODES);
 	progress_count = 0;
 	progress_total = references.size();
 	progress_original_total = progress_total;
@@ -502,6 +599,8 @@ BVHNode* BVHBuild::run()
 		task_pool.wait_work();
 	}
 
+	progress_phase(PHASE_FINALIZE);
+
 	/* delete if we canceled */
 	if(rootnode) {
 		if(progress.get_cancel()) {
@@ -514,9 +613,19 @@ BVHNode* BVHBuild::run()
 			rootnode->update_visibility();
 			rootnode->update_time();
 		}
+		progress_phase(PHASE_NUM);
 		if(rootnode != NULL) {
 			VLOG(1) << "BVH build statistics:\n"
-			        << "  Build time: " << time_dt() - build_start_time << "\n"
+			        << "  Build time: "
+			        << progress_phase_time[PHASE_ADD_REFERENCES] +
+			           progress_phase_time[PHASE_BUILD_NODES] +
+			           progress_phase_time[PHASE_FINALIZE] << "\n"
+			        << "    Adding references: "
+			        << progress_phase_time[PHASE_ADD_REFERENCES] << "\n"
+			        << "    Building nodes: "
+			        << progress_phase_time[PHASE_BUILD_NODES] << "\n"
+			        << "    Finalizing: "
+			        << progress_phase_time[PHASE_FINALIZE] << "\n"
 			        << "  Total number of nodes: "
 			        << string_human_readable_number(rootnode->getSubtreeSize(BVH_STAT_NODE_COUNT)) << "\n"
 			        << "  Number of inner nodes: "
@@ -538,6 +647,35 @@ BVHNode* BVHBuild::run()
 	return rootnode;
 }
 
+void BVHBuild::progress_phase(BuildPhase phase)
+{
+	const double current_time = time_dt();
+	if(progress_current_phase != PHASE_NUM) {
+		progress_phase_time[progress_current_phase] +=
+		        current_time - progress_phase_start_time;
+	}
+	progress_current_phase = phase;
+	progress_phase_start_time = current_time;
+
+	switch(phase) {
+		case PHASE_ADD_REFERENCES:
+			progress.set_substatus("Building BVH, adding references");
+			break;
+		case PHASE_BUILD_NODES:
+			progress.set_substatus(string_printf(
+			        "Building BVH, added references in %.2fs",
+			        progress_phase_time[PHASE_ADD_REFERENCES]));
+			break;
+		case PHASE_FINALIZE:
+			progress.set_substatus(string_printf(
+			        "Building BVH, built nodes in %.2fs",
+			        progress_phase_time[PHASE_BUILD_NODES]));
+			break;
+		case PHASE_NUM:
+			break;
+	}
+}
+
 void BVHBuild::progress_update()
 {
 	if(time_dt() - progress_start_time < 0.25)
@@ -546,8 +684,9 @@ void BVHBuild::progress_update()
 	double progress_start = (double)progress_count/(double)progress_total;
 	double duplicates = (double)(progress_total - progress_original_total)/(double)progress_total;
 
-	string msg = string_printf("Building BVH %.0f%%, duplicates %.0f%%",
-	                           progress_start * 100.0, duplicates * 100.0);
+	string msg = string_printf("Building BVH %.0f%%, duplicates %.0f%%, %.2fs",
+	                           progress_start * 100.0, duplicates * 100.0,
+	                           time_dt() - progress_phase_start_time);
 
 	progress.set_substatus(msg);
 	progress_start_time = time_dt();
@@ -811,9 +950,15 @@ BVHNode* BVHBuild::build_node(const BVHRange& range,
 	if(range.size() < THREAD_TASK_SIZE) {
 		/* Local build. */
 
-		/* Build left node. */
-		vector<BVHReference> copy(references->begin() + right.start(),
-		                          references->begin() + right.end());
+		/* Build left node. References of the right node are copied to the
+		 * thread's storage of this level, since the left subtree might add
+		 * new references for spatial splits. Deeper levels use their own
+		 * storage, so it is not overwritten until the right node is built.
+		 */
+		assert(level < storage->right_references.size());
+		vector<BVHReference>& copy = storage->right_references[level];
+		copy.assign(references->begin() + right.start(),
+		            references->begin() + right.end());
 		right.set_start(0);
 
 		BVHNode *leftnode = build_node(left, references, level + 1, thread_id);
@@ -38,6 +38,37 @@ class Mesh;
 class Object;
 class Progress;
 
+/* BVH Reference Arena
+ *
+ * Storage for the references created by a single add references task. Every
+ * task fills in its own arena, so no synchronization is needed, and arenas
+ * are merged into the main references array in a deterministic order once
+ * all tasks are done.
+ */
+
+struct BVHReferenceArena {
+	BVHReferenceArena()
+	: mesh(NULL),
+	  object_index(0),
+	  prim_type(0),
+	  prim_start(0),
+	  prim_end(0),
+	  bounds(BoundBox::empty),
+	  center(BoundBox::empty) {}
+
+	/* Mesh and range of its primitives to create references for. */
+	Mesh *mesh;
+	int object_index;
+	int prim_type;
+	size_t prim_start;
+	size_t prim_end;
+
+	/* Created references and their accumulated bounds. */
+	vector<BVHReference> references;
+	BoundBox bounds;
+	BoundBox center;
+};
+
 /* BVH Builder */
 
 class BVHBuild
@@ -64,10 +95,20 @@ protected:
 	friend class BVHObjectBinning;
 
 	/* Adding references. */
-	void add_reference_triangles(BoundBox& root, BoundBox& center, Mesh *mesh, int i);
-	void add_reference_curves(BoundBox& root, BoundBox& center, Mesh *mesh, int i);
-	void add_reference_mesh(BoundBox& root, BoundBox& center, Mesh *mesh, int i);
-	void add_reference_object(BoundBox& root, BoundBox& center, Object *ob, int i);
+	void add_reference_triangles(BVHReferenceArena& arena,
+	                             Mesh *mesh,
+	                             int i,
+	                             size_t start,
+	                             size_t end);
+	void add_reference_curves(BVHReferenceArena& arena,
+	                          Mesh *mesh,
+	                          int i,
+	                          size_t start,
+	                          size_t end);
+	void add_reference_mesh(vector<BVHReferenceArena>& arenas,
+	                        Mesh *mesh,
+	                        int i);
+	void add_reference_object(BVHReferenceArena& arena, Object *ob, int i);
 	void add_references(BVHRange& root);
 
 	/* Building. */
@@ -85,6 +126,8 @@ protected:
 
 	/* Threads. */
 	enum { THREAD_TASK_SIZE = 4096 };
+	enum { REFERENCE_TASK_SIZE = 65536 };
+	void thread_add_references(BVHReferenceArena *arena);
 	void thread_build_node(InnerNode *node,
 	                       int child,
 	                       BVHObjectBinning *range,
@@ -98,6 +141,14 @@ protected:
 	thread_mutex build_mutex;
 
 	/* Progress. */
+	enum BuildPhase {
+		PHASE_ADD_REFERENCES = 0,
+		PHASE_BUILD_NODES,
+		PHASE_FINALIZE,
+
+		PHASE_NUM,
+	};
+	void progress_phase(BuildPhase phase);
 	void progress_update();
 
 	/* Tree rotations. */
@@ -123,6 +174,9 @@ protected:
 	/* Progress reporting. */
 	Progress& progress;
 	double progress_start_time;
+	BuildPhase progress_current_phase;
+	double progress_phase_start_time;
+	double progress_phase_time[PHASE_NUM];
 	size_t progress_count;
 	size_t progress_total;
 	size_t progress_original_total;
@@ -0,0 +1,313 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bvh/bvh_cache.h"
+
+#include "bvh/bvh.h"
+
+#include "render/attribute.h"
+#include "render/mesh.h"
+#include "render/object.h"
+
+#include "util/util_foreach.h"
+#include "util/util_logging.h"
+#include "util/util_map.h"
+#include "util/util_md5.h"
+#include "util/util_path.h"
+
+#include <stdio.h>
+
+#include <OpenImageIO/filesystem.h>
+
+CCL_NAMESPACE_BEGIN
+
+/* Increase when the packed BVH layout or the key changes. */
+#define BVH_CACHE_VERSION 1
+
+static const char bvh_cache_magic[4] = {'C', 'B', 'V', 'H'};
+
+/* Key hashing */
+
+static void md5_append_attribute(MD5Hash& md5,
+                                 const AttributeSet& attributes,
+                                 AttributeStandard std)
+{
+	const Attribute *attr = attributes.find(std);
+	size_t size = (attr)? attr->buffer.size(): 0;
+
+	md5_append_value(md5, size);
+	if(size) {
+		md5_append_data(md5, attr->data(), size);
+	}
+}
+
+/* Hash of everything in the mesh that ends up in its packed BVH. */
+static string mesh_content_hash(const Mesh *mesh)
+{
+	MD5Hash md5;
+
+	md5_append_array(md5, mesh->verts);
+	md5_append_array(md5, mesh->triangles);
+	md5_append_array(md5, mesh->curve_keys);
+	md5_append_array(md5, mesh->curve_radius);
+	md5_append_array(md5, mesh->curve_first_key);
+
+	md5_append_value(md5, mesh->motion_steps);
+	md5_append_value(md5, mesh->use_motion_blur);
+	md5_append_attribute(md5, mesh->attributes, ATTR_STD_MOTION_VERTEX_POSITION);
+	md5_append_attribute(md5, mesh->curve_attributes, ATTR_STD_MOTION_VERTEX_POSITION);
+
+	md5_append_value(md5, mesh->transform_applied);
+	md5_append_value(md5, mesh->need_build_bvh());
+
+	return md5.get_hex();
+}
+
+string BVHCache::key(const BVHParams& params, const vector<Object*>& objects)
+{
+	MD5Hash md5;
+
+	md5.append(string_printf("cycles-bvh-%d", BVH_CACHE_VERSION));
+
+	md5_append_value(md5, params.bvh_layout);
+	md5_append_value(md5, params.top_level);
+	md5_append_value(md5, params.use_spatial_split);
+	md5_append_value(md5, params.spatial_split_alpha);
+	md5_append_value(md5, params.use_unaligned_nodes);
+	md5_append_value(md5, params.unaligned_split_threshold);
+	md5_append_value(md5, params.sah_node_cost);
+	md5_append_value(md5, params.sah_primitive_cost);
+	md5_append_value(md5, params.min_leaf_size);
+	md5_append_value(md5, params.max_triangle_leaf_size);
+	md5_append_value(md5, params.max_motion_triangle_leaf_size);
+	md5_append_value(md5, params.max_curve_leaf_size);
+	md5_append_value(md5, params.max_motion_curve_leaf_size);
+	md5_append_value(md5, params.primitive_mask);
+	md5_append_value(md5, params.num_motion_curve_steps);
+	md5_append_value(md5, params.num_motion_triangle_steps);
+
+	/* Instances share the mesh, only hash it once. */
+	map<const Mesh*, string> mesh_hashes;
+
+	md5_append_value(md5, objects.size());
+	foreach(const Object *object, objects) {
+		const Mesh *mesh = object->mesh;
+
+		map<const Mesh*, string>::iterator it = mesh_hashes.find(mesh);
+		if(it == mesh_hashes.end()) {
+			it = mesh_hashes.insert(std::make_pair(mesh, mesh_content_hash(mesh))).first;
+		}
+		md5.append(it->second);
+
+		md5_append_value(md5, object->tfm);
+		md5_append_array(md5, object->motion);
+		md5_append_value(md5, object->bounds.min);
+		md5_append_value(md5, object->bounds.max);
+		md5_append_value(md5, object->visibility_for_tracing());
+		md5_append_value(md5, object->is_traceable());
+
+		/* Primitive indices of the top level BVH point into the scene arrays. */
+		if(params.top_level) {
+			md5_append_value(md5, mesh->tri_offset);
+			md5_append_value(md5, mesh->curve_offset);
+		}
+	}
+
+	return md5.get_hex();
+}
+
+/* Serialization */
+
+template<typename T>
+static bool write_array(FILE *f, const array<T>& data, size_t *bytes)
+{
+	const uint64_t size = data.size();
+	if(fwrite(&size, sizeof(size), 1, f) != 1) {
+		return false;
+	}
+	if(size && fwrite(data.data(), sizeof(T), size, f) != size) {
+		return false;
+	}
+	*bytes += sizeof(size) + size * sizeof(T);
+	return true;
+}
+
+template<typename T>
+static bool read_array(FILE *f, array<T>& data, size_t *bytes)
+{
+	uint64_t size;
+	if(fread(&size, sizeof(size), 1, f) != 1) {
+		return false;
+	}
+	data.resize(size);
+	if(size && fread(data.data(), sizeof(T), size, f) != size) {
+		return false;
+	}
+	*bytes += sizeof(size) + size * sizeof(T);
+	return true;
+}
+
+struct BVHCacheHeader {
+	char magic[4];
+	int version;
+	int bvh_layout;
+	int root_index;
+	float nodes_area;
+	float root_area;
+	float build_cost;
+};
+
+/* Stats */
+
+string BVHCache::Stats::full_report() const
+{
+	string report = "";
+	report += string_printf("Hits:           %s\n", string_human_readable_number(hits).c_str());
+	report += string_printf("Misses:         %s\n", string_human_readable_number(misses).c_str());
+	report += string_printf("Bytes read:     %s\n", string_human_readable_size(bytes_read).c_str());
+	report += string_printf("Bytes written:  %s\n", string_human_readable_size(bytes_written).c_str());
+	return report;
+}
+
+/* BVH Cache */
+
+BVHCache::BVHCache(const string& path)
+: path(path)
+{
+}
+
+string BVHCache::filepath(const string& key) const
+{
+	return path_join(path, key + ".bvh");
+}
+
+bool BVHCache::load(const string& key, BVH *bvh)
+{
+	const string filename = filepath(key);
+	FILE *f = path_exists(filename)? path_fopen(filename, "rb"): NULL;
+
+	if(!f) {
+		thread_scoped_lock stats_lock(stats_mutex);
+		stats.misses++;
+		return false;
+	}
+
+	PackedBVH& pack = bvh->pack;
+	BVHCacheHeader header;
+	size_t bytes = sizeof(header);
+
+	bool success =
+	        fread(&header, sizeof(header), 1, f) == 1 &&
+	        memcmp(header.magic, bvh_cache_magic, sizeof(header.magic)) == 0 &&
+	        header.version == BVH_CACHE_VERSION &&
+	        header.bvh_layout == bvh->params.bvh_layout &&
+	        read_array(f, pack.nodes, &bytes) &&
+	        read_array(f, pack.leaf_nodes, &bytes) &&
+	        read_array(f, pack.object_node, &bytes) &&
+	        read_array(f, pack.prim_tri_index, &bytes) &&
+	        read_array(f, pack.prim_tri_verts, &bytes) &&
+	        read_array(f, pack.prim_type, &bytes) &&
+	        read_array(f, pack.prim_visibility, &bytes) &&
+	        read_array(f, pack.prim_index, &bytes) &&
+	        read_array(f, pack.prim_object, &bytes) &&
+	        read_array(f, pack.prim_time, &bytes);
+
+	fclose(f);
+
+	if(!success) {
+		VLOG(1) << "Failed to read BVH cache file " << filename << ".";
+		bvh->pack = PackedBVH();
+
+		thread_scoped_lock stats_lock(stats_mutex);
+		stats.misses++;
+		return false;
+	}
+
+	pack.root_index = header.root_index;
+	bvh->nodes_area = header.nodes_area;
+	bvh->root_area = header.root_area;
+	bvh->build_cost = header.build_cost;
+	bvh->refit_cost = header.build_cost;
+	bvh->num_refits = 0;
+
+	VLOG(2) << "Loaded BVH from cache file " << filename << ".";
+
+	thread_scoped_lock stats_lock(stats_mutex);
+	stats.hits++;
+	stats.bytes_read += bytes;
+	return true;
+}
+
+void BVHCache::store(const string& key, const BVH *bvh)
+{
+	const string filename = filepath(key);
+	/* Write to a temporary file first, so that other processes sharing the
+	 * cache never see partially written files. */
+	const string tmp_filename = filename + "." + OIIO::Filesystem::unique_path() + ".tmp";
+
+	path_create_directories(filename);
+	FILE *f = path_fopen(tmp_filename, "wb");
+	if(!f) {
+		VLOG(1) << "Failed to create BVH cache file " << tmp_filename << ".";
+		return;
+	}
+
+	const PackedBVH& pack = bvh->pack;
+	BVHCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, bvh_cache_magic, sizeof(header.magic));
+	header.version = BVH_CACHE_VERSION;
+	header.bvh_layout = bvh->params.bvh_layout;
+	header.root_index = pack.root_index;
+	header.nodes_area = bvh->nodes_area;
+	header.root_area = bvh->root_area;
+	header.build_cost = bvh->build_cost;
+	size_t bytes = sizeof(header);
+
+	bool success =
+	        fwrite(&header, sizeof(header), 1, f) == 1 &&
+	        write_array(f, pack.nodes, &bytes) &&
+	        write_array(f, pack.leaf_nodes, &bytes) &&
+	        write_array(f, pack.object_node, &bytes) &&
+	        write_array(f, pack.prim_tri_index, &bytes) &&
+	        write_array(f, pack.prim_tri_verts, &bytes) &&
+	        write_array(f, pack.prim_type, &bytes) &&
+	        write_array(f, pack.prim_visibility, &bytes) &&
+	        write_array(f, pack.prim_index, &bytes) &&
+	        write_array(f, pack.prim_object, &bytes) &&
+	        write_array(f, pack.prim_time, &bytes);
+
+	success = (fclose(f) == 0) && success;
+
+	if(!success || rename(tmp_filename.c_str(), filename.c_str()) != 0) {
+		VLOG(1) << "Failed to write BVH cache file " << filename << ".";
+		path_remove(tmp_filename);
+		return;
+	}
+
+	VLOG(2) << "Stored BVH in cache file " << filename << ".";
+
+	thread_scoped_lock stats_lock(stats_mutex);
+	stats.bytes_written += bytes;
+}
+
+void BVHCache::get_stats(Stats *stats)
+{
+	thread_scoped_lock stats_lock(stats_mutex);
+	*stats = this->stats;
+}
+
+CCL_NAMESPACE_END
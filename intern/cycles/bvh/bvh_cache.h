@@ -0,0 +1,83 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __BVH_CACHE_H__
+#define __BVH_CACHE_H__
+
+#include "util/util_string.h"
+#include "util/util_thread.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+class BVH;
+class BVHParams;
+class Object;
+
+/* BVH Cache
+ *
+ * Persistent cache of packed BVHs in a directory on disk, shared between
+ * renders and processes. Entries are keyed by a hash of the geometry,
+ * objects and build parameters, so unchanged geometry does not need to be
+ * built again on the next frame or the next render job.
+ *
+ * Only the packed BVH is cached, which saves the build but not the rest of
+ * the scene export. Mesh attributes and other device arrays are still
+ * synced and packed as usual. Entries are read into memory with regular
+ * file I/O, they are not memory-mapped. */
+
+class BVHCache {
+public:
+	struct Stats {
+		Stats()
+		: hits(0),
+		  misses(0),
+		  bytes_read(0),
+		  bytes_written(0) {}
+
+		size_t hits;
+		size_t misses;
+		size_t bytes_read;
+		size_t bytes_written;
+
+		string full_report() const;
+	};
+
+	explicit BVHCache(const string& path);
+
+	/* Key of the BVH built over the given objects. */
+	static string key(const BVHParams& params, const vector<Object*>& objects);
+
+	/* Load packed BVH and its build statistics, returns false on a miss. */
+	bool load(const string& key, BVH *bvh);
+	/* Store packed BVH, must be called before the data is moved to the
+	 * device. */
+	void store(const string& key, const BVH *bvh);
+
+	void get_stats(Stats *stats);
+
+protected:
+	string filepath(const string& key) const;
+
+	string path;
+
+	thread_mutex stats_mutex;
+	Stats stats;
+};
+
+CCL_NAMESPACE_END
+
+#endif  /* __BVH_CACHE_H__ */
@@ -125,6 +125,49 @@ int BVHNode::getSubtreeSize(BVH_STAT stat) const
 				cnt += has_unaligned? 1: 0;
 			}
 			return cnt;
+		case BVH_STAT_ONODE_COUNT:
+		case BVH_STAT_UNALIGNED_INNER_ONODE_COUNT:
+			{
+				/* Children of an octo node are collected from up to three
+				 * levels of the binary tree, same as BVH8::pack_nodes().
+				 */
+				const BVHNode *nodes[8];
+				int num_nodes = 0;
+				for(int i = 0; i < num_children(); i++) {
+					BVHNode *node = get_child(i);
+					if(node->is_leaf()) {
+						nodes[num_nodes++] = node;
+						continue;
+					}
+					for(int j = 0; j < node->num_children(); j++) {
+						BVHNode *child = node->get_child(j);
+						if(child->is_leaf()) {
+							nodes[num_nodes++] = child;
+						}
+						else {
+							nodes[num_nodes++] = child->get_child(0);
+							nodes[num_nodes++] = child->get_child(1);
+						}
+					}
+				}
+				bool has_unaligned = false;
+				for(int i = 0; i < num_nodes; i++) {
+					has_unaligned |= nodes[i]->is_unaligned;
+					if(nodes[i]->is_leaf()) {
+						cnt += (stat == BVH_STAT_ONODE_COUNT)? 1: 0;
+					}
+					else {
+						cnt += nodes[i]->getSubtreeSize(stat);
+					}
+				}
+				if(stat == BVH_STAT_ONODE_COUNT) {
+					cnt += 1;
+				}
+				else if(num_nodes != 0) {
+					cnt += has_unaligned? 1: 0;
+				}
+			}
+			return cnt;
 		case BVH_STAT_ALIGNED_LEAF_COUNT:
 			cnt = (is_leaf() && !is_unaligned) ? 1 : 0;
 			break;
@@ -142,6 +142,7 @@ public:
 	 *
 	 * If the requested layout is supported by the device, it will be used.
 	 * Otherwise, widest supported layout below that will be used.
+	 * BVH_LAYOUT_AUTO uses the widest layout supported by the device.
 	 */
 	static BVHLayout best_bvh_layout(BVHLayout requested_layout,
 	                                 BVHLayoutMask supported_layouts);
@@ -267,6 +268,12 @@ struct BVHSpatialStorage {
 	 * new references in before they're getting inserted into actual array,
 	 */
 	vector<BVHReference> new_references;
+
+	/* Per-level storage for references of the right child when building
+	 * nodes locally within a thread. Reused for all nodes built by the
+	 * thread, so memory is only allocated once per level.
+	 */
+	vector<vector<BVHReference> > right_references;
 };
 
 CCL_NAMESPACE_END
@@ -49,6 +49,7 @@
 #include "util/util_map.h"
 #include "util/util_opengl.h"
 #include "util/util_optimization.h"
+#include "util/util_profiling.h"
 #include "util/util_progress.h"
 #include "util/util_system.h"
 #include "util/util_thread.h"
@@ -171,14 +172,35 @@ public:
 #endif
 
 	bool use_split_kernel;
+	bool use_packet_traversal;
+
+	/* Copies of data textures in the memory of each NUMA node. They are made
+	 * by the first render thread on a node, so first touch places the pages
+	 * there, and are dropped whenever the texture changes. */
+	struct NUMATexture {
+		void *data;
+		size_t size;
+	};
+	typedef map<string, NUMATexture> NUMATextureMap;
+
+	bool use_numa_replication;
+	thread_mutex numa_mutex;
+	map<string, device_memory*> numa_data_textures;
+	vector<NUMATextureMap> numa_textures;
 
 	DeviceRequestedFeatures requested_features;
 
 	KernelFunctions<void(*)(KernelGlobals *, float *, int, int, int, int, int)>             path_trace_kernel;
+	KernelFunctions<void(*)(KernelGlobals *, float *, int, int, int, int, int, int)>        path_trace_packet_kernel;
 	KernelFunctions<void(*)(KernelGlobals *, uchar4 *, float *, float, int, int, int, int)> convert_to_half_float_kernel;
 	KernelFunctions<void(*)(KernelGlobals *, uchar4 *, float *, float, int, int, int, int)> convert_to_byte_kernel;
 	KernelFunctions<void(*)(KernelGlobals *, uint4 *, float4 *, int, int, int, int, int)>   shader_kernel;
 
+	KernelFunctions<void(*)(KernelGlobals *, float *, int, int, int, int, int)>      adaptive_stopping_kernel;
+	KernelFunctions<void(*)(KernelGlobals *, float *, int, int, int, int, int, int)> adaptive_filter_x_kernel;
+	KernelFunctions<int(*)(KernelGlobals *, float *, int, int, int, int, int, int)>  adaptive_filter_y_kernel;
+	KernelFunctions<void(*)(KernelGlobals *, float *, int, int, int, int, int)>      adaptive_adjust_samples_kernel;
+
 	KernelFunctions<void(*)(int, TilesInfo*, int, int, float*, float*, float*, float*, float*, int*, int, int)> filter_divide_shadow_kernel;
 	KernelFunctions<void(*)(int, TilesInfo*, int, int, int, int, float*, float*, int*, int, int)>               filter_get_feature_kernel;
 	KernelFunctions<void(*)(int, int, float*, float*, float*, float*, int*, int)>                               filter_detect_outliers_kernel;
@@ -212,9 +234,14 @@ public:
 	  texture_info(this, "__texture_info", MEM_TEXTURE),
 #define REGISTER_KERNEL(name) name ## _kernel(KERNEL_FUNCTIONS(name))
 	  REGISTER_KERNEL(path_trace),
+	  REGISTER_KERNEL(path_trace_packet),
 	  REGISTER_KERNEL(convert_to_half_float),
 	  REGISTER_KERNEL(convert_to_byte),
 	  REGISTER_KERNEL(shader),
+	  REGISTER_KERNEL(adaptive_stopping),
+	  REGISTER_KERNEL(adaptive_filter_x),
+	  REGISTER_KERNEL(adaptive_filter_y),
+	  REGISTER_KERNEL(adaptive_adjust_samples),
 	  REGISTER_KERNEL(filter_divide_shadow),
 	  REGISTER_KERNEL(filter_get_feature),
 	  REGISTER_KERNEL(filter_detect_outliers),
@@ -234,6 +261,16 @@ public:
 			info.cpu_threads = TaskScheduler::num_threads();
 		}
 
+		/* Octo BVH traversal is only compiled into the AVX2 kernel, so make
+		 * sure it is not used when a different kernel was selected.
+		 */
+#ifdef WITH_CYCLES_OPTIMIZED_KERNEL_AVX2
+		if(!(DebugFlags().cpu.has_avx2() && system_cpu_support_avx2()))
+#endif
+		{
+			info.bvh_layout_mask &= ~BVH_LAYOUT_BVH8;
+		}
+
 #ifdef WITH_OSL
 		kernel_globals.osl = &osl_globals;
 #endif
@@ -241,6 +278,21 @@ public:
 		if(use_split_kernel) {
 			VLOG(1) << "Will be using split kernel.";
 		}
+		use_packet_traversal = DebugFlags().cpu.packet_traversal && !use_split_kernel;
+		if(use_packet_traversal) {
+			VLOG(1) << "Will be using packet traversal for camera rays.";
+		}
+		use_numa_replication = DebugFlags().cpu.numa_replication &&
+		                       system_cpu_num_numa_nodes() > 1;
+		if(use_numa_replication) {
+			VLOG(1) << "Will be copying scene data to "
+			        << system_cpu_num_numa_nodes() << " NUMA nodes.";
+			if(!DebugFlags().cpu.numa_pinning) {
+				VLOG(1) << "NUMA replication is enabled without NUMA pinning, "
+				        << "pinning render threads as well.";
+			}
+			numa_textures.resize(system_cpu_num_numa_nodes());
+		}
 		need_texture_info = false;
 
 #define REGISTER_SPLIT_KERNEL(name) split_kernels[#name] = KernelFunctions<void(*)(KernelGlobals*, KernelData*)>(KERNEL_FUNCTIONS(name))
@@ -270,6 +322,12 @@ public:
 	{
 		task_pool.stop();
 		texture_info.free();
+
+		for(int node = 0; node < numa_textures.size(); node++) {
+			foreach(NUMATextureMap::value_type& it, numa_textures[node]) {
+				numa_texture_free(it.second);
+			}
+		}
 	}
 
 	virtual bool show_samples() const
@@ -385,6 +443,12 @@ public:
 							mem.name,
 							mem.host_pointer,
 							mem.data_size);
+
+			if(use_numa_replication) {
+				thread_scoped_lock lock(numa_mutex);
+				numa_textures_remove(mem.name);
+				numa_data_textures[mem.name] = &mem;
+			}
 		}
 		else {
 			/* Image Texture. */
@@ -411,6 +475,17 @@ public:
 			info.width = mem.data_width;
 			info.height = mem.data_height;
 			info.depth = mem.data_depth;
+			info.cache = (uint64_t)mem.texture_cache;
+			info.sparse = (uint64_t)mem.sparse_grid;
+
+			if(mem.sparse_grid) {
+				/* Memory only holds the packed bricks, dimensions come from
+				 * the grid. */
+				const SparseGrid *grid = (const SparseGrid*)mem.sparse_grid;
+				info.width = grid->width;
+				info.height = grid->height;
+				info.depth = grid->depth;
+			}
 
 			need_texture_info = true;
 		}
@@ -422,6 +497,12 @@ public:
 
 	void tex_free(device_memory& mem)
 	{
+		if(use_numa_replication && mem.interpolation == INTERPOLATION_NONE) {
+			thread_scoped_lock lock(numa_mutex);
+			numa_textures_remove(mem.name);
+			numa_data_textures.erase(mem.name);
+		}
+
 		if(mem.device_pointer) {
 			mem.device_pointer = 0;
 			stats.mem_free(mem.device_size);
@@ -430,6 +511,59 @@ public:
 		}
 	}
 
+	void numa_texture_free(NUMATexture& texture)
+	{
+		util_aligned_free(texture.data);
+		stats.mem_free(texture.size);
+	}
+
+	/* Drop the copies of a data texture on all nodes, lock must be held. */
+	void numa_textures_remove(const string& name)
+	{
+		for(int node = 0; node < numa_textures.size(); node++) {
+			NUMATextureMap::iterator it = numa_textures[node].find(name);
+			if(it != numa_textures[node].end()) {
+				numa_texture_free(it->second);
+				numa_textures[node].erase(it);
+			}
+		}
+	}
+
+	/* Point the kernel globals to the copies of data textures on the node of
+	 * the calling thread, copying the textures there when needed. */
+	void numa_kernel_globals_init(KernelGlobals *kg)
+	{
+		const int node = system_cpu_current_numa_node();
+		if(node < 0 || node >= numa_textures.size()) {
+			return;
+		}
+
+		thread_scoped_lock lock(numa_mutex);
+		NUMATextureMap& textures = numa_textures[node];
+
+		for(map<string, device_memory*>::iterator it = numa_data_textures.begin();
+		    it != numa_data_textures.end();
+		    it++)
+		{
+			device_memory& mem = *it->second;
+			if(!mem.host_pointer) {
+				continue;
+			}
+
+			NUMATextureMap::iterator copy = textures.find(it->first);
+			if(copy == textures.end()) {
+				NUMATexture texture;
+				texture.size = mem.memory_size();
+				texture.data = util_aligned_malloc(texture.size, MIN_ALIGNMENT_CPU_DATA_TYPES);
+				memcpy(texture.data, mem.host_pointer, texture.size);
+				stats.mem_alloc(texture.size);
+				copy = textures.insert(NUMATextureMap::value_type(it->first, texture)).first;
+			}
+
+			kernel_tex_copy(kg, mem.name, copy->second.data, mem.data_size);
+		}
+	}
+
 	void *osl_memory()
 	{
 #ifdef WITH_OSL
@@ -684,6 +818,45 @@ public:
 		return true;
 	}
 
+	/* Test pixels of the tile for convergence, returns the number of pixels
+	 * that still need samples. */
+	int adaptive_sampling_filter(KernelGlobals *kg, RenderTile &tile, int sample)
+	{
+		float *render_buffer = (float*)tile.buffer;
+
+		for(int y = tile.y; y < tile.y + tile.h; y++) {
+			for(int x = tile.x; x < tile.x + tile.w; x++) {
+				adaptive_stopping_kernel()(kg, render_buffer,
+				                           sample, x, y, tile.offset, tile.stride);
+			}
+		}
+
+		for(int y = tile.y; y < tile.y + tile.h; y++) {
+			adaptive_filter_x_kernel()(kg, render_buffer,
+			                           sample, y, tile.x, tile.w, tile.offset, tile.stride);
+		}
+
+		int num_active = 0;
+		for(int x = tile.x; x < tile.x + tile.w; x++) {
+			num_active += adaptive_filter_y_kernel()(kg, render_buffer,
+			                                         sample, x, tile.y, tile.h, tile.offset, tile.stride);
+		}
+
+		return num_active;
+	}
+
+	void adaptive_sampling_post_process(KernelGlobals *kg, RenderTile &tile)
+	{
+		float *render_buffer = (float*)tile.buffer;
+
+		for(int y = tile.y; y < tile.y + tile.h; y++) {
+			for(int x = tile.x; x < tile.x + tile.w; x++) {
+				adaptive_adjust_samples_kernel()(kg, render_buffer,
+				                                 tile.sample, x, y, tile.offset, tile.stride);
+			}
+		}
+	}
+
 	void path_trace(DeviceTask &task, RenderTile &tile, KernelGlobals *kg)
 	{
 		scoped_timer timer(&tile.buffers->render_time);
@@ -692,23 +865,65 @@ public:
 		int start_sample = tile.start_sample;
 		int end_sample = tile.start_sample + tile.num_samples;
 
+		const bool use_adaptive_sampling = (kg->__data.film.pass_adaptive_aux_buffer != 0);
+		const int adaptive_min_samples = kg->__data.integrator.adaptive_min_samples;
+		const int adaptive_step = kg->__data.integrator.adaptive_step;
+		int num_active_pixels = tile.w*tile.h;
+
+		tile.pixel_samples = 0;
+
 		for(int sample = start_sample; sample < end_sample; sample++) {
 			if(task.get_cancel() || task_pool.canceled()) {
 				if(task.need_finish_queue == false)
 					break;
 			}
 
-			for(int y = tile.y; y < tile.y + tile.h; y++) {
-				for(int x = tile.x; x < tile.x + tile.w; x++) {
-					path_trace_kernel()(kg, render_buffer,
-					                    sample, x, y, tile.offset, tile.stride);
+			if(use_packet_traversal) {
+				/* Spans of neighbor pixels in a row are coherent enough to
+				 * trace their camera rays together. */
+				for(int y = tile.y; y < tile.y + tile.h; y++) {
+					for(int x = tile.x; x < tile.x + tile.w; x += BVH_PACKET_SIZE) {
+						int num_pixels = min(BVH_PACKET_SIZE, tile.x + tile.w - x);
+						path_trace_packet_kernel()(kg, render_buffer,
+						                           sample, x, y, num_pixels,
+						                           tile.offset, tile.stride);
+					}
+				}
+			}
+			else {
+				for(int y = tile.y; y < tile.y + tile.h; y++) {
+					for(int x = tile.x; x < tile.x + tile.w; x++) {
+						path_trace_kernel()(kg, render_buffer,
+						                    sample, x, y, tile.offset, tile.stride);
+					}
 				}
 			}
 
 			tile.sample = sample + 1;
+			tile.pixel_samples += num_active_pixels;
+
+			if(use_adaptive_sampling &&
+			   tile.sample >= adaptive_min_samples &&
+			   (tile.sample % adaptive_step) == 0)
+			{
+				num_active_pixels = adaptive_sampling_filter(kg, tile, tile.sample);
+
+				if(num_active_pixels == 0) {
+					/* Whole tile converged, passes get scaled to the full
+					 * sample count and the skipped samples count as done for
+					 * the progress. */
+					tile.sample = end_sample;
+					task.update_progress(&tile, tile.w*tile.h*(end_sample - sample));
+					break;
+				}
+			}
 
 			task.update_progress(&tile, tile.w*tile.h);
 		}
+
+		if(use_adaptive_sampling) {
+			adaptive_sampling_post_process(kg, tile);
+		}
 	}
 
 	void denoise(DeviceTask &task, DenoisingTask& denoising, RenderTile &tile)
@@ -765,7 +980,14 @@ public:
 			}
 		}
 
+#ifdef WITH_CYCLES_PROFILING
+		if(task.profiler) {
+			task.profiler->add_state(&kg->profiler);
+		}
+#endif
+
 		RenderTile tile;
+		tile.thread = task.thread_index;
 		DenoisingTask denoising(this);
 
 		while(task.acquire_tile(this, tile)) {
@@ -790,6 +1012,12 @@ public:
 			}
 		}
 
+#ifdef WITH_CYCLES_PROFILING
+		if(task.profiler) {
+			task.profiler->remove_state(&kg->profiler);
+		}
+#endif
+
 		thread_kernel_globals_free((KernelGlobals*)kgbuffer.device_pointer);
 		kg->~KernelGlobals();
 		kgbuffer.free();
@@ -894,6 +1122,9 @@ protected:
 #ifdef WITH_OSL
 		OSLShader::thread_init(&kg, &kernel_globals, &osl_globals);
 #endif
+		if(use_numa_replication) {
+			numa_kernel_globals_init(&kg);
+		}
 		return kg;
 	}
 
@@ -1050,6 +1281,11 @@ void device_cpu_info(vector<DeviceInfo>& devices)
 	if (system_cpu_support_sse2()) {
 		info.bvh_layout_mask |= BVH_LAYOUT_BVH4;
 	}
+#ifdef WITH_CYCLES_OPTIMIZED_KERNEL_AVX2
+	if (system_cpu_support_avx2()) {
+		info.bvh_layout_mask |= BVH_LAYOUT_BVH8;
+	}
+#endif
 	info.has_volume_decoupled = true;
 	info.has_osl = true;
 	info.has_half_images = true;
@@ -1222,6 +1222,8 @@ public:
 		info.width = mem.data_width;
 		info.height = mem.data_height;
 		info.depth = mem.data_depth;
+		info.cache = 0;
+		info.sparse = 0;
 		need_texture_info = true;
 	}
 
@@ -2074,6 +2076,7 @@ public:
 
 			/* keep rendering tiles until done */
 			RenderTile tile;
+			tile.thread = task->thread_index;
 			DenoisingTask denoising(this);
 
 			while(task->acquire_tile(this, tile)) {
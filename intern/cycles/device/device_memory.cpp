@@ -33,6 +33,8 @@ device_memory::device_memory(Device *device, const char *name, MemoryType type)
   name(name),
   interpolation(INTERPOLATION_NONE),
   extension(EXTENSION_REPEAT),
+  texture_cache(NULL),
+  sparse_grid(NULL),
   device(device),
   device_pointer(0),
   host_pointer(0),
@@ -191,6 +191,10 @@ public:
 	const char *name;
 	InterpolationType interpolation;
 	ExtensionType extension;
+	/* Image loaded on demand through the CPU texture cache. */
+	void *texture_cache;
+	/* Volume stored as packed bricks of a sparse voxel grid on the CPU. */
+	void *sparse_grid;
 
 	/* Pointers. */
 	Device *device;
@@ -202,6 +206,7 @@ public:
 
 protected:
 	friend class CUDADevice;
+	friend class SharedMemoryBuffer;
 
 	/* Only create through subclasses. */
 	device_memory(Device *device, const char *name, MemoryType type);
@@ -366,6 +371,21 @@ public:
 		assert(device_pointer == 0);
 	}
 
+	/* Give data back to an array, freeing device memory. */
+	void give_data(array<T>& to)
+	{
+		device_free();
+
+		to.set_data((T*)host_pointer, data_size);
+
+		data_size = 0;
+		data_width = 0;
+		data_height = 0;
+		data_depth = 0;
+		host_pointer = 0;
+		assert(device_pointer == 0);
+	}
+
 	/* Free device and host memory. */
 	void free()
 	{
@@ -74,6 +74,12 @@ public:
 				devices.push_back(SubDevice(device));
 		}
 #endif
+
+		/* Total number of threads acquiring tiles, see task_add(). */
+		this->info.cpu_threads = 0;
+		foreach(SubDevice& sub, devices) {
+			this->info.cpu_threads += max(sub.device->info.cpu_threads, 1);
+		}
 	}
 
 	~MultiDevice()
@@ -356,11 +362,21 @@ public:
 		list<DeviceTask> tasks;
 		task.split(tasks, devices.size());
 
+		/* Render threads of different devices must not share a tile queue,
+		 * so each device gets its own range of thread indices. GPU devices
+		 * use a single thread. */
+		int thread_index = task.thread_index;
+
 		foreach(SubDevice& sub, devices) {
 			if(!tasks.empty()) {
 				DeviceTask subtask = tasks.front();
 				tasks.pop_front();
 
+				if(task.type == DeviceTask::RENDER) {
+					subtask.thread_index = thread_index;
+					thread_index += max(sub.device->info.cpu_threads, 1);
+				}
+
 				if(task.buffer) subtask.buffer = sub.ptr_map[task.buffer];
 				if(task.rgba_byte) subtask.rgba_byte = sub.ptr_map[task.rgba_byte];
 				if(task.rgba_half) subtask.rgba_half = sub.ptr_map[task.rgba_half];
@@ -20,6 +20,7 @@
 
 #include "util/util_foreach.h"
 #include "util/util_logging.h"
+#include "util/util_time.h"
 
 #if defined(WITH_NETWORK)
 
@@ -49,6 +50,11 @@ public:
 	device_ptr mem_counter;
 	DeviceTask the_task; /* todo: handle multiple tasks */
 
+	/* Buffers exchanged through shared memory with a server on the same host. */
+	bool use_shared_memory;
+	string shared_memory_prefix;
+	SharedMemoryMap shared_buffers;
+
 	thread_mutex rpc_lock;
 
 	virtual bool show_samples() const
@@ -79,12 +85,53 @@ public:
 			error_func.network_error(error.message());
 
 		mem_counter = 0;
+		use_shared_memory = false;
+
+		if(!error && socket.remote_endpoint().address().is_loopback())
+			shared_memory_init();
 	}
 
 	~NetworkDevice()
 	{
 		RPCSend snd(socket, &error_func, "stop");
 		snd.write();
+
+		foreach(SharedMemoryMap::value_type& it, shared_buffers)
+			delete it.second;
+	}
+
+	void shared_memory_init()
+	{
+		/* Segment names must be unique across processes on the host. */
+		uint64_t token = (uint64_t)(time_dt() * 1e6);
+		shared_memory_prefix = string_printf("cycles_%llx_%p",
+		                                     (unsigned long long)token,
+		                                     (void*)this);
+
+		/* Let the server verify it can map memory from this process, it may
+		 * still be on another host behind a forwarded port or in a container. */
+		SharedMemoryBuffer test;
+		if(!test.create(shared_memory_prefix + "_test", sizeof(token)))
+			return;
+
+		memcpy(test.data, &token, sizeof(token));
+
+		RPCSend snd(socket, &error_func, "shared_memory");
+		snd.add(test.name);
+		snd.add(token);
+		snd.write();
+
+		RPCReceive rcv(socket, &error_func);
+		rcv.read(use_shared_memory);
+
+		VLOG(1) << "Network device shared memory "
+		        << (use_shared_memory? "enabled.": "not supported by server.");
+	}
+
+	SharedMemoryBuffer *shared_buffer_find(device_ptr client_pointer)
+	{
+		SharedMemoryMap::iterator i = shared_buffers.find(client_pointer);
+		return (i != shared_buffers.end())? i->second: NULL;
 	}
 
 	void mem_alloc(device_memory& mem)
@@ -99,20 +146,54 @@ public:
 
 		mem.device_pointer = ++mem_counter;
 
+		/* Empty name when the buffer goes over the socket. */
+		SharedMemoryBuffer *shared = NULL;
+		if(use_shared_memory && mem.memory_size()) {
+			shared = new SharedMemoryBuffer();
+			string name = string_printf("%s_%llu",
+			                            shared_memory_prefix.c_str(),
+			                            (unsigned long long)mem.device_pointer);
+			if(!shared->create(name, mem.memory_size())) {
+				delete shared;
+				shared = NULL;
+			}
+		}
+
 		RPCSend snd(socket, &error_func, "mem_alloc");
 		snd.add(mem);
+		snd.add(shared? shared->name: string());
 		snd.write();
+
+		if(shared) {
+			bool mapped;
+			RPCReceive rcv(socket, &error_func);
+			rcv.read(mapped);
+
+			if(mapped) {
+				shared_buffers[mem.device_pointer] = shared;
+				shared->map_host(mem);
+			}
+			else {
+				delete shared;
+			}
+		}
 	}
 
 	void mem_copy_to(device_memory& mem)
 	{
 		thread_scoped_lock lock(rpc_lock);
 
+		SharedMemoryBuffer *shared = shared_buffer_find(mem.device_pointer);
+		if(shared && mem.host_pointer != shared->data)
+			memcpy(shared->data, mem.host_pointer, std::min<size_t>(mem.memory_size(), shared->size));
+
 		RPCSend snd(socket, &error_func, "mem_copy_to");
 
 		snd.add(mem);
 		snd.write();
-		snd.write_buffer(mem.host_pointer, mem.memory_size());
+
+		if(!shared)
+			snd.write_buffer(mem.host_pointer, mem.memory_size());
 	}
 
 	void mem_copy_from(device_memory& mem, int y, int w, int h, int elem)
@@ -131,7 +212,24 @@ public:
 		snd.write();
 
 		RPCReceive rcv(socket, &error_func);
-		rcv.read_buffer(mem.host_pointer, data_size);
+
+		SharedMemoryBuffer *shared = shared_buffer_find(mem.device_pointer);
+		if(shared) {
+			if(mem.host_pointer == shared->data) {
+				/* The server wrote the rows into our host memory. */
+				return;
+			}
+
+			/* Only the requested rows, the server wrote them into the segment. */
+			size_t offset = (size_t)elem*y*w;
+			size_t size = (size_t)elem*w*h;
+
+			if(offset + size <= std::min<size_t>(data_size, shared->size))
+				memcpy((uchar*)mem.host_pointer + offset, (uchar*)shared->data + offset, size);
+		}
+		else {
+			rcv.read_buffer(mem.host_pointer, data_size);
+		}
 	}
 
 	void mem_zero(device_memory& mem)
@@ -154,6 +252,14 @@ public:
 			snd.add(mem);
 			snd.write();
 
+			/* Server keeps its mapping until it processed the free. */
+			SharedMemoryMap::iterator i = shared_buffers.find(mem.device_pointer);
+			if(i != shared_buffers.end()) {
+				i->second->unmap_host(mem);
+				delete i->second;
+				shared_buffers.erase(i);
+			}
+
 			mem.device_pointer = 0;
 		}
 	}
@@ -181,7 +287,6 @@ public:
 
 		RPCSend snd(socket, &error_func, "load_kernels");
 		snd.add(requested_features.experimental);
-		snd.add(requested_features.max_closure);
 		snd.add(requested_features.max_nodes_group);
 		snd.add(requested_features.nodes_features);
 		snd.write();
@@ -221,6 +326,7 @@ public:
 				break;
 
 			RenderTile tile;
+			tile.thread = the_task.thread_index;
 
 			lock.lock();
 			RPCReceive rcv(socket, &error_func);
@@ -328,6 +434,12 @@ public:
 		error_func = NetworkError();
 	}
 
+	~DeviceServer()
+	{
+		foreach(SharedMemoryMap::value_type& it, mem_shared)
+			delete it.second;
+	}
+
 	void listen()
 	{
 		/* receive remote function calls */
@@ -377,6 +489,41 @@ protected:
 		return i->second;
 	}
 
+	/* map a shared memory segment created by the client and insert it into mem_shared */
+	SharedMemoryBuffer *shared_buffer_insert(device_ptr client_pointer, const string& name, size_t data_size)
+	{
+		SharedMemoryBuffer *shared = new SharedMemoryBuffer();
+
+		if(!shared->open(name, data_size)) {
+			delete shared;
+			return NULL;
+		}
+
+		pair<SharedMemoryMap::iterator,bool> shared_ins = mem_shared.insert(
+		        SharedMemoryMap::value_type(client_pointer, shared));
+		assert(shared_ins.second);
+		(void)shared_ins;
+
+		return shared;
+	}
+
+	SharedMemoryBuffer *shared_buffer_find(device_ptr client_pointer)
+	{
+		SharedMemoryMap::iterator i = mem_shared.find(client_pointer);
+		return (i != mem_shared.end())? i->second: NULL;
+	}
+
+	/* host side memory of the buffer, shared with the client or received over the network */
+	void *host_pointer_find(device_ptr client_pointer)
+	{
+		SharedMemoryBuffer *shared = shared_buffer_find(client_pointer);
+		if(shared)
+			return shared->data;
+
+		DataVector &data_v = data_vector_find(client_pointer);
+		return (data_v.size())? (void*)&data_v[0]: 0;
+	}
+
 	/* setup mapping and reverse mapping of client_pointer<->real_pointer */
 	void pointer_mapping_insert(device_ptr client_pointer, device_ptr real_pointer)
 	{
@@ -413,10 +560,17 @@ protected:
 		assert(irev != ptr_imap.end());
 		ptr_imap.erase(irev);
 
-		/* erase the data vector */
-		DataMap::iterator idata = mem_data.find(client_pointer);
-		assert(idata != mem_data.end());
-		mem_data.erase(idata);
+		/* erase the data vector or shared memory mapping */
+		SharedMemoryMap::iterator ishared = mem_shared.find(client_pointer);
+		if(ishared != mem_shared.end()) {
+			delete ishared->second;
+			mem_shared.erase(ishared);
+		}
+		else {
+			DataMap::iterator idata = mem_data.find(client_pointer);
+			assert(idata != mem_data.end());
+			mem_data.erase(idata);
+		}
 
 		return result;
 	}
@@ -429,17 +583,33 @@ protected:
 	void process(RPCReceive& rcv, thread_scoped_lock &lock)
 	{
 		if(rcv.name == "mem_alloc") {
-			string name;
+			string name, shared_name;
 			network_device_memory mem(device);
 			rcv.read(mem, name);
-			lock.unlock();
+			rcv.read(shared_name);
 
-			/* Allocate host side data buffer. */
 			size_t data_size = mem.memory_size();
 			device_ptr client_pointer = mem.device_pointer;
 
-			DataVector &data_v = data_vector_insert(client_pointer, data_size);
-			mem.host_pointer = (data_size)? (void*)&(data_v[0]): 0;
+			/* Map the client's shared memory segment if it created one. */
+			SharedMemoryBuffer *shared = NULL;
+			if(!shared_name.empty()) {
+				shared = shared_buffer_insert(client_pointer, shared_name, data_size);
+
+				RPCSend snd(socket, &error_func, "mem_alloc");
+				snd.add(shared != NULL);
+				snd.write();
+			}
+			lock.unlock();
+
+			if(shared) {
+				mem.host_pointer = shared->data;
+			}
+			else {
+				/* Allocate host side data buffer. */
+				DataVector &data_v = data_vector_insert(client_pointer, data_size);
+				mem.host_pointer = (data_size)? (void*)&(data_v[0]): 0;
+			}
 
 			/* Perform the allocation on the actual device. */
 			device->mem_alloc(mem);
@@ -458,8 +628,7 @@ protected:
 
 			if(client_pointer) {
 				/* Lookup existing host side data buffer. */
-				DataVector &data_v = data_vector_find(client_pointer);
-				mem.host_pointer = (void*)&data_v[0];
+				mem.host_pointer = host_pointer_find(client_pointer);
 
 				/* Translate the client pointer to a real device pointer. */
 				mem.device_pointer = device_ptr_from_client_pointer(client_pointer);
@@ -470,8 +639,10 @@ protected:
 				mem.host_pointer = (data_size)? (void*)&(data_v[0]): 0;
 			}
 
-			/* Copy data from network into memory buffer. */
-			rcv.read_buffer((uint8_t*)mem.host_pointer, data_size);
+			/* Copy data from network into memory buffer, shared memory
+			 * already contains it. */
+			if(!(client_pointer && shared_buffer_find(client_pointer)))
+				rcv.read_buffer((uint8_t*)mem.host_pointer, data_size);
 
 			/* Copy the data from the memory buffer to the device buffer. */
 			device->mem_copy_to(mem);
@@ -495,17 +666,17 @@ protected:
 			device_ptr client_pointer = mem.device_pointer;
 			mem.device_pointer = device_ptr_from_client_pointer(client_pointer);
 
-			DataVector &data_v = data_vector_find(client_pointer);
-
-			mem.host_pointer = (device_ptr)&(data_v[0]);
+			mem.host_pointer = host_pointer_find(client_pointer);
 
 			device->mem_copy_from(mem, y, w, h, elem);
 
 			size_t data_size = mem.memory_size();
 
+			/* Client reads shared memory directly. */
 			RPCSend snd(socket, &error_func, "mem_copy_from");
 			snd.write();
-			snd.write_buffer((uint8_t*)mem.host_pointer, data_size);
+			if(!shared_buffer_find(client_pointer))
+				snd.write_buffer((uint8_t*)mem.host_pointer, data_size);
 			lock.unlock();
 		}
 		else if(rcv.name == "mem_zero") {
@@ -519,8 +690,7 @@ protected:
 
 			if(client_pointer) {
 				/* Lookup existing host side data buffer. */
-				DataVector &data_v = data_vector_find(client_pointer);
-				mem.host_pointer = (void*)&data_v[0];
+				mem.host_pointer = host_pointer_find(client_pointer);
 
 				/* Translate the client pointer to a real device pointer. */
 				mem.device_pointer = device_ptr_from_client_pointer(client_pointer);
@@ -528,7 +698,7 @@ protected:
 			else {
 				/* Allocate host side data buffer. */
 				DataVector &data_v = data_vector_insert(client_pointer, data_size);
-				mem.host_pointer = (void*)? (device_ptr)&(data_v[0]): 0;
+				mem.host_pointer = (data_size)? (void*)&(data_v[0]): 0;
 			}
 
 			/* Zero memory. */
@@ -552,6 +722,23 @@ protected:
 
 			device->mem_free(mem);
 		}
+		else if(rcv.name == "shared_memory") {
+			string name;
+			uint64_t token;
+
+			rcv.read(name);
+			rcv.read(token);
+
+			/* Check that we see the same segment as the client. */
+			SharedMemoryBuffer test;
+			bool result = test.open(name, sizeof(token)) &&
+			              memcmp(test.data, &token, sizeof(token)) == 0;
+
+			RPCSend snd(socket, &error_func, "shared_memory");
+			snd.add(result);
+			snd.write();
+			lock.unlock();
+		}
 		else if(rcv.name == "const_copy_to") {
 			string name_string;
 			size_t size;
@@ -568,7 +755,6 @@ protected:
 		else if(rcv.name == "load_kernels") {
 			DeviceRequestedFeatures requested_features;
 			rcv.read(requested_features.experimental);
-			rcv.read(requested_features.max_closure);
 			rcv.read(requested_features.max_nodes_group);
 			rcv.read(requested_features.nodes_features);
 
@@ -748,6 +934,7 @@ protected:
 	PtrMap ptr_map;
 	PtrMap ptr_imap;
 	DataMap mem_data;
+	SharedMemoryMap mem_shared;
 
 	struct AcquireEntry {
 		string name;
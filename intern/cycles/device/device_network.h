@@ -26,6 +26,8 @@
 #include <boost/array.hpp>
 #include <boost/asio.hpp>
 #include <boost/bind.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
 #include <boost/serialization/vector.hpp>
 #include <boost/thread.hpp>
 
@@ -37,6 +39,7 @@
 
 #include "util/util_foreach.h"
 #include "util/util_list.h"
+#include "util/util_logging.h"
 #include "util/util_map.h"
 #include "util/util_param.h"
 #include "util/util_string.h"
@@ -106,6 +109,126 @@ private:
 	int error_count;
 };
 
+/* Shared memory buffer
+ *
+ * When client and server run on the same host, device memory is exchanged
+ * through shared memory instead of being written to the socket. The client
+ * creates a segment for each allocated buffer and both processes use the
+ * mapping directly as host memory of the buffer, so data is never copied
+ * between them. Only the RPC messages themselves go over the socket then. */
+
+class SharedMemoryBuffer {
+public:
+	SharedMemoryBuffer()
+	: data(NULL), size(0), owner(false)
+	{
+	}
+
+	~SharedMemoryBuffer()
+	{
+		close();
+	}
+
+	/* Create a new segment, fails if one with the same name exists. */
+	bool create(const string& name_, size_t size_)
+	{
+		using namespace boost::interprocess;
+
+		try {
+			shared_memory_object segment(create_only, name_.c_str(), read_write);
+			owner = true;
+			name = name_;
+			segment.truncate(size_);
+			mapped_region(segment, read_write).swap(region);
+		}
+		catch(interprocess_exception& e) {
+			/* Not fatal, the buffer goes over the socket instead. */
+			VLOG(1) << "Shared memory create error: " << e.what();
+			close();
+			return false;
+		}
+
+		data = region.get_address();
+		size = size_;
+		return true;
+	}
+
+	/* Map a segment created by the other process. */
+	bool open(const string& name_, size_t size_)
+	{
+		using namespace boost::interprocess;
+
+		try {
+			shared_memory_object segment(open_only, name_.c_str(), read_write);
+			mapped_region(segment, read_write).swap(region);
+		}
+		catch(interprocess_exception& e) {
+			VLOG(1) << "Shared memory open error: " << e.what();
+			close();
+			return false;
+		}
+
+		if(region.get_size() < size_) {
+			close();
+			return false;
+		}
+
+		name = name_;
+		data = region.get_address();
+		size = size_;
+		return true;
+	}
+
+	/* Use the mapping as host memory of the buffer, like mapped host memory
+	 * on CUDA, so it is not copied on this side either. */
+	void map_host(device_memory& mem)
+	{
+		if(mem.host_pointer && !mem.shared_pointer) {
+			memcpy(data, mem.host_pointer, std::min<size_t>(mem.memory_size(), size));
+			mem.host_free();
+			mem.host_pointer = data;
+			mem.shared_pointer = data;
+		}
+	}
+
+	/* Give the buffer its own host memory again before the mapping goes
+	 * away, freeing device memory must keep the host data valid. */
+	void unmap_host(device_memory& mem)
+	{
+		if(mem.host_pointer == data) {
+			mem.host_pointer = mem.host_alloc(mem.memory_size());
+			if(mem.host_pointer) {
+				memcpy(mem.host_pointer, data, std::min<size_t>(mem.memory_size(), size));
+			}
+		}
+		if(mem.shared_pointer == data) {
+			mem.shared_pointer = 0;
+		}
+	}
+
+	void close()
+	{
+		/* Existing mappings stay valid after removing the name. */
+		if(owner) {
+			boost::interprocess::shared_memory_object::remove(name.c_str());
+			owner = false;
+		}
+
+		boost::interprocess::mapped_region().swap(region);
+		data = NULL;
+		size = 0;
+	}
+
+	string name;
+	void *data;
+	size_t size;
+
+protected:
+	bool owner;
+	boost::interprocess::mapped_region region;
+};
+
+typedef map<device_ptr, SharedMemoryBuffer*> SharedMemoryMap;
 
 /* Remote procedure call Send */
 
@@ -32,7 +32,8 @@ DeviceTask::DeviceTask(Type type_)
 : type(type_), x(0), y(0), w(0), h(0), rgba_byte(0), rgba_half(0), buffer(0),
   sample(0), num_samples(1),
   shader_input(0), shader_output(0),
-  shader_eval_type(0), shader_filter(0), shader_x(0), shader_w(0)
+  shader_eval_type(0), shader_filter(0), shader_x(0), shader_w(0),
+  thread_index(0), profiler(NULL)
 {
 	last_update_time = time_dt();
 }
@@ -83,8 +84,11 @@ void DeviceTask::split(list<DeviceTask>& tasks, int num, int max_size)
 		}
 	}
 	else if(type == RENDER) {
-		for(int i = 0; i < num; i++)
-			tasks.push_back(*this);
+		for(int i = 0; i < num; i++) {
+			DeviceTask task = *this;
+			task.thread_index = thread_index + i;
+			tasks.push_back(task);
+		}
 	}
 	else {
 		for(int i = 0; i < num; i++) {
@@ -28,6 +28,7 @@ CCL_NAMESPACE_BEGIN
 /* Device Task */
 
 class Device;
+class Profiler;
 class RenderBuffers;
 class RenderTile;
 class Tile;
@@ -53,6 +54,11 @@ public:
 
 	int passes_size;
 
+	/* Index of the subtask after splitting, for render tasks this is the
+	 * thread acquiring tiles. Multi devices give every device its own range
+	 * of thread indices, starting at the index of the task being split. */
+	int thread_index;
+
 	explicit DeviceTask(Type type = RENDER);
 
 	int get_subtask_count(int num, int max_size = 0);
@@ -79,6 +85,9 @@ public:
 	bool need_finish_queue;
 	bool integrator_branched;
 	int2 requested_tile_size;
+
+	/* Sampling profiler of the render threads, NULL when not profiling. */
+	Profiler *profiler;
 protected:
 	double last_update_time;
 };
@@ -107,6 +107,7 @@ public:
 		}
 		else if(task->type == DeviceTask::RENDER) {
 			RenderTile tile;
+			tile.thread = task->thread_index;
 			DenoisingTask denoising(this);
 
 			/* Keep rendering tiles until done. */
@@ -129,6 +129,7 @@ public:
 		}
 		else if(task->type == DeviceTask::RENDER) {
 			RenderTile tile;
+			tile.thread = task->thread_index;
 			DenoisingTask denoising(this);
 
 			/* Allocate buffer for kernel globals */
@@ -34,6 +34,11 @@ CCL_NAMESPACE_BEGIN
 #  include "kernel/bvh/qbvh_nodes.h"
 #endif
 
+/* Common OBVH functions. */
+#ifdef __OBVH__
+#  include "kernel/bvh/obvh_nodes.h"
+#endif
+
 /* Regular BVH traversal */
 
 #include "kernel/bvh/bvh_nodes.h"
@@ -152,6 +157,15 @@ CCL_NAMESPACE_BEGIN
 #  endif
 #endif  /* __VOLUME_RECORD_ALL__ */
 
+/* Packet traversal of coherent rays */
+
+#if defined(__BVH_PACKET__)
+#  include "kernel/bvh/qbvh_packet.h"
+#  ifdef __OBVH__
+#    include "kernel/bvh/obvh_packet.h"
+#  endif
+#endif  /* __BVH_PACKET__ */
+
 #undef BVH_FEATURE
 #undef BVH_NAME_JOIN
 #undef BVH_NAME_EVAL
@@ -166,6 +180,8 @@ ccl_device_intersect bool scene_intersect(KernelGlobals *kg,
                                           float difl,
                                           float extmax)
 {
+	PROFILING_INIT(kg, PROFILING_INTERSECT);
+
 #ifdef __OBJECT_MOTION__
 	if(kernel_data.bvh.have_motion) {
 #  ifdef __HAIR__
@@ -201,6 +217,63 @@ ccl_device_intersect bool scene_intersect(KernelGlobals *kg,
 #endif /* __KERNEL_CPU__ */
 }
 
+#ifdef __BVH_PACKET__
+/* Packet traversal only handles flat triangle BVHs, scenes with instancing,
+ * motion blur or hair have to trace rays one by one. */
+ccl_device_inline bool scene_intersect_packet_supported(KernelGlobals *kg)
+{
+	if(kernel_data.bvh.have_motion ||
+	   kernel_data.bvh.have_curves ||
+	   kernel_data.bvh.have_instancing)
+	{
+		return false;
+	}
+	switch(kernel_data.bvh.bvh_layout) {
+#ifdef __OBVH__
+		case BVH_LAYOUT_BVH8:
+#endif
+		case BVH_LAYOUT_BVH4:
+			return true;
+		default:
+			return false;
+	}
+}
+
+/* Intersect up to BVH_PACKET_SIZE coherent rays, returns a bitmask of the
+ * rays that hit something. With PATH_RAY_SHADOW_OPAQUE visibility any hit
+ * terminates a ray, as for regular shadow rays. A single ray is traced with
+ * the regular traversal. */
+ccl_device_intersect uint scene_intersect_packet(KernelGlobals *kg,
+                                                 const Ray *rays,
+                                                 Intersection *isects,
+                                                 int num_rays,
+                                                 const uint visibility)
+{
+	PROFILING_INIT(kg, PROFILING_INTERSECT);
+
+	if(num_rays > 1 && scene_intersect_packet_supported(kg)) {
+		switch(kernel_data.bvh.bvh_layout) {
+#ifdef __OBVH__
+			case BVH_LAYOUT_BVH8:
+				return obvh_intersect_packet(kg, rays, isects, num_rays, visibility);
+#endif
+			case BVH_LAYOUT_BVH4:
+				return qbvh_intersect_packet(kg, rays, isects, num_rays, visibility);
+			default:
+				break;
+		}
+	}
+
+	uint hit_mask = 0;
+	for(int i = 0; i < num_rays; i++) {
+		if(scene_intersect(kg, rays[i], visibility, &isects[i], NULL, 0.0f, 0.0f)) {
+			hit_mask |= (1u << i);
+		}
+	}
+	return hit_mask;
+}
+#endif  /* __BVH_PACKET__ */
+
 #ifdef __BVH_LOCAL__
 /* Note: ray is passed by value to work around a possible CUDA compiler bug. */
 ccl_device_intersect void scene_intersect_local(KernelGlobals *kg,
@@ -210,6 +283,8 @@ ccl_device_intersect void scene_intersect_local(KernelGlobals *kg,
                                                 uint *lcg_state,
                                                 int max_hits)
 {
+	PROFILING_INIT(kg, PROFILING_INTERSECT_LOCAL);
+
 #ifdef __OBJECT_MOTION__
 	if(kernel_data.bvh.have_motion) {
 		return bvh_intersect_local_motion(kg,
@@ -237,6 +312,8 @@ ccl_device_intersect bool scene_intersect_shadow_all(KernelGlobals *kg,
                                                      uint max_hits,
                                                      uint *num_hits)
 {
+	PROFILING_INIT(kg, PROFILING_INTERSECT_SHADOW_ALL);
+
 #  ifdef __OBJECT_MOTION__
 	if(kernel_data.bvh.have_motion) {
 #    ifdef __HAIR__
@@ -296,6 +373,8 @@ ccl_device_intersect bool scene_intersect_volume(KernelGlobals *kg,
                                                  Intersection *isect,
                                                  const uint visibility)
 {
+	PROFILING_INIT(kg, PROFILING_INTERSECT_VOLUME);
+
 #  ifdef __OBJECT_MOTION__
 	if(kernel_data.bvh.have_motion) {
 		return bvh_intersect_volume_motion(kg, ray, isect, visibility);
@@ -324,6 +403,8 @@ ccl_device_intersect uint scene_intersect_volume_all(KernelGlobals *kg,
                                                      const uint max_hits,
                                                      const uint visibility)
 {
+	PROFILING_INIT(kg, PROFILING_INTERSECT_VOLUME_ALL);
+
 #  ifdef __OBJECT_MOTION__
 	if(kernel_data.bvh.have_motion) {
 		return bvh_intersect_volume_all_motion(kg, ray, isect, max_hits, visibility);
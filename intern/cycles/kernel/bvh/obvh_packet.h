@@ -0,0 +1,209 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Packet traversal of coherent rays through the OBVH.
+ *
+ * Same scheme as obvh_intersect_packet(), with eight children per node.
+ */
+
+ccl_device uint obvh_intersect_packet(KernelGlobals *kg,
+                                      const Ray *rays,
+                                      Intersection *isects,
+                                      const int num_rays,
+                                      const uint visibility)
+{
+	kernel_assert(num_rays <= BVH_PACKET_SIZE);
+
+	/* Traversal stack, items store the subset of rays to traverse with. */
+	BVHPacketStackItem traversal_stack[BVH_OSTACK_SIZE];
+	int stack_ptr = 0;
+
+	/* Ray parameters. */
+	float3 P[BVH_PACKET_SIZE];
+	float3 dir[BVH_PACKET_SIZE];
+	avx3f idir8[BVH_PACKET_SIZE];
+	avx3f P_idir8[BVH_PACKET_SIZE];
+	avxf tfar[BVH_PACKET_SIZE];
+	int near_x[BVH_PACKET_SIZE], near_y[BVH_PACKET_SIZE], near_z[BVH_PACKET_SIZE];
+	int far_x[BVH_PACKET_SIZE], far_y[BVH_PACKET_SIZE], far_z[BVH_PACKET_SIZE];
+
+	uint active_mask = 0;
+	const avxf tnear(0.0f);
+
+	for(int i = 0; i < num_rays; i++) {
+		Intersection *isect = &isects[i];
+
+		isect->t = rays[i].t;
+		isect->u = 0.0f;
+		isect->v = 0.0f;
+		isect->prim = PRIM_NONE;
+		isect->object = OBJECT_NONE;
+
+		BVH_DEBUG_INIT();
+
+		P[i] = rays[i].P;
+		dir[i] = bvh_clamp_direction(rays[i].D);
+		float3 idir = bvh_inverse_direction(dir[i]);
+
+		idir8[i] = avx3f(avxf(idir.x), avxf(idir.y), avxf(idir.z));
+		float3 P_idir = P[i]*idir;
+		P_idir8[i] = avx3f(avxf(P_idir.x), avxf(P_idir.y), avxf(P_idir.z));
+		tfar[i] = avxf(rays[i].t);
+
+		qbvh_near_far_idx_calc(idir,
+		                       &near_x[i], &near_y[i], &near_z[i],
+		                       &far_x[i], &far_y[i], &far_z[i]);
+
+		if(isfinite(P[i].x)) {
+			active_mask |= (1u << i);
+		}
+	}
+
+	traversal_stack[0].addr = kernel_data.bvh.root;
+	traversal_stack[0].ray_mask = active_mask;
+	traversal_stack[0].dist = -FLT_MAX;
+
+	while(stack_ptr >= 0) {
+		/* Pop. */
+		const int node_addr = traversal_stack[stack_ptr].addr;
+		const float node_dist = traversal_stack[stack_ptr].dist;
+		uint ray_mask = traversal_stack[stack_ptr].ray_mask & active_mask;
+		--stack_ptr;
+
+		/* Drop rays that already found a closer hit. */
+		for(uint m = ray_mask; m != 0; ) {
+			const uint i = __bscf(m);
+			if(node_dist > isects[i].t) {
+				ray_mask &= ~(1u << i);
+			}
+		}
+
+		if(ray_mask == 0) {
+			continue;
+		}
+
+		if(node_addr >= 0) {
+			/* Internal node. */
+#ifdef __VISIBILITY_FLAG__
+			float4 inodes = kernel_tex_fetch(__bvh_nodes, node_addr+0);
+			if((__float_as_uint(inodes.x) & visibility) == 0) {
+				continue;
+			}
+#endif
+
+			uint child_rays[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+			float child_dist[8] = {FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX,
+			                       FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX};
+
+			for(uint m = ray_mask; m != 0; ) {
+				const uint i = __bscf(m);
+				avxf dist;
+				int child_mask = obvh_aligned_node_intersect(kg,
+				                                             tnear,
+				                                             tfar[i],
+				                                             P_idir8[i],
+				                                             idir8[i],
+				                                             near_x[i], near_y[i], near_z[i],
+				                                             far_x[i], far_y[i], far_z[i],
+				                                             node_addr,
+				                                             &dist);
+				BVH_DEBUG_NEXT_NODE();
+
+				while(child_mask != 0) {
+					const int c = __bscf(child_mask);
+					child_rays[c] |= (1u << i);
+					child_dist[c] = min(child_dist[c], ((float*)&dist)[c]);
+				}
+			}
+
+			/* Push hit children, farthest first so the closest child is
+			 * traversed next. */
+			const avxf cnodes = kernel_tex_fetch_avxf(__bvh_nodes, node_addr+14);
+			int order[8];
+			int num_children = 0;
+
+			for(int c = 0; c < 8; c++) {
+				if(child_rays[c] == 0) {
+					continue;
+				}
+				int j = num_children++;
+				while(j > 0 && child_dist[order[j - 1]] < child_dist[c]) {
+					order[j] = order[j - 1];
+					--j;
+				}
+				order[j] = c;
+			}
+
+			for(int k = 0; k < num_children; k++) {
+				const int c = order[k];
+				++stack_ptr;
+				kernel_assert(stack_ptr < BVH_OSTACK_SIZE);
+				traversal_stack[stack_ptr].addr = __float_as_int(cnodes[c]);
+				traversal_stack[stack_ptr].ray_mask = child_rays[c];
+				traversal_stack[stack_ptr].dist = child_dist[c];
+			}
+		}
+		else {
+			/* Leaf node. */
+			const float4 leaf = kernel_tex_fetch(__bvh_leaf_nodes, (-node_addr-1));
+#ifdef __VISIBILITY_FLAG__
+			if((__float_as_uint(leaf.z) & visibility) == 0) {
+				continue;
+			}
+#endif
+
+			const int prim_start = __float_as_int(leaf.x);
+			const int prim_end = __float_as_int(leaf.y);
+			kernel_assert(prim_start >= 0);
+			kernel_assert((__float_as_int(leaf.w) & PRIMITIVE_ALL) == PRIMITIVE_TRIANGLE);
+
+			for(uint m = ray_mask; m != 0; ) {
+				const uint i = __bscf(m);
+				Intersection *isect = &isects[i];
+				for(int prim_addr = prim_start; prim_addr < prim_end; prim_addr++) {
+					BVH_DEBUG_NEXT_INTERSECTION();
+					if(triangle_intersect(kg,
+					                      isect,
+					                      P[i],
+					                      dir[i],
+					                      visibility,
+					                      OBJECT_NONE,
+					                      prim_addr))
+					{
+						tfar[i] = avxf(isect->t);
+						/* Shadow ray early termination. */
+						if(visibility & PATH_RAY_SHADOW_OPAQUE) {
+							active_mask &= ~(1u << i);
+							break;
+						}
+					}
+				}
+			}
+
+			if(active_mask == 0) {
+				break;
+			}
+		}
+	}
+
+	uint hit_mask = 0;
+	for(int i = 0; i < num_rays; i++) {
+		if(isects[i].prim != PRIM_NONE) {
+			hit_mask |= (1u << i);
+		}
+	}
+	return hit_mask;
+}
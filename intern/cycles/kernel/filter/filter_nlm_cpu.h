@@ -16,6 +16,10 @@
 
 CCL_NAMESPACE_BEGIN
 
+/* The NLM loops process four pixels of a row at once, with scalar loops for
+ * the pixels at the borders of the rect. Both compute the same values in the
+ * same order, so results do not depend on the position of a pixel in a row. */
+
 ccl_device_inline void kernel_filter_nlm_calc_difference(int dx, int dy,
                                                          const float *ccl_restrict weight_image,
                                                          const float *ccl_restrict variance_image,
@@ -26,10 +30,31 @@ ccl_device_inline void kernel_filter_nlm_calc_difference(int dx, int dy,
                                                          float a,
                                                          float k_2)
 {
+	const int numChannels = channel_offset? 3 : 1;
+	const float4 a4 = make_float4(a);
+	const float4 k_24 = make_float4(k_2);
+	const float4 eps4 = make_float4(1e-8f);
+	const float4 channel_scale4 = make_float4(1.0f/numChannels);
+
 	for(int y = rect.y; y < rect.w; y++) {
-		for(int x = rect.x; x < rect.z; x++) {
+		int x = rect.x;
+		for(; x + 4 <= rect.z; x += 4) {
+			float4 diff = make_float4(0.0f);
+			for(int c = 0; c < numChannels; c++) {
+				const float *p = weight_image + c*channel_offset + y*stride + x;
+				const float *q = weight_image + c*channel_offset + (y+dy)*stride + (x+dx);
+				float4 cdiff = load_float4(p) - load_float4(q);
+				float4 pvar = load_float4(variance_image + c*channel_offset + y*stride + x);
+				float4 qvar = load_float4(variance_image + c*channel_offset + (y+dy)*stride + (x+dx));
+				diff += (cdiff*cdiff - a4*(pvar + min(pvar, qvar))) / (eps4 + k_24*(pvar+qvar));
+			}
+			if(numChannels > 1) {
+				diff = diff * channel_scale4;
+			}
+			store_float4(difference_image + y*stride + x, diff);
+		}
+		for(; x < rect.z; x++) {
 			float diff = 0.0f;
-			int numChannels = channel_offset? 3 : 1;
 			for(int c = 0; c < numChannels; c++) {
 				float cdiff = weight_image[c*channel_offset + y*stride + x] - weight_image[c*channel_offset + (y+dy)*stride + (x+dx)];
 				float pvar = variance_image[c*channel_offset + y*stride + x];
@@ -44,6 +69,33 @@ ccl_device_inline void kernel_filter_nlm_calc_difference(int dx, int dy,
 	}
 }
 
+/* Average over the horizontal window of a pixel, clipped to the rect. */
+ccl_device_inline float kernel_filter_nlm_window_average(const float *ccl_restrict row,
+                                                         int x,
+                                                         int4 rect,
+                                                         int f)
+{
+	const int low = max(rect.x, x-f);
+	const int high = min(rect.z, x+f+1);
+	float sum = 0.0f;
+	for(int x1 = low; x1 < high; x1++) {
+		sum += row[x1];
+	}
+	return sum * (1.0f/(high - low));
+}
+
+/* Same for four pixels whose windows are fully inside the rect. */
+ccl_device_inline float4 kernel_filter_nlm_window_average4(const float *ccl_restrict row,
+                                                           int x,
+                                                           int f)
+{
+	float4 sum = make_float4(0.0f);
+	for(int x1 = x-f; x1 <= x+f; x1++) {
+		sum += load_float4(row + x1);
+	}
+	return sum * make_float4(1.0f/(2*f+1));
+}
+
 ccl_device_inline void kernel_filter_nlm_blur(const float *ccl_restrict difference_image,
                                               float *out_image,
                                               int4 rect,
@@ -86,16 +138,33 @@ ccl_device_inline void kernel_filter_nlm_calc_weight(const float *ccl_restrict d
 		int pos_dx = max(0, dx);
 		int neg_dx = min(0, dx);
 		for(int y = rect.y; y < rect.w; y++) {
-			for(int x = rect.x-neg_dx; x < rect.z-pos_dx; x++) {
-				out_image[y*stride + x] += difference_image[y*stride + x+dx];
+			float *out_row = out_image + y*stride;
+			const float *difference_row = difference_image + y*stride + dx;
+			int x = rect.x-neg_dx;
+			for(; x + 4 <= rect.z-pos_dx; x += 4) {
+				store_float4(out_row + x, load_float4(out_row + x) + load_float4(difference_row + x));
+			}
+			for(; x < rect.z-pos_dx; x++) {
+				out_row[x] += difference_row[x];
 			}
 		}
 	}
+	const float4 scale4 = make_float4(1.0f/(2*f+1));
 	for(int y = rect.y; y < rect.w; y++) {
-		for(int x = rect.x; x < rect.z; x++) {
+		float *out_row = out_image + y*stride;
+		int x = rect.x;
+		for(; x < min(rect.x+f, rect.z); x++) {
+			const int low = max(rect.x, x-f);
+			const int high = min(rect.z, x+f+1);
+			out_row[x] = fast_expf(-max(out_row[x] * (1.0f/(high - low)), 0.0f));
+		}
+		for(; x + 4 + f <= rect.z; x += 4) {
+			store_float4(out_row + x, fast_expf4(-max(load_float4(out_row + x) * scale4, make_float4(0.0f))));
+		}
+		for(; x < rect.z; x++) {
 			const int low = max(rect.x, x-f);
 			const int high = min(rect.z, x+f+1);
-			out_image[y*stride + x] = fast_expf(-max(out_image[y*stride + x] * (1.0f/(high - low)), 0.0f));
+			out_row[x] = fast_expf(-max(out_row[x] * (1.0f/(high - low)), 0.0f));
 		}
 	}
 }
@@ -110,16 +179,26 @@ ccl_device_inline void kernel_filter_nlm_update_output(int dx, int dy,
                                                        int f)
 {
 	for(int y = rect.y; y < rect.w; y++) {
-		for(int x = rect.x; x < rect.z; x++) {
-			const int low = max(rect.x, x-f);
-			const int high = min(rect.z, x+f+1);
-			float sum = 0.0f;
-			for(int x1 = low; x1 < high; x1++) {
-				sum += difference_image[y*stride + x1];
-			}
-			float weight = sum * (1.0f/(high - low));
-			accum_image[y*stride + x] += weight;
-			out_image[y*stride + x] += weight*image[(y+dy)*stride + (x+dx)];
+		const float *difference_row = difference_image + y*stride;
+		const float *image_row = image + (y+dy)*stride + dx;
+		float *out_row = out_image + y*stride;
+		float *accum_row = accum_image + y*stride;
+
+		int x = rect.x;
+		for(; x < min(rect.x+f, rect.z); x++) {
+			float weight = kernel_filter_nlm_window_average(difference_row, x, rect, f);
+			accum_row[x] += weight;
+			out_row[x] += weight*image_row[x];
+		}
+		for(; x + 4 + f <= rect.z; x += 4) {
+			float4 weight = kernel_filter_nlm_window_average4(difference_row, x, f);
+			store_float4(accum_row + x, load_float4(accum_row + x) + weight);
+			store_float4(out_row + x, load_float4(out_row + x) + weight*load_float4(image_row + x));
+		}
+		for(; x < rect.z; x++) {
+			float weight = kernel_filter_nlm_window_average(difference_row, x, rect, f);
+			accum_row[x] += weight;
+			out_row[x] += weight*image_row[x];
 		}
 	}
 }
@@ -140,13 +219,7 @@ ccl_device_inline void kernel_filter_nlm_construct_gramian(int dx, int dy,
 	/* fy and fy are in filter-window-relative coordinates, while x and y are in feature-window-relative coordinates. */
 	for(int y = clip_area.y; y < clip_area.w; y++) {
 		for(int x = clip_area.x; x < clip_area.z; x++) {
-			const int low = max(rect.x, x-f);
-			const int high = min(rect.z, x+f+1);
-			float sum = 0.0f;
-			for(int x1 = low; x1 < high; x1++) {
-				sum += difference_image[y*stride + x1];
-			}
-			float weight = sum * (1.0f/(high - low));
+			float weight = kernel_filter_nlm_window_average(difference_image + y*stride, x, rect, f);
 
 			int storage_ofs = coord_to_local_index(filter_window, x, y);
 			float  *l_transform = transform + storage_ofs*TRANSFORM_SIZE;
@@ -94,6 +94,22 @@ ccl_device_inline AttributeDescriptor find_attribute(KernelGlobals *kg, const Sh
 	return desc;
 }
 
+/* Quantized UV maps, stored as two 16 bit values per corner relative to the
+ * bounds of the UV map on the mesh. */
+
+ccl_device_inline float4 attribute_quantized_range(KernelGlobals *kg, const AttributeDescriptor desc)
+{
+	return kernel_tex_fetch(__attributes_quantized_range, desc.flags >> ATTR_QUANTIZED_RANGE_SHIFT);
+}
+
+ccl_device_inline float3 attribute_dequantize_uv(KernelGlobals *kg, float4 range, int index)
+{
+	const uint packed = kernel_tex_fetch(__attributes_quantized, index);
+	return make_float3(range.x + range.z*(float)(packed & 0xFFFF),
+	                   range.y + range.w*(float)(packed >> 16),
+	                   0.0f);
+}
+
 /* Transform matrix attribute on meshes */
 
 ccl_device Transform primitive_attribute_matrix(KernelGlobals *kg, const ShaderData *sd, const AttributeDescriptor desc)
@@ -74,15 +74,25 @@ ccl_device_inline void triangle_vertices(KernelGlobals *kg, int prim, float3 P[3
 	P[2] = float4_to_float3(kernel_tex_fetch(__prim_tri_verts, tri_vindex.w+2));
 }
 
+/* Vertex normal, which may be stored octahedral encoded */
+
+ccl_device_inline float3 triangle_vertex_normal(KernelGlobals *kg, uint vertex)
+{
+	if(kernel_data.bvh.use_compressed_normals) {
+		return oct16_to_float3(kernel_tex_fetch(__tri_vnormal_oct, vertex));
+	}
+	return float4_to_float3(kernel_tex_fetch(__tri_vnormal, vertex));
+}
+
 /* Interpolate smooth vertex normal from vertices */
 
 ccl_device_inline float3 triangle_smooth_normal(KernelGlobals *kg, float3 Ng, int prim, float u, float v)
 {
 	/* load triangle vertices */
 	const uint4 tri_vindex = kernel_tex_fetch(__tri_vindex, prim);
-	float3 n0 = float4_to_float3(kernel_tex_fetch(__tri_vnormal, tri_vindex.x));
-	float3 n1 = float4_to_float3(kernel_tex_fetch(__tri_vnormal, tri_vindex.y));
-	float3 n2 = float4_to_float3(kernel_tex_fetch(__tri_vnormal, tri_vindex.z));
+	float3 n0 = triangle_vertex_normal(kg, tri_vindex.x);
+	float3 n1 = triangle_vertex_normal(kg, tri_vindex.y);
+	float3 n2 = triangle_vertex_normal(kg, tri_vindex.z);
 
 	float3 N = safe_normalize((1.0f - u - v)*n2 + u*n0 + v*n1);
 
@@ -175,7 +185,13 @@ ccl_device float3 triangle_attribute_float3(KernelGlobals *kg, const ShaderData
 		int tri = desc.offset + sd->prim*3;
 		float3 f0, f1, f2;
 
-		if(desc.element == ATTR_ELEMENT_CORNER) {
+		if(desc.flags & ATTR_QUANTIZED) {
+			const float4 range = attribute_quantized_range(kg, desc);
+			f0 = attribute_dequantize_uv(kg, range, tri + 0);
+			f1 = attribute_dequantize_uv(kg, range, tri + 1);
+			f2 = attribute_dequantize_uv(kg, range, tri + 2);
+		}
+		else if(desc.element == ATTR_ELEMENT_CORNER) {
 			f0 = float4_to_float3(kernel_tex_fetch(__attributes_float3, tri + 0));
 			f1 = float4_to_float3(kernel_tex_fetch(__attributes_float3, tri + 1));
 			f2 = float4_to_float3(kernel_tex_fetch(__attributes_float3, tri + 2));
@@ -0,0 +1,190 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KERNEL_ADAPTIVE_SAMPLING_H__
+#define __KERNEL_ADAPTIVE_SAMPLING_H__
+
+CCL_NAMESPACE_BEGIN
+
+/* Adaptive Sampling
+ *
+ * Pixels stop receiving samples once the error estimate falls below the
+ * threshold. The estimate compares the combined pass with the auxiliary
+ * buffer, which only accumulates every second sample, as in section 2.1 of
+ * "A hierarchical automatic stopping condition for Monte Carlo global
+ * illumination" by Dammertz et al.
+ *
+ * Converged pixels store the sample count at which they converged, so their
+ * passes can be scaled up to the full sample count once the tile is done and
+ * the rest of the pipeline does not need to know about adaptive sampling. */
+
+ccl_device_inline ccl_global float *kernel_adaptive_pixel_buffer(KernelGlobals *kg,
+                                                                 ccl_global float *buffer,
+                                                                 int x, int y,
+                                                                 int offset, int stride)
+{
+	int index = offset + x + y*stride;
+	return buffer + index*kernel_data.film.pass_stride;
+}
+
+/* Is the pixel done, buffer points to the pixel. */
+ccl_device_inline bool kernel_adaptive_pixel_converged(KernelGlobals *kg,
+                                                       ccl_global float *buffer)
+{
+	return kernel_data.film.pass_adaptive_aux_buffer &&
+	       buffer[kernel_data.film.pass_adaptive_aux_buffer + 3] != 0.0f;
+}
+
+/* Test for convergence after the given number of samples were rendered. */
+ccl_device void kernel_adaptive_stopping(KernelGlobals *kg,
+                                         ccl_global float *buffer,
+                                         int sample,
+                                         int x, int y,
+                                         int offset, int stride)
+{
+	buffer = kernel_adaptive_pixel_buffer(kg, buffer, x, y, offset, stride);
+	ccl_global float *aux = buffer + kernel_data.film.pass_adaptive_aux_buffer;
+
+	if(aux[3] != 0.0f) {
+		return;
+	}
+
+	float3 I = make_float3(buffer[0], buffer[1], buffer[2]);
+	float3 A = make_float3(aux[0], aux[1], aux[2]);
+
+	/* A small epsilon is added to the divisor to avoid division by zero. */
+	float error = (fabsf(I.x - A.x) + fabsf(I.y - A.y) + fabsf(I.z - A.z)) /
+	              (sample*0.0001f + sqrtf(fmaxf(I.x + I.y + I.z, 0.0f)));
+
+	if(error < kernel_data.integrator.adaptive_threshold*(float)sample) {
+		aux[3] = (float)sample;
+	}
+}
+
+/* Pixels that converged in this step are marked active again when they are
+ * next to an active pixel, so noise is not left behind at the boundaries of
+ * converged regions. Filtering is separable, first along rows marking
+ * neighbors as pending, then along columns which also resolves the pending
+ * pixels, giving a 3x3 dilation within the tile. */
+
+ccl_device void kernel_adaptive_filter_x(KernelGlobals *kg,
+                                         ccl_global float *buffer,
+                                         int sample,
+                                         int y,
+                                         int start_x, int width,
+                                         int offset, int stride)
+{
+	const int aux_offset = kernel_data.film.pass_adaptive_aux_buffer + 3;
+	const float step_sample = (float)sample;
+	bool prev_active = false;
+
+	for(int x = start_x; x < start_x + width; x++) {
+		ccl_global float *aux = kernel_adaptive_pixel_buffer(kg, buffer, x, y, offset, stride) + aux_offset;
+		const bool active = (*aux == 0.0f);
+
+		if(*aux == step_sample) {
+			bool next_active = false;
+			if(x + 1 < start_x + width) {
+				next_active = (kernel_adaptive_pixel_buffer(kg, buffer, x + 1, y, offset, stride)[aux_offset] == 0.0f);
+			}
+			if(prev_active || next_active) {
+				*aux = -1.0f;
+			}
+		}
+
+		prev_active = active;
+	}
+}
+
+/* Returns number of pixels in the column that still need samples. */
+ccl_device int kernel_adaptive_filter_y(KernelGlobals *kg,
+                                        ccl_global float *buffer,
+                                        int sample,
+                                        int x,
+                                        int start_y, int height,
+                                        int offset, int stride)
+{
+	const int aux_offset = kernel_data.film.pass_adaptive_aux_buffer + 3;
+	const float step_sample = (float)sample;
+	bool prev_active = false;
+	int num_active = 0;
+
+	for(int y = start_y; y < start_y + height; y++) {
+		ccl_global float *aux = kernel_adaptive_pixel_buffer(kg, buffer, x, y, offset, stride) + aux_offset;
+		const bool active = (*aux <= 0.0f);
+
+		if(*aux == step_sample) {
+			bool next_active = false;
+			if(y + 1 < start_y + height) {
+				next_active = (kernel_adaptive_pixel_buffer(kg, buffer, x, y + 1, offset, stride)[aux_offset] <= 0.0f);
+			}
+			if(prev_active || next_active) {
+				*aux = 0.0f;
+			}
+		}
+		else if(*aux < 0.0f) {
+			*aux = 0.0f;
+		}
+
+		if(*aux == 0.0f) {
+			num_active++;
+		}
+
+		prev_active = active;
+	}
+
+	return num_active;
+}
+
+/* Scale passes of a pixel that converged early to the given sample count. */
+ccl_device void kernel_adaptive_adjust_samples(KernelGlobals *kg,
+                                               ccl_global float *buffer,
+                                               int sample,
+                                               int x, int y,
+                                               int offset, int stride)
+{
+	buffer = kernel_adaptive_pixel_buffer(kg, buffer, x, y, offset, stride);
+	ccl_global float *aux = buffer + kernel_data.film.pass_adaptive_aux_buffer;
+
+	if(aux[3] == 0.0f || aux[3] == (float)sample) {
+		return;
+	}
+
+	const float scale = (float)sample / aux[3];
+	const int pass_stride = kernel_data.film.pass_stride;
+	const int flag = kernel_data.film.pass_flag;
+
+	/* Depth and ID passes are written once and are not divided by the
+	 * sample count. */
+	const int skip_depth = (flag & PASSMASK(DEPTH))? kernel_data.film.pass_depth: -1;
+	const int skip_object_id = (flag & PASSMASK(OBJECT_ID))? kernel_data.film.pass_object_id: -1;
+	const int skip_material_id = (flag & PASSMASK(MATERIAL_ID))? kernel_data.film.pass_material_id: -1;
+
+	for(int i = 0; i < pass_stride; i++) {
+		if(i == skip_depth || i == skip_object_id || i == skip_material_id) {
+			continue;
+		}
+		buffer[i] *= scale;
+	}
+
+	/* Passes now hold the full sample count, which is what the next
+	 * progressive pass has to scale from. */
+	aux[3] = (float)sample;
+}
+
+CCL_NAMESPACE_END
+
+#endif  /* __KERNEL_ADAPTIVE_SAMPLING_H__ */
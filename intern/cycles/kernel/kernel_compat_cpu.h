@@ -39,7 +39,9 @@
 #include "util/util_simd.h"
 #include "util/util_half.h"
 #include "util/util_types.h"
+#include "util/util_sparse_grid.h"
 #include "util/util_texture.h"
+#include "util/util_texture_cache.h"
 
 #define ccl_addr_space
 
@@ -150,6 +152,10 @@ ccl_device_inline void print_sse3i(const char *label, sse3i& a)
 
 #endif
 
+#ifdef __KERNEL_AVX__
+typedef vector3<avxf> avx3f;
+#endif
+
 CCL_NAMESPACE_END
 
 #endif /* __KERNEL_COMPAT_CPU_H__ */
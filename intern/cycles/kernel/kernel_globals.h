@@ -19,6 +19,8 @@
 #ifndef __KERNEL_GLOBALS_H__
 #define __KERNEL_GLOBALS_H__
 
+#include "kernel/kernel_profiling.h"
+
 #ifdef __KERNEL_CPU__
 #  include "util/util_vector.h"
 #endif
@@ -74,6 +76,10 @@ typedef struct KernelGlobals {
 
 	int2 global_size;
 	int2 global_id;
+
+#  ifdef WITH_CYCLES_PROFILING
+	ProfilingState profiler;
+#  endif
 } KernelGlobals;
 
 #endif  /* __KERNEL_CPU__ */
@@ -497,6 +497,20 @@ ccl_device float spot_light_attenuation(float3 dir, float spot_angle, float spot
 	return attenuation;
 }
 
+/* Probability of light_sample() picking the lamp. */
+ccl_device_inline float lamp_light_pdf_select(KernelGlobals *kg, int lamp, float3 P)
+{
+#ifdef __LIGHT_TREE__
+	if(kernel_data.integrator.use_light_tree) {
+		const int type = kernel_tex_fetch(__lights, lamp).type;
+		if(type != LIGHT_DISTANT && type != LIGHT_BACKGROUND) {
+			return light_tree_lamp_pdf(kg, lamp, P);
+		}
+	}
+#endif
+	return kernel_data.integrator.pdf_lights;
+}
+
 ccl_device float lamp_light_pdf(KernelGlobals *kg, const float3 Ng, const float3 I, float t)
 {
 	float cos_pi = dot(Ng, I);
@@ -624,7 +638,7 @@ ccl_device_inline bool lamp_light_sample(KernelGlobals *kg,
 		}
 	}
 
-	ls->pdf *= kernel_data.integrator.pdf_lights;
+	ls->pdf *= lamp_light_pdf_select(kg, lamp, P);
 
 	return (ls->pdf > 0.0f);
 }
@@ -768,7 +782,7 @@ ccl_device bool lamp_light_eval(KernelGlobals *kg, int lamp, float3 P, float3 D,
 		return false;
 	}
 
-	ls->pdf *= kernel_data.integrator.pdf_lights;
+	ls->pdf *= lamp_light_pdf_select(kg, lamp, P);
 
 	return true;
 }
@@ -806,9 +820,24 @@ ccl_device_inline bool triangle_world_space_vertices(KernelGlobals *kg, int obje
 	return has_motion;
 }
 
-ccl_device_inline float triangle_light_pdf_area(KernelGlobals *kg, const float3 Ng, const float3 I, float t)
+/* Probability density over the area of the triangle at the center of the
+ * shutter interval, of light_sample() picking a point on it. */
+ccl_device_inline float triangle_light_pdf_density(KernelGlobals *kg,
+                                                   int object,
+                                                   int prim,
+                                                   float3 P,
+                                                   float area)
+{
+#ifdef __LIGHT_TREE__
+	if(kernel_data.integrator.use_light_tree) {
+		return (area > 0.0f)? light_tree_triangle_pdf(kg, object, prim, P)/area: 0.0f;
+	}
+#endif
+	return kernel_data.integrator.pdf_triangles;
+}
+
+ccl_device_inline float triangle_light_pdf_area(KernelGlobals *kg, const float3 Ng, const float3 I, float t, float pdf)
 {
-	float pdf = kernel_data.integrator.pdf_triangles;
 	float cos_pi = fabsf(dot(Ng, I));
 
 	if(cos_pi == 0.0f)
@@ -833,10 +862,11 @@ ccl_device_forceinline float triangle_light_pdf(KernelGlobals *kg, ShaderData *s
 	const float3 N = cross(e0, e1);
 	const float distance_to_plane = fabsf(dot(N, sd->I * t))/dot(N, N);
 
+	/* sd contains the point on the light source
+	 * calculate Px, the point that we're shading */
+	const float3 Px = sd->P + sd->I * t;
+
 	if(longest_edge_squared > distance_to_plane*distance_to_plane) {
-		/* sd contains the point on the light source
-		 * calculate Px, the point that we're shading */
-		const float3 Px = sd->P + sd->I * t;
 		const float3 v0_p = V[0] - Px;
 		const float3 v1_p = V[1] - Px;
 		const float3 v2_p = V[2] - Px;
@@ -864,22 +894,26 @@ ccl_device_forceinline float triangle_light_pdf(KernelGlobals *kg, ShaderData *s
 			else {
 				area = 0.5f * len(N);
 			}
-			const float pdf = area * kernel_data.integrator.pdf_triangles;
+			const float pdf = area * triangle_light_pdf_density(kg, sd->object, sd->prim, Px, area);
 			return pdf / solid_angle;
 		}
 	}
 	else {
-		float pdf = triangle_light_pdf_area(kg, sd->Ng, sd->I, t);
+		const float area = 0.5f * len(N);
+		float area_pre = area;
 		if(has_motion) {
-			const float	area = 0.5f * len(N);
 			if(UNLIKELY(area == 0.0f)) {
 				return 0.0f;
 			}
+			triangle_world_space_vertices(kg, sd->object, sd->prim, -1.0f, V);
+			area_pre = triangle_area(V[0], V[1], V[2]);
+		}
+		float pdf = triangle_light_pdf_area(kg, sd->Ng, sd->I, t,
+		                                    triangle_light_pdf_density(kg, sd->object, sd->prim, Px, area_pre));
+		if(has_motion) {
 			/* scale the PDF.
 			 * area = the area the sample was taken from
 			 * area_pre = the are from which pdf_triangles was calculated from */
-			triangle_world_space_vertices(kg, sd->object, sd->prim, -1.0f, V);
-			const float area_pre = triangle_area(V[0], V[1], V[2]);
 			pdf = pdf * area_pre / area;
 		}
 		return pdf;
@@ -1005,7 +1039,7 @@ ccl_device_forceinline void triangle_light_sample(KernelGlobals *kg, int prim, i
 				triangle_world_space_vertices(kg, object, prim, -1.0f, V);
 				area = triangle_area(V[0], V[1], V[2]);
 			}
-			const float pdf = area * kernel_data.integrator.pdf_triangles;
+			const float pdf = area * triangle_light_pdf_density(kg, object, prim, P, area);
 			ls->pdf = pdf / solid_angle;
 		}
 	}
@@ -1019,13 +1053,17 @@ ccl_device_forceinline void triangle_light_sample(KernelGlobals *kg, int prim, i
 		ls->P = u * V[0] + v * V[1] + t * V[2];
 		/* compute incoming direction, distance and pdf */
 		ls->D = normalize_len(ls->P - P, &ls->t);
-		ls->pdf = triangle_light_pdf_area(kg, ls->Ng, -ls->D, ls->t);
+		float area_pre = area;
+		if(has_motion) {
+			triangle_world_space_vertices(kg, object, prim, -1.0f, V);
+			area_pre = triangle_area(V[0], V[1], V[2]);
+		}
+		ls->pdf = triangle_light_pdf_area(kg, ls->Ng, -ls->D, ls->t,
+		                                  triangle_light_pdf_density(kg, object, prim, P, area_pre));
 		if(has_motion && area != 0.0f) {
 			/* scale the PDF.
 			 * area = the area the sample was taken from
 			 * area_pre = the are from which pdf_triangles was calculated from */
-			triangle_world_space_vertices(kg, object, prim, -1.0f, V);
-			const float area_pre = triangle_area(V[0], V[1], V[2]);
 			ls->pdf = ls->pdf * area_pre / area;
 		}
 		ls->u = u;
@@ -1086,8 +1124,23 @@ ccl_device_noinline bool light_sample(KernelGlobals *kg,
                                       int bounce,
                                       LightSample *ls)
 {
+	PROFILING_INIT(kg, PROFILING_LIGHT_SAMPLE);
+
 	/* sample index */
+#ifdef __LIGHT_TREE__
+	int index;
+	if(kernel_data.integrator.use_light_tree) {
+		index = light_tree_sample(kg, P, &randu);
+		if(index == -1) {
+			return false;
+		}
+	}
+	else {
+		index = light_distribution_sample(kg, &randu);
+	}
+#else
 	int index = light_distribution_sample(kg, &randu);
+#endif
 
 	/* fetch light data */
 	const ccl_global KernelLightDistribution *kdistribution = &kernel_tex_fetch(__light_distribution, index);
@@ -0,0 +1,178 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+CCL_NAMESPACE_BEGIN
+
+/* Light Tree
+ *
+ * Bounding volume hierarchy over emissive triangles and lamps, built by the
+ * light manager. A light is picked by descending the tree, choosing between
+ * two children proportional to an estimate of their contribution at the
+ * shading point, from their power, distance and orientation.
+ *
+ * Based on:
+ * Alejandro Conty Estevez and Christopher Kulla.
+ * Importance Sampling of Many Lights with Adaptive Tree Splitting.
+ */
+
+#ifdef __LIGHT_TREE__
+
+ccl_device_inline float light_tree_node_importance(const ccl_global KernelLightTreeNode *knode,
+                                                   float3 P)
+{
+	const float3 bbox_min = make_float3(knode->bbox_min[0],
+	                                    knode->bbox_min[1],
+	                                    knode->bbox_min[2]);
+	const float3 bbox_max = make_float3(knode->bbox_max[0],
+	                                    knode->bbox_max[1],
+	                                    knode->bbox_max[2]);
+	const float3 centroid = 0.5f*(bbox_min + bbox_max);
+	const float radius_sq = 0.25f*len_squared(bbox_max - bbox_min);
+
+	float dist;
+	const float3 D = safe_normalize_len(centroid - P, &dist);
+	const float dist_sq = dist*dist;
+
+	/* Orientation bound, the angle between the emission cone and the shading
+	 * point is reduced by the angle the node bounds cover as seen from it. */
+	float cos_theta = 1.0f;
+	if(knode->theta_o < M_PI_F && dist_sq > radius_sq) {
+		const float3 axis = make_float3(knode->axis[0], knode->axis[1], knode->axis[2]);
+		const float theta = fast_acosf(clamp(-dot(axis, D), -1.0f, 1.0f));
+		const float theta_u = fast_asinf(sqrtf(radius_sq/dist_sq));
+		const float theta_prime = max(theta - knode->theta_o - theta_u, 0.0f);
+
+		if(theta_prime > knode->theta_e) {
+			return 0.0f;
+		}
+		cos_theta = fast_cosf(theta_prime);
+	}
+
+	/* Distance is clamped to the node size, so shading points close to or
+	 * inside the node do not get an unbounded importance. */
+	return knode->energy*cos_theta/max(dist_sq, max(radius_sq, 1e-12f));
+}
+
+ccl_device_inline void light_tree_child_importance(KernelGlobals *kg,
+                                                   int child,
+                                                   float3 P,
+                                                   float *importance0,
+                                                   float *importance1)
+{
+	const ccl_global KernelLightTreeNode *knode0 = &kernel_tex_fetch(__light_tree_nodes, child);
+	const ccl_global KernelLightTreeNode *knode1 = &kernel_tex_fetch(__light_tree_nodes, child + 1);
+
+	if(knode0->num_infinite || knode1->num_infinite) {
+		/* Distant and background lights are picked by count, with the rest
+		 * of the tree counting as a single light. */
+		*importance0 = (float)max(knode0->num_infinite, 1);
+		*importance1 = (float)max(knode1->num_infinite, 1);
+	}
+	else {
+		*importance0 = light_tree_node_importance(knode0, P);
+		*importance1 = light_tree_node_importance(knode1, P);
+	}
+}
+
+/* Pick a light, returning its index in the light distribution or -1 when no
+ * light can contribute to the shading point. randu is rescaled so it can be
+ * reused for sampling a position on the light. */
+ccl_device int light_tree_sample(KernelGlobals *kg, float3 P, float *randu)
+{
+	float r = *randu;
+	int index = 0;
+
+	for(;;) {
+		const int child = kernel_tex_fetch(__light_tree_nodes, index).child;
+
+		if(child < 0) {
+			*randu = r;
+			return ~child;
+		}
+
+		float importance0, importance1;
+		light_tree_child_importance(kg, child, P, &importance0, &importance1);
+
+		const float total = importance0 + importance1;
+		if(total == 0.0f) {
+			return -1;
+		}
+
+		const float prob0 = importance0/total;
+		if(r < prob0) {
+			index = child;
+			r = r/prob0;
+		}
+		else {
+			index = child + 1;
+			r = (r - prob0)/(1.0f - prob0);
+		}
+	}
+}
+
+/* Probability of light_tree_sample() picking the leaf, found by walking up to
+ * the root. Light sampling and MIS both use this, rather than accumulating it
+ * while descending, so they always agree on the probabilities. */
+ccl_device float light_tree_leaf_pdf(KernelGlobals *kg, uint leaf, float3 P)
+{
+	if(leaf == LIGHT_TREE_NONE) {
+		return 0.0f;
+	}
+
+	float pdf = 1.0f;
+	int index = leaf;
+	int parent = kernel_tex_fetch(__light_tree_nodes, index).parent;
+
+	while(parent >= 0) {
+		const int child = kernel_tex_fetch(__light_tree_nodes, parent).child;
+
+		float importance0, importance1;
+		light_tree_child_importance(kg, child, P, &importance0, &importance1);
+
+		const float total = importance0 + importance1;
+		if(total == 0.0f) {
+			return 0.0f;
+		}
+
+		pdf *= ((index == child)? importance0: importance1)/total;
+
+		index = parent;
+		parent = kernel_tex_fetch(__light_tree_nodes, index).parent;
+	}
+
+	return pdf;
+}
+
+ccl_device_inline float light_tree_lamp_pdf(KernelGlobals *kg, int lamp, float3 P)
+{
+	return light_tree_leaf_pdf(kg, kernel_tex_fetch(__light_tree_leaves, lamp), P);
+}
+
+ccl_device_inline float light_tree_triangle_pdf(KernelGlobals *kg, int object, int prim, float3 P)
+{
+	/* First leaf slot of the object, and triangle offset of its mesh. */
+	const uint2 offset = kernel_tex_fetch(__light_tree_objects, object);
+
+	if(offset.x == LIGHT_TREE_NONE) {
+		return 0.0f;
+	}
+
+	return light_tree_leaf_pdf(kg, kernel_tex_fetch(__light_tree_leaves, offset.x + prim - offset.y), P);
+}
+
+#endif  /* __LIGHT_TREE__ */
+
+CCL_NAMESPACE_END
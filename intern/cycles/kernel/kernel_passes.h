@@ -344,6 +344,11 @@ ccl_device_inline void kernel_write_result(KernelGlobals *kg,
 
 	kernel_write_light_passes(kg, buffer, L);
 
+	if(kernel_data.film.pass_adaptive_aux_buffer && (sample & 1)) {
+		kernel_write_pass_float3(buffer + kernel_data.film.pass_adaptive_aux_buffer,
+		                         2.0f*L_sum);
+	}
+
 #ifdef __DENOISING_FEATURES__
 	if(kernel_data.film.pass_denoising_data) {
 #  ifdef __SHADOW_TRICKS__
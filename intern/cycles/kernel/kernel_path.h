@@ -29,8 +29,10 @@
 
 #include "kernel/kernel_accumulate.h"
 #include "kernel/kernel_shader.h"
+#include "kernel/kernel_light_tree.h"
 #include "kernel/kernel_light.h"
 #include "kernel/kernel_passes.h"
+#include "kernel/kernel_adaptive_sampling.h"
 
 #if defined(__VOLUME__) || defined(__SUBSURFACE__)
 #  include "kernel/kernel_volume.h"
@@ -57,6 +59,8 @@ ccl_device_forceinline bool kernel_path_scene_intersect(
 	Intersection *isect,
 	PathRadiance *L)
 {
+	PROFILING_INIT(kg, PROFILING_SCENE_INTERSECT);
+
 	uint visibility = path_state_ray_visibility(kg, state);
 
 	if(path_state_ao_bounce(kg, state)) {
@@ -105,6 +109,8 @@ ccl_device_forceinline void kernel_path_lamp_emission(
 	ShaderData *emission_sd,
 	PathRadiance *L)
 {
+	PROFILING_INIT(kg, PROFILING_INDIRECT_EMISSION);
+
 #ifdef __LAMP_MIS__
 	if(kernel_data.integrator.use_lamp_mis && !(state->flag & PATH_RAY_CAMERA)) {
 		/* ray starting from previous non-transparent bounce */
@@ -172,6 +178,8 @@ ccl_device_forceinline VolumeIntegrateResult kernel_path_volume(
 	ShaderData *emission_sd,
 	PathRadiance *L)
 {
+	PROFILING_INIT(kg, PROFILING_VOLUME);
+
 	/* Sanitize volume stack. */
 	if(!hit) {
 		kernel_volume_clean_stack(kg, state->volume_stack);
@@ -278,6 +286,8 @@ ccl_device_forceinline bool kernel_path_shader_apply(
 	PathRadiance *L,
 	ccl_global float *buffer)
 {
+	PROFILING_INIT(kg, PROFILING_SHADER_APPLY);
+
 #ifdef __SHADOW_TRICKS__
 	if((sd->object_flag & SD_OBJECT_SHADOW_CATCHER)) {
 		if(state->flag & PATH_RAY_TRANSPARENT_BACKGROUND) {
@@ -355,6 +365,8 @@ ccl_device_noinline void kernel_path_ao(KernelGlobals *kg,
                                         float3 throughput,
                                         float3 ao_alpha)
 {
+	PROFILING_INIT(kg, PROFILING_AO);
+
 	/* todo: solve correlation */
 	float bsdf_u, bsdf_v;
 
@@ -400,6 +412,8 @@ ccl_device void kernel_path_indirect(KernelGlobals *kg,
                                      PathState *state,
                                      PathRadiance *L)
 {
+	PROFILING_INIT(kg, PROFILING_PATH_INTEGRATE);
+
 #ifdef __SUBSURFACE__
 	SubsurfaceIndirectRays ss_indirect;
 	kernel_path_subsurface_init_indirect(&ss_indirect);
@@ -501,6 +515,7 @@ ccl_device void kernel_path_indirect(KernelGlobals *kg,
 		/* bssrdf scatter to a different location on the same object, replacing
 		 * the closures with a diffuse BSDF */
 		if(sd->flag & SD_BSSRDF) {
+			PROFILING_EVENT(PROFILING_SUBSURFACE);
 			if(kernel_path_subsurface_scatter(kg,
 			                                  sd,
 			                                  emission_sd,
@@ -517,6 +532,7 @@ ccl_device void kernel_path_indirect(KernelGlobals *kg,
 
 #if defined(__EMISSION__)
 		if(kernel_data.integrator.use_direct_light) {
+			PROFILING_EVENT(PROFILING_CONNECT_LIGHT);
 			int all = (kernel_data.integrator.sample_all_lights_indirect) ||
 			          (state->flag & PATH_RAY_SHADOW_CATCHER);
 			kernel_branched_path_surface_connect_light(kg,
@@ -534,8 +550,11 @@ ccl_device void kernel_path_indirect(KernelGlobals *kg,
 		}
 #endif
 
+		PROFILING_EVENT(PROFILING_SURFACE_BOUNCE);
 		if(!kernel_path_surface_bounce(kg, sd, &throughput, state, &L->state, ray))
 			break;
+
+		PROFILING_EVENT(PROFILING_PATH_INTEGRATE);
 	}
 
 #ifdef __SUBSURFACE__
@@ -566,8 +585,11 @@ ccl_device_forceinline void kernel_path_integrate(
 	Ray *ray,
 	PathRadiance *L,
 	ccl_global float *buffer,
-	ShaderData *emission_sd)
+	ShaderData *emission_sd,
+	const Intersection *primary_isect)
 {
+	PROFILING_INIT(kg, PROFILING_PATH_INTEGRATE);
+
 	/* Shader data memory used for both volumes and surfaces, saves stack space. */
 	ShaderData sd;
 
@@ -582,7 +604,26 @@ ccl_device_forceinline void kernel_path_integrate(
 	for(;;) {
 		/* Find intersection with objects in scene. */
 		Intersection isect;
-		bool hit = kernel_path_scene_intersect(kg, state, ray, &isect, L);
+		bool hit;
+
+#ifdef __BVH_PACKET__
+		if(primary_isect != NULL) {
+			/* Camera ray was already traced as part of a packet. */
+			isect = *primary_isect;
+			hit = (isect.prim != PRIM_NONE);
+			primary_isect = NULL;
+#  ifdef __KERNEL_DEBUG__
+			L->debug_data.num_bvh_traversed_nodes += isect.num_traversed_nodes;
+			L->debug_data.num_bvh_traversed_instances += isect.num_traversed_instances;
+			L->debug_data.num_bvh_intersections += isect.num_intersections;
+			L->debug_data.num_ray_bounces++;
+#  endif  /* __KERNEL_DEBUG__ */
+		}
+		else
+#endif  /* __BVH_PACKET__ */
+		{
+			hit = kernel_path_scene_intersect(kg, state, ray, &isect, L);
+		}
 
 		/* Find intersection with lamps and compute emission for MIS. */
 		kernel_path_lamp_emission(kg, state, ray, throughput, &isect, &sd, L);
@@ -670,6 +711,7 @@ ccl_device_forceinline void kernel_path_integrate(
 		/* bssrdf scatter to a different location on the same object, replacing
 		 * the closures with a diffuse BSDF */
 		if(sd.flag & SD_BSSRDF) {
+			PROFILING_EVENT(PROFILING_SUBSURFACE);
 			if(kernel_path_subsurface_scatter(kg,
 			                                  &sd,
 			                                  emission_sd,
@@ -685,6 +727,7 @@ ccl_device_forceinline void kernel_path_integrate(
 #endif  /* __SUBSURFACE__ */
 
 		/* direct lighting */
+		PROFILING_EVENT(PROFILING_CONNECT_LIGHT);
 		kernel_path_surface_connect_light(kg, &sd, emission_sd, throughput, state, L);
 
 #ifdef __VOLUME__
@@ -692,8 +735,11 @@ ccl_device_forceinline void kernel_path_integrate(
 #endif
 
 		/* compute direct lighting and next bounce */
+		PROFILING_EVENT(PROFILING_SURFACE_BOUNCE);
 		if(!kernel_path_surface_bounce(kg, &sd, &throughput, state, &L->state, ray))
 			break;
+
+		PROFILING_EVENT(PROFILING_PATH_INTEGRATE);
 	}
 
 #ifdef __SUBSURFACE__
@@ -719,12 +765,18 @@ ccl_device void kernel_path_trace(KernelGlobals *kg,
 	ccl_global float *buffer,
 	int sample, int x, int y, int offset, int stride)
 {
+	PROFILING_INIT(kg, PROFILING_RAY_SETUP);
+
 	/* buffer offset */
 	int index = offset + x + y*stride;
 	int pass_stride = kernel_data.film.pass_stride;
 
 	buffer += index*pass_stride;
 
+	if(kernel_adaptive_pixel_converged(kg, buffer)) {
+		return;
+	}
+
 	/* Initialize random numbers and sample ray. */
 	uint rng_hash;
 	Ray ray;
@@ -754,11 +806,101 @@ ccl_device void kernel_path_trace(KernelGlobals *kg,
 	                      &ray,
 	                      &L,
 	                      buffer,
-	                      emission_sd);
+	                      emission_sd,
+	                      NULL);
 
+	PROFILING_EVENT(PROFILING_WRITE_RESULT);
 	kernel_write_result(kg, buffer, sample, &L);
 }
 
+#ifdef __BVH_PACKET__
+/* Path trace a span of up to BVH_PACKET_SIZE pixels of one row, with the
+ * camera rays of all pixels traced together as a packet. */
+ccl_device void kernel_path_trace_packet(KernelGlobals *kg,
+	ccl_global float *buffer,
+	int sample, int x, int y, int num_pixels, int offset, int stride)
+{
+	kernel_assert(num_pixels <= BVH_PACKET_SIZE);
+
+	if(!scene_intersect_packet_supported(kg)) {
+		for(int i = 0; i < num_pixels; i++) {
+			kernel_path_trace(kg, buffer, sample, x + i, y, offset, stride);
+		}
+		return;
+	}
+
+	PROFILING_INIT(kg, PROFILING_RAY_SETUP);
+
+	int pass_stride = kernel_data.film.pass_stride;
+
+	/* Initialize random numbers and sample rays, skipping pixels without
+	 * a camera ray or that converged already. */
+	ccl_global float *pixel_buffer[BVH_PACKET_SIZE];
+	uint rng_hash[BVH_PACKET_SIZE];
+	Ray rays[BVH_PACKET_SIZE];
+	int num_rays = 0;
+
+	for(int i = 0; i < num_pixels; i++) {
+		int index = offset + x + i + y*stride;
+		ccl_global float *pixel = buffer + index*pass_stride;
+
+		if(kernel_adaptive_pixel_converged(kg, pixel)) {
+			continue;
+		}
+
+		kernel_path_trace_setup(kg, sample, x + i, y, &rng_hash[num_rays], &rays[num_rays]);
+
+		if(rays[num_rays].t == 0.0f) {
+			continue;
+		}
+
+		pixel_buffer[num_rays++] = pixel;
+	}
+
+	if(num_rays == 0) {
+		return;
+	}
+
+	/* Initialize states. */
+	ShaderDataTinyStorage emission_sd_storage;
+	ShaderData *emission_sd = AS_SHADER_DATA(&emission_sd_storage);
+
+	PathState states[BVH_PACKET_SIZE];
+	for(int i = 0; i < num_rays; i++) {
+		path_state_init(kg, emission_sd, &states[i], rng_hash[i], sample, &rays[i]);
+	}
+
+	/* Trace camera rays, visibility is the same for all of them. */
+	Intersection isects[BVH_PACKET_SIZE];
+	PROFILING_EVENT(PROFILING_SCENE_INTERSECT);
+	scene_intersect_packet(kg,
+	                       rays,
+	                       isects,
+	                       num_rays,
+	                       path_state_ray_visibility(kg, &states[0]));
+
+	/* Integrate. */
+	for(int i = 0; i < num_rays; i++) {
+		float3 throughput = make_float3(1.0f, 1.0f, 1.0f);
+
+		PathRadiance L;
+		path_radiance_init(&L, kernel_data.film.use_light_pass);
+
+		kernel_path_integrate(kg,
+		                      &states[i],
+		                      throughput,
+		                      &rays[i],
+		                      &L,
+		                      pixel_buffer[i],
+		                      emission_sd,
+		                      &isects[i]);
+
+		PROFILING_EVENT(PROFILING_WRITE_RESULT);
+		kernel_write_result(kg, pixel_buffer[i], sample, &L);
+	}
+}
+#endif  /* __BVH_PACKET__ */
+
 #endif  /* __SPLIT_KERNEL__ */
 
 CCL_NAMESPACE_END
@@ -42,6 +42,7 @@ KERNEL_TEX(DecomposedTransform, __camera_motion)
 /* triangles */
 KERNEL_TEX(uint, __tri_shader)
 KERNEL_TEX(float4, __tri_vnormal)
+KERNEL_TEX(uint, __tri_vnormal_oct)
 KERNEL_TEX(uint4, __tri_vindex)
 KERNEL_TEX(uint, __tri_patch)
 KERNEL_TEX(float2, __tri_patch_uv)
@@ -58,12 +59,17 @@ KERNEL_TEX(uint4, __attributes_map)
 KERNEL_TEX(float, __attributes_float)
 KERNEL_TEX(float4, __attributes_float3)
 KERNEL_TEX(uchar4, __attributes_uchar4)
+KERNEL_TEX(uint, __attributes_quantized)
+KERNEL_TEX(float4, __attributes_quantized_range)
 
 /* lights */
 KERNEL_TEX(KernelLightDistribution, __light_distribution)
 KERNEL_TEX(KernelLight, __lights)
 KERNEL_TEX(float2, __light_background_marginal_cdf)
 KERNEL_TEX(float2, __light_background_conditional_cdf)
+KERNEL_TEX(KernelLightTreeNode, __light_tree_nodes)
+KERNEL_TEX(uint, __light_tree_leaves)
+KERNEL_TEX(uint2, __light_tree_objects)
 
 /* particles */
 KERNEL_TEX(KernelParticle, __particles)
@@ -82,6 +82,12 @@ CCL_NAMESPACE_BEGIN
 #  ifdef __KERNEL_SSE2__
 #    define __QBVH__
 #  endif
+#  ifdef __KERNEL_AVX2__
+#    define __OBVH__
+#  endif
+#  if defined(__KERNEL_AVX__) && !defined(__SPLIT_KERNEL__)
+#    define __BVH_PACKET__
+#  endif
 #  define __KERNEL_SHADING__
 #  define __KERNEL_ADV_SHADING__
 #  define __BRANCHED_PATH__
@@ -193,6 +199,7 @@ CCL_NAMESPACE_BEGIN
 #  define __PASSES__
 #  define __BACKGROUND_MIS__
 #  define __LAMP_MIS__
+#  define __LIGHT_TREE__
 #  define __AO__
 #  define __CAMERA_MOTION__
 #  define __OBJECT_MOTION__
@@ -459,6 +466,13 @@ typedef enum DenoisingPassOffsets {
 	DENOISING_PASS_SIZE_CLEAN         = 3,
 } DenoisingPassOffsets;
 
+/* Adaptive sampling auxiliary buffer, stored after the denoising data.
+ * The first three components accumulate every second sample with double
+ * weight, the difference to the combined pass is the error estimate. The
+ * last component holds the sample count at which the pixel converged, or
+ * zero while it still needs samples. */
+#define ADAPTIVE_AUX_BUFFER_SIZE 4
+
 typedef enum eBakePassFilter {
 	BAKE_FILTER_NONE = 0,
 	BAKE_FILTER_DIRECT = (1 << 0),
@@ -808,8 +822,15 @@ typedef enum AttributeStandard {
 typedef enum AttributeFlag {
 	ATTR_FINAL_SIZE = (1 << 0),
 	ATTR_SUBDIVIDED = (1 << 1),
+	/* Stored as two 16 bit values relative to a range, see
+	 * attribute_dequantize_uv(). */
+	ATTR_QUANTIZED = (1 << 2),
 } AttributeFlag;
 
+/* Quantized attributes store the index of their range in the flags. */
+#define ATTR_QUANTIZED_RANGE_SHIFT 8
+#define ATTR_QUANTIZED_MAX_RANGES (1 << 16)
+
 typedef struct AttributeDescriptor {
 	AttributeElement element;
 	NodeAttributeType type;
@@ -1272,7 +1293,8 @@ typedef struct KernelFilm {
 	int pass_denoising_clean;
 	int denoising_flags;
 
-	int pad1, pad2, pad3;
+	int pass_adaptive_aux_buffer;
+	int pad1, pad2;
 
 #ifdef __KERNEL_DEBUG__
 	int pass_bvh_traversed_nodes;
@@ -1305,6 +1327,7 @@ typedef struct KernelIntegrator {
 	int num_distribution;
 	int num_all_lights;
 	float pdf_triangles;
+	/* With the light tree, only used for distant and background lights. */
 	float pdf_lights;
 	int pdf_background_res;
 	float light_inv_rr_threshold;
@@ -1368,16 +1391,33 @@ typedef struct KernelIntegrator {
 	int start_sample;
 
 	int max_closures;
+
+	/* adaptive sampling */
+	int adaptive_min_samples;
+	int adaptive_step;
+	float adaptive_threshold;
+	int adaptive_pad;
+
+	/* light tree */
+	int use_light_tree;
+	int light_tree_pad1, light_tree_pad2, light_tree_pad3;
 } KernelIntegrator;
 static_assert_align(KernelIntegrator, 16);
 
+/* Maximum number of rays traced together by packet traversal. */
+#define BVH_PACKET_SIZE 8
+
 typedef enum KernelBVHLayout {
 	BVH_LAYOUT_NONE = 0,
 
 	BVH_LAYOUT_BVH2 = (1 << 0),
 	BVH_LAYOUT_BVH4 = (1 << 1),
+	BVH_LAYOUT_BVH8 = (1 << 2),
+
+	/* Widest layout supported by the device, BVH8 when the AVX2 kernel is used. */
+	BVH_LAYOUT_AUTO = (1 << 3),
 
-	BVH_LAYOUT_DEFAULT = BVH_LAYOUT_BVH4,
+	BVH_LAYOUT_DEFAULT = BVH_LAYOUT_AUTO,
 	BVH_LAYOUT_ALL = (unsigned int)(-1),
 } KernelBVHLayout;
 
@@ -1389,7 +1429,9 @@ typedef struct KernelBVH {
 	int have_instancing;
 	int bvh_layout;
 	int use_bvh_steps;
-	int pad1, pad2;
+	/* Vertex normals are stored octahedral encoded in __tri_vnormal_oct. */
+	int use_compressed_normals;
+	int pad1;
 } KernelBVH;
 static_assert_align(KernelBVH, 16);
 
@@ -1515,6 +1557,32 @@ typedef struct KernelLightDistribution {
 } KernelLightDistribution;
 static_assert_align(KernelLightDistribution, 16);
 
+/* Marks emitters and objects without a light tree leaf. */
+#define LIGHT_TREE_NONE (~0u)
+
+typedef struct KernelLightTreeNode {
+	/* Bounds of the emitters in the node. */
+	float bbox_min[3];
+	/* Index of the first of the two consecutive children for inner nodes,
+	 * bitwise negated index into the light distribution for leaves. */
+	int child;
+	float bbox_max[3];
+	/* Index of the parent node, -1 for the root. */
+	int parent;
+	/* Cone bounding the emission normals, with theta_o the spread of the
+	 * normals and theta_e the spread of the emission around each normal. */
+	float axis[3];
+	float theta_o;
+	float theta_e;
+	/* Estimated power of the emitters in the node. */
+	float energy;
+	/* Number of distant and background lights in the node, these have no
+	 * position and are picked by count instead. */
+	int num_infinite;
+	int pad;
+} KernelLightTreeNode;
+static_assert_align(KernelLightTreeNode, 16);
+
 typedef struct KernelParticle {
 	int index;
 	float age;
@@ -23,6 +23,50 @@ void KERNEL_FUNCTION_FULL_NAME(path_trace)(KernelGlobals *kg,
                                            int offset,
                                            int stride);
 
+void KERNEL_FUNCTION_FULL_NAME(path_trace_packet)(KernelGlobals *kg,
+                                                  float *buffer,
+                                                  int sample,
+                                                  int x, int y,
+                                                  int num_pixels,
+                                                  int offset,
+                                                  int stride);
+
+uint KERNEL_FUNCTION_FULL_NAME(intersect_packet)(KernelGlobals *kg,
+                                                 const Ray *rays,
+                                                 Intersection *isects,
+                                                 int num_rays,
+                                                 uint visibility);
+
+void KERNEL_FUNCTION_FULL_NAME(adaptive_stopping)(KernelGlobals *kg,
+                                                  float *buffer,
+                                                  int sample,
+                                                  int x, int y,
+                                                  int offset,
+                                                  int stride);
+
+void KERNEL_FUNCTION_FULL_NAME(adaptive_filter_x)(KernelGlobals *kg,
+                                                  float *buffer,
+                                                  int sample,
+                                                  int y,
+                                                  int start_x, int width,
+                                                  int offset,
+                                                  int stride);
+
+int KERNEL_FUNCTION_FULL_NAME(adaptive_filter_y)(KernelGlobals *kg,
+                                                 float *buffer,
+                                                 int sample,
+                                                 int x,
+                                                 int start_y, int height,
+                                                 int offset,
+                                                 int stride);
+
+void KERNEL_FUNCTION_FULL_NAME(adaptive_adjust_samples)(KernelGlobals *kg,
+                                                        float *buffer,
+                                                        int sample,
+                                                        int x, int y,
+                                                        int offset,
+                                                        int stride);
+
 void KERNEL_FUNCTION_FULL_NAME(convert_to_byte)(KernelGlobals *kg,
                                                 uchar4 *rgba,
                                                 float *buffer,
@@ -63,14 +63,82 @@ template<typename T> struct TextureInterpolator  {
 		return make_float4(f, f, f, 1.0f);
 	}
 
-	static ccl_always_inline float4 read(const T *data,
-	                                     int x, int y,
-	                                     int width, int height)
+	/* Texels of an image fully stored in memory. */
+	struct ImageTexels {
+		ccl_always_inline ImageTexels(const TextureInfo& info)
+		: data((const T*)info.data), width(info.width), height(info.height) {}
+
+		ccl_always_inline float4 fetch(int x, int y) const
+		{
+			return read(data[y * width + x]);
+		}
+
+		const T *data;
+		int width, height;
+	};
+
+	/* Texels of an image loaded on demand through the texture cache. */
+	struct CachedTexels {
+		ccl_always_inline CachedTexels(const TextureInfo& info)
+		: image((TextureCache::Image*)info.cache), width(image->width), height(image->height) {}
+
+		ccl_always_inline float4 fetch(int x, int y) const
+		{
+			return read(image->fetch<T>(x, y));
+		}
+
+		TextureCache::Image *image;
+		int width, height;
+	};
+
+	/* Voxels of a volume fully stored in memory. */
+	struct VoxelTexels {
+		ccl_always_inline VoxelTexels(const TextureInfo& info)
+		: data((const T*)info.data), width(info.width), height(info.height), depth(info.depth) {}
+
+		ccl_always_inline float4 fetch(int x, int y, int z) const
+		{
+			return read(data[x + ((size_t)z * height + y) * width]);
+		}
+
+		const T *data;
+		int width, height, depth;
+	};
+
+	/* Voxels of a volume stored as packed bricks of a sparse grid, lookups
+	 * in empty bricks do not touch any voxel data. */
+	struct SparseTexels {
+		ccl_always_inline SparseTexels(const TextureInfo& info)
+		: data((const T*)info.data),
+		  grid((const SparseGrid*)info.sparse),
+		  width(info.width), height(info.height), depth(info.depth)
+		{
+			/* Texel types have no common zero constructor, vector types
+			 * leave their members uninitialized by default. */
+			T zero;
+			memset((void*)&zero, 0, sizeof(zero));
+			empty = read(zero);
+		}
+
+		ccl_always_inline float4 fetch(int x, int y, int z) const
+		{
+			const T *voxel = grid->voxel(data, x, y, z);
+			return (voxel)? read(*voxel): empty;
+		}
+
+		const T *data;
+		const SparseGrid *grid;
+		int width, height, depth;
+		float4 empty;
+	};
+
+	template<typename Texels>
+	static ccl_always_inline float4 read(const Texels& texels, int x, int y)
 	{
-		if(x < 0 || y < 0 || x >= width || y >= height) {
+		if(x < 0 || y < 0 || x >= texels.width || y >= texels.height) {
 			return make_float4(0.0f, 0.0f, 0.0f, 0.0f);
 		}
-		return read(data[y * width + x]);
+		return texels.fetch(x, y);
 	}
 
 	static ccl_always_inline int wrap_periodic(int x, int width)
@@ -95,12 +163,13 @@ template<typename T> struct TextureInterpolator  {
 
 	/* ********  2D interpolation ******** */
 
+	template<typename Texels>
 	static ccl_always_inline float4 interp_closest(const TextureInfo& info,
+	                                               const Texels& texels,
 	                                               float x, float y)
 	{
-		const T *data = (const T*)info.data;
-		const int width = info.width;
-		const int height = info.height;
+		const int width = texels.width;
+		const int height = texels.height;
 		int ix, iy;
 		frac(x*(float)width, &ix);
 		frac(y*(float)height, &iy);
@@ -122,15 +191,16 @@ template<typename T> struct TextureInterpolator  {
 				kernel_assert(0);
 				return make_float4(0.0f, 0.0f, 0.0f, 0.0f);
 		}
-		return read(data[ix + iy*width]);
+		return texels.fetch(ix, iy);
 	}
 
+	template<typename Texels>
 	static ccl_always_inline float4 interp_linear(const TextureInfo& info,
+	                                              const Texels& texels,
 	                                              float x, float y)
 	{
-		const T *data = (const T*)info.data;
-		const int width = info.width;
-		const int height = info.height;
+		const int width = texels.width;
+		const int height = texels.height;
 		int ix, iy, nix, niy;
 		const float tx = frac(x*(float)width - 0.5f, &ix);
 		const float ty = frac(y*(float)height - 0.5f, &iy);
@@ -155,18 +225,19 @@ template<typename T> struct TextureInterpolator  {
 				kernel_assert(0);
 				return make_float4(0.0f, 0.0f, 0.0f, 0.0f);
 		}
-		return (1.0f - ty) * (1.0f - tx) * read(data, ix, iy, width, height) +
-		       (1.0f - ty) * tx * read(data, nix, iy, width, height) +
-		       ty * (1.0f - tx) * read(data, ix, niy, width, height) +
-		       ty * tx * read(data, nix, niy, width, height);
+		return (1.0f - ty) * (1.0f - tx) * read(texels, ix, iy) +
+		       (1.0f - ty) * tx * read(texels, nix, iy) +
+		       ty * (1.0f - tx) * read(texels, ix, niy) +
+		       ty * tx * read(texels, nix, niy);
 	}
 
+	template<typename Texels>
 	static ccl_always_inline float4 interp_cubic(const TextureInfo& info,
+	                                             const Texels& texels,
 	                                             float x, float y)
 	{
-		const T *data = (const T*)info.data;
-		const int width = info.width;
-		const int height = info.height;
+		const int width = texels.width;
+		const int height = texels.height;
 		int ix, iy, nix, niy;
 		const float tx = frac(x*(float)width - 0.5f, &ix);
 		const float ty = frac(y*(float)height - 0.5f, &iy);
@@ -210,7 +281,7 @@ template<typename T> struct TextureInterpolator  {
 		/* Some helper macro to keep code reasonable size,
 		 * let compiler to inline all the matrix multiplications.
 		 */
-#define DATA(x, y) (read(data, xc[x], yc[y], width, height))
+#define DATA(x, y) (read(texels, xc[x], yc[y]))
 #define TERM(col) \
 		(v[col] * (u[0] * DATA(0, col) + \
 		           u[1] * DATA(1, col) + \
@@ -226,30 +297,43 @@ template<typename T> struct TextureInterpolator  {
 #undef DATA
 	}
 
+	template<typename Texels>
 	static ccl_always_inline float4 interp(const TextureInfo& info,
+	                                       const Texels& texels,
 	                                       float x, float y)
 	{
-		if(UNLIKELY(!info.data)) {
-			return make_float4(0.0f, 0.0f, 0.0f, 0.0f);
-		}
 		switch(info.interpolation) {
 			case INTERPOLATION_CLOSEST:
-				return interp_closest(info, x, y);
+				return interp_closest(info, texels, x, y);
 			case INTERPOLATION_LINEAR:
-				return interp_linear(info, x, y);
+				return interp_linear(info, texels, x, y);
 			default:
-				return interp_cubic(info, x, y);
+				return interp_cubic(info, texels, x, y);
 		}
 	}
 
+	static ccl_always_inline float4 interp(const TextureInfo& info,
+	                                       float x, float y)
+	{
+		if(info.cache) {
+			return interp(info, CachedTexels(info), x, y);
+		}
+		if(UNLIKELY(!info.data)) {
+			return make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+		}
+		return interp(info, ImageTexels(info), x, y);
+	}
+
 	/* ********  3D interpolation ******** */
 
+	template<typename Texels>
 	static ccl_always_inline float4 interp_3d_closest(const TextureInfo& info,
+	                                                  const Texels& texels,
 	                                                  float x, float y, float z)
 	{
-		int width = info.width;
-		int height = info.height;
-		int depth = info.depth;
+		const int width = texels.width;
+		const int height = texels.height;
+		const int depth = texels.depth;
 		int ix, iy, iz;
 
 		frac(x*(float)width, &ix);
@@ -279,16 +363,17 @@ template<typename T> struct TextureInterpolator  {
 				return make_float4(0.0f, 0.0f, 0.0f, 0.0f);
 		}
 
-		const T *data = (const T*)info.data;
-		return read(data[ix + iy*width + iz*width*height]);
+		return texels.fetch(ix, iy, iz);
 	}
 
+	template<typename Texels>
 	static ccl_always_inline float4 interp_3d_linear(const TextureInfo& info,
+	                                                 const Texels& texels,
 	                                                 float x, float y, float z)
 	{
-		int width = info.width;
-		int height = info.height;
-		int depth = info.depth;
+		const int width = texels.width;
+		const int height = texels.height;
+		const int depth = texels.depth;
 		int ix, iy, iz;
 		int nix, niy, niz;
 
@@ -327,18 +412,17 @@ template<typename T> struct TextureInterpolator  {
 				return make_float4(0.0f, 0.0f, 0.0f, 0.0f);
 		}
 
-		const T *data = (const T*)info.data;
 		float4 r;
 
-		r  = (1.0f - tz)*(1.0f - ty)*(1.0f - tx)*read(data[ix + iy*width + iz*width*height]);
-		r += (1.0f - tz)*(1.0f - ty)*tx*read(data[nix + iy*width + iz*width*height]);
-		r += (1.0f - tz)*ty*(1.0f - tx)*read(data[ix + niy*width + iz*width*height]);
-		r += (1.0f - tz)*ty*tx*read(data[nix + niy*width + iz*width*height]);
+		r  = (1.0f - tz)*(1.0f - ty)*(1.0f - tx)*texels.fetch(ix, iy, iz);
+		r += (1.0f - tz)*(1.0f - ty)*tx*texels.fetch(nix, iy, iz);
+		r += (1.0f - tz)*ty*(1.0f - tx)*texels.fetch(ix, niy, iz);
+		r += (1.0f - tz)*ty*tx*texels.fetch(nix, niy, iz);
 
-		r += tz*(1.0f - ty)*(1.0f - tx)*read(data[ix + iy*width + niz*width*height]);
-		r += tz*(1.0f - ty)*tx*read(data[nix + iy*width + niz*width*height]);
-		r += tz*ty*(1.0f - tx)*read(data[ix + niy*width + niz*width*height]);
-		r += tz*ty*tx*read(data[nix + niy*width + niz*width*height]);
+		r += tz*(1.0f - ty)*(1.0f - tx)*texels.fetch(ix, iy, niz);
+		r += tz*(1.0f - ty)*tx*texels.fetch(nix, iy, niz);
+		r += tz*ty*(1.0f - tx)*texels.fetch(ix, niy, niz);
+		r += tz*ty*tx*texels.fetch(nix, niy, niz);
 
 		return r;
 	}
@@ -349,16 +433,19 @@ template<typename T> struct TextureInterpolator  {
 	 * Only happens for AVX2 kernel and global __KERNEL_SSE__ vectorization
 	 * enabled.
 	 */
+	template<typename Texels>
 #ifdef __GNUC__
 	static ccl_always_inline
 #else
 	static ccl_never_inline
 #endif
-	float4 interp_3d_tricubic(const TextureInfo& info, float x, float y, float z)
+	float4 interp_3d_tricubic(const TextureInfo& info,
+	                          const Texels& texels,
+	                          float x, float y, float z)
 	{
-		int width = info.width;
-		int height = info.height;
-		int depth = info.depth;
+		const int width = texels.width;
+		const int height = texels.height;
+		const int depth = texels.depth;
 		int ix, iy, iz;
 		int nix, niy, niz;
 		/* Tricubic b-spline interpolation. */
@@ -415,20 +502,14 @@ template<typename T> struct TextureInterpolator  {
 		}
 
 		const int xc[4] = {pix, ix, nix, nnix};
-		const int yc[4] = {width * piy,
-		                   width * iy,
-		                   width * niy,
-		                   width * nniy};
-		const int zc[4] = {width * height * piz,
-		                   width * height * iz,
-		                   width * height * niz,
-		                   width * height * nniz};
+		const int yc[4] = {piy, iy, niy, nniy};
+		const int zc[4] = {piz, iz, niz, nniz};
 		float u[4], v[4], w[4];
 
 		/* Some helper macro to keep code reasonable size,
 		 * let compiler to inline all the matrix multiplications.
 		 */
-#define DATA(x, y, z) (read(data[xc[x] + yc[y] + zc[z]]))
+#define DATA(x, y, z) (texels.fetch(xc[x], yc[y], zc[z]))
 #define COL_TERM(col, row) \
 		(v[col] * (u[0] * DATA(0, col, row) + \
 		           u[1] * DATA(1, col, row) + \
@@ -445,7 +526,6 @@ template<typename T> struct TextureInterpolator  {
 		SET_CUBIC_SPLINE_WEIGHTS(w, tz);
 
 		/* Actual interpolation. */
-		const T *data = (const T*)info.data;
 		return ROW_TERM(0) + ROW_TERM(1) + ROW_TERM(2) + ROW_TERM(3);
 
 #undef COL_TERM
@@ -453,21 +533,33 @@ template<typename T> struct TextureInterpolator  {
 #undef DATA
 	}
 
+	template<typename Texels>
 	static ccl_always_inline float4 interp_3d(const TextureInfo& info,
+	                                          const Texels& texels,
 	                                          float x, float y, float z,
 	                                          InterpolationType interp)
 	{
-		if(UNLIKELY(!info.data))
-			return make_float4(0.0f, 0.0f, 0.0f, 0.0f);
-
 		switch((interp == INTERPOLATION_NONE)? info.interpolation: interp) {
 			case INTERPOLATION_CLOSEST:
-				return interp_3d_closest(info, x, y, z);
+				return interp_3d_closest(info, texels, x, y, z);
 			case INTERPOLATION_LINEAR:
-				return interp_3d_linear(info, x, y, z);
+				return interp_3d_linear(info, texels, x, y, z);
 			default:
-				return interp_3d_tricubic(info, x, y, z);
+				return interp_3d_tricubic(info, texels, x, y, z);
+		}
+	}
+
+	static ccl_always_inline float4 interp_3d(const TextureInfo& info,
+	                                          float x, float y, float z,
+	                                          InterpolationType interp)
+	{
+		if(UNLIKELY(!info.data))
+			return make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+
+		if(info.sparse) {
+			return interp_3d(info, SparseTexels(info), x, y, z, interp);
 		}
+		return interp_3d(info, VoxelTexels(info), x, y, z, interp);
 	}
 #undef SET_CUBIC_SPLINE_WEIGHTS
 };
@@ -99,6 +99,130 @@ void KERNEL_FUNCTION_FULL_NAME(path_trace)(KernelGlobals *kg,
 #endif /* KERNEL_STUB */
 }
 
+/* Path trace a row span of up to BVH_PACKET_SIZE pixels, tracing camera
+ * rays as a packet where the architecture supports it. */
+void KERNEL_FUNCTION_FULL_NAME(path_trace_packet)(KernelGlobals *kg,
+                                                  float *buffer,
+                                                  int sample,
+                                                  int x, int y,
+                                                  int num_pixels,
+                                                  int offset,
+                                                  int stride)
+{
+#ifdef KERNEL_STUB
+	STUB_ASSERT(KERNEL_ARCH, path_trace_packet);
+#else
+#  ifdef __BRANCHED_PATH__
+	if(kernel_data.integrator.branched) {
+		for(int i = 0; i < num_pixels; i++) {
+			kernel_branched_path_trace(kg,
+			                           buffer,
+			                           sample,
+			                           x + i, y,
+			                           offset,
+			                           stride);
+		}
+	}
+	else
+#  endif
+	{
+#  ifdef __BVH_PACKET__
+		kernel_path_trace_packet(kg, buffer, sample, x, y, num_pixels, offset, stride);
+#  else
+		for(int i = 0; i < num_pixels; i++) {
+			kernel_path_trace(kg, buffer, sample, x + i, y, offset, stride);
+		}
+#  endif
+	}
+#endif /* KERNEL_STUB */
+}
+
+/* Intersect rays with the scene, used for benchmarking traversal. */
+uint KERNEL_FUNCTION_FULL_NAME(intersect_packet)(KernelGlobals *kg,
+                                                 const Ray *rays,
+                                                 Intersection *isects,
+                                                 int num_rays,
+                                                 uint visibility)
+{
+#ifdef KERNEL_STUB
+	STUB_ASSERT(KERNEL_ARCH, intersect_packet);
+	return 0;
+#else
+#  ifdef __BVH_PACKET__
+	return scene_intersect_packet(kg, rays, isects, num_rays, visibility);
+#  else
+	uint hit_mask = 0;
+	for(int i = 0; i < num_rays; i++) {
+		if(scene_intersect(kg, rays[i], visibility, &isects[i], NULL, 0.0f, 0.0f)) {
+			hit_mask |= (1u << i);
+		}
+	}
+	return hit_mask;
+#  endif
+#endif /* KERNEL_STUB */
+}
+
+/* Adaptive Sampling */
+
+void KERNEL_FUNCTION_FULL_NAME(adaptive_stopping)(KernelGlobals *kg,
+                                                  float *buffer,
+                                                  int sample,
+                                                  int x, int y,
+                                                  int offset,
+                                                  int stride)
+{
+#ifdef KERNEL_STUB
+	STUB_ASSERT(KERNEL_ARCH, adaptive_stopping);
+#else
+	kernel_adaptive_stopping(kg, buffer, sample, x, y, offset, stride);
+#endif /* KERNEL_STUB */
+}
+
+void KERNEL_FUNCTION_FULL_NAME(adaptive_filter_x)(KernelGlobals *kg,
+                                                  float *buffer,
+                                                  int sample,
+                                                  int y,
+                                                  int start_x, int width,
+                                                  int offset,
+                                                  int stride)
+{
+#ifdef KERNEL_STUB
+	STUB_ASSERT(KERNEL_ARCH, adaptive_filter_x);
+#else
+	kernel_adaptive_filter_x(kg, buffer, sample, y, start_x, width, offset, stride);
+#endif /* KERNEL_STUB */
+}
+
+int KERNEL_FUNCTION_FULL_NAME(adaptive_filter_y)(KernelGlobals *kg,
+                                                 float *buffer,
+                                                 int sample,
+                                                 int x,
+                                                 int start_y, int height,
+                                                 int offset,
+                                                 int stride)
+{
+#ifdef KERNEL_STUB
+	STUB_ASSERT(KERNEL_ARCH, adaptive_filter_y);
+	return 0;
+#else
+	return kernel_adaptive_filter_y(kg, buffer, sample, x, start_y, height, offset, stride);
+#endif /* KERNEL_STUB */
+}
+
+void KERNEL_FUNCTION_FULL_NAME(adaptive_adjust_samples)(KernelGlobals *kg,
+                                                        float *buffer,
+                                                        int sample,
+                                                        int x, int y,
+                                                        int offset,
+                                                        int stride)
+{
+#ifdef KERNEL_STUB
+	STUB_ASSERT(KERNEL_ARCH, adaptive_adjust_samples);
+#else
+	kernel_adaptive_adjust_samples(kg, buffer, sample, x, y, offset, stride);
+#endif /* KERNEL_STUB */
+}
+
 /* Film */
 
 void KERNEL_FUNCTION_FULL_NAME(convert_to_byte)(KernelGlobals *kg,
@@ -253,6 +253,9 @@ ccl_device_noinline void svm_eval_nodes(KernelGlobals *kg, ShaderData *sd, ccl_a
 			case NODE_VALUE_V:
 				svm_node_value_v(kg, sd, stack, node.y, &offset);
 				break;
+			case NODE_VALUES:
+				svm_node_values(kg, stack, node, &offset);
+				break;
 			case NODE_ATTR:
 				svm_node_attr(kg, sd, stack, node);
 				break;
@@ -280,6 +283,9 @@ ccl_device_noinline void svm_eval_nodes(KernelGlobals *kg, ShaderData *sd, ccl_a
 			case NODE_TEX_IMAGE_BOX:
 				svm_node_tex_image_box(kg, sd, stack, node);
 				break;
+			case NODE_TEX_IMAGE_UV:
+				svm_node_tex_image_uv(kg, sd, stack, node);
+				break;
 			case NODE_TEX_NOISE:
 				svm_node_tex_noise(kg, sd, stack, node, &offset);
 				break;
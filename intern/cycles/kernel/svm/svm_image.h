@@ -74,6 +74,41 @@ ccl_device void svm_node_tex_image(KernelGlobals *kg, ShaderData *sd, float *sta
 		stack_store_float(stack, alpha_offset, f.w);
 }
 
+/* Image lookup with flat projection, reading the texture coordinate from an
+ * UV attribute rather than the stack. This is an attribute node and an image
+ * node fused together, used for the common case of an image texture with the
+ * default or an UV map texture coordinate. */
+ccl_device void svm_node_tex_image_uv(KernelGlobals *kg, ShaderData *sd, float *stack, uint4 node)
+{
+	uint id = node.y;
+	uint out_offset, alpha_offset, srgb;
+
+	decode_node_uchar4(node.z, NULL, &out_offset, &alpha_offset, &srgb);
+
+	NodeAttributeType type;
+	uint attr_offset;
+	AttributeDescriptor desc = svm_node_attr_init(kg, sd,
+	                                              make_uint4(NODE_ATTR, node.w, 0, NODE_ATTR_FLOAT3),
+	                                              &type, &attr_offset);
+
+	float3 co;
+	if(desc.type == NODE_ATTR_FLOAT3) {
+		co = primitive_attribute_float3(kg, sd, desc, NULL, NULL);
+	}
+	else {
+		float f = primitive_attribute_float(kg, sd, desc, NULL, NULL);
+		co = make_float3(f, f, f);
+	}
+
+	uint use_alpha = stack_valid(alpha_offset);
+	float4 f = svm_image_texture(kg, id, co.x, co.y, srgb, use_alpha);
+
+	if(stack_valid(out_offset))
+		stack_store_float3(stack, out_offset, make_float3(f.x, f.y, f.z));
+	if(stack_valid(alpha_offset))
+		stack_store_float(stack, alpha_offset, f.w);
+}
+
 ccl_device void svm_node_tex_image_box(KernelGlobals *kg, ShaderData *sd, float *stack, uint4 node)
 {
 	/* get object space normal */
@@ -136,6 +136,8 @@ typedef enum ShaderNodeType {
 	NODE_DISPLACEMENT,
 	NODE_VECTOR_DISPLACEMENT,
 	NODE_PRINCIPLED_VOLUME,
+	NODE_VALUES,
+	NODE_TEX_IMAGE_UV,
 } ShaderNodeType;
 
 typedef enum NodeAttributeType {
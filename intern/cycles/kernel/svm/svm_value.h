@@ -32,5 +32,27 @@ ccl_device void svm_node_value_v(KernelGlobals *kg, ShaderData *sd, float *stack
 	stack_store_float3(stack, out_offset, p);
 }
 
+/* Constants for up to 8 stack offsets, batched by the compiler so a shader
+ * with many unlinked inputs does not dispatch a value node for each of them.
+ * Unused offsets are SVM_STACK_INVALID. */
+ccl_device void svm_node_values(KernelGlobals *kg, float *stack, uint4 node, int *offset)
+{
+	for(uint i = 0; i < node.y; i++) {
+		float4 value = read_node_float(kg, offset);
+		uint offset_x, offset_y, offset_z, offset_w;
+
+		decode_node_uchar4((i == 0)? node.z: node.w, &offset_x, &offset_y, &offset_z, &offset_w);
+
+		if(stack_valid(offset_x))
+			stack_store_float(stack, offset_x, value.x);
+		if(stack_valid(offset_y))
+			stack_store_float(stack, offset_y, value.y);
+		if(stack_valid(offset_z))
+			stack_store_float(stack, offset_z, value.z);
+		if(stack_valid(offset_w))
+			stack_store_float(stack, offset_w, value.w);
+	}
+}
+
 CCL_NAMESPACE_END
 
@@ -42,6 +42,7 @@ BufferParams::BufferParams()
 
 	denoising_data_pass = false;
 	denoising_clean_pass = false;
+	adaptive_sampling_pass = false;
 
 	Pass::add(PASS_COMBINED, passes);
 }
@@ -60,6 +61,7 @@ bool BufferParams::modified(const BufferParams& params)
 		&& height == params.height
 		&& full_width == params.full_width
 		&& full_height == params.full_height
+		&& adaptive_sampling_pass == params.adaptive_sampling_pass
 		&& Pass::equals(passes, params.passes));
 }
 
@@ -75,6 +77,10 @@ int BufferParams::get_passes_size()
 		if(denoising_clean_pass) size += DENOISING_PASS_SIZE_CLEAN;
 	}
 
+	if(adaptive_sampling_pass) {
+		size = align_up(size, 4) + ADAPTIVE_AUX_BUFFER_SIZE;
+	}
+
 	return align_up(size, 4);
 }
 
@@ -104,6 +110,8 @@ RenderTile::RenderTile()
 
 	offset = 0;
 	stride = 0;
+	pixel_samples = 0;
+	thread = 0;
 
 	buffer = 0;
 
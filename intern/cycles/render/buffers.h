@@ -54,6 +54,8 @@ public:
 	bool denoising_data_pass;
 	/* If only some light path types should be denoised, an additional pass is needed. */
 	bool denoising_clean_pass;
+	/* Auxiliary buffer for the adaptive sampling error estimate. */
+	bool adaptive_sampling_pass;
 
 	/* functions */
 	BufferParams();
@@ -135,6 +137,13 @@ public:
 	int offset;
 	int stride;
 	int tile_index;
+	/* Number of pixel samples actually rendered, lower than w*h*num_samples
+	 * when adaptive sampling stopped pixels early. Zero if the device does
+	 * not keep track of it. */
+	uint64_t pixel_samples;
+	/* Index of the device thread rendering the tile, tiles are queued per
+	 * thread by the tile manager. */
+	int thread;
 
 	device_ptr buffer;
 
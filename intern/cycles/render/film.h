@@ -60,6 +60,7 @@ public:
 	bool denoising_data_pass;
 	bool denoising_clean_pass;
 	int denoising_flags;
+	bool use_adaptive_sampling;
 	float pass_alpha_threshold;
 
 	int pass_stride;
@@ -50,6 +50,13 @@ ImageManager::ImageManager(const DeviceInfo& info)
 	max_num_images = TEX_NUM_MAX;
 	has_half_images = info.has_half_images;
 
+	/* Kernel texture lookups can only go through the cache on the CPU. */
+	use_texture_cache = (info.type == DEVICE_CPU);
+	texture_cache = NULL;
+
+	/* Same for sparse volume grids. */
+	use_sparse_volumes = (info.type == DEVICE_CPU);
+
 	for(size_t type = 0; type < IMAGE_DATA_NUM_TYPES; type++) {
 		tex_num_images[type] = 0;
 	}
@@ -61,6 +68,8 @@ ImageManager::~ImageManager()
 		for(size_t slot = 0; slot < images[type].size(); slot++)
 			assert(!images[type][slot]);
 	}
+
+	delete texture_cache;
 }
 
 void ImageManager::set_osl_texture_system(void *texture_system)
@@ -338,6 +347,8 @@ int ImageManager::add_image(const string& filename,
 	img->users = 1;
 	img->use_alpha = use_alpha;
 	img->mem = NULL;
+	img->cache_image = NULL;
+	img->sparse_grid = NULL;
 
 	images[type][slot] = img;
 
@@ -483,6 +494,93 @@ bool ImageManager::file_load_image_generic(Image *img,
 	return true;
 }
 
+/* Expand pixels read with the given number of components in place to the
+ * channels of the device texture, and remove non-finite values. */
+template<TypeDesc::BASETYPE FileFormat,
+         typename StorageType>
+static void image_convert_pixels(StorageType *pixels,
+                                 size_t num_pixels,
+                                 int components,
+                                 bool is_rgba,
+                                 bool cmyk,
+                                 bool use_alpha)
+{
+	const StorageType alpha_one = (FileFormat == TypeDesc::UINT8)? 255 : 1;
+	if(is_rgba) {
+		if(cmyk) {
+			/* CMYK */
+			for(size_t i = num_pixels-1, pixel = 0; pixel < num_pixels; pixel++, i--) {
+				pixels[i*4+2] = (pixels[i*4+2]*pixels[i*4+3])/255;
+				pixels[i*4+1] = (pixels[i*4+1]*pixels[i*4+3])/255;
+				pixels[i*4+0] = (pixels[i*4+0]*pixels[i*4+3])/255;
+				pixels[i*4+3] = alpha_one;
+			}
+		}
+		else if(components == 2) {
+			/* grayscale + alpha */
+			for(size_t i = num_pixels-1, pixel = 0; pixel < num_pixels; pixel++, i--) {
+				pixels[i*4+3] = pixels[i*2+1];
+				pixels[i*4+2] = pixels[i*2+0];
+				pixels[i*4+1] = pixels[i*2+0];
+				pixels[i*4+0] = pixels[i*2+0];
+			}
+		}
+		else if(components == 3) {
+			/* RGB */
+			for(size_t i = num_pixels-1, pixel = 0; pixel < num_pixels; pixel++, i--) {
+				pixels[i*4+3] = alpha_one;
+				pixels[i*4+2] = pixels[i*3+2];
+				pixels[i*4+1] = pixels[i*3+1];
+				pixels[i*4+0] = pixels[i*3+0];
+			}
+		}
+		else if(components == 1) {
+			/* grayscale */
+			for(size_t i = num_pixels-1, pixel = 0; pixel < num_pixels; pixel++, i--) {
+				pixels[i*4+3] = alpha_one;
+				pixels[i*4+2] = pixels[i];
+				pixels[i*4+1] = pixels[i];
+				pixels[i*4+0] = pixels[i];
+			}
+		}
+		if(use_alpha == false) {
+			for(size_t i = num_pixels-1, pixel = 0; pixel < num_pixels; pixel++, i--) {
+				pixels[i*4+3] = alpha_one;
+			}
+		}
+	}
+	/* Make sure we don't have buggy values. */
+	if(FileFormat == TypeDesc::FLOAT) {
+		/* For RGBA buffers we put all channels to 0 if either of them is not
+		 * finite. This way we avoid possible artifacts caused by fully changed
+		 * hue.
+		 */
+		if(is_rgba) {
+			for(size_t i = 0; i < num_pixels; i += 4) {
+				StorageType *pixel = &pixels[i*4];
+				if(!isfinite(pixel[0]) ||
+				   !isfinite(pixel[1]) ||
+				   !isfinite(pixel[2]) ||
+				   !isfinite(pixel[3]))
+				{
+					pixel[0] = 0;
+					pixel[1] = 0;
+					pixel[2] = 0;
+					pixel[3] = 0;
+				}
+			}
+		}
+		else {
+			for(size_t i = 0; i < num_pixels; ++i) {
+				StorageType *pixel = &pixels[i];
+				if(!isfinite(pixel[0])) {
+					pixel[0] = 0;
+				}
+			}
+		}
+	}
+}
+
 template<TypeDesc::BASETYPE FileFormat,
          typename StorageType,
          typename DeviceType>
@@ -491,12 +589,27 @@ bool ImageManager::file_load_image(Image *img,
                                    int texture_limit,
                                    device_vector<DeviceType>& tex_img)
 {
-	const StorageType alpha_one = (FileFormat == TypeDesc::UINT8)? 255 : 1;
+	if(img->cache_image) {
+		/* Pixels are loaded on demand by the texture cache, the device only
+		 * gets a placeholder texel. */
+		thread_scoped_lock device_lock(device_mutex);
+		DeviceType *pixels = tex_img.alloc(1, 1);
+		memset(pixels, 0, sizeof(DeviceType));
+		tex_img.texture_cache = img->cache_image;
+		return true;
+	}
+
 	ImageInput *in = NULL;
 	int width, height, depth, components;
 	if(!file_load_image_generic(img, &in, width, height, depth, components)) {
 		return false;
 	}
+	/* Check if we actually have a float4 slot, in case components == 1,
+	 * but device doesn't support single channel textures.
+	 */
+	const bool is_rgba = (type == IMAGE_DATA_TYPE_FLOAT4 ||
+	                      type == IMAGE_DATA_TYPE_HALF4 ||
+	                      type == IMAGE_DATA_TYPE_BYTE4);
 	/* Read RGBA pixels. */
 	vector<StorageType> pixels_storage;
 	StorageType *pixels;
@@ -505,7 +618,24 @@ bool ImageManager::file_load_image(Image *img,
 		/* Don't bother with invalid images. */
 		return false;
 	}
-	if(texture_limit > 0 && max_size > texture_limit) {
+	const bool use_sparse = use_sparse_volumes && depth > 1;
+	const bool use_scale = texture_limit > 0 && max_size > texture_limit;
+	if(use_sparse && in && !use_scale) {
+		/* Volume files are converted to a sparse grid while reading. */
+		const bool loaded = file_load_sparse_volume<FileFormat, StorageType>(img,
+		                                                                     in,
+		                                                                     (const DeviceType*)NULL,
+		                                                                     width, height, depth,
+		                                                                     components,
+		                                                                     is_rgba,
+		                                                                     tex_img);
+		in->close();
+		delete in;
+		return loaded;
+	}
+	/* Scaled images and builtin volumes go through a temporary dense copy,
+	 * builtin callbacks fill all voxels at once. */
+	if(use_scale || use_sparse) {
 		pixels_storage.resize(((size_t)width)*height*depth*4);
 		pixels = &pixels_storage[0];
 	}
@@ -570,87 +700,14 @@ bool ImageManager::file_load_image(Image *img,
 			/* TODO(dingto): Support half for ImBuf. */
 		}
 	}
-	/* Check if we actually have a float4 slot, in case components == 1,
-	 * but device doesn't support single channel textures.
-	 */
-	bool is_rgba = (type == IMAGE_DATA_TYPE_FLOAT4 ||
-	                type == IMAGE_DATA_TYPE_HALF4 ||
-	                type == IMAGE_DATA_TYPE_BYTE4);
-	if(is_rgba) {
-		if(cmyk) {
-			/* CMYK */
-			for(size_t i = num_pixels-1, pixel = 0; pixel < num_pixels; pixel++, i--) {
-				pixels[i*4+2] = (pixels[i*4+2]*pixels[i*4+3])/255;
-				pixels[i*4+1] = (pixels[i*4+1]*pixels[i*4+3])/255;
-				pixels[i*4+0] = (pixels[i*4+0]*pixels[i*4+3])/255;
-				pixels[i*4+3] = alpha_one;
-			}
-		}
-		else if(components == 2) {
-			/* grayscale + alpha */
-			for(size_t i = num_pixels-1, pixel = 0; pixel < num_pixels; pixel++, i--) {
-				pixels[i*4+3] = pixels[i*2+1];
-				pixels[i*4+2] = pixels[i*2+0];
-				pixels[i*4+1] = pixels[i*2+0];
-				pixels[i*4+0] = pixels[i*2+0];
-			}
-		}
-		else if(components == 3) {
-			/* RGB */
-			for(size_t i = num_pixels-1, pixel = 0; pixel < num_pixels; pixel++, i--) {
-				pixels[i*4+3] = alpha_one;
-				pixels[i*4+2] = pixels[i*3+2];
-				pixels[i*4+1] = pixels[i*3+1];
-				pixels[i*4+0] = pixels[i*3+0];
-			}
-		}
-		else if(components == 1) {
-			/* grayscale */
-			for(size_t i = num_pixels-1, pixel = 0; pixel < num_pixels; pixel++, i--) {
-				pixels[i*4+3] = alpha_one;
-				pixels[i*4+2] = pixels[i];
-				pixels[i*4+1] = pixels[i];
-				pixels[i*4+0] = pixels[i];
-			}
-		}
-		if(img->use_alpha == false) {
-			for(size_t i = num_pixels-1, pixel = 0; pixel < num_pixels; pixel++, i--) {
-				pixels[i*4+3] = alpha_one;
-			}
-		}
-	}
-	/* Make sure we don't have buggy values. */
-	if(FileFormat == TypeDesc::FLOAT) {
-		/* For RGBA buffers we put all channels to 0 if either of them is not
-		 * finite. This way we avoid possible artifacts caused by fully changed
-		 * hue.
-		 */
-		if(is_rgba) {
-			for(size_t i = 0; i < num_pixels; i += 4) {
-				StorageType *pixel = &pixels[i*4];
-				if(!isfinite(pixel[0]) ||
-				   !isfinite(pixel[1]) ||
-				   !isfinite(pixel[2]) ||
-				   !isfinite(pixel[3]))
-				{
-					pixel[0] = 0;
-					pixel[1] = 0;
-					pixel[2] = 0;
-					pixel[3] = 0;
-				}
-			}
-		}
-		else {
-			for(size_t i = 0; i < num_pixels; ++i) {
-				StorageType *pixel = &pixels[i];
-				if(!isfinite(pixel[0])) {
-					pixel[0] = 0;
-				}
-			}
-		}
-	}
+	image_convert_pixels<FileFormat>(pixels,
+	                                 num_pixels,
+	                                 components,
+	                                 is_rgba,
+	                                 cmyk,
+	                                 img->use_alpha);
 	/* Scale image down if needed. */
-	if(pixels_storage.size() > 0) {
+	if(use_scale) {
 		float scale_factor = 1.0f;
 		while(max_size * scale_factor > texture_limit) {
 			scale_factor *= 0.5f;
@@ -666,19 +723,145 @@ bool ImageManager::file_load_image(Image *img,
 		                         &scaled_pixels,
 		                         &scaled_width, &scaled_height, &scaled_depth);
 
-		StorageType *texture_pixels;
+		pixels_storage.swap(scaled_pixels);
+		width = scaled_width;
+		height = scaled_height;
+		depth = scaled_depth;
+	}
+	if(pixels_storage.size() > 0) {
+		const DeviceType *voxels = (const DeviceType*)&pixels_storage[0];
+
+		if(use_sparse) {
+			file_load_sparse_volume<FileFormat, StorageType>(img,
+			                                                 NULL,
+			                                                 voxels,
+			                                                 width, height, depth,
+			                                                 components,
+			                                                 is_rgba,
+			                                                 tex_img);
+		}
+		else {
+			DeviceType *texture_pixels;
+
+			{
+				thread_scoped_lock device_lock(device_mutex);
+				texture_pixels = tex_img.alloc(width, height, depth);
+			}
+
+			memcpy(texture_pixels,
+			       voxels,
+			       ((size_t)width) * height * depth * sizeof(DeviceType));
+		}
+	}
+	return true;
+}
+
+/* Build a sparse grid one layer of bricks at a time, either from slices read
+ * from the file or from dense voxels. Volumes for which the sparse layout
+ * does not save enough memory are stored dense. */
+template<TypeDesc::BASETYPE FileFormat,
+         typename StorageType,
+         typename DeviceType>
+bool ImageManager::file_load_sparse_volume(Image *img,
+                                           ImageInput *in,
+                                           const DeviceType *voxels,
+                                           int width,
+                                           int height,
+                                           int depth,
+                                           int components,
+                                           bool is_rgba,
+                                           device_vector<DeviceType>& tex_img)
+{
+	SparseGrid *grid = new SparseGrid();
+	array<DeviceType> packed;
+	vector<StorageType> slab;
+
+	const size_t slice_size = ((size_t)width) * height;
+	if(in) {
+		slab.resize(slice_size * SparseGrid::BRICK_SIZE * max(components, 4));
+	}
+
+	grid->reset(width, height, depth);
+
+	for(int bz = 0; bz < grid->bricks_z; bz++) {
+		const int z0 = bz * SparseGrid::BRICK_SIZE;
+		const int z1 = min(z0 + SparseGrid::BRICK_SIZE, depth);
+
+		if(!in) {
+			grid->build_slab(voxels + z0 * slice_size, bz, packed);
+			continue;
+		}
+
+		StorageType *pixels = &slab[0];
+		for(int z = z0; z < z1; z++) {
+			if(!in->read_scanlines(0, height, z,
+			                       FileFormat,
+			                       (uchar*)(pixels + (z - z0) * slice_size * components)))
+			{
+				delete grid;
+				return false;
+			}
+		}
+
+		const size_t num_pixels = slice_size * (z1 - z0);
+		if(components > 4) {
+			for(size_t i = 0; i < num_pixels; i++) {
+				pixels[i*4+0] = pixels[i*components+0];
+				pixels[i*4+1] = pixels[i*components+1];
+				pixels[i*4+2] = pixels[i*components+2];
+				pixels[i*4+3] = pixels[i*components+3];
+			}
+		}
+		image_convert_pixels<FileFormat>(pixels,
+		                                 num_pixels,
+		                                 components,
+		                                 is_rgba,
+		                                 false,
+		                                 img->use_alpha);
+
+		grid->build_slab((const DeviceType*)pixels, bz, packed);
+	}
+
+	grid->build_tiles();
+
+	/* Bricks are padded at the border of the grid, so keep mostly filled
+	 * volumes dense which is also faster to look up. */
+	const size_t num_active_bricks = grid->num_active_bricks();
+	const size_t dense_size = ((size_t)width) * height * depth * sizeof(DeviceType);
+	const size_t sparse_size = num_active_bricks * SparseGrid::BRICK_VOXELS * sizeof(DeviceType) +
+	                           grid->memory_size();
+
+	VLOG(1) << "Volume " << img->filename << ": "
+	        << num_active_bricks << " of " << grid->num_bricks() << " bricks active, "
+	        << string_human_readable_size(sparse_size) << " sparse, "
+	        << string_human_readable_size(dense_size) << " dense.";
+
+	if(sparse_size * 4 > dense_size * 3) {
+		DeviceType *texture_pixels;
 
 		{
 			thread_scoped_lock device_lock(device_mutex);
-			texture_pixels = (StorageType*)tex_img.alloc(scaled_width,
-			                                             scaled_height,
-			                                             scaled_depth);
+			texture_pixels = tex_img.alloc(width, height, depth);
 		}
 
-		memcpy(texture_pixels,
-		       &scaled_pixels[0],
-		       scaled_pixels.size() * sizeof(StorageType));
+		grid->unpack(packed.data(), texture_pixels);
+		delete grid;
+		return true;
+	}
+
+	DeviceType *texture_voxels;
+
+	{
+		thread_scoped_lock device_lock(device_mutex);
+		/* Keep at least one voxel, so fully empty volumes still have data. */
+		texture_voxels = tex_img.alloc(max(num_active_bricks * SparseGrid::BRICK_VOXELS, (size_t)1));
 	}
+
+	memset(texture_voxels, 0, sizeof(DeviceType));
+	memcpy(texture_voxels, packed.data(), packed.size() * sizeof(DeviceType));
+
+	tex_img.sparse_grid = grid;
+	img->sparse_grid = grid;
 	return true;
 }
 
@@ -712,6 +895,23 @@ void ImageManager::device_load_image(Device *device,
 		img->mem = NULL;
 	}
 
+	if(img->cache_image) {
+		texture_cache->remove_image(img->cache_image);
+		img->cache_image = NULL;
+	}
+
+	delete img->sparse_grid;
+	img->sparse_grid = NULL;
+
+	/* Images from file can be loaded on demand, builtin images are always
+	 * loaded fully. */
+	if(texture_cache && !img->builtin_data) {
+		img->cache_image = texture_cache->add_image(img->filename,
+		                                            type,
+		                                            img->use_alpha,
+		                                            texture_limit);
+	}
+
 	/* Create new texture. */
 	if(type == IMAGE_DATA_TYPE_FLOAT4) {
 		device_vector<float4> *tex_img
@@ -878,6 +1078,11 @@ void ImageManager::device_free_image(Device *, ImageDataType type, int slot)
 			delete img->mem;
 		}
 
+		if(img->cache_image) {
+			texture_cache->remove_image(img->cache_image);
+		}
+
+		delete img->sparse_grid;
 		delete img;
 		images[type][slot] = NULL;
 		--tex_num_images[type];
@@ -892,6 +1097,8 @@ void ImageManager::device_update(Device *device,
 		return;
 	}
 
+	device_update_texture_cache(scene);
+
 	TaskPool pool;
 	for(int type = 0; type < IMAGE_DATA_NUM_TYPES; type++) {
 		for(size_t slot = 0; slot < images[type].size(); slot++) {
@@ -930,6 +1137,8 @@ void ImageManager::device_update_slot(Device *device,
 	Image *image = images[type][slot];
 	assert(image != NULL);
 
+	device_update_texture_cache(scene);
+
 	if(image->users == 0) {
 		device_free_image(device, type, slot);
 	}
@@ -953,6 +1162,17 @@ void ImageManager::device_free_builtin(Device *device)
 	}
 }
 
+void ImageManager::device_update_texture_cache(Scene *scene)
+{
+	if(texture_cache || !use_texture_cache) {
+		return;
+	}
+
+	if(scene->params.texture_cache_size > 0) {
+		texture_cache = new TextureCache(scene->params.texture_cache_size);
+	}
+}
+
 void ImageManager::device_free(Device *device)
 {
 	for(int type = 0; type < IMAGE_DATA_NUM_TYPES; type++) {
@@ -961,6 +1181,12 @@ void ImageManager::device_free(Device *device)
 		}
 		images[type].clear();
 	}
+
+	if(texture_cache) {
+		TextureCache::Stats stats;
+		texture_cache->get_stats(&stats);
+		VLOG(1) << "Texture cache statistics:\n" << stats.full_report();
+	}
 }
 
 CCL_NAMESPACE_END
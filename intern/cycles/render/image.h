@@ -21,7 +21,9 @@
 #include "device/device_memory.h"
 
 #include "util/util_image.h"
+#include "util/util_sparse_grid.h"
 #include "util/util_string.h"
+#include "util/util_texture_cache.h"
 #include "util/util_thread.h"
 #include "util/util_vector.h"
 
@@ -121,6 +123,8 @@ public:
 
 		string mem_name;
 		device_memory *mem;
+		TextureCache::Image *cache_image;
+		SparseGrid *sparse_grid;
 
 		int users;
 	};
@@ -136,6 +140,13 @@ private:
 	vector<Image*> images[IMAGE_DATA_NUM_TYPES];
 	void *osl_texture_system;
 
+	/* Out-of-core texture cache, only used for CPU rendering. */
+	bool use_texture_cache;
+	TextureCache *texture_cache;
+
+	/* Store volumes as sparse grids, only used for CPU rendering. */
+	bool use_sparse_volumes;
+
 	bool file_load_image_generic(Image *img,
 	                             ImageInput **in,
 	                             int &width,
@@ -151,11 +162,26 @@ private:
 	                     int texture_limit,
 	                     device_vector<DeviceType>& tex_img);
 
+	template<TypeDesc::BASETYPE FileFormat,
+	         typename StorageType,
+	         typename DeviceType>
+	bool file_load_sparse_volume(Image *img,
+	                             ImageInput *in,
+	                             const DeviceType *voxels,
+	                             int width,
+	                             int height,
+	                             int depth,
+	                             int components,
+	                             bool is_rgba,
+	                             device_vector<DeviceType>& tex_img);
+
 	int max_flattened_slot(ImageDataType type);
 	int type_index_to_flattened_slot(int slot, ImageDataType type);
 	int flattened_slot_to_type_index(int flat_slot, ImageDataType *type);
 	string name_from_type(int type);
 
+	void device_update_texture_cache(Scene *scene);
+
 	void device_load_image(Device *device,
 	                       Scene *scene,
 	                       ImageDataType type,
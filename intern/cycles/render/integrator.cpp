@@ -64,9 +64,13 @@ NODE_DEFINE(Integrator)
 	SOCKET_INT(volume_samples, "Volume Samples", 1);
 	SOCKET_INT(start_sample, "Start Sample", 0);
 
+	SOCKET_FLOAT(adaptive_threshold, "Adaptive Threshold", 0.0f);
+	SOCKET_INT(adaptive_min_samples, "Adaptive Min Samples", 0);
+
 	SOCKET_BOOLEAN(sample_all_lights_direct, "Sample All Lights Direct", true);
 	SOCKET_BOOLEAN(sample_all_lights_indirect, "Sample All Lights Indirect", true);
 	SOCKET_FLOAT(light_sampling_threshold, "Light Sampling Threshold", 0.05f);
+	SOCKET_BOOLEAN(use_light_tree, "Use Light Tree", false);
 
 	static NodeEnum method_enum;
 	method_enum.insert("path", PATH);
@@ -168,6 +172,24 @@ void Integrator::device_update(Device *device, DeviceScene *dscene, Scene *scene
 	kintegrator->sampling_pattern = sampling_pattern;
 	kintegrator->aa_samples = aa_samples;
 
+	/* Convergence is tested every few samples, the step has to be even since
+	 * the error estimate compares against every second sample. */
+	kintegrator->adaptive_step = 4;
+	if(adaptive_min_samples > 0) {
+		kintegrator->adaptive_min_samples = adaptive_min_samples;
+	}
+	else {
+		kintegrator->adaptive_min_samples = max(4, (int)sqrtf((float)aa_samples));
+	}
+	kintegrator->adaptive_min_samples = (int)round_up(kintegrator->adaptive_min_samples,
+	                                                  kintegrator->adaptive_step);
+	if(adaptive_threshold > 0.0f) {
+		kintegrator->adaptive_threshold = adaptive_threshold;
+	}
+	else {
+		kintegrator->adaptive_threshold = max(0.001f, 1.0f / (float)max(aa_samples, 1));
+	}
+
 	if(light_sampling_threshold > 0.0f) {
 		kintegrator->light_inv_rr_threshold = 1.0f / light_sampling_threshold;
 	}
@@ -232,8 +254,19 @@ void Integrator::tag_update(Scene *scene)
 			break;
 		}
 	}
+	if(scene->light_manager->use_light_tree != use_light_tree_sampling()) {
+		scene->light_manager->tag_update(scene);
+	}
 	need_update = true;
 }
 
+bool Integrator::use_light_tree_sampling() const
+{
+	if(method == BRANCHED_PATH && (sample_all_lights_direct || sample_all_lights_indirect)) {
+		return false;
+	}
+	return use_light_tree;
+}
+
 CCL_NAMESPACE_END
 
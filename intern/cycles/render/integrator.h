@@ -65,9 +65,14 @@ public:
 	int volume_samples;
 	int start_sample;
 
+	/* Zero selects the threshold and minimum samples from the AA samples. */
+	float adaptive_threshold;
+	int adaptive_min_samples;
+
 	bool sample_all_lights_direct;
 	bool sample_all_lights_indirect;
 	float light_sampling_threshold;
+	bool use_light_tree;
 
 	enum Method {
 		BRANCHED_PATH = 0,
@@ -90,6 +95,10 @@ public:
 
 	bool modified(const Integrator& integrator);
 	void tag_update(Scene *scene);
+
+	/* The light tree only replaces picking a single light, when sampling
+	 * all lights the flat distribution is used. */
+	bool use_light_tree_sampling() const;
 };
 
 CCL_NAMESPACE_END
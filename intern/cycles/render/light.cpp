@@ -19,6 +19,7 @@
 #include "render/integrator.h"
 #include "render/film.h"
 #include "render/light.h"
+#include "render/light_tree.h"
 #include "render/mesh.h"
 #include "render/object.h"
 #include "render/scene.h"
@@ -171,6 +172,7 @@ LightManager::LightManager()
 {
 	need_update = true;
 	use_light_visibility = false;
+	use_light_tree = false;
 }
 
 LightManager::~LightManager()
@@ -242,10 +244,24 @@ bool LightManager::object_usable_as_light(Object *object) {
 	return false;
 }
 
-void LightManager::device_update_distribution(Device *, DeviceScene *dscene, Scene *scene, Progress& progress)
+/* Strength of an emission shader for the light tree, only known for constant
+ * emission. Other shaders are assumed to have unit strength. */
+static float light_tree_shader_strength(Shader *shader)
+{
+	float3 emission;
+	if(shader->is_constant_emission(&emission)) {
+		return average(fabs(emission));
+	}
+	return 1.0f;
+}
+
+void LightManager::device_update_distribution(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress)
 {
 	progress.set_status("Updating Lights", "Computing distribution");
 
+	use_light_tree = scene->integrator->use_light_tree_sampling();
+	const bool build_light_tree = use_light_tree && device->info.advanced_shading;
+
 	/* count */
 	size_t num_lights = 0;
 	size_t num_portals = 0;
@@ -291,6 +307,21 @@ void LightManager::device_update_distribution(Device *, DeviceScene *dscene, Sce
 	KernelLightDistribution *distribution = dscene->light_distribution.alloc(num_distribution + 1);
 	float totarea = 0.0f;
 
+	/* Emitters for the light tree, and the slot of each distribution index in
+	 * the leaves table. Lamps come first in the table, followed by all the
+	 * triangles of each light object, so leaves can be found from the lamp
+	 * index or from the object and primitive. */
+	vector<LightTreePrimitive> light_tree_prims;
+	vector<int> light_tree_infinite;
+	vector<uint> light_tree_slots;
+	vector<uint2> light_tree_objects;
+	uint num_light_tree_slots = num_lights;
+
+	if(build_light_tree) {
+		light_tree_slots.resize(num_distribution, LIGHT_TREE_NONE);
+		light_tree_objects.resize(scene->objects.size(), make_uint2(LIGHT_TREE_NONE, 0));
+	}
+
 	/* triangles */
 	size_t offset = 0;
 	int j = 0;
@@ -327,6 +358,13 @@ void LightManager::device_update_distribution(Device *, DeviceScene *dscene, Sce
 		}
 
 		size_t mesh_num_triangles = mesh->num_triangles();
+		uint object_slot = num_light_tree_slots;
+
+		if(build_light_tree) {
+			light_tree_objects[object_id] = make_uint2(object_slot, mesh->tri_offset);
+			num_light_tree_slots += mesh_num_triangles;
+		}
+
 		for(size_t i = 0; i < mesh_num_triangles; i++) {
 			int shader_index = mesh->shader[i];
 			Shader *shader = (shader_index < mesh->used_shaders.size())
@@ -334,6 +372,10 @@ void LightManager::device_update_distribution(Device *, DeviceScene *dscene, Sce
 			                         : scene->default_surface;
 
 			if(shader->use_mis && shader->has_surface_emission) {
+				if(build_light_tree) {
+					light_tree_slots[offset] = object_slot + i;
+				}
+
 				distribution[offset].totarea = totarea;
 				distribution[offset].prim = i + mesh->tri_offset;
 				distribution[offset].mesh_light.shader_flag = shader_flag;
@@ -354,7 +396,20 @@ void LightManager::device_update_distribution(Device *, DeviceScene *dscene, Sce
 					p3 = transform_point(&tfm, p3);
 				}
 
-				totarea += triangle_area(p1, p2, p3);
+				float area = triangle_area(p1, p2, p3);
+				totarea += area;
+
+				if(build_light_tree) {
+					/* Triangles emit from both sides. */
+					LightTreePrimitive prim;
+					prim.bounds = BoundBox(p1);
+					prim.bounds.grow(p2);
+					prim.bounds.grow(p3);
+					prim.cone = LightTreeCone::omnidirectional();
+					prim.energy = 2.0f*area*light_tree_shader_strength(shader);
+					prim.distribution_index = offset - 1;
+					light_tree_prims.push_back(prim);
+				}
 			}
 		}
 
@@ -378,6 +433,48 @@ void LightManager::device_update_distribution(Device *, DeviceScene *dscene, Sce
 		distribution[offset].lamp.size = light->size;
 		totarea += lightarea;
 
+		if(build_light_tree) {
+			light_tree_slots[offset] = light_index;
+
+			if(light->type == LIGHT_DISTANT || light->type == LIGHT_BACKGROUND) {
+				light_tree_infinite.push_back(offset);
+			}
+			else {
+				/* Power of the lamp, relative to that of mesh lights. */
+				Shader *shader = (light->shader) ? light->shader : scene->default_light;
+				float strength = light_tree_shader_strength(shader);
+
+				LightTreePrimitive prim;
+				prim.distribution_index = offset;
+
+				if(light->type == LIGHT_AREA) {
+					float3 axisu = light->axisu*(light->sizeu*light->size);
+					float3 axisv = light->axisv*(light->sizev*light->size);
+
+					prim.bounds = BoundBox(light->co - 0.5f*axisu - 0.5f*axisv);
+					prim.bounds.grow(light->co + 0.5f*axisu - 0.5f*axisv);
+					prim.bounds.grow(light->co - 0.5f*axisu + 0.5f*axisv);
+					prim.bounds.grow(light->co + 0.5f*axisu + 0.5f*axisv);
+					prim.cone = LightTreeCone(safe_normalize(light->dir), 0.0f, M_PI_2_F);
+					prim.energy = 0.25f*strength;
+				}
+				else {
+					float3 radius = make_float3(light->size, light->size, light->size);
+
+					prim.bounds = BoundBox(light->co - radius, light->co + radius);
+					if(light->type == LIGHT_SPOT) {
+						prim.cone = LightTreeCone(safe_normalize(light->dir), 0.5f*light->spot_angle, 0.0f);
+					}
+					else {
+						prim.cone = LightTreeCone::omnidirectional();
+					}
+					prim.energy = M_1_PI_F*strength;
+				}
+
+				light_tree_prims.push_back(prim);
+			}
+		}
+
 		if(light->size > 0.0f && light->use_mis)
 			use_lamp_mis = true;
 		if(light->type == LIGHT_BACKGROUND) {
@@ -446,6 +543,49 @@ void LightManager::device_update_distribution(Device *, DeviceScene *dscene, Sce
 		/* CDF */
 		dscene->light_distribution.copy_to_device();
 
+		/* Light tree */
+		kintegrator->use_light_tree = build_light_tree;
+
+		if(build_light_tree) {
+			progress.set_status("Updating Lights", "Building light tree");
+
+			double time_start = time_dt();
+
+			LightTree light_tree;
+			light_tree.build(light_tree_prims, light_tree_infinite, num_distribution);
+
+			KernelLightTreeNode *nodes = dscene->light_tree_nodes.alloc(light_tree.nodes.size());
+			memcpy(nodes, &light_tree.nodes[0], sizeof(KernelLightTreeNode)*light_tree.nodes.size());
+
+			uint *leaves = dscene->light_tree_leaves.alloc(num_light_tree_slots);
+			for(size_t i = 0; i < num_light_tree_slots; i++) {
+				leaves[i] = LIGHT_TREE_NONE;
+			}
+			for(size_t i = 0; i < num_distribution; i++) {
+				if(light_tree_slots[i] != LIGHT_TREE_NONE) {
+					leaves[light_tree_slots[i]] = light_tree.leaves[i];
+				}
+			}
+
+			uint2 *objects = dscene->light_tree_objects.alloc(light_tree_objects.size());
+			for(size_t i = 0; i < light_tree_objects.size(); i++) {
+				objects[i] = light_tree_objects[i];
+			}
+
+			dscene->light_tree_nodes.copy_to_device();
+			dscene->light_tree_leaves.copy_to_device();
+			dscene->light_tree_objects.copy_to_device();
+
+			/* Distant and background lights are picked by count, against the
+			 * rest of the tree as a single light. */
+			int num_infinite = light_tree_infinite.size();
+			int num_choices = num_infinite + (light_tree_prims.empty()? 0: 1);
+			kintegrator->pdf_lights = (num_infinite)? 1.0f/num_choices: 0.0f;
+
+			VLOG(1) << "Light tree built in " << time_dt() - time_start << " seconds:\n"
+			        << light_tree.stats.full_report();
+		}
+
 		/* Portals */
 		if(num_portals > 0) {
 			kintegrator->portal_offset = light_index;
@@ -463,6 +603,7 @@ void LightManager::device_update_distribution(Device *, DeviceScene *dscene, Sce
 
 		kintegrator->num_distribution = 0;
 		kintegrator->num_all_lights = 0;
+		kintegrator->use_light_tree = false;
 		kintegrator->pdf_triangles = 0.0f;
 		kintegrator->pdf_lights = 0.0f;
 		kintegrator->use_lamp_mis = false;
@@ -872,6 +1013,9 @@ void LightManager::device_free(Device *, DeviceScene *dscene)
 	dscene->lights.free();
 	dscene->light_background_marginal_cdf.free();
 	dscene->light_background_conditional_cdf.free();
+	dscene->light_tree_nodes.free();
+	dscene->light_tree_leaves.free();
+	dscene->light_tree_objects.free();
 }
 
 void LightManager::tag_update(Scene * /*scene*/)
@@ -83,6 +83,10 @@ public:
 	bool use_light_visibility;
 	bool need_update;
 
+	/* Integrator settings asked for the light tree when the distribution was
+	 * last built, see Integrator::use_light_tree_sampling(). */
+	bool use_light_tree;
+
 	LightManager();
 	~LightManager();
 
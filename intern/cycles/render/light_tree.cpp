@@ -0,0 +1,406 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "render/light_tree.h"
+
+#include "util/util_algorithm.h"
+#include "util/util_math.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Number of bins along each axis when searching for a split. */
+static const int LIGHT_TREE_NUM_BINS = 12;
+
+/* Beyond this depth nodes are split at the median, which bounds the depth
+ * for badly distributed emitters. Deep trees cost traversal time, and lose
+ * precision of the random number reused for sampling the light. */
+static const int LIGHT_TREE_MAX_SAH_DEPTH = 48;
+
+/* Cone */
+
+LightTreeCone::LightTreeCone()
+: axis(make_float3(0.0f, 0.0f, 1.0f)), theta_o(-1.0f), theta_e(0.0f)
+{
+}
+
+LightTreeCone::LightTreeCone(const float3& axis, float theta_o, float theta_e)
+: axis(axis), theta_o(theta_o), theta_e(theta_e)
+{
+}
+
+LightTreeCone LightTreeCone::omnidirectional()
+{
+	return LightTreeCone(make_float3(0.0f, 0.0f, 1.0f), M_PI_F, M_PI_2_F);
+}
+
+LightTreeCone LightTreeCone::merge(const LightTreeCone& cone_a, const LightTreeCone& cone_b)
+{
+	if(cone_a.is_empty()) {
+		return cone_b;
+	}
+	if(cone_b.is_empty()) {
+		return cone_a;
+	}
+
+	/* Let a be the wider cone. */
+	const bool swap = (cone_b.theta_o > cone_a.theta_o);
+	const LightTreeCone& a = (swap)? cone_b: cone_a;
+	const LightTreeCone& b = (swap)? cone_a: cone_b;
+
+	const float theta_d = safe_acosf(dot(a.axis, b.axis));
+	const float theta_e = max(a.theta_e, b.theta_e);
+
+	/* b is inside a. */
+	if(min(theta_d + b.theta_o, M_PI_F) <= a.theta_o) {
+		return LightTreeCone(a.axis, a.theta_o, theta_e);
+	}
+
+	const float theta_o = 0.5f*(a.theta_o + theta_d + b.theta_o);
+	const float3 rotation_axis = cross(a.axis, b.axis);
+
+	/* Covering all directions, or axes pointing in opposite directions
+	 * where the rotation is not defined. */
+	if(theta_o >= M_PI_F || len_squared(rotation_axis) < 1e-12f) {
+		return LightTreeCone(a.axis, M_PI_F, theta_e);
+	}
+
+	/* Rotate the axis of a towards b, to the middle of the new cone. */
+	const float theta_r = theta_o - a.theta_o;
+	const float3 w = normalize(rotation_axis);
+	const float3 axis = normalize(a.axis*cosf(theta_r) + cross(w, a.axis)*sinf(theta_r));
+
+	return LightTreeCone(axis, theta_o, theta_e);
+}
+
+float LightTreeCone::measure() const
+{
+	/* Integral of the cosine weighted emission over the sphere of directions,
+	 * as given in the paper. */
+	const float theta_w = min(theta_o + theta_e, M_PI_F);
+	const float sin_theta_o = sinf(theta_o);
+	const float cos_theta_o = cosf(theta_o);
+
+	return M_2PI_F*(1.0f - cos_theta_o) +
+	       M_PI_2_F*(2.0f*theta_w*sin_theta_o -
+	                 cosf(theta_o - 2.0f*theta_w) -
+	                 2.0f*theta_o*sin_theta_o +
+	                 cos_theta_o);
+}
+
+/* Stats */
+
+LightTree::Stats::Stats()
+: num_nodes(0),
+  num_leaves(0),
+  max_depth(0)
+{
+}
+
+string LightTree::Stats::full_report() const
+{
+	string result = "";
+	result += string_printf("Nodes:           %d\n", num_nodes);
+	result += string_printf("Leaves:          %d\n", num_leaves);
+	result += string_printf("Max depth:       %d\n", max_depth);
+	return result;
+}
+
+/* Tree */
+
+LightTree::LightTree()
+{
+}
+
+void LightTree::build(vector<LightTreePrimitive>& prims,
+                      const vector<int>& infinite_lights,
+                      int num_distribution)
+{
+	nodes.clear();
+	leaves.clear();
+	leaves.resize(num_distribution, LIGHT_TREE_NONE);
+	stats = Stats();
+
+	const int num_local = prims.size();
+	const int num_infinite = infinite_lights.size();
+
+	if(num_local == 0 && num_infinite == 0) {
+		return;
+	}
+
+	nodes.resize(1);
+
+	if(num_local > 0 && num_infinite > 0) {
+		/* Root picking between infinite lights and the rest of the tree. */
+		nodes.resize(3);
+		memset(&nodes[0], 0, sizeof(KernelLightTreeNode));
+		nodes[0].child = 1;
+		nodes[0].parent = -1;
+		nodes[0].num_infinite = num_infinite;
+
+		build_infinite(1, 0, 1, infinite_lights, 0, num_infinite);
+		build_local(2, 0, 1, prims, 0, num_local);
+	}
+	else if(num_infinite > 0) {
+		build_infinite(0, -1, 0, infinite_lights, 0, num_infinite);
+	}
+	else {
+		build_local(0, -1, 0, prims, 0, num_local);
+	}
+
+	stats.num_nodes = nodes.size();
+}
+
+void LightTree::add_leaf(int index, int depth, int distribution_index)
+{
+	nodes[index].child = ~distribution_index;
+	leaves[distribution_index] = index;
+
+	stats.num_leaves++;
+	stats.max_depth = max(stats.max_depth, depth);
+}
+
+void LightTree::build_local(int index,
+                            int parent,
+                            int depth,
+                            vector<LightTreePrimitive>& prims,
+                            int begin,
+                            int end)
+{
+	BoundBox bounds = BoundBox::empty;
+	BoundBox centroid_bounds = BoundBox::empty;
+	LightTreeCone cone;
+	float energy = 0.0f;
+
+	for(int i = begin; i < end; i++) {
+		bounds.grow(prims[i].bounds);
+		centroid_bounds.grow(prims[i].bounds.center());
+		cone = LightTreeCone::merge(cone, prims[i].cone);
+		energy += prims[i].energy;
+	}
+
+	KernelLightTreeNode& knode = nodes[index];
+	memset(&knode, 0, sizeof(KernelLightTreeNode));
+	knode.bbox_min[0] = bounds.min.x;
+	knode.bbox_min[1] = bounds.min.y;
+	knode.bbox_min[2] = bounds.min.z;
+	knode.bbox_max[0] = bounds.max.x;
+	knode.bbox_max[1] = bounds.max.y;
+	knode.bbox_max[2] = bounds.max.z;
+	knode.parent = parent;
+	knode.axis[0] = cone.axis.x;
+	knode.axis[1] = cone.axis.y;
+	knode.axis[2] = cone.axis.z;
+	knode.theta_o = cone.theta_o;
+	knode.theta_e = cone.theta_e;
+	knode.energy = energy;
+	knode.num_infinite = 0;
+
+	if(end - begin == 1) {
+		add_leaf(index, depth, prims[begin].distribution_index);
+		return;
+	}
+
+	int mid = split(prims, begin, end, bounds, centroid_bounds, depth);
+
+	/* Note that this invalidates knode. */
+	int child = nodes.size();
+	nodes.resize(child + 2);
+	nodes[index].child = child;
+
+	build_local(child, index, depth + 1, prims, begin, mid);
+	build_local(child + 1, index, depth + 1, prims, mid, end);
+}
+
+void LightTree::build_infinite(int index,
+                               int parent,
+                               int depth,
+                               const vector<int>& infinite_lights,
+                               int begin,
+                               int end)
+{
+	KernelLightTreeNode& knode = nodes[index];
+	memset(&knode, 0, sizeof(KernelLightTreeNode));
+	knode.parent = parent;
+	knode.num_infinite = end - begin;
+
+	if(end - begin == 1) {
+		add_leaf(index, depth, infinite_lights[begin]);
+		return;
+	}
+
+	int mid = (begin + end)/2;
+
+	int child = nodes.size();
+	nodes.resize(child + 2);
+	nodes[index].child = child;
+
+	build_infinite(child, index, depth + 1, infinite_lights, begin, mid);
+	build_infinite(child + 1, index, depth + 1, infinite_lights, mid, end);
+}
+
+namespace {
+
+struct LightTreeBin {
+	LightTreeBin()
+	: bounds(BoundBox::empty), energy(0.0f), count(0)
+	{
+	}
+
+	void add(const LightTreeBin& other)
+	{
+		bounds.grow(other.bounds);
+		cone = LightTreeCone::merge(cone, other.cone);
+		energy += other.energy;
+		count += other.count;
+	}
+
+	/* Surface area orientation heuristic from the paper. */
+	float cost() const
+	{
+		return energy*cone.measure()*bounds.safe_area();
+	}
+
+	BoundBox bounds;
+	LightTreeCone cone;
+	float energy;
+	int count;
+};
+
+struct LightTreeBinLeft {
+	LightTreeBinLeft(int axis, float min, float inv_extent, int split_bin)
+	: axis(axis), min(min), inv_extent(inv_extent), split_bin(split_bin)
+	{
+	}
+
+	bool operator()(const LightTreePrimitive& prim) const
+	{
+		int bin = (int)((prim.bounds.center()[axis] - min)*inv_extent);
+		return clamp(bin, 0, LIGHT_TREE_NUM_BINS - 1) < split_bin;
+	}
+
+	int axis;
+	float min;
+	float inv_extent;
+	int split_bin;
+};
+
+struct LightTreeCentroidCompare {
+	LightTreeCentroidCompare(int axis)
+	: axis(axis)
+	{
+	}
+
+	bool operator()(const LightTreePrimitive& a, const LightTreePrimitive& b) const
+	{
+		return a.bounds.center2()[axis] < b.bounds.center2()[axis];
+	}
+
+	int axis;
+};
+
+}  /* namespace */
+
+int LightTree::split(vector<LightTreePrimitive>& prims,
+                     int begin,
+                     int end,
+                     const BoundBox& bounds,
+                     const BoundBox& centroid_bounds,
+                     int depth)
+{
+	const float3 extent = bounds.size();
+	const float3 centroid_extent = centroid_bounds.size();
+	const float max_extent = max3(extent);
+
+	float best_cost = FLT_MAX;
+	int best_axis = -1;
+	int best_bin = 0;
+
+	for(int axis = 0; axis < 3 && depth < LIGHT_TREE_MAX_SAH_DEPTH; axis++) {
+		if(centroid_extent[axis] == 0.0f) {
+			continue;
+		}
+
+		const float inv_extent = LIGHT_TREE_NUM_BINS/centroid_extent[axis];
+		LightTreeBin bins[LIGHT_TREE_NUM_BINS];
+
+		for(int i = begin; i < end; i++) {
+			const LightTreePrimitive& prim = prims[i];
+			int bin = (int)((prim.bounds.center()[axis] - centroid_bounds.min[axis])*inv_extent);
+			bin = clamp(bin, 0, LIGHT_TREE_NUM_BINS - 1);
+
+			bins[bin].bounds.grow(prim.bounds);
+			bins[bin].cone = LightTreeCone::merge(bins[bin].cone, prim.cone);
+			bins[bin].energy += prim.energy;
+			bins[bin].count++;
+		}
+
+		/* Cost of everything right of each split. */
+		float right_cost[LIGHT_TREE_NUM_BINS];
+		LightTreeBin right;
+		for(int i = LIGHT_TREE_NUM_BINS - 1; i > 0; i--) {
+			right.add(bins[i]);
+			right_cost[i] = (right.count > 0)? right.cost(): 0.0f;
+		}
+
+		/* Regularization favoring splits of the longest axis, so nodes do
+		 * not get thin. */
+		const float regularization = (extent[axis] > 0.0f)? max_extent/extent[axis]: 1.0f;
+
+		LightTreeBin left;
+		for(int i = 1; i < LIGHT_TREE_NUM_BINS; i++) {
+			left.add(bins[i - 1]);
+
+			if(left.count == 0 || left.count == end - begin) {
+				continue;
+			}
+
+			const float cost = regularization*(left.cost() + right_cost[i]);
+			if(cost < best_cost) {
+				best_cost = cost;
+				best_axis = axis;
+				best_bin = i;
+			}
+		}
+	}
+
+	if(best_axis != -1) {
+		/* Binning is repeated with the same arithmetic, so primitives end up
+		 * on the same side as they were counted on. */
+		LightTreeBinLeft is_left(best_axis,
+		                         centroid_bounds.min[best_axis],
+		                         LIGHT_TREE_NUM_BINS/centroid_extent[best_axis],
+		                         best_bin);
+		vector<LightTreePrimitive>::iterator mid = std::partition(prims.begin() + begin,
+		                                                          prims.begin() + end,
+		                                                          is_left);
+		return mid - prims.begin();
+	}
+
+	/* Median split along the longest axis, when no split was found because
+	 * all centroids are in the same place, or the tree got too deep. */
+	int axis = 0;
+	if(centroid_extent.y > centroid_extent[axis]) axis = 1;
+	if(centroid_extent.z > centroid_extent[axis]) axis = 2;
+
+	int mid = (begin + end)/2;
+	std::nth_element(prims.begin() + begin,
+	                 prims.begin() + mid,
+	                 prims.begin() + end,
+	                 LightTreeCentroidCompare(axis));
+	return mid;
+}
+
+CCL_NAMESPACE_END
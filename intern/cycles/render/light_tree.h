@@ -0,0 +1,120 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __LIGHT_TREE_H__
+#define __LIGHT_TREE_H__
+
+#include "kernel/kernel_types.h"
+
+#include "util/util_boundbox.h"
+#include "util/util_string.h"
+#include "util/util_types.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Cone bounding the emission of a set of emitters, see KernelLightTreeNode. */
+
+class LightTreeCone {
+public:
+	LightTreeCone();
+	LightTreeCone(const float3& axis, float theta_o, float theta_e);
+
+	/* Cone for emitters which emit in all directions. */
+	static LightTreeCone omnidirectional();
+
+	/* Smallest cone containing both cones. */
+	static LightTreeCone merge(const LightTreeCone& a, const LightTreeCone& b);
+
+	/* Measure of the directions the cone emits in, used by the build cost. */
+	float measure() const;
+
+	bool is_empty() const { return theta_o < 0.0f; }
+
+	float3 axis;
+	float theta_o;
+	float theta_e;
+};
+
+/* Emitter with a position in the scene. */
+
+struct LightTreePrimitive {
+	BoundBox bounds;
+	LightTreeCone cone;
+	float energy;
+	/* Index in the light distribution. */
+	int distribution_index;
+};
+
+/* Light Tree
+ *
+ * Bounding volume hierarchy over the emitters of the light distribution,
+ * sampled in the kernel by kernel_light_tree.h. Distant and background lights
+ * have no position, they go into a separate subtree which is picked by count
+ * against the rest of the tree. */
+
+class LightTree {
+public:
+	LightTree();
+
+	/* Build from the emitters, which are reordered. Leaves are indexed by
+	 * distribution index, which must be below num_distribution. */
+	void build(vector<LightTreePrimitive>& prims,
+	           const vector<int>& infinite_lights,
+	           int num_distribution);
+
+	/* Root first, children of an inner node are consecutive. */
+	vector<KernelLightTreeNode> nodes;
+	/* Leaf node of each light distribution index, or LIGHT_TREE_NONE. */
+	vector<uint> leaves;
+
+	struct Stats {
+		Stats();
+
+		string full_report() const;
+
+		int num_nodes;
+		int num_leaves;
+		int max_depth;
+	} stats;
+
+protected:
+	void build_local(int index,
+	                 int parent,
+	                 int depth,
+	                 vector<LightTreePrimitive>& prims,
+	                 int begin,
+	                 int end);
+	void build_infinite(int index,
+	                    int parent,
+	                    int depth,
+	                    const vector<int>& infinite_lights,
+	                    int begin,
+	                    int end);
+
+	int split(vector<LightTreePrimitive>& prims,
+	          int begin,
+	          int end,
+	          const BoundBox& bounds,
+	          const BoundBox& centroid_bounds,
+	          int depth);
+
+	void add_leaf(int index, int depth, int distribution_index);
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __LIGHT_TREE_H__ */
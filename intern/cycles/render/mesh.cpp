@@ -16,6 +16,7 @@
 
 #include "bvh/bvh.h"
 #include "bvh/bvh_build.h"
+#include "bvh/bvh_cache.h"
 
 #include "render/camera.h"
 #include "render/curves.h"
@@ -30,6 +31,7 @@
 
 #include "kernel/osl/osl_globals.h"
 
+#include "subd/subd_cache.h"
 #include "subd/subd_split.h"
 #include "subd/subd_patch_table.h"
 
@@ -454,6 +456,7 @@ Mesh::Mesh()
 
 	subdivision_type = SUBDIVISION_NONE;
 	subd_params = NULL;
+	subd_cache = NULL;
 
 	patch_table = NULL;
 }
@@ -463,6 +466,7 @@ Mesh::~Mesh()
 	delete bvh;
 	delete patch_table;
 	delete subd_params;
+	delete subd_cache;
 }
 
 void Mesh::resize_mesh(int numverts, int numtris)
@@ -923,6 +927,30 @@ void Mesh::pack_normals(float4 *vnormal)
 	}
 }
 
+void Mesh::pack_normals(uint *vnormal_oct)
+{
+	Attribute *attr_vN = attributes.find(ATTR_STD_VERTEX_NORMAL);
+	if(attr_vN == NULL) {
+		/* Happens on objects with just hair. */
+		return;
+	}
+
+	bool do_transform = transform_applied;
+	Transform ntfm = transform_normal;
+
+	float3 *vN = attr_vN->data_float3();
+	size_t verts_size = verts.size();
+
+	for(size_t i = 0; i < verts_size; i++) {
+		float3 vNi = vN[i];
+
+		if(do_transform)
+			vNi = safe_normalize(transform_direction(&ntfm, vNi));
+
+		vnormal_oct[i] = float3_to_oct16(vNi);
+	}
+}
+
 void Mesh::pack_verts(const vector<uint>& tri_prim_index,
                       uint4 *tri_vindex,
                       uint *tri_patch,
@@ -1030,9 +1058,26 @@ void Mesh::pack_patches(uint *patch_data, uint vert_offset, uint face_offset, ui
 	}
 }
 
+/* Check whether refit made BVH too poor, so it is better to rebuild it. */
+static bool bvh_refit_degraded(const BVH *bvh, const SceneParams *params)
+{
+	const float cost_ratio = bvh->refit_cost_ratio();
+	VLOG(2) << "BVH refit " << bvh->num_refits << " times, cost ratio "
+	        << cost_ratio << ".";
+	if(params->bvh_refit_rebuild_factor > 0.0f &&
+	   cost_ratio > params->bvh_refit_rebuild_factor)
+	{
+		VLOG(1) << "BVH quality degraded after refit, cost ratio "
+		        << cost_ratio << ", rebuilding.";
+		return true;
+	}
+	return false;
+}
+
 void Mesh::compute_bvh(Device *device,
                        DeviceScene *dscene,
                        SceneParams *params,
+                       BVHCache *bvh_cache,
                        Progress *progress,
                        int n,
                        int total)
@@ -1055,12 +1100,14 @@ void Mesh::compute_bvh(Device *device,
 		vector<Object*> objects;
 		objects.push_back(&object);
 
+		bool do_rebuild = true;
 		if(bvh && !need_update_rebuild) {
 			progress->set_status(msg, "Refitting BVH");
 			bvh->objects = objects;
 			bvh->refit(*progress);
+			do_rebuild = bvh_refit_degraded(bvh, params);
 		}
-		else {
+		if(do_rebuild) {
 			progress->set_status(msg, "Building BVH");
 
 			BVHParams bparams;
@@ -1075,7 +1122,17 @@ void Mesh::compute_bvh(Device *device,
 
 			delete bvh;
 			bvh = BVH::create(bparams, objects);
-			MEM_GUARDED_CALL(progress, bvh->build, *progress);
+
+			string cache_key;
+			if(bvh_cache) {
+				cache_key = BVHCache::key(bparams, objects);
+			}
+			if(!bvh_cache || !bvh_cache->load(cache_key, bvh)) {
+				MEM_GUARDED_CALL(progress, bvh->build, *progress);
+				if(bvh_cache && !progress->get_cancel()) {
+					bvh_cache->store(cache_key, bvh);
+				}
+			}
 		}
 	}
 
@@ -1166,10 +1223,14 @@ MeshManager::MeshManager()
 {
 	need_update = true;
 	need_flags_update = true;
+	bvh = NULL;
+	bvh_cache = NULL;
 }
 
 MeshManager::~MeshManager()
 {
+	delete bvh;
+	delete bvh_cache;
 }
 
 void MeshManager::update_osl_attributes(Device *device, Scene *scene, vector<AttributeRequestSet>& mesh_attributes)
@@ -1392,12 +1453,69 @@ void MeshManager::update_svm_attributes(Device *, DeviceScene *dscene, Scene *sc
 	dscene->attributes_map.copy_to_device();
 }
 
+/* Quantized UVs keep a precision of 1/65535 of their extent. Larger extents,
+ * like UDIM layouts with many tiles or UVs repeating a texture, would lose
+ * detail within a tile, so they keep float storage. */
+#define QUANTIZED_UV_MAX_EXTENT 1.0f
+
+static void attribute_uv_bounds(Attribute *mattr,
+                                size_t size,
+                                float2 *uv_min,
+                                float2 *uv_max)
+{
+	const float3 *data = mattr->data_float3();
+
+	*uv_min = make_float2(FLT_MAX, FLT_MAX);
+	*uv_max = make_float2(-FLT_MAX, -FLT_MAX);
+	for(size_t k = 0; k < size; k++) {
+		const float2 uv = make_float2(data[k].x, data[k].y);
+		*uv_min = min(*uv_min, uv);
+		*uv_max = max(*uv_max, uv);
+	}
+	if(size == 0) {
+		*uv_min = *uv_max = make_float2(0.0f, 0.0f);
+	}
+}
+
+/* With compressed geometry, UV maps of triangles are stored as two 16 bit
+ * values per corner relative to their bounds on the mesh. Both passes over
+ * the attributes must make the same decision, so ranges are counted here. */
+static bool attribute_use_quantized(Scene *scene,
+                                    Mesh *mesh,
+                                    Attribute *mattr,
+                                    AttributePrimitive prim,
+                                    size_t *num_quantized)
+{
+	if(!scene->params.use_compressed_geometry ||
+	   mattr == NULL ||
+	   mattr->std != ATTR_STD_UV ||
+	   mattr->element != ATTR_ELEMENT_CORNER ||
+	   prim != ATTR_PRIM_TRIANGLE ||
+	   mesh->subdivision_type != Mesh::SUBDIVISION_NONE ||
+	   *num_quantized >= ATTR_QUANTIZED_MAX_RANGES)
+	{
+		return false;
+	}
+
+	float2 uv_min, uv_max;
+	attribute_uv_bounds(mattr, mattr->element_size(mesh, prim), &uv_min, &uv_max);
+	const float2 extent = uv_max - uv_min;
+	if(extent.x > QUANTIZED_UV_MAX_EXTENT || extent.y > QUANTIZED_UV_MAX_EXTENT) {
+		return false;
+	}
+
+	(*num_quantized)++;
+	return true;
+}
+
 static void update_attribute_element_size(Mesh *mesh,
                                           Attribute *mattr,
                                           AttributePrimitive prim,
+                                          bool quantized,
                                           size_t *attr_float_size,
                                           size_t *attr_float3_size,
-                                          size_t *attr_uchar4_size)
+                                          size_t *attr_uchar4_size,
+                                          size_t *attr_quantized_size)
 {
 	if(mattr) {
 		size_t size = mattr->element_size(mesh, prim);
@@ -1405,6 +1523,9 @@ static void update_attribute_element_size(Mesh *mesh,
 		if(mattr->element == ATTR_ELEMENT_VOXEL) {
 			/* pass */
 		}
+		else if(quantized) {
+			*attr_quantized_size += size;
+		}
 		else if(mattr->element == ATTR_ELEMENT_CORNER_BYTE) {
 			*attr_uchar4_size += size;
 		}
@@ -1427,8 +1548,13 @@ static void update_attribute_element_offset(Mesh *mesh,
                                             size_t& attr_float3_offset,
                                             device_vector<uchar4>& attr_uchar4,
                                             size_t& attr_uchar4_offset,
+                                            device_vector<uint>& attr_quantized,
+                                            size_t& attr_quantized_offset,
+                                            device_vector<float4>& attr_quantized_range,
+                                            size_t& attr_quantized_range_offset,
                                             Attribute *mattr,
                                             AttributePrimitive prim,
+                                            bool quantized,
                                             TypeDesc& type,
                                             AttributeDescriptor& desc)
 {
@@ -1459,6 +1585,31 @@ static void update_attribute_element_offset(Mesh *mesh,
 			}
 			attr_uchar4_offset += size;
 		}
+		else if(quantized) {
+			float3 *data = mattr->data_float3();
+			offset = attr_quantized_offset;
+
+			float2 uv_min, uv_max;
+			attribute_uv_bounds(mattr, size, &uv_min, &uv_max);
+
+			const float2 extent = uv_max - uv_min;
+			const float2 inv_extent = make_float2((extent.x > 0.0f)? 65535.0f/extent.x: 0.0f,
+			                                      (extent.y > 0.0f)? 65535.0f/extent.y: 0.0f);
+
+			assert(attr_quantized.size() >= offset + size);
+			for(size_t k = 0; k < size; k++) {
+				const uint qu = (uint)clamp((data[k].x - uv_min.x)*inv_extent.x + 0.5f, 0.0f, 65535.0f);
+				const uint qv = (uint)clamp((data[k].y - uv_min.y)*inv_extent.y + 0.5f, 0.0f, 65535.0f);
+				attr_quantized[offset+k] = qu | (qv << 16);
+			}
+			attr_quantized_offset += size;
+
+			const size_t range = attr_quantized_range_offset++;
+			assert(attr_quantized_range.size() > range);
+			attr_quantized_range[range] = make_float4(uv_min.x, uv_min.y,
+			                                          extent.x/65535.0f, extent.y/65535.0f);
+			desc.flags |= ATTR_QUANTIZED | (range << ATTR_QUANTIZED_RANGE_SHIFT);
+		}
 		else if(mattr->type == TypeDesc::TypeFloat) {
 			float *data = mattr->data_float();
 			offset = attr_float_offset;
@@ -1507,6 +1658,7 @@ static void update_attribute_element_offset(Mesh *mesh,
 				offset -= mesh->face_offset;
 		}
 		else if(element == ATTR_ELEMENT_CORNER || element == ATTR_ELEMENT_CORNER_BYTE) {
+			/* also for quantized attributes, which are only used on triangles */
 			if(prim == ATTR_PRIM_TRIANGLE)
 				offset -= 3*mesh->tri_offset;
 			else
@@ -1555,6 +1707,8 @@ void MeshManager::device_update_attributes(Device *device, DeviceScene *dscene,
 	size_t attr_float_size = 0;
 	size_t attr_float3_size = 0;
 	size_t attr_uchar4_size = 0;
+	size_t attr_quantized_size = 0;
+	size_t num_quantized = 0;
 	for(size_t i = 0; i < scene->meshes.size(); i++) {
 		Mesh *mesh = scene->meshes[i];
 		AttributeRequestSet& attributes = mesh_attributes[i];
@@ -1566,31 +1720,45 @@ void MeshManager::device_update_attributes(Device *device, DeviceScene *dscene,
 			update_attribute_element_size(mesh,
 			                              triangle_mattr,
 			                              ATTR_PRIM_TRIANGLE,
+			                              attribute_use_quantized(scene, mesh, triangle_mattr,
+			                                                      ATTR_PRIM_TRIANGLE, &num_quantized),
 			                              &attr_float_size,
 			                              &attr_float3_size,
-			                              &attr_uchar4_size);
+			                              &attr_uchar4_size,
+			                              &attr_quantized_size);
 			update_attribute_element_size(mesh,
 			                              curve_mattr,
 			                              ATTR_PRIM_CURVE,
+			                              attribute_use_quantized(scene, mesh, curve_mattr,
+			                                                      ATTR_PRIM_CURVE, &num_quantized),
 			                              &attr_float_size,
 			                              &attr_float3_size,
-			                              &attr_uchar4_size);
+			                              &attr_uchar4_size,
+			                              &attr_quantized_size);
 			update_attribute_element_size(mesh,
 			                              subd_mattr,
 			                              ATTR_PRIM_SUBD,
+			                              attribute_use_quantized(scene, mesh, subd_mattr,
+			                                                      ATTR_PRIM_SUBD, &num_quantized),
 			                              &attr_float_size,
 			                              &attr_float3_size,
-			                              &attr_uchar4_size);
+			                              &attr_uchar4_size,
+			                              &attr_quantized_size);
 		}
 	}
 
 	dscene->attributes_float.alloc(attr_float_size);
 	dscene->attributes_float3.alloc(attr_float3_size);
 	dscene->attributes_uchar4.alloc(attr_uchar4_size);
+	dscene->attributes_quantized.alloc(attr_quantized_size);
+	dscene->attributes_quantized_range.alloc(num_quantized);
 
 	size_t attr_float_offset = 0;
 	size_t attr_float3_offset = 0;
 	size_t attr_uchar4_offset = 0;
+	size_t attr_quantized_offset = 0;
+	size_t attr_quantized_range_offset = 0;
+	num_quantized = 0;
 
 	/* Fill in attributes. */
 	for(size_t i = 0; i < scene->meshes.size(); i++) {
@@ -1608,8 +1776,12 @@ void MeshManager::device_update_attributes(Device *device, DeviceScene *dscene,
 			                                dscene->attributes_float, attr_float_offset,
 			                                dscene->attributes_float3, attr_float3_offset,
 			                                dscene->attributes_uchar4, attr_uchar4_offset,
+			                                dscene->attributes_quantized, attr_quantized_offset,
+			                                dscene->attributes_quantized_range, attr_quantized_range_offset,
 			                                triangle_mattr,
 			                                ATTR_PRIM_TRIANGLE,
+			                                attribute_use_quantized(scene, mesh, triangle_mattr,
+			                                                        ATTR_PRIM_TRIANGLE, &num_quantized),
 			                                req.triangle_type,
 			                                req.triangle_desc);
 
@@ -1617,8 +1789,12 @@ void MeshManager::device_update_attributes(Device *device, DeviceScene *dscene,
 			                                dscene->attributes_float, attr_float_offset,
 			                                dscene->attributes_float3, attr_float3_offset,
 			                                dscene->attributes_uchar4, attr_uchar4_offset,
+			                                dscene->attributes_quantized, attr_quantized_offset,
+			                                dscene->attributes_quantized_range, attr_quantized_range_offset,
 			                                curve_mattr,
 			                                ATTR_PRIM_CURVE,
+			                                attribute_use_quantized(scene, mesh, curve_mattr,
+			                                                        ATTR_PRIM_CURVE, &num_quantized),
 			                                req.curve_type,
 			                                req.curve_desc);
 
@@ -1626,8 +1802,12 @@ void MeshManager::device_update_attributes(Device *device, DeviceScene *dscene,
 			                                dscene->attributes_float, attr_float_offset,
 			                                dscene->attributes_float3, attr_float3_offset,
 			                                dscene->attributes_uchar4, attr_uchar4_offset,
+			                                dscene->attributes_quantized, attr_quantized_offset,
+			                                dscene->attributes_quantized_range, attr_quantized_range_offset,
 			                                subd_mattr,
 			                                ATTR_PRIM_SUBD,
+			                                attribute_use_quantized(scene, mesh, subd_mattr,
+			                                                        ATTR_PRIM_SUBD, &num_quantized),
 			                                req.subd_type,
 			                                req.subd_desc);
 
@@ -1655,6 +1835,10 @@ void MeshManager::device_update_attributes(Device *device, DeviceScene *dscene,
 	if(dscene->attributes_uchar4.size()) {
 		dscene->attributes_uchar4.copy_to_device();
 	}
+	if(dscene->attributes_quantized.size()) {
+		dscene->attributes_quantized.copy_to_device();
+		dscene->attributes_quantized_range.copy_to_device();
+	}
 
 	if(progress.get_cancel()) return;
 
@@ -1768,8 +1952,19 @@ void MeshManager::device_update_mesh(Device *,
 		/* normals */
 		progress.set_status("Updating Mesh", "Computing normals");
 
+		/* Also used by displacement, which is evaluated before the BVH is built. */
+		const bool use_compressed_normals = scene->params.use_compressed_geometry;
+		dscene->data.bvh.use_compressed_normals = use_compressed_normals;
+
 		uint *tri_shader = dscene->tri_shader.alloc(tri_size);
-		float4 *vnormal = dscene->tri_vnormal.alloc(vert_size);
+		float4 *vnormal = NULL;
+		uint *vnormal_oct = NULL;
+		if(use_compressed_normals) {
+			vnormal_oct = dscene->tri_vnormal_oct.alloc(vert_size);
+		}
+		else {
+			vnormal = dscene->tri_vnormal.alloc(vert_size);
+		}
 		uint4 *tri_vindex = dscene->tri_vindex.alloc(tri_size);
 		uint *tri_patch = dscene->tri_patch.alloc(tri_size);
 		float2 *tri_patch_uv = dscene->tri_patch_uv.alloc(vert_size);
@@ -1777,7 +1972,12 @@ void MeshManager::device_update_mesh(Device *,
 		foreach(Mesh *mesh, scene->meshes) {
 			mesh->pack_shaders(scene,
 			                   &tri_shader[mesh->tri_offset]);
-			mesh->pack_normals(&vnormal[mesh->vert_offset]);
+			if(use_compressed_normals) {
+				mesh->pack_normals(&vnormal_oct[mesh->vert_offset]);
+			}
+			else {
+				mesh->pack_normals(&vnormal[mesh->vert_offset]);
+			}
 			mesh->pack_verts(tri_prim_index,
 			                 &tri_vindex[mesh->tri_offset],
 			                 &tri_patch[mesh->tri_offset],
@@ -1791,7 +1991,12 @@ void MeshManager::device_update_mesh(Device *,
 		progress.set_status("Updating Mesh", "Copying Mesh to device");
 
 		dscene->tri_shader.copy_to_device();
-		dscene->tri_vnormal.copy_to_device();
+		if(use_compressed_normals) {
+			dscene->tri_vnormal_oct.copy_to_device();
+		}
+		else {
+			dscene->tri_vnormal.copy_to_device();
+		}
 		dscene->tri_vindex.copy_to_device();
 		dscene->tri_patch.copy_to_device();
 		dscene->tri_patch_uv.copy_to_device();
@@ -1861,14 +2066,50 @@ void MeshManager::device_update_bvh(Device *device, DeviceScene *dscene, Scene *
 	bparams.num_motion_triangle_steps = scene->params.num_bvh_time_steps;
 	bparams.num_motion_curve_steps = scene->params.num_bvh_time_steps;
 
-	VLOG(1) << "Using " << bvh_layout_name(bparams.bvh_layout)
-	        << " layout.";
+	/* Refit existing BVH if it was built with the same parameters. Time steps
+	 * are not supported by refit, their bounds would not be split in time.
+	 */
+	bool do_rebuild = true;
+	if(bvh != NULL &&
+	   bvh->params.bvh_layout == bparams.bvh_layout &&
+	   bvh->params.use_spatial_split == bparams.use_spatial_split &&
+	   bvh->params.use_unaligned_nodes == bparams.use_unaligned_nodes &&
+	   bparams.num_motion_triangle_steps == 0 &&
+	   bparams.num_motion_curve_steps == 0)
+	{
+		VLOG(1) << "Refitting " << bvh_layout_name(bparams.bvh_layout)
+		        << " scene BVH.";
+
+		progress.set_status("Updating Scene BVH", "Refitting");
+		bvh->objects = scene->objects;
+		bvh->refit(progress);
+		do_rebuild = bvh_refit_degraded(bvh, &scene->params);
+	}
+
+	if(do_rebuild) {
+		VLOG(1) << "Using " << bvh_layout_name(bparams.bvh_layout)
+		        << " layout.";
+
+		delete bvh;
+		bvh = BVH::create(bparams, scene->objects);
 
-	BVH *bvh = BVH::create(bparams, scene->objects);
-	bvh->build(progress);
+		string cache_key;
+		if(bvh_cache) {
+			progress.set_status("Updating Scene BVH", "Loading from cache");
+			cache_key = BVHCache::key(bparams, scene->objects);
+		}
+		if(!bvh_cache || !bvh_cache->load(cache_key, bvh)) {
+			bvh->build(progress);
+			if(bvh_cache && !progress.get_cancel()) {
+				bvh_cache->store(cache_key, bvh);
+			}
+		}
+		bvh_topology(scene, bvh_built_topology);
+	}
 
 	if(progress.get_cancel()) {
 		delete bvh;
+		bvh = NULL;
 		return;
 	}
 
@@ -1876,7 +2117,6 @@ void MeshManager::device_update_bvh(Device *device, DeviceScene *dscene, Scene *
 	progress.set_status("Updating Scene BVH", "Copying BVH to device");
 
 	PackedBVH& pack = bvh->pack;
-
 	if(pack.nodes.size()) {
 		dscene->bvh_nodes.steal_data(pack.nodes);
 		dscene->bvh_nodes.copy_to_device();
@@ -1921,8 +2161,55 @@ void MeshManager::device_update_bvh(Device *device, DeviceScene *dscene, Scene *
 	dscene->data.bvh.root = pack.root_index;
 	dscene->data.bvh.bvh_layout = bparams.bvh_layout;
 	dscene->data.bvh.use_bvh_steps = (scene->params.num_bvh_time_steps != 0);
+}
 
-	delete bvh;
+void MeshManager::bvh_topology(Scene *scene, vector<size_t>& topology)
+{
+	topology.clear();
+	topology.reserve(scene->objects.size() * 3);
+	foreach(Object *object, scene->objects) {
+		Mesh *mesh = object->mesh;
+		topology.push_back(object->is_traceable());
+		topology.push_back(mesh->num_triangles());
+		topology.push_back(mesh->curve_keys.size());
+	}
+}
+
+bool MeshManager::bvh_can_refit(Scene *scene)
+{
+	if(bvh == NULL || bvh->objects != scene->objects) {
+		return false;
+	}
+
+	/* Instanced meshes have their own BVH merged into the scene one, those
+	 * are not supported by refit.
+	 */
+	foreach(Object *object, scene->objects) {
+		Mesh *mesh = object->mesh;
+		if(mesh->need_build_bvh() || mesh->need_update_rebuild) {
+			return false;
+		}
+	}
+
+	vector<size_t> topology;
+	bvh_topology(scene, topology);
+	return topology == bvh_built_topology;
+}
+
+void MeshManager::bvh_take_from_device(DeviceScene *dscene)
+{
+	PackedBVH& pack = bvh->pack;
+
+	dscene->bvh_nodes.give_data(pack.nodes);
+	dscene->bvh_leaf_nodes.give_data(pack.leaf_nodes);
+	dscene->object_node.give_data(pack.object_node);
+	dscene->prim_tri_index.give_data(pack.prim_tri_index);
+	dscene->prim_tri_verts.give_data(pack.prim_tri_verts);
+	dscene->prim_type.give_data(pack.prim_type);
+	dscene->prim_visibility.give_data(pack.prim_visibility);
+	dscene->prim_index.give_data(pack.prim_index);
+	dscene->prim_object.give_data(pack.prim_object);
+	dscene->prim_time.give_data(pack.prim_time);
 }
 
 void MeshManager::device_update_preprocess(Device *device,
@@ -2135,9 +2422,29 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 		                                           false);
 	}
 
+	/* Keep scene BVH data when only deformation and transforms changed, so
+	 * it can be refit instead of rebuilt from scratch.
+	 */
+	if(bvh_can_refit(scene)) {
+		bvh_take_from_device(dscene);
+		if(bvh->pack.nodes.size() == 0) {
+			/* Device data was freed already. */
+			delete bvh;
+			bvh = NULL;
+		}
+	}
+	else {
+		delete bvh;
+		bvh = NULL;
+	}
+
 	/* Device update. */
 	device_free(device, dscene);
 
+	if(bvh_cache == NULL && !scene->params.bvh_cache_path.empty()) {
+		bvh_cache = new BVHCache(scene->params.bvh_cache_path);
+	}
+
 	mesh_calc_offset(scene);
 	if(true_displacement_used) {
 		device_update_mesh(device, dscene, scene, true, progress);
@@ -2184,6 +2491,7 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 			                        device,
 			                        dscene,
 			                        &scene->params,
+			                        bvh_cache,
 			                        &progress,
 			                        i,
 			                        num_bvh));
@@ -2216,6 +2524,12 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 	device_update_bvh(device, dscene, scene, progress);
 	if(progress.get_cancel()) return;
 
+	if(bvh_cache) {
+		BVHCache::Stats stats;
+		bvh_cache->get_stats(&stats);
+		VLOG(1) << "BVH cache statistics:\n" << stats.full_report();
+	}
+
 	device_update_mesh(device, dscene, scene, false, progress);
 	if(progress.get_cancel()) return;
 
@@ -2246,6 +2560,7 @@ void MeshManager::device_free(Device *device, DeviceScene *dscene)
 	dscene->prim_time.free();
 	dscene->tri_shader.free();
 	dscene->tri_vnormal.free();
+	dscene->tri_vnormal_oct.free();
 	dscene->tri_vindex.free();
 	dscene->tri_patch.free();
 	dscene->tri_patch_uv.free();
@@ -2256,6 +2571,8 @@ void MeshManager::device_free(Device *device, DeviceScene *dscene)
 	dscene->attributes_float.free();
 	dscene->attributes_float3.free();
 	dscene->attributes_uchar4.free();
+	dscene->attributes_quantized.free();
+	dscene->attributes_quantized_range.free();
 
 #ifdef WITH_OSL
 	OSLGlobals *og = (OSLGlobals*)device->osl_memory();
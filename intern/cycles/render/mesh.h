@@ -34,6 +34,7 @@ CCL_NAMESPACE_BEGIN
 
 class Attribute;
 class BVH;
+class BVHCache;
 class Device;
 class DeviceScene;
 class Mesh;
@@ -43,6 +44,7 @@ class SceneParams;
 class AttributeRequest;
 struct SubdParams;
 class DiagSplit;
+class SubdCache;
 struct PackedPatchTable;
 
 /* Mesh */
@@ -218,6 +220,8 @@ public:
 	array<SubdEdgeCrease> subd_creases;
 
 	SubdParams *subd_params;
+	/* Diced grids of the previous tessellation, if subd_params->use_cache. */
+	SubdCache *subd_cache;
 
 	vector<Shader*> used_shaders;
 	AttributeSet attributes;
@@ -281,6 +285,7 @@ public:
 
 	void pack_shaders(Scene *scene, uint *shader);
 	void pack_normals(float4 *vnormal);
+	void pack_normals(uint *vnormal_oct);
 	void pack_verts(const vector<uint>& tri_prim_index,
 	                uint4 *tri_vindex,
 	                uint *tri_patch,
@@ -293,6 +298,7 @@ public:
 	void compute_bvh(Device *device,
 	                 DeviceScene *dscene,
 	                 SceneParams *params,
+	                 BVHCache *bvh_cache,
 	                 Progress *progress,
 	                 int n,
 	                 int total);
@@ -376,6 +382,11 @@ protected:
 	                       Scene *scene,
 	                       Progress& progress);
 
+	/* Scene BVH refit. */
+	void bvh_topology(Scene *scene, vector<size_t>& topology);
+	bool bvh_can_refit(Scene *scene);
+	void bvh_take_from_device(DeviceScene *dscene);
+
 	void device_update_displacement_images(Device *device,
 	                                       Scene *scene,
 	                                       Progress& progress);
@@ -383,6 +394,17 @@ protected:
 	void device_update_volume_images(Device *device,
 									 Scene *scene,
 									 Progress& progress);
+
+	/* Scene BVH, kept between updates so it can be refit when only meshes
+	 * are deformed and objects are moved. The packed data is owned by the
+	 * device arrays in between updates.
+	 */
+	BVH *bvh;
+	/* Primitive counts of all objects the scene BVH was built for. */
+	vector<size_t> bvh_built_topology;
+
+	/* On-disk cache of built BVHs, when a cache directory is set. */
+	BVHCache *bvh_cache;
 };
 
 CCL_NAMESPACE_END
@@ -18,12 +18,16 @@
 #include "render/attribute.h"
 #include "render/camera.h"
 
+#include "subd/subd_cache.h"
 #include "subd/subd_split.h"
 #include "subd/subd_patch.h"
 #include "subd/subd_patch_table.h"
 
 #include "util/util_foreach.h"
 #include "util/util_algorithm.h"
+#include "util/util_logging.h"
+#include "util/util_md5.h"
+#include "util/util_task.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -155,7 +159,10 @@ class OsdData {
 	Far::PatchMap* patch_map;
 
 public:
-	OsdData() : mesh(NULL), refiner(NULL), patch_table(NULL), patch_map(NULL) {}
+	/* Adaptive refinement level, depends on the dicing camera. */
+	int isolation;
+
+	OsdData() : mesh(NULL), refiner(NULL), patch_table(NULL), patch_map(NULL), isolation(0) {}
 
 	~OsdData()
 	{
@@ -179,8 +186,8 @@ public:
 				Far::TopologyRefinerFactory<Mesh>::Options(type, options));
 
 		/* adaptive refinement */
-		int max_isolation = calculate_max_isolation();
-		refiner->RefineAdaptive(Far::TopologyRefiner::AdaptiveOptions(max_isolation));
+		isolation = calculate_max_isolation();
+		refiner->RefineAdaptive(Far::TopologyRefiner::AdaptiveOptions(isolation));
 
 		/* create patch table */
 		Far::PatchTableFactory::Options patch_options;
@@ -339,8 +346,185 @@ struct OsdPatch : Patch {
 
 #endif
 
+/* Patch to split and dice, quads start from one of their four subpatches. */
+
+struct SubdPatchJob {
+	Patch *patch;
+	QuadDice::SubPatch subpatch;
+	bool use_subpatch;
+	/* Grid was reused from the cache. */
+	bool cached;
+};
+
+static void subd_patch_job_add(vector<SubdPatchJob>& jobs,
+                               Patch *patch,
+                               float2 P00, float2 P10, float2 P01, float2 P11)
+{
+	SubdPatchJob job;
+	job.patch = patch;
+	job.subpatch.patch = patch;
+	job.subpatch.P00 = P00;
+	job.subpatch.P10 = P10;
+	job.subpatch.P01 = P01;
+	job.subpatch.P11 = P11;
+	job.use_subpatch = true;
+	job.cached = false;
+	jobs.push_back(job);
+}
+
+static void subd_patch_job_add(vector<SubdPatchJob>& jobs, Patch *patch)
+{
+	SubdPatchJob job;
+	job.patch = patch;
+	job.use_subpatch = false;
+	job.cached = false;
+	jobs.push_back(job);
+}
+
+/* Split and dice a range of patches, into the cache when it is used or else
+ * into the grids of the batch. */
+static void subd_tessellate_patches(const SubdParams *params,
+                                    vector<SubdPatchJob> *jobs,
+                                    SubdCache *cache,
+                                    vector<DicedGrid> *batch_grids,
+                                    size_t batch_begin,
+                                    size_t begin,
+                                    size_t end)
+{
+	DiagSplit split(*params);
+
+	for(size_t i = begin; i < end; i++) {
+		SubdPatchJob& job = (*jobs)[i];
+
+		if(job.use_subpatch) {
+			QuadDice::SubPatch subpatch = job.subpatch;
+			split.split_quad(job.patch, &subpatch);
+		}
+		else {
+			split.split_quad(job.patch);
+		}
+
+		if(cache) {
+			job.cached = cache->update(i, split);
+			if(!job.cached) {
+				split.dice(&cache->grid(i));
+			}
+		}
+		else {
+			split.dice(&(*batch_grids)[i - batch_begin]);
+		}
+
+		split.clear();
+	}
+}
+
+/* Hash of the control mesh, which together with the split determines the
+ * diced grids. */
+static string subd_control_hash(Mesh *mesh, int isolation)
+{
+	MD5Hash md5;
+
+	md5_append_value(md5, mesh->subdivision_type);
+	md5_append_value(md5, isolation);
+	md5_append_array(md5, mesh->verts);
+	md5_append_array(md5, mesh->subd_face_corners);
+	md5_append_array(md5, mesh->subd_creases);
+
+	/* Hash fields separately, to skip padding. */
+	md5_append_value(md5, mesh->subd_faces.size());
+	for(size_t i = 0; i < mesh->subd_faces.size(); i++) {
+		const Mesh::SubdFace& face = mesh->subd_faces[i];
+		md5_append_value(md5, face.start_corner);
+		md5_append_value(md5, face.num_corners);
+		md5_append_value(md5, face.shader);
+		md5_append_value(md5, face.smooth);
+		md5_append_value(md5, face.ptex_offset);
+	}
+
+	Attribute *attr_vN = mesh->subd_attributes.find(ATTR_STD_VERTEX_NORMAL);
+	if(attr_vN) {
+		md5_append_data(md5, attr_vN->data(), attr_vN->buffer.size());
+	}
+
+	return md5.get_hex();
+}
+
+/* Append the grids of a batch of patches to the mesh. */
+static void subd_append_grids(Mesh *mesh,
+                              const vector<SubdPatchJob>& jobs,
+                              const vector<DicedGrid>& batch_grids,
+                              size_t begin,
+                              size_t end)
+{
+	SubdCache *cache = mesh->subd_cache;
+
+	/* Count and allocate the new verts and triangles of all grids. */
+	size_t vert_offset = mesh->verts.size();
+	size_t tri_offset = mesh->num_triangles();
+	size_t num_verts = vert_offset;
+	size_t num_tris = tri_offset;
+
+	for(size_t i = begin; i < end; i++) {
+		const DicedGrid& grid = (cache)? cache->grid(i): batch_grids[i - begin];
+		num_verts += grid.num_verts();
+		num_tris += grid.num_triangles();
+	}
+
+	if(num_verts > mesh->verts.capacity() || num_tris*3 > mesh->triangles.capacity()) {
+		mesh->reserve_mesh(size_t(num_verts * 1.2), size_t(num_tris * 1.2));
+	}
+
+	mesh->resize_mesh(num_verts, num_tris);
+	mesh->num_subd_verts += num_verts - vert_offset;
+
+	Attribute *attr_vN = mesh->attributes.find(ATTR_STD_VERTEX_NORMAL);
+	Attribute *attr_ptex_uv = mesh->attributes.find(ATTR_STD_PTEX_UV);
+	Attribute *attr_ptex_face_id = mesh->attributes.find(ATTR_STD_PTEX_FACE_ID);
+
+	float3 *vN = attr_vN->data_float3();
+	float3 *ptex_uv = (attr_ptex_uv)? attr_ptex_uv->data_float3(): NULL;
+	float *ptex_face_id = (attr_ptex_face_id)? attr_ptex_face_id->data_float(): NULL;
+
+	/* Copy grids in order, so the result does not depend on threading. */
+	for(size_t i = begin; i < end; i++) {
+		const DicedGrid& grid = (cache)? cache->grid(i): batch_grids[i - begin];
+		Patch *patch = jobs[i].patch;
+
+		for(size_t v = 0; v < grid.num_verts(); v++) {
+			mesh->verts[vert_offset + v] = grid.P[v];
+			vN[vert_offset + v] = grid.N[v];
+			mesh->vert_patch_uv[vert_offset + v] = grid.uv[v];
+
+			if(ptex_uv) {
+				ptex_uv[vert_offset + v] = make_float3(grid.uv[v].x, grid.uv[v].y, 0.0f);
+			}
+		}
+
+		const int patch_ptex_face_id = patch->ptex_face_id();
+
+		for(size_t t = 0; t < grid.num_triangles(); t++) {
+			for(int k = 0; k < 3; k++) {
+				mesh->triangles[(tri_offset + t)*3 + k] = vert_offset + grid.triangles[t*3 + k];
+			}
+
+			mesh->shader[tri_offset + t] = patch->shader;
+			mesh->smooth[tri_offset + t] = true;
+			mesh->triangle_patch[tri_offset + t] = patch->patch_index;
+
+			if(ptex_face_id) {
+				ptex_face_id[tri_offset + t] = (float)patch_ptex_face_id;
+			}
+		}
+
+		vert_offset += grid.num_verts();
+		tri_offset += grid.num_triangles();
+	}
+}
+
 void Mesh::tessellate(DiagSplit *split)
 {
+	int isolation = 0;
+
 #ifdef WITH_OPENSUBDIV
 	OsdData osd_data;
 	bool need_packed_patch_table = false;
@@ -348,6 +532,7 @@ void Mesh::tessellate(DiagSplit *split)
 	if(subdivision_type == SUBDIVISION_CATMULL_CLARK) {
 		if(subd_faces.size()) {
 			osd_data.build_from_mesh(this);
+			isolation = osd_data.isolation;
 		}
 	}
 	else
@@ -369,25 +554,57 @@ void Mesh::tessellate(DiagSplit *split)
 	Attribute *attr_vN = subd_attributes.find(ATTR_STD_VERTEX_NORMAL);
 	float3* vN = attr_vN->data_float3();
 
+	/* Attributes written by dicing. */
+	attributes.add(ATTR_STD_VERTEX_NORMAL);
+
+	if(split->params.ptex) {
+		attributes.add(ATTR_STD_PTEX_UV);
+		attributes.add(ATTR_STD_PTEX_FACE_ID);
+	}
+
+	/* Patches are stored up front, reserved so pointers to them stay valid. */
+	size_t num_patches = 0;
+	for(int f = 0; f < num_faces; f++) {
+		num_patches += (subd_faces[f].is_quad())? 1: subd_faces[f].num_corners;
+	}
+
+	vector<LinearQuadPatch> linear_patches;
+#ifdef WITH_OPENSUBDIV
+	vector<OsdPatch> osd_patches;
+
+	if(subdivision_type == SUBDIVISION_CATMULL_CLARK) {
+		osd_patches.reserve(num_patches);
+	}
+	else
+#endif
+	{
+		linear_patches.reserve(num_patches);
+	}
+
+	vector<SubdPatchJob> jobs;
+
 	for(int f = 0; f < num_faces; f++) {
 		SubdFace& face = subd_faces[f];
 
 		if(face.is_quad()) {
 			/* quad */
-			QuadDice::SubPatch subpatch;
+			Patch *patch;
 
-			LinearQuadPatch quad_patch;
 #ifdef WITH_OPENSUBDIV
-			OsdPatch osd_patch(&osd_data);
-
 			if(subdivision_type == SUBDIVISION_CATMULL_CLARK) {
+				osd_patches.push_back(OsdPatch(&osd_data));
+				OsdPatch& osd_patch = osd_patches.back();
+
 				osd_patch.patch_index = face.ptex_offset;
 
-				subpatch.patch = &osd_patch;
+				patch = &osd_patch;
 			}
 			else
 #endif
 			{
+				linear_patches.push_back(LinearQuadPatch());
+				LinearQuadPatch& quad_patch = linear_patches.back();
+
 				float3 *hull = quad_patch.hull;
 				float3 *normals = quad_patch.normals;
 
@@ -412,50 +629,39 @@ void Mesh::tessellate(DiagSplit *split)
 				swap(hull[2], hull[3]);
 				swap(normals[2], normals[3]);
 
-				subpatch.patch = &quad_patch;
+				patch = &quad_patch;
 			}
 
-			subpatch.patch->shader = face.shader;
+			patch->shader = face.shader;
 
 			/* Quad faces need to be split at least once to line up with split ngons, we do this
 			 * here in this manner because if we do it later edge factors may end up slightly off.
 			 */
-			subpatch.P00 = make_float2(0.0f, 0.0f);
-			subpatch.P10 = make_float2(0.5f, 0.0f);
-			subpatch.P01 = make_float2(0.0f, 0.5f);
-			subpatch.P11 = make_float2(0.5f, 0.5f);
-			split->split_quad(subpatch.patch, &subpatch);
-
-			subpatch.P00 = make_float2(0.5f, 0.0f);
-			subpatch.P10 = make_float2(1.0f, 0.0f);
-			subpatch.P01 = make_float2(0.5f, 0.5f);
-			subpatch.P11 = make_float2(1.0f, 0.5f);
-			split->split_quad(subpatch.patch, &subpatch);
-
-			subpatch.P00 = make_float2(0.0f, 0.5f);
-			subpatch.P10 = make_float2(0.5f, 0.5f);
-			subpatch.P01 = make_float2(0.0f, 1.0f);
-			subpatch.P11 = make_float2(0.5f, 1.0f);
-			split->split_quad(subpatch.patch, &subpatch);
-
-			subpatch.P00 = make_float2(0.5f, 0.5f);
-			subpatch.P10 = make_float2(1.0f, 0.5f);
-			subpatch.P01 = make_float2(0.5f, 1.0f);
-			subpatch.P11 = make_float2(1.0f, 1.0f);
-			split->split_quad(subpatch.patch, &subpatch);
+			subd_patch_job_add(jobs, patch,
+			                   make_float2(0.0f, 0.0f), make_float2(0.5f, 0.0f),
+			                   make_float2(0.0f, 0.5f), make_float2(0.5f, 0.5f));
+			subd_patch_job_add(jobs, patch,
+			                   make_float2(0.5f, 0.0f), make_float2(1.0f, 0.0f),
+			                   make_float2(0.5f, 0.5f), make_float2(1.0f, 0.5f));
+			subd_patch_job_add(jobs, patch,
+			                   make_float2(0.0f, 0.5f), make_float2(0.5f, 0.5f),
+			                   make_float2(0.0f, 1.0f), make_float2(0.5f, 1.0f));
+			subd_patch_job_add(jobs, patch,
+			                   make_float2(0.5f, 0.5f), make_float2(1.0f, 0.5f),
+			                   make_float2(0.5f, 1.0f), make_float2(1.0f, 1.0f));
 		}
 		else {
 			/* ngon */
 #ifdef WITH_OPENSUBDIV
 			if(subdivision_type == SUBDIVISION_CATMULL_CLARK) {
-				OsdPatch patch(&osd_data);
-
-				patch.shader = face.shader;
-
 				for(int corner = 0; corner < face.num_corners; corner++) {
+					osd_patches.push_back(OsdPatch(&osd_data));
+					OsdPatch& patch = osd_patches.back();
+
+					patch.shader = face.shader;
 					patch.patch_index = face.ptex_offset + corner;
 
-					split->split_quad(&patch);
+					subd_patch_job_add(jobs, &patch);
 				}
 			}
 			else
@@ -471,7 +677,8 @@ void Mesh::tessellate(DiagSplit *split)
 				}
 
 				for(int corner = 0; corner < face.num_corners; corner++) {
-					LinearQuadPatch patch;
+					linear_patches.push_back(LinearQuadPatch());
+					LinearQuadPatch& patch = linear_patches.back();
 					float3 *hull = patch.hull;
 					float3 *normals = patch.normals;
 
@@ -503,12 +710,66 @@ void Mesh::tessellate(DiagSplit *split)
 						}
 					}
 
-					split->split_quad(&patch);
+					subd_patch_job_add(jobs, &patch);
 				}
 			}
 		}
 	}
 
+	/* Grids are kept for the next tessellation if requested, otherwise only
+	 * a batch of them is in memory at a time. */
+	if(split->params.use_cache) {
+		if(!subd_cache) {
+			subd_cache = new SubdCache();
+		}
+		subd_cache->begin(subd_control_hash(this, isolation), jobs.size());
+	}
+	else {
+		delete subd_cache;
+		subd_cache = NULL;
+	}
+
+	/* Split and dice patches in parallel, in batches of small tasks since
+	 * the cost of patches varies a lot with their size on screen. */
+	const size_t task_size = 16;
+	const size_t batch_size = max(TaskScheduler::num_threads(), 1) * task_size * 8;
+	vector<DicedGrid> batch_grids((subd_cache)? 0: min(batch_size, jobs.size()));
+	size_t num_cached = 0;
+
+	for(size_t batch_begin = 0; batch_begin < jobs.size(); batch_begin += batch_size) {
+		const size_t batch_end = min(batch_begin + batch_size, jobs.size());
+
+		TaskPool pool;
+		for(size_t begin = batch_begin; begin < batch_end; begin += task_size) {
+			pool.push(function_bind(&subd_tessellate_patches,
+			                        &split->params,
+			                        &jobs,
+			                        subd_cache,
+			                        &batch_grids,
+			                        batch_begin,
+			                        begin,
+			                        min(begin + task_size, batch_end)));
+		}
+		pool.wait_work();
+
+		subd_append_grids(this, jobs, batch_grids, batch_begin, batch_end);
+
+		for(size_t i = batch_begin; i < batch_end; i++) {
+			num_cached += jobs[i].cached;
+		}
+		foreach(DicedGrid& grid, batch_grids) {
+			grid.clear();
+		}
+	}
+
+	VLOG(1) << "Tessellated " << name << ": " << jobs.size() << " patches, "
+	        << num_cached << " reused from cache, "
+	        << num_subd_verts << " vertices.";
+	if(subd_cache) {
+		VLOG(1) << "Tessellation cache memory: "
+		        << string_human_readable_size(subd_cache->memory_size());
+	}
+
 	/* interpolate center points for attributes */
 	foreach(Attribute& attr, subd_attributes.attributes) {
 #ifdef WITH_OPENSUBDIV
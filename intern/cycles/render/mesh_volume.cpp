@@ -16,11 +16,13 @@
 
 #include "render/mesh.h"
 #include "render/attribute.h"
+#include "render/image.h"
 #include "render/scene.h"
 
 #include "util/util_foreach.h"
 #include "util/util_logging.h"
 #include "util/util_progress.h"
+#include "util/util_sparse_grid.h"
 #include "util/util_types.h"
 
 CCL_NAMESPACE_BEGIN
@@ -113,7 +115,8 @@ struct VolumeParams {
 	int pad_size;
 };
 
-static const int CUBE_SIZE = 8;
+/* Same as the sparse grid bricks, so active bricks map to a single node. */
+static const int CUBE_SIZE = SparseGrid::BRICK_SIZE;
 
 /* Create a mesh from a volume.
  *
@@ -151,6 +154,8 @@ public:
 
 	void add_node_with_padding(int x, int y, int z);
 
+	void add_brick_with_padding(int bx, int by, int bz);
+
 	void create_mesh(vector<float3> &vertices,
 	                 vector<int> &indices,
 	                 vector<float3> &face_normals);
@@ -223,6 +228,24 @@ void VolumeMeshBuilder::add_node_with_padding(int x, int y, int z)
 	}
 }
 
+void VolumeMeshBuilder::add_brick_with_padding(int bx, int by, int bz)
+{
+	const int3 &resolution = params->resolution;
+	const int x0 = bx*CUBE_SIZE, x1 = min(x0 + CUBE_SIZE, resolution.x) - 1;
+	const int y0 = by*CUBE_SIZE, y1 = min(y0 + CUBE_SIZE, resolution.y) - 1;
+	const int z0 = bz*CUBE_SIZE, z1 = min(z0 + CUBE_SIZE, resolution.z) - 1;
+
+	add_node(x0, y0, z0);
+
+	/* Padding of the corner voxels reaches all neighbor nodes that padding of
+	 * any other voxel in the brick would. */
+	for(int i = 0; i < 8; i++) {
+		add_node_with_padding((i & 1)? x1: x0,
+		                      (i & 2)? y1: y0,
+		                      (i & 4)? z1: z0);
+	}
+}
+
 void VolumeMeshBuilder::create_mesh(vector<float3> &vertices,
                                     vector<int> &indices,
                                     vector<float3> &face_normals)
@@ -396,6 +419,7 @@ void VolumeMeshBuilder::convert_quads_to_tris(const vector<QuadData> &quads,
 struct VoxelAttributeGrid {
 	float *data;
 	int channels;
+	SparseGrid *sparse_grid;
 };
 
 void MeshManager::create_volume_mesh(Scene *scene,
@@ -418,9 +442,13 @@ void MeshManager::create_volume_mesh(Scene *scene,
 
 		VoxelAttribute *voxel = attr.data_voxel();
 		device_memory *image_memory = scene->image_manager->image_memory(voxel->slot);
-		int3 resolution = make_int3(image_memory->data_width,
-                                    image_memory->data_height,
-		                            image_memory->data_depth);
+		SparseGrid *sparse_grid = (SparseGrid*)image_memory->sparse_grid;
+		int3 resolution = (sparse_grid)? make_int3(sparse_grid->width,
+		                                           sparse_grid->height,
+		                                           sparse_grid->depth):
+		                                 make_int3(image_memory->data_width,
+		                                           image_memory->data_height,
+		                                           image_memory->data_depth);
 
 		if(volume_params.resolution == make_int3(0, 0, 0)) {
 			volume_params.resolution = resolution;
@@ -433,6 +461,7 @@ void MeshManager::create_volume_mesh(Scene *scene,
 		VoxelAttributeGrid voxel_grid;
 		voxel_grid.data = static_cast<float*>(image_memory->host_pointer);
 		voxel_grid.channels = image_memory->data_elements;
+		voxel_grid.sparse_grid = sparse_grid;
 		voxel_grids.push_back(voxel_grid);
 	}
 
@@ -488,14 +517,47 @@ void MeshManager::create_volume_mesh(Scene *scene,
 	VolumeMeshBuilder builder(&volume_params);
 	const float isovalue = mesh->volume_isovalue;
 
-	for(int z = 0; z < resolution.z; ++z) {
-		for(int y = 0; y < resolution.y; ++y) {
-			for(int x = 0; x < resolution.x; ++x) {
-				size_t voxel_index = compute_voxel_index(resolution, x, y, z);
+	for(size_t i = 0; i < voxel_grids.size(); ++i) {
+		const VoxelAttributeGrid &voxel_grid = voxel_grids[i];
+		const SparseGrid *sparse_grid = voxel_grid.sparse_grid;
+
+		if(sparse_grid) {
+			/* Use the occupancy of the sparse grid, skipping tiles and
+			 * bricks without voxels above the isovalue. */
+			for(int tz = 0; tz < sparse_grid->tiles_z; ++tz) {
+				for(int ty = 0; ty < sparse_grid->tiles_y; ++ty) {
+					for(int tx = 0; tx < sparse_grid->tiles_x; ++tx) {
+						if(sparse_grid->tile_max(tx, ty, tz) < isovalue) {
+							continue;
+						}
 
-				for(size_t i = 0; i < voxel_grids.size(); ++i) {
-					const VoxelAttributeGrid &voxel_grid = voxel_grids[i];
-					const int channels = voxel_grid.channels;
+						const int tile_size = SparseGrid::TILE_SIZE;
+						const int bx_end = min((tx + 1)*tile_size, sparse_grid->bricks_x);
+						const int by_end = min((ty + 1)*tile_size, sparse_grid->bricks_y);
+						const int bz_end = min((tz + 1)*tile_size, sparse_grid->bricks_z);
+
+						for(int bz = tz*tile_size; bz < bz_end; ++bz) {
+							for(int by = ty*tile_size; by < by_end; ++by) {
+								for(int bx = tx*tile_size; bx < bx_end; ++bx) {
+									if(sparse_grid->brick_max(bx, by, bz) >= isovalue) {
+										builder.add_brick_with_padding(bx, by, bz);
+									}
+								}
+							}
+						}
+					}
+				}
+			}
+
+			continue;
+		}
+
+		const int channels = voxel_grid.channels;
+
+		for(int z = 0; z < resolution.z; ++z) {
+			for(int y = 0; y < resolution.y; ++y) {
+				for(int x = 0; x < resolution.x; ++x) {
+					size_t voxel_index = compute_voxel_index(resolution, x, y, z);
 
 					for(int c = 0; c < channels; c++) {
 						if(voxel_grid.data[voxel_index * channels + c] >= isovalue) {
@@ -538,8 +600,16 @@ void MeshManager::create_volume_mesh(Scene *scene,
 	        << ((vertices.size() + face_normals.size())*sizeof(float3) + indices.size()*sizeof(int))/(1024.0*1024.0)
 	        << "Mb.";
 
+	size_t grid_memory = 0;
+	foreach(const VoxelAttributeGrid &voxel_grid, voxel_grids) {
+		const SparseGrid *sparse_grid = voxel_grid.sparse_grid;
+		grid_memory += (sparse_grid)?
+			sparse_grid->num_active_bricks()*SparseGrid::BRICK_VOXELS*voxel_grid.channels*sizeof(float) + sparse_grid->memory_size():
+			((size_t)resolution.x)*resolution.y*resolution.z*voxel_grid.channels*sizeof(float);
+	}
+
 	VLOG(1) << "Memory usage volume grid: "
-	        << (resolution.x*resolution.y*resolution.z*sizeof(float))/(1024.0*1024.0)
+	        << grid_memory/(1024.0*1024.0)
 	        << "Mb.";
 }
 
@@ -290,6 +290,67 @@ void ImageTextureNode::attributes(Shader *shader, AttributeRequestSet *attribute
 	ShaderNode::attributes(shader, attributes);
 }
 
+/* Image textures using the UV coordinates of a texture coordinate or UV map
+ * node read the UV attribute themselves, with a fused attribute and image
+ * node. This is only done when all users of the UV output can do so, then the
+ * UV output itself is not compiled. */
+
+static bool image_texture_uv_fusable(ShaderInput *input)
+{
+	if(input->parent->type != ImageTextureNode::node_type || input->name() != "Vector") {
+		return false;
+	}
+
+	ImageTextureNode *image = (ImageTextureNode*)input->parent;
+	return image->projection == NODE_IMAGE_PROJ_FLAT && image->tex_mapping.skip();
+}
+
+static bool texture_uv_output_fused(SVMCompiler& compiler, ShaderOutput *output)
+{
+	ShaderNode *node = output->parent;
+
+	if(!compiler.use_node_fusion) {
+		return false;
+	}
+
+	/* Shifted texture coordinates for bump are not supported. */
+	if(output->name() != "UV" || output->links.empty() ||
+	   node->bump == SHADER_BUMP_DX || node->bump == SHADER_BUMP_DY)
+	{
+		return false;
+	}
+
+	if(node->type == TextureCoordinateNode::node_type) {
+		if(((TextureCoordinateNode*)node)->from_dupli)
+			return false;
+	}
+	else if(node->type == UVMapNode::node_type) {
+		if(((UVMapNode*)node)->from_dupli)
+			return false;
+	}
+	else {
+		return false;
+	}
+
+	foreach(ShaderInput *input, output->links) {
+		if(!image_texture_uv_fusable(input))
+			return false;
+	}
+
+	return true;
+}
+
+static uint texture_uv_attribute(SVMCompiler& compiler, ShaderOutput *output)
+{
+	if(output->parent->type == UVMapNode::node_type) {
+		UVMapNode *uv_map = (UVMapNode*)output->parent;
+		if(uv_map->attribute != "")
+			return compiler.attribute(uv_map->attribute);
+	}
+
+	return compiler.attribute(ATTR_STD_UV);
+}
+
 void ImageTextureNode::compile(SVMCompiler& compiler)
 {
 	ShaderInput *vector_in = input("Vector");
@@ -313,6 +374,19 @@ void ImageTextureNode::compile(SVMCompiler& compiler)
 
 	if(slot != -1) {
 		int srgb = (is_linear || color_space != NODE_COLOR_SPACE_COLOR)? 0: 1;
+
+		if(vector_in->link && texture_uv_output_fused(compiler, vector_in->link)) {
+			compiler.add_node(NODE_TEX_IMAGE_UV,
+				slot,
+				compiler.encode_uchar4(
+					SVM_STACK_INVALID,
+					compiler.stack_assign_if_linked(color_out),
+					compiler.stack_assign_if_linked(alpha_out),
+					srgb),
+				texture_uv_attribute(compiler, vector_in->link));
+			return;
+		}
+
 		int vector_offset = tex_mapping.compile_begin(compiler, vector_in);
 
 		if(projection != NODE_IMAGE_PROJ_BOX) {
@@ -3196,7 +3270,7 @@ void TextureCoordinateNode::compile(SVMCompiler& compiler)
 	}
 
 	out = output("UV");
-	if(!out->links.empty()) {
+	if(!out->links.empty() && !texture_uv_output_fused(compiler, out)) {
 		if(from_dupli) {
 			compiler.add_node(texco_node, NODE_TEXCO_DUPLI_UV, compiler.stack_assign(out));
 		}
@@ -3311,7 +3385,7 @@ void UVMapNode::compile(SVMCompiler& compiler)
 		attr_node = NODE_ATTR_BUMP_DY;
 	}
 
-	if(!out->links.empty()) {
+	if(!out->links.empty() && !texture_uv_output_fused(compiler, out)) {
 		if(from_dupli) {
 			compiler.add_node(texco_node, NODE_TEXCO_DUPLI_UV, compiler.stack_assign(out));
 		}
@@ -53,6 +53,7 @@ DeviceScene::DeviceScene(Device *device)
   prim_time(device, "__prim_time", MEM_TEXTURE),
   tri_shader(device, "__tri_shader", MEM_TEXTURE),
   tri_vnormal(device, "__tri_vnormal", MEM_TEXTURE),
+  tri_vnormal_oct(device, "__tri_vnormal_oct", MEM_TEXTURE),
   tri_vindex(device, "__tri_vindex", MEM_TEXTURE),
   tri_patch(device, "__tri_patch", MEM_TEXTURE),
   tri_patch_uv(device, "__tri_patch_uv", MEM_TEXTURE),
@@ -68,10 +69,15 @@ DeviceScene::DeviceScene(Device *device)
   attributes_float(device, "__attributes_float", MEM_TEXTURE),
   attributes_float3(device, "__attributes_float3", MEM_TEXTURE),
   attributes_uchar4(device, "__attributes_uchar4", MEM_TEXTURE),
+  attributes_quantized(device, "__attributes_quantized", MEM_TEXTURE),
+  attributes_quantized_range(device, "__attributes_quantized_range", MEM_TEXTURE),
   light_distribution(device, "__light_distribution", MEM_TEXTURE),
   lights(device, "__lights", MEM_TEXTURE),
   light_background_marginal_cdf(device, "__light_background_marginal_cdf", MEM_TEXTURE),
   light_background_conditional_cdf(device, "__light_background_conditional_cdf", MEM_TEXTURE),
+  light_tree_nodes(device, "__light_tree_nodes", MEM_TEXTURE),
+  light_tree_leaves(device, "__light_tree_leaves", MEM_TEXTURE),
+  light_tree_objects(device, "__light_tree_objects", MEM_TEXTURE),
   particles(device, "__particles", MEM_TEXTURE),
   svm_nodes(device, "__svm_nodes", MEM_TEXTURE),
   shaders(device, "__shaders", MEM_TEXTURE),
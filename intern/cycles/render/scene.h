@@ -76,6 +76,7 @@ public:
 	/* mesh */
 	device_vector<uint> tri_shader;
 	device_vector<float4> tri_vnormal;
+	device_vector<uint> tri_vnormal_oct;
 	device_vector<uint4> tri_vindex;
 	device_vector<uint> tri_patch;
 	device_vector<float2> tri_patch_uv;
@@ -99,12 +100,17 @@ public:
 	device_vector<float> attributes_float;
 	device_vector<float4> attributes_float3;
 	device_vector<uchar4> attributes_uchar4;
+	device_vector<uint> attributes_quantized;
+	device_vector<float4> attributes_quantized_range;
 
 	/* lights */
 	device_vector<KernelLightDistribution> light_distribution;
 	device_vector<KernelLight> lights;
 	device_vector<float2> light_background_marginal_cdf;
 	device_vector<float2> light_background_conditional_cdf;
+	device_vector<KernelLightTreeNode> light_tree_nodes;
+	device_vector<uint> light_tree_leaves;
+	device_vector<uint2> light_tree_objects;
 
 	/* particles */
 	device_vector<KernelParticle> particles;
@@ -163,9 +169,29 @@ public:
 	bool use_bvh_unaligned_nodes;
 	int num_bvh_time_steps;
 
+	/* BVHs of deformed meshes with unchanged topology are refit instead of
+	 * rebuilt. Once the estimated cost of a refit BVH exceeds its cost after
+	 * build by this factor it is rebuilt again, 0 disables the rebuild.
+	 */
+	float bvh_refit_rebuild_factor;
+
+	/* Directory to store built BVHs in, to load them again when rendering
+	 * the same geometry later. Empty disables the cache. Only the packed BVH
+	 * is cached, the meshes themselves are still synced and packed. */
+	string bvh_cache_path;
+
+	/* Store vertex normals and UV maps quantized, trading a small loss of
+	 * precision for less memory. Vertex positions and UV maps spanning more
+	 * than one UDIM tile are never quantized. */
+	bool use_compressed_geometry;
+
 	bool persistent_data;
 	int texture_limit;
 
+	/* Memory budget in bytes for loading image textures on demand on the
+	 * CPU, 0 loads images fully into memory. */
+	size_t texture_cache_size;
+
 	SceneParams()
 	{
 		shadingsystem = SHADINGSYSTEM_SVM;
@@ -174,8 +200,11 @@ public:
 		use_bvh_spatial_split = false;
 		use_bvh_unaligned_nodes = true;
 		num_bvh_time_steps = 0;
+		bvh_refit_rebuild_factor = 1.5f;
+		use_compressed_geometry = false;
 		persistent_data = false;
 		texture_limit = 0;
+		texture_cache_size = 0;
 	}
 
 	bool modified(const SceneParams& params)
@@ -185,8 +214,12 @@ public:
 		&& use_bvh_spatial_split == params.use_bvh_spatial_split
 		&& use_bvh_unaligned_nodes == params.use_bvh_unaligned_nodes
 		&& num_bvh_time_steps == params.num_bvh_time_steps
+		&& bvh_refit_rebuild_factor == params.bvh_refit_rebuild_factor
+		&& bvh_cache_path == params.bvh_cache_path
+		&& use_compressed_geometry == params.use_compressed_geometry
 		&& persistent_data == params.persistent_data
-		&& texture_limit == params.texture_limit); }
+		&& texture_limit == params.texture_limit
+		&& texture_cache_size == params.texture_cache_size); }
 };
 
 /* Scene */
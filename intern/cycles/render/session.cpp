@@ -27,6 +27,8 @@
 #include "render/scene.h"
 #include "render/session.h"
 #include "render/bake.h"
+#include "render/stats.h"
+#include "render/tile_writer.h"
 
 #include "util/util_foreach.h"
 #include "util/util_function.h"
@@ -54,6 +56,7 @@ Session::Session(const SessionParams& params_)
 	TaskScheduler::init(params.threads);
 
 	device = Device::create(params.device, stats, params.background);
+	tile_manager.set_num_threads(device->info.cpu_threads);
 
 	if(params.background && !params.write_render_cb) {
 		buffers = NULL;
@@ -66,6 +69,7 @@ Session::Session(const SessionParams& params_)
 
 	session_thread = NULL;
 	scene = NULL;
+	tile_writer = NULL;
 
 	reset_time = 0.0;
 	last_update_time = 0.0;
@@ -102,22 +106,13 @@ Session::~Session()
 	}
 
 	if(params.write_render_cb) {
-		/* tonemap and write out image if requested */
-		delete display;
-
-		display = new DisplayBuffer(device, false);
-		display->reset(buffers->params);
-		tonemap(params.samples);
-
-		int w = display->draw_width;
-		int h = display->draw_height;
-		uchar4 *pixels = display->rgba_byte.copy_from_device(0, w, h);
-		params.write_render_cb((uchar*)pixels, w, h, 4);
+		write_render();
 	}
 
 	/* clean up */
 	tile_manager.device_free();
 
+	delete tile_writer;
 	delete buffers;
 	delete display;
 	delete scene;
@@ -131,6 +126,21 @@ void Session::start()
 	session_thread = new thread(function_bind(&Session::run, this));
 }
 
+void Session::write_render()
+{
+	/* tonemap and write out image if requested */
+	delete display;
+
+	display = new DisplayBuffer(device, false);
+	display->reset(buffers->params);
+	tonemap(params.samples);
+
+	int w = display->draw_width;
+	int h = display->draw_height;
+	uchar4 *pixels = display->rgba_byte.copy_from_device(0, w, h);
+	params.write_render_cb((uchar*)pixels, w, h, 4);
+}
+
 bool Session::ready_to_reset()
 {
 	double dt = time_dt() - reset_time;
@@ -362,9 +372,9 @@ bool Session::acquire_tile(Device *tile_device, RenderTile& rtile)
 	Tile *tile;
 	int device_num = device->device_number(tile_device);
 
-	if(!tile_manager.next_tile(tile, device_num))
+	if(!tile_manager.next_tile(tile, device_num, rtile.thread))
 		return false;
-	
+
 	/* fill render tile */
 	rtile.x = tile_manager.state.buffer.full_x + tile->x;
 	rtile.y = tile_manager.state.buffer.full_y + tile->y;
@@ -375,6 +385,7 @@ bool Session::acquire_tile(Device *tile_device, RenderTile& rtile)
 	rtile.resolution = tile_manager.state.resolution_divider;
 	rtile.tile_index = tile->index;
 	rtile.task = (tile->state == Tile::DENOISE)? RenderTile::DENOISE: RenderTile::PATH_TRACE;
+	rtile.pixel_samples = 0;
 
 	tile_lock.unlock();
 
@@ -440,6 +451,14 @@ void Session::release_tile(RenderTile& rtile)
 
 	progress.add_finished_tile(rtile.task == RenderTile::DENOISE);
 
+	if(rtile.task == RenderTile::PATH_TRACE) {
+		uint64_t pixel_samples = rtile.pixel_samples;
+		if(pixel_samples == 0) {
+			pixel_samples = (uint64_t)rtile.w*rtile.h*(rtile.sample - rtile.start_sample);
+		}
+		tile_manager.add_rendered_pixel_samples(pixel_samples);
+	}
+
 	bool delete_tile;
 
 	if(tile_manager.finish_tile(rtile.tile_index, delete_tile)) {
@@ -447,6 +466,10 @@ void Session::release_tile(RenderTile& rtile)
 			write_render_tile_cb(rtile);
 		}
 
+		if(tile_writer && !tile_writer->write_tile(rtile)) {
+			progress.set_error(tile_writer->get_error());
+		}
+
 		if(delete_tile) {
 			delete rtile.buffers;
 			tile_manager.state.tiles[rtile.tile_index].buffers = NULL;
@@ -731,12 +754,34 @@ void Session::run()
 		/* reset number of rendered samples */
 		progress.reset_sample();
 
+		if(params.use_profiling) {
+			profiler.start();
+		}
+
+		/* Tiles only have their own buffers without full frame buffers. */
+		if(!params.tile_output_path.empty() && !buffers) {
+			open_tile_writer();
+		}
+
 		if(device_use_gl)
 			run_gpu();
 		else
 			run_cpu();
+
+		profiler.stop();
+
+		if(tile_writer) {
+			if(!tile_writer->close()) {
+				progress.set_error(tile_writer->get_error());
+			}
+			delete tile_writer;
+			tile_writer = NULL;
+		}
 	}
 
+	VLOG(1) << "Tile scheduling statistics:\n"
+	        << tile_manager.stats.full_report();
+
 	/* progress update */
 	if(progress.get_cancel())
 		progress.set_status("Cancel", progress.get_cancel_message());
@@ -870,6 +915,12 @@ void Session::update_scene()
 
 		progress.set_status("Updating Scene");
 		MEM_GUARDED_CALL(&progress, scene->device_update, device, progress);
+
+		/* No render threads are running here, so counters can be resized
+		 * for the updated scene. */
+		if(params.use_profiling) {
+			profiler.reset(scene->shaders.size(), scene->objects.size());
+		}
 	}
 }
 
@@ -906,6 +957,10 @@ void Session::update_status_time(bool show_pause, bool show_done)
 		if(params.use_denoising) {
 			substatus += string_printf(", Denoised %d tiles", progress.get_denoised_tiles());
 		}
+		if(rendering_finished && scene->film->use_adaptive_sampling) {
+			substatus += string_printf(", %.1f effective samples",
+			                           (double)tile_manager.get_rendered_effective_samples());
+		}
 	}
 	else if(tile_manager.num_samples == INT_MAX)
 		substatus = string_printf("Path Tracing Sample %d", progressive_sample+1);
@@ -950,6 +1005,7 @@ void Session::render()
 	task.integrator_branched = scene->integrator->method == Integrator::BRANCHED_PATH;
 	task.requested_tile_size = params.tile_size;
 	task.passes_size = tile_manager.params.get_passes_size();
+	task.profiler = params.use_profiling? &profiler: NULL;
 
 	if(params.use_denoising) {
 		task.denoising_radius = params.denoising_radius;
@@ -966,6 +1022,34 @@ void Session::render()
 	device->task_add(task);
 }
 
+void Session::open_tile_writer()
+{
+	thread_scoped_lock scene_lock(scene->mutex);
+
+	tile_writer = new TileWriter();
+	if(!tile_writer->open(params.tile_output_path,
+	                      tile_manager.params,
+	                      params.tile_size,
+	                      scene->film->exposure))
+	{
+		progress.set_error(string_printf("Failed to open %s for writing tiles: %s",
+		                                 params.tile_output_path.c_str(),
+		                                 tile_writer->get_error().c_str()));
+		delete tile_writer;
+		tile_writer = NULL;
+	}
+}
+
+void Session::collect_statistics(RenderStats *render_stats)
+{
+	thread_scoped_lock scene_lock(scene->mutex);
+
+	if(params.use_profiling) {
+		render_stats->collect_profiling(scene, profiler);
+	}
+	render_stats->collect_geometry(scene);
+}
+
 void Session::tonemap(int sample)
 {
 	/* add tonemap task */
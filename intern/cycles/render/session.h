@@ -22,6 +22,7 @@
 #include "render/shader.h"
 #include "render/tile.h"
 
+#include "util/util_profiling.h"
 #include "util/util_progress.h"
 #include "util/util_stats.h"
 #include "util/util_thread.h"
@@ -36,7 +37,9 @@ class DeviceRequestedFeatures;
 class DisplayBuffer;
 class Progress;
 class RenderBuffers;
+class RenderStats;
 class Scene;
+class TileWriter;
 
 /* Session Parameters */
 
@@ -70,6 +73,14 @@ public:
 
 	ShadingSystem shadingsystem;
 
+	/* Sample the CPU render threads, for the statistics report. */
+	bool use_profiling;
+
+	/* Stream finished tiles into a tiled multilayer OpenEXR file at this
+	 * path, freeing their buffers right away. Only used for background
+	 * renders without write_render_cb, which have no full frame buffers. */
+	string tile_output_path;
+
 	function<bool(const uchar *pixels,
 	              int width,
 	              int height,
@@ -103,6 +114,8 @@ public:
 
 		shadingsystem = SHADINGSYSTEM_SVM;
 		tile_order = TILE_CENTER;
+
+		use_profiling = false;
 	}
 
 	bool modified(const SessionParams& params)
@@ -122,7 +135,8 @@ public:
 		&& text_timeout == params.text_timeout
 		&& progressive_update_timeout == params.progressive_update_timeout
 		&& tile_order == params.tile_order
-		&& shadingsystem == params.shadingsystem); }
+		&& shadingsystem == params.shadingsystem
+		&& use_profiling == params.use_profiling); }
 
 };
 
@@ -141,6 +155,7 @@ public:
 	SessionParams params;
 	TileManager tile_manager;
 	Stats stats;
+	Profiler profiler;
 
 	function<void(RenderTile&)> write_render_tile_cb;
 	function<void(RenderTile&, bool)> update_render_tile_cb;
@@ -152,6 +167,10 @@ public:
 	bool draw(BufferParams& params, DeviceDrawParams& draw_params);
 	void wait();
 
+	/* Tonemap the render and pass it to write_render_cb, only valid after
+	 * wait(). Done automatically when the session is destroyed. */
+	void write_render();
+
 	bool ready_to_reset();
 	void reset(BufferParams& params, int samples);
 	void set_samples(int samples);
@@ -166,6 +185,9 @@ public:
 	 * (for example, when rendering with unlimited samples). */
 	float get_progress();
 
+	/* Fill in statistics of the finished render, only valid after wait(). */
+	void collect_statistics(RenderStats *stats);
+
 protected:
 	struct DelayedReset {
 		thread_mutex mutex;
@@ -182,6 +204,8 @@ protected:
 	void render();
 	void reset_(BufferParams& params, int samples);
 
+	void open_tile_writer();
+
 	void run_cpu();
 	bool draw_cpu(BufferParams& params, DeviceDrawParams& draw_params);
 	void reset_cpu(BufferParams& params, int samples);
@@ -201,6 +225,8 @@ protected:
 
 	thread *session_thread;
 
+	TileWriter *tile_writer;
+
 	volatile bool display_outdated;
 
 	volatile bool gpu_draw_ready;
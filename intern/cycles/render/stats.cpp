@@ -0,0 +1,192 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "render/object.h"
+#include "render/scene.h"
+#include "render/shader.h"
+#include "render/stats.h"
+
+#include "util/util_algorithm.h"
+#include "util/util_foreach.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Only the most expensive shaders and objects are listed. */
+static const size_t MAX_REPORT_ENTRIES = 20;
+
+NamedSampleCountEntry::NamedSampleCountEntry(const string& name, uint64_t samples, uint64_t hits)
+: name(name), samples(samples), hits(hits)
+{
+}
+
+NamedSizeEntry::NamedSizeEntry(const string& name, size_t size)
+: name(name), size(size)
+{
+}
+
+static bool namedSampleCountEntryComparator(const NamedSampleCountEntry& a,
+                                            const NamedSampleCountEntry& b)
+{
+	/* Sort by samples, most expensive first. */
+	return a.samples > b.samples;
+}
+
+RenderStats::RenderStats()
+: has_profiling(false),
+  has_geometry(false),
+  num_deduplicated_meshes(0),
+  deduplicated_size(0)
+{
+}
+
+void RenderStats::collect_geometry(Scene *scene)
+{
+	DeviceScene& dscene = scene->dscene;
+
+	has_geometry = true;
+	geometry.clear();
+
+	geometry.push_back(NamedSizeEntry("Vertex positions", dscene.prim_tri_verts.memory_size()));
+	geometry.push_back(NamedSizeEntry("Triangle indices", dscene.tri_vindex.memory_size()));
+	if(scene->params.use_compressed_geometry) {
+		geometry.push_back(NamedSizeEntry("Vertex normals (octahedral)",
+		                                  dscene.tri_vnormal_oct.memory_size()));
+	}
+	else {
+		geometry.push_back(NamedSizeEntry("Vertex normals", dscene.tri_vnormal.memory_size()));
+	}
+	geometry.push_back(NamedSizeEntry("Attributes float", dscene.attributes_float.memory_size()));
+	geometry.push_back(NamedSizeEntry("Attributes float3", dscene.attributes_float3.memory_size()));
+	geometry.push_back(NamedSizeEntry("Attributes byte", dscene.attributes_uchar4.memory_size()));
+	geometry.push_back(NamedSizeEntry("Attributes quantized",
+	                                  dscene.attributes_quantized.memory_size() +
+	                                  dscene.attributes_quantized_range.memory_size()));
+}
+
+void RenderStats::collect_profiling(Scene *scene, Profiler& prof)
+{
+	has_profiling = true;
+
+	kernel.clear();
+	for(int event = 0; event < PROFILING_NUM_EVENTS; event++) {
+		uint64_t samples = prof.get_event((ProfilingEvent)event);
+		if(samples > 0) {
+			kernel.push_back(NamedSampleCountEntry(Profiler::event_name((ProfilingEvent)event),
+			                                       samples,
+			                                       0));
+		}
+	}
+
+	shaders.clear();
+	for(size_t i = 0; i < scene->shaders.size(); i++) {
+		uint64_t samples, hits;
+		if(prof.get_shader(i, samples, hits)) {
+			shaders.push_back(NamedSampleCountEntry(scene->shaders[i]->name.string(),
+			                                        samples,
+			                                        hits));
+		}
+	}
+
+	objects.clear();
+	for(size_t i = 0; i < scene->objects.size(); i++) {
+		uint64_t samples, hits;
+		if(prof.get_object(i, samples, hits)) {
+			objects.push_back(NamedSampleCountEntry(scene->objects[i]->name.string(),
+			                                        samples,
+			                                        hits));
+		}
+	}
+}
+
+string RenderStats::entries_report(const string& indent,
+                                   vector<NamedSampleCountEntry>& entries,
+                                   bool with_hits)
+{
+	sort(entries.begin(), entries.end(), namedSampleCountEntryComparator);
+
+	uint64_t total_samples = 0;
+	foreach(const NamedSampleCountEntry& entry, entries) {
+		total_samples += entry.samples;
+	}
+
+	string result = "";
+	for(size_t i = 0; i < min(entries.size(), MAX_REPORT_ENTRIES); i++) {
+		const NamedSampleCountEntry& entry = entries[i];
+		double percent = 100.0 * entry.samples / max(total_samples, (uint64_t)1);
+
+		result += string_printf("%s%-32s %10.2fs (%5.1f%%)",
+		                        indent.c_str(),
+		                        entry.name.c_str(),
+		                        entry.samples * 0.001,
+		                        percent);
+		if(with_hits) {
+			result += string_printf(" %12llu hits", (unsigned long long)entry.hits);
+		}
+		result += "\n";
+	}
+
+	if(entries.size() > MAX_REPORT_ENTRIES) {
+		result += string_printf("%s(%d more)\n",
+		                        indent.c_str(),
+		                        (int)(entries.size() - MAX_REPORT_ENTRIES));
+	}
+
+	return result;
+}
+
+string RenderStats::full_report()
+{
+	string indent = "  ";
+	string result = "";
+
+	if(has_profiling) {
+		result += "Kernel (sampled render thread time):\n";
+		result += entries_report(indent, kernel, false);
+		result += "Shaders:\n";
+		result += entries_report(indent, shaders, true);
+		result += "Objects:\n";
+		result += entries_report(indent, objects, true);
+	}
+	else {
+		result += "Profiling information not available, render with profiling enabled.\n";
+	}
+
+	if(has_geometry) {
+		size_t total_size = 0;
+		foreach(const NamedSizeEntry& entry, geometry) {
+			total_size += entry.size;
+		}
+
+		result += string_printf("Geometry memory: %s\n",
+		                        string_human_readable_size(total_size).c_str());
+		foreach(const NamedSizeEntry& entry, geometry) {
+			result += string_printf("%s%-32s %s\n",
+			                        indent.c_str(),
+			                        entry.name.c_str(),
+			                        string_human_readable_size(entry.size).c_str());
+		}
+	}
+
+	if(num_deduplicated_meshes) {
+		result += string_printf("Deduplicated meshes: %d, saved %s\n",
+		                        num_deduplicated_meshes,
+		                        string_human_readable_size(deduplicated_size).c_str());
+	}
+
+	return result;
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __RENDER_STATS_H__
+#define __RENDER_STATS_H__
+
+#include "util/util_profiling.h"
+#include "util/util_string.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+class Scene;
+
+/* Named entry of the profiling report, samples are approximately
+ * milliseconds of render thread time. */
+class NamedSampleCountEntry {
+public:
+	NamedSampleCountEntry(const string& name, uint64_t samples, uint64_t hits);
+
+	string name;
+	uint64_t samples;
+	uint64_t hits;
+};
+
+/* Named entry of the geometry memory report. */
+class NamedSizeEntry {
+public:
+	NamedSizeEntry(const string& name, size_t size);
+
+	string name;
+	size_t size;
+};
+
+/* Statistics of a finished render, meant to be printed to the render log. */
+class RenderStats {
+public:
+	RenderStats();
+
+	/* Gather kernel, shader and object times from a stopped profiler. */
+	void collect_profiling(Scene *scene, Profiler& prof);
+
+	/* Gather device memory used by the mesh arrays of the scene. */
+	void collect_geometry(Scene *scene);
+
+	string full_report();
+
+	bool has_profiling;
+	bool has_geometry;
+
+	/* Meshes replaced by an identical mesh during sync, and the memory of
+	 * their geometry. */
+	int num_deduplicated_meshes;
+	size_t deduplicated_size;
+
+	vector<NamedSampleCountEntry> kernel;
+	vector<NamedSampleCountEntry> shaders;
+	vector<NamedSampleCountEntry> objects;
+	vector<NamedSizeEntry> geometry;
+
+protected:
+	string entries_report(const string& indent,
+	                      vector<NamedSampleCountEntry>& entries,
+	                      bool with_hits);
+};
+
+CCL_NAMESPACE_END
+
+#endif  /* __RENDER_STATS_H__ */
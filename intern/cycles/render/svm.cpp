@@ -163,8 +163,14 @@ SVMCompiler::SVMCompiler(ShaderManager *shader_manager_, ImageManager *image_man
 	current_shader = NULL;
 	current_graph = NULL;
 	background = false;
+	use_node_fusion = true;
 	mix_weight_offset = SVM_STACK_INVALID;
 	compile_failed = false;
+	values_node_index = -1;
+	values_node_size = 0;
+	data_node_index = -1;
+	num_instructions = 0;
+	num_batched_values = 0;
 }
 
 int SVMCompiler::stack_size(SocketType::Type type)
@@ -249,19 +255,27 @@ int SVMCompiler::stack_assign(ShaderInput *input)
 			input->stack_offset = stack_find_offset(input->type());
 
 			if(input->type() == SocketType::FLOAT) {
-				add_node(NODE_VALUE_F, __float_as_int(node->get_float(input->socket_type)), input->stack_offset);
+				stack_store_value(input->stack_offset, __float_as_uint(node->get_float(input->socket_type)));
 			}
 			else if(input->type() == SocketType::INT) {
-				add_node(NODE_VALUE_F, node->get_int(input->socket_type), input->stack_offset);
+				stack_store_value(input->stack_offset, node->get_int(input->socket_type));
 			}
 			else if(input->type() == SocketType::VECTOR ||
 			        input->type() == SocketType::NORMAL ||
 			        input->type() == SocketType::POINT ||
 			        input->type() == SocketType::COLOR)
 			{
+				float3 value = node->get_float3(input->socket_type);
 
-				add_node(NODE_VALUE_V, input->stack_offset);
-				add_node(NODE_VALUE_V, node->get_float3(input->socket_type));
+				if(use_node_fusion) {
+					stack_store_value(input->stack_offset + 0, __float_as_uint(value.x));
+					stack_store_value(input->stack_offset + 1, __float_as_uint(value.y));
+					stack_store_value(input->stack_offset + 2, __float_as_uint(value.z));
+				}
+				else {
+					add_node(NODE_VALUE_V, input->stack_offset);
+					add_node(NODE_VALUE_V, value);
+				}
 			}
 			else /* should not get called for closure */
 				assert(0);
@@ -352,6 +366,48 @@ void SVMCompiler::stack_clear_temporary(ShaderNode *node)
 	}
 }
 
+/* Add nodes to load a constant onto the stack. Constants for the unlinked
+ * inputs of a node are loaded one after the other, these are batched into
+ * NODE_VALUES nodes to avoid dispatching a value node for each of them. */
+void SVMCompiler::stack_store_value(int offset, uint value)
+{
+	if(!use_node_fusion) {
+		add_node(NODE_VALUE_F, value, offset);
+		return;
+	}
+
+	/* Start a new node unless the last one is a NODE_VALUES node with space
+	 * left, since values can only be appended at the end. */
+	if(values_node_index == -1 ||
+	   values_node_size == 8 ||
+	   values_node_index + 1 + current_svm_nodes[values_node_index].y != (int)current_svm_nodes.size())
+	{
+		const uint no_offsets = encode_uchar4(SVM_STACK_INVALID,
+		                                      SVM_STACK_INVALID,
+		                                      SVM_STACK_INVALID,
+		                                      SVM_STACK_INVALID);
+
+		values_node_index = current_svm_nodes.size();
+		values_node_size = 0;
+		add_node(NODE_VALUES, 0, no_offsets, no_offsets);
+	}
+
+	const int index = values_node_size++;
+
+	if(index % 4 == 0) {
+		add_node(0, 0, 0, 0);
+		current_svm_nodes[values_node_index].y++;
+	}
+
+	int4& values_node = current_svm_nodes[values_node_index];
+	int& offsets = (index < 4)? values_node.z: values_node.w;
+	const int shift = (index % 4) * 8;
+	offsets = (int)(((uint)offsets & ~(0xFFu << shift)) | ((uint)offset << shift));
+
+	current_svm_nodes[values_node_index + 1 + index / 4][index % 4] = (int)value;
+	num_batched_values++;
+}
+
 uint SVMCompiler::encode_uchar4(uint x, uint y, uint z, uint w)
 {
 	assert(x <= 255);
@@ -367,13 +423,34 @@ void SVMCompiler::add_node(int a, int b, int c, int d)
 	current_svm_nodes.push_back_slow(make_int4(a, b, c, d));
 }
 
+void SVMCompiler::count_instruction(ShaderNodeType type)
+{
+	/* Math, mix and vector value nodes store extra data in a second node of
+	 * the same type, which is not an instruction. */
+	const bool has_data_node = (type == NODE_MATH ||
+	                            type == NODE_VECTOR_MATH ||
+	                            type == NODE_MIX ||
+	                            type == NODE_VALUE_V);
+	const int index = current_svm_nodes.size();
+
+	if(has_data_node && index == data_node_index) {
+		data_node_index = -1;
+		return;
+	}
+
+	num_instructions++;
+	data_node_index = (has_data_node)? index + 1: -1;
+}
+
 void SVMCompiler::add_node(ShaderNodeType type, int a, int b, int c)
 {
+	count_instruction(type);
 	current_svm_nodes.push_back_slow(make_int4(type, a, b, c));
 }
 
 void SVMCompiler::add_node(ShaderNodeType type, const float3& f)
 {
+	count_instruction(type);
 	current_svm_nodes.push_back_slow(make_int4(type,
 		__float_as_int(f.x),
 		__float_as_int(f.y),
@@ -640,12 +717,16 @@ void SVMCompiler::generate_multi_closure(ShaderNode *root_node,
 				                                      stack_assign(facin),
 				                                      0));
 				int node_jump_skip_index = current_svm_nodes.size() - 1;
+				num_instructions++;
 
 				generate_multi_closure(root_node, cl1in->link->parent, state);
 
 				/* Fill in jump instruction location to be after closure. */
 				current_svm_nodes[node_jump_skip_index].y =
 				        current_svm_nodes.size() - node_jump_skip_index - 1;
+				/* Constants after the jump target must not be added to
+				 * nodes before it. */
+				values_node_index = -1;
 			}
 
 			/* generate instructions for input closure 2 */
@@ -658,12 +739,16 @@ void SVMCompiler::generate_multi_closure(ShaderNode *root_node,
 				                                      stack_assign(facin),
 				                                      0));
 				int node_jump_skip_index = current_svm_nodes.size() - 1;
+				num_instructions++;
 
 				generate_multi_closure(root_node, cl2in->link->parent, state);
 
 				/* Fill in jump instruction location to be after closure. */
 				current_svm_nodes[node_jump_skip_index].y =
 				        current_svm_nodes.size() - node_jump_skip_index - 1;
+				/* Constants after the jump target must not be added to
+				 * nodes before it. */
+				values_node_index = -1;
 			}
 
 			/* unassign */
@@ -734,6 +819,9 @@ void SVMCompiler::compile_type(Shader *shader, ShaderGraph *graph, ShaderType ty
 	/* clear all compiler state */
 	memset(&active_stack, 0, sizeof(active_stack));
 	current_svm_nodes.clear();
+	values_node_index = -1;
+	data_node_index = -1;
+	num_instructions = 0;
 
 	foreach(ShaderNode *node_iter, graph->nodes) {
 		foreach(ShaderInput *input, node_iter->inputs)
@@ -794,6 +882,8 @@ void SVMCompiler::compile_type(Shader *shader, ShaderGraph *graph, ShaderType ty
 	/* if compile failed, generate empty shader */
 	if(compile_failed) {
 		current_svm_nodes.clear();
+		values_node_index = -1;
+		num_instructions = 0;
 		compile_failed = false;
 	}
 
@@ -812,6 +902,7 @@ void SVMCompiler::compile(Scene *scene,
 	/* copy graph for shader with bump mapping */
 	ShaderNode *output = shader->graph->output();
 	int start_num_svm_nodes = svm_nodes.size();
+	int num_svm_instructions = 0;
 
 	const double time_start = time_dt();
 
@@ -847,6 +938,7 @@ void SVMCompiler::compile(Scene *scene,
 	if(has_bump) {
 		scoped_timer timer((summary != NULL)? &summary->time_generate_bump: NULL);
 		compile_type(shader, shader->graph, SHADER_TYPE_BUMP);
+		num_svm_instructions += num_instructions;
 		svm_nodes[index].y = svm_nodes.size();
 		svm_nodes.append(current_svm_nodes);
 	}
@@ -855,6 +947,7 @@ void SVMCompiler::compile(Scene *scene,
 	{
 		scoped_timer timer((summary != NULL)? &summary->time_generate_surface: NULL);
 		compile_type(shader, shader->graph, SHADER_TYPE_SURFACE);
+		num_svm_instructions += num_instructions;
 		/* only set jump offset if there's no bump shader, as the bump shader will fall thru to this one if it exists */
 		if(!has_bump) {
 			svm_nodes[index].y = svm_nodes.size();
@@ -866,6 +959,7 @@ void SVMCompiler::compile(Scene *scene,
 	{
 		scoped_timer timer((summary != NULL)? &summary->time_generate_volume: NULL);
 		compile_type(shader, shader->graph, SHADER_TYPE_VOLUME);
+		num_svm_instructions += num_instructions;
 		svm_nodes[index].z = svm_nodes.size();
 		svm_nodes.append(current_svm_nodes);
 	}
@@ -874,6 +968,7 @@ void SVMCompiler::compile(Scene *scene,
 	{
 		scoped_timer timer((summary != NULL)? &summary->time_generate_displacement: NULL);
 		compile_type(shader, shader->graph, SHADER_TYPE_DISPLACEMENT);
+		num_svm_instructions += num_instructions;
 		svm_nodes[index].w = svm_nodes.size();
 		svm_nodes.append(current_svm_nodes);
 	}
@@ -883,6 +978,8 @@ void SVMCompiler::compile(Scene *scene,
 		summary->time_total = time_dt() - time_start;
 		summary->peak_stack_usage = max_stack_use;
 		summary->num_svm_nodes = svm_nodes.size() - start_num_svm_nodes;
+		summary->num_svm_instructions = num_svm_instructions;
+		summary->num_batched_values = num_batched_values;
 	}
 }
 
@@ -890,6 +987,8 @@ void SVMCompiler::compile(Scene *scene,
 
 SVMCompiler::Summary::Summary()
 	: num_svm_nodes(0),
+	  num_svm_instructions(0),
+	  num_batched_values(0),
 	  peak_stack_usage(0),
 	  time_finalize(0.0),
 	  time_generate_surface(0.0),
@@ -904,6 +1003,8 @@ string SVMCompiler::Summary::full_report() const
 {
 	string report = "";
 	report += string_printf("Number of SVM nodes: %d\n", num_svm_nodes);
+	report += string_printf("Eval loop length:    %d\n", num_svm_instructions);
+	report += string_printf("Batched constants:   %d\n", num_batched_values);
 	report += string_printf("Peak stack usage:    %d\n", peak_stack_usage);
 
 	report += string_printf("Time (in seconds):\n");
@@ -14,8 +14,8 @@
  * limitations under the License.
  */
 
-#ifndef __SVM_H__
-#define __SVM_H__
+#ifndef __RENDER_SVM_H__
+#define __RENDER_SVM_H__
 
 #include "render/attribute.h"
 #include "render/graph.h"
@@ -68,6 +68,13 @@ public:
 		/* Number of SVM nodes shader was compiled into. */
 		int num_svm_nodes;
 
+		/* Number of instructions dispatched by the SVM evaluation loop, when
+		 * no closures are skipped. Summed over all shader types. */
+		int num_svm_instructions;
+
+		/* Constants loaded onto the stack with batched value nodes. */
+		int num_batched_values;
+
 		/* Peak stack usage during shader evaluation. */
 		int peak_stack_usage;
 
@@ -127,6 +134,11 @@ public:
 	ShaderManager *shader_manager;
 	bool background;
 
+	/* Batch constants into NODE_VALUES and fuse UV image lookups into
+	 * NODE_TEX_IMAGE_UV. Disabled only to compare against node by node
+	 * compilation in tests. */
+	bool use_node_fusion;
+
 protected:
 	/* stack */
 	struct Stack {
@@ -183,6 +195,8 @@ protected:
 	void stack_clear_temporary(ShaderNode *node);
 	int stack_size(SocketType::Type type);
 	void stack_clear_users(ShaderNode *node, ShaderNodeSet& done);
+	void stack_store_value(int offset, uint value);
+	void count_instruction(ShaderNodeType type);
 
 	bool node_skip_input(ShaderNode *node, ShaderInput *input);
 
@@ -216,9 +230,20 @@ protected:
 	int max_stack_use;
 	uint mix_weight_offset;
 	bool compile_failed;
+
+	/* Index of the last NODE_VALUES node, if constants can still be added
+	 * to it, or -1. */
+	int values_node_index;
+	int values_node_size;
+	/* Index the data node of the last instruction is expected at, see
+	 * count_instruction(). */
+	int data_node_index;
+	/* Number of instructions generated for the current shader type. */
+	int num_instructions;
+	int num_batched_values;
 };
 
 CCL_NAMESPACE_END
 
-#endif /* __SVM_H__ */
+#endif /* __RENDER_SVM_H__ */
 
@@ -18,6 +18,7 @@
 
 #include "util/util_algorithm.h"
 #include "util/util_foreach.h"
+#include "util/util_time.h"
 #include "util/util_types.h"
 
 CCL_NAMESPACE_BEGIN
@@ -86,6 +87,13 @@ enum SpiralDirection {
 	DIRECTION_RIGHT,
 };
 
+/* Maximum number of neighbor tiles a thread takes from the shared list. */
+const int WORK_STEALING_MAX_RUN = 4;
+/* Tiles are not split below this size in pixels. */
+const int WORK_STEALING_MIN_SPLIT_SIZE = 8;
+/* Maximum number of tile splits per thread in a pass. */
+const int WORK_STEALING_MAX_SPLITS = 8;
+
 }  /* namespace */
 
 TileManager::TileManager(bool progressive_, int num_samples_, int2 tile_size_, int start_resolution_,
@@ -99,6 +107,7 @@ TileManager::TileManager(bool progressive_, int num_samples_, int2 tile_size_, i
 	pixel_size = pixel_size_;
 	num_samples = num_samples_;
 	num_devices = num_devices_;
+	num_threads = 1;
 	preserve_tile_device = preserve_tile_device_;
 	background = background_;
 	schedule_denoising = false;
@@ -150,12 +159,22 @@ void TileManager::reset(BufferParams& params_, int num_samples_)
 	state.sample = range_start_sample - 1;
 	state.num_tiles = 0;
 	state.num_samples = 0;
+	state.rendered_pixel_samples = 0;
 	state.resolution_divider = get_divider(params.width, params.height, start_resolution);
 	state.render_tiles.clear();
 	state.denoising_tiles.clear();
+	state.thread_tiles.clear();
+	state.num_idle_threads = 0;
+	state.last_event_time = 0.0;
+	stats = Stats();
 	device_free();
 }
 
+void TileManager::set_num_threads(int num_threads_)
+{
+	num_threads = max(num_threads_, 1);
+}
+
 void TileManager::set_samples(int num_samples_)
 {
 	num_samples = num_samples_;
@@ -354,6 +373,8 @@ void TileManager::gen_render_tiles()
 	foreach(Tile& tile, state.tiles) {
 		state.render_tiles[tile.device].push_back(tile.index);
 	}
+
+	state.num_idle_threads = 0;
 }
 
 void TileManager::set_tiles()
@@ -363,6 +384,14 @@ void TileManager::set_tiles()
 	int image_h = max(1, params.height/resolution);
 
 	state.num_tiles = gen_tiles(!background);
+	state.thread_tiles.clear();
+	state.num_idle_threads = 0;
+
+	/* Splitting tiles must not reallocate the tiles array, acquired tiles
+	 * are referenced by pointer while they are set up for rendering. */
+	if(use_work_stealing()) {
+		state.tiles.reserve(state.tiles.size() + WORK_STEALING_MAX_SPLITS*num_threads);
+	}
 
 	state.buffer.width = image_w;
 	state.buffer.height = image_h;
@@ -412,6 +441,8 @@ bool TileManager::finish_tile(int index, bool &delete_tile)
 {
 	delete_tile = false;
 
+	add_idle_time();
+
 	if(progressive) {
 		return true;
 	}
@@ -462,7 +493,7 @@ bool TileManager::finish_tile(int index, bool &delete_tile)
 	}
 }
 
-bool TileManager::next_tile(Tile* &tile, int device)
+bool TileManager::next_tile(Tile* &tile, int device, int thread)
 {
 	int logical_device = preserve_tile_device? device: 0;
 
@@ -476,8 +507,15 @@ bool TileManager::next_tile(Tile* &tile, int device)
 		return true;
 	}
 
-	if(state.render_tiles[logical_device].empty())
+	if(use_work_stealing()) {
+		return next_tile_work_stealing(tile, thread);
+	}
+
+	if(state.render_tiles[logical_device].empty()) {
+		add_idle_time();
+		state.num_idle_threads++;
 		return false;
+	}
 
 	int idx = state.render_tiles[logical_device].front();
 	state.render_tiles[logical_device].pop_front();
@@ -485,6 +523,117 @@ bool TileManager::next_tile(Tile* &tile, int device)
 	return true;
 }
 
+bool TileManager::use_work_stealing() const
+{
+	return background && !progressive && !preserve_tile_device && !schedule_denoising;
+}
+
+/* Threads take runs of neighbor tiles from the shared list into their own
+ * queue, so they render coherent parts of the image. A thread that runs dry
+ * steals half of the longest queue of another thread. Once fewer tiles are
+ * left than there are threads, tiles are halved when acquired and the other
+ * half is queued, so the last large tile does not keep the other threads
+ * waiting. */
+bool TileManager::next_tile_work_stealing(Tile* &tile, int thread)
+{
+	if(thread >= (int)state.thread_tiles.size()) {
+		state.thread_tiles.resize(thread + 1);
+	}
+
+	std::deque<int>& queue = state.thread_tiles[thread];
+	list<int>& shared_tiles = state.render_tiles[0];
+
+	if(queue.empty() && !shared_tiles.empty()) {
+		int num = clamp((int)shared_tiles.size() / (2*num_threads), 1, WORK_STEALING_MAX_RUN);
+		for(int i = 0; i < num; i++) {
+			queue.push_back(shared_tiles.front());
+			shared_tiles.pop_front();
+		}
+	}
+
+	if(queue.empty()) {
+		/* Steal from the back, furthest away from what the other thread
+		 * renders next. */
+		std::deque<int> *victim = &queue;
+		foreach(std::deque<int>& other, state.thread_tiles) {
+			if(other.size() > victim->size()) {
+				victim = &other;
+			}
+		}
+
+		int num = (victim->size() + 1) / 2;
+		for(int i = 0; i < num; i++) {
+			queue.push_front(victim->back());
+			victim->pop_back();
+		}
+		stats.num_stolen_tiles += num;
+	}
+
+	if(queue.empty()) {
+		add_idle_time();
+		state.num_idle_threads++;
+		return false;
+	}
+
+	int idx = queue.front();
+	queue.pop_front();
+
+	size_t num_queued = shared_tiles.size();
+	foreach(const std::deque<int>& other, state.thread_tiles) {
+		num_queued += other.size();
+	}
+	if(num_queued + 1 < (size_t)num_threads) {
+		split_tile(idx, queue);
+	}
+
+	tile = &state.tiles[idx];
+	return true;
+}
+
+/* Split tile in half along its longer side, the second half is queued. */
+bool TileManager::split_tile(int index, std::deque<int>& queue)
+{
+	if(state.tiles.size() == state.tiles.capacity()) {
+		return false;
+	}
+
+	Tile& tile = state.tiles[index];
+	const bool split_x = (tile.w >= tile.h);
+	const int size = split_x? tile.w: tile.h;
+
+	if(size < 2*WORK_STEALING_MIN_SPLIT_SIZE) {
+		return false;
+	}
+
+	Tile other = tile;
+	other.index = state.tiles.size();
+	if(split_x) {
+		tile.w = size/2;
+		other.x += tile.w;
+		other.w -= tile.w;
+	}
+	else {
+		tile.h = size/2;
+		other.y += tile.h;
+		other.h -= tile.h;
+	}
+
+	state.tiles.push_back(other);
+	queue.push_back(other.index);
+	state.num_tiles++;
+	stats.num_split_tiles++;
+
+	return true;
+}
+
+/* Accumulate idle time of threads that ran out of tiles until now. */
+void TileManager::add_idle_time()
+{
+	double current_time = time_dt();
+	stats.tail_idle_time += state.num_idle_threads * (current_time - state.last_event_time);
+	state.last_event_time = current_time;
+}
+
 bool TileManager::done()
 {
 	int end_sample = (range_num_samples == -1)
@@ -534,5 +683,25 @@ int TileManager::get_num_effective_samples()
 	                                 : range_num_samples;
 }
 
+float TileManager::get_rendered_effective_samples()
+{
+	uint64_t num_pixels = (uint64_t)max(params.width, 1) * max(params.height, 1);
+	return (float)((double)state.rendered_pixel_samples / num_pixels);
+}
+
+void TileManager::add_rendered_pixel_samples(uint64_t pixel_samples)
+{
+	state.rendered_pixel_samples += pixel_samples;
+}
+
+string TileManager::Stats::full_report() const
+{
+	string report = "";
+	report += string_printf("Split tiles:     %d\n", num_split_tiles);
+	report += string_printf("Stolen tiles:    %d\n", num_stolen_tiles);
+	report += string_printf("Tail idle time:  %.2fs\n", tail_idle_time);
+	return report;
+}
+
 CCL_NAMESPACE_END
 
@@ -21,6 +21,9 @@
 
 #include "render/buffers.h"
 #include "util/util_list.h"
+#include "util/util_string.h"
+
+#include <deque>
 
 CCL_NAMESPACE_BEGIN
 
@@ -65,6 +68,25 @@ class TileManager {
 public:
 	BufferParams params;
 
+	/* Tile scheduling statistics, accumulated over all passes since the
+	 * last reset. */
+	struct Stats {
+		Stats()
+		: num_split_tiles(0),
+		  num_stolen_tiles(0),
+		  tail_idle_time(0.0) {}
+
+		/* Tiles split in two at the end of a pass so idle threads get work. */
+		int num_split_tiles;
+		/* Tiles taken from the queue of another thread. */
+		int num_stolen_tiles;
+		/* Time threads spent without work while other threads were still
+		 * rendering, summed over all threads. */
+		double tail_idle_time;
+
+		string full_report() const;
+	} stats;
+
 	struct State {
 		vector<Tile> tiles;
 		int tile_stride;
@@ -78,11 +100,24 @@ public:
 		 * but can be higher due to the initial resolution division for previews. */
 		uint64_t total_pixel_samples;
 
+		/* Samples over all pixels that were actually rendered, lower than
+		 * total_pixel_samples when adaptive sampling stopped pixels early. */
+		uint64_t rendered_pixel_samples;
+
 		/* These lists contain the indices of the tiles to be rendered/denoised and are used
 		 * when acquiring a new tile for the device.
 		 * Each list in each vector is for one logical device. */
 		vector<list<int> > render_tiles;
 		vector<list<int> > denoising_tiles;
+
+		/* Per thread queues of tiles to render when work stealing is used,
+		 * filled from render_tiles on demand. */
+		vector<std::deque<int> > thread_tiles;
+
+		/* Number of threads that ran out of tiles in this pass, and time
+		 * of the last scheduling event to accumulate their idle time. */
+		int num_idle_threads;
+		double last_event_time;
 	} state;
 
 	int num_samples;
@@ -94,8 +129,9 @@ public:
 	void device_free();
 	void reset(BufferParams& params, int num_samples);
 	void set_samples(int num_samples);
+	void set_num_threads(int num_threads);
 	bool next();
-	bool next_tile(Tile* &tile, int device = 0);
+	bool next_tile(Tile* &tile, int device = 0, int thread = 0);
 	bool finish_tile(int index, bool& delete_tile);
 	bool done();
 
@@ -112,6 +148,11 @@ public:
 	/* Get number of actual samples to render. */
 	int get_num_effective_samples();
 
+	/* Average number of samples per pixel rendered so far. With adaptive
+	 * sampling this ends up lower than get_num_effective_samples(). */
+	float get_rendered_effective_samples();
+	void add_rendered_pixel_samples(uint64_t pixel_samples);
+
 	/* Schedule tiles for denoising after they've been rendered. */
 	bool schedule_denoising;
 protected:
@@ -124,6 +165,7 @@ protected:
 	int start_resolution;
 	int pixel_size;
 	int num_devices;
+	int num_threads;
 
 	/* in some cases it is important that the same tile will be returned for the same
 	 * device it was originally generated for (i.e. viewport rendering when buffer is
@@ -150,6 +192,14 @@ protected:
 
 	int get_neighbor_index(int index, int neighbor);
 	bool check_neighbor_state(int index, Tile::State state);
+
+	/* Work stealing scheduling of tiles between threads of a device. Only
+	 * used for final renders without denoising, where tiles do not need to
+	 * stay on a grid or on one device. */
+	bool use_work_stealing() const;
+	bool next_tile_work_stealing(Tile* &tile, int thread);
+	bool split_tile(int index, std::deque<int>& queue);
+	void add_idle_time();
 };
 
 CCL_NAMESPACE_END
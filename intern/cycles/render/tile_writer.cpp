@@ -0,0 +1,351 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#include "render/tile_writer.h"
+
+#include "util/util_algorithm.h"
+#include "util/util_foreach.h"
+#include "util/util_logging.h"
+#include "util/util_math.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Pass names and channels as used by Blender for multilayer OpenEXR files,
+ * so files can be loaded back into the compositor. */
+static bool pass_file_channels(PassType type, const char **name, const char **channels)
+{
+	switch(type) {
+		case PASS_COMBINED: *name = "Combined"; *channels = "RGBA"; return true;
+		case PASS_DEPTH: *name = "Depth"; *channels = "Z"; return true;
+		case PASS_NORMAL: *name = "Normal"; *channels = "XYZ"; return true;
+		case PASS_UV: *name = "UV"; *channels = "UVA"; return true;
+		case PASS_OBJECT_ID: *name = "IndexOB"; *channels = "X"; return true;
+		case PASS_MATERIAL_ID: *name = "IndexMA"; *channels = "X"; return true;
+		case PASS_MOTION: *name = "Vector"; *channels = "XYZW"; return true;
+		case PASS_RENDER_TIME: *name = "Debug Render Time"; *channels = "X"; return true;
+#ifdef __KERNEL_DEBUG__
+		case PASS_BVH_TRAVERSED_NODES: *name = "Debug BVH Traversed Nodes"; *channels = "X"; return true;
+		case PASS_BVH_TRAVERSED_INSTANCES: *name = "Debug BVH Traversed Instances"; *channels = "X"; return true;
+		case PASS_BVH_INTERSECTIONS: *name = "Debug BVH Intersections"; *channels = "X"; return true;
+		case PASS_RAY_BOUNCES: *name = "Debug Ray Bounces"; *channels = "X"; return true;
+#endif
+		case PASS_MIST: *name = "Mist"; *channels = "Z"; return true;
+		case PASS_EMISSION: *name = "Emit"; *channels = "RGB"; return true;
+		case PASS_BACKGROUND: *name = "Env"; *channels = "RGB"; return true;
+		case PASS_AO: *name = "AO"; *channels = "RGB"; return true;
+		case PASS_SHADOW: *name = "Shadow"; *channels = "RGB"; return true;
+		case PASS_DIFFUSE_DIRECT: *name = "DiffDir"; *channels = "RGB"; return true;
+		case PASS_DIFFUSE_INDIRECT: *name = "DiffInd"; *channels = "RGB"; return true;
+		case PASS_DIFFUSE_COLOR: *name = "DiffCol"; *channels = "RGB"; return true;
+		case PASS_GLOSSY_DIRECT: *name = "GlossDir"; *channels = "RGB"; return true;
+		case PASS_GLOSSY_INDIRECT: *name = "GlossInd"; *channels = "RGB"; return true;
+		case PASS_GLOSSY_COLOR: *name = "GlossCol"; *channels = "RGB"; return true;
+		case PASS_TRANSMISSION_DIRECT: *name = "TransDir"; *channels = "RGB"; return true;
+		case PASS_TRANSMISSION_INDIRECT: *name = "TransInd"; *channels = "RGB"; return true;
+		case PASS_TRANSMISSION_COLOR: *name = "TransCol"; *channels = "RGB"; return true;
+		case PASS_SUBSURFACE_DIRECT: *name = "SubsurfaceDir"; *channels = "RGB"; return true;
+		case PASS_SUBSURFACE_INDIRECT: *name = "SubsurfaceInd"; *channels = "RGB"; return true;
+		case PASS_SUBSURFACE_COLOR: *name = "SubsurfaceCol"; *channels = "RGB"; return true;
+		case PASS_VOLUME_DIRECT: *name = "VolumeDir"; *channels = "RGB"; return true;
+		case PASS_VOLUME_INDIRECT: *name = "VolumeInd"; *channels = "RGB"; return true;
+		default:
+			/* Passes only used internally, like motion weight. */
+			return false;
+	}
+}
+
+/* Tile Writer Stats */
+
+TileWriter::Stats::Stats()
+: num_written_tiles(0),
+  num_missing_tiles(0),
+  peak_pending_memory(0)
+{
+}
+
+string TileWriter::Stats::full_report() const
+{
+	string report = "";
+	report += string_printf("Written tiles:   %d\n", num_written_tiles);
+	report += string_printf("Missing tiles:   %d\n", num_missing_tiles);
+	report += string_printf("Peak pending:    %s\n", string_human_readable_size(peak_pending_memory).c_str());
+	return report;
+}
+
+/* Tile Writer */
+
+TileWriter::TileWriter()
+: out(NULL),
+  num_channels(0),
+  exposure(1.0f),
+  pending_memory(0)
+{
+}
+
+TileWriter::~TileWriter()
+{
+	close();
+}
+
+bool TileWriter::open(const string& filepath_,
+                      const BufferParams& params_,
+                      int2 tile_size,
+                      float exposure_,
+                      const string& layer_name)
+{
+	assert(out == NULL);
+
+	filepath = filepath_;
+	params = params_;
+	exposure = exposure_;
+	stats = Stats();
+
+	/* Channel layout. */
+	vector<string> channel_names;
+	int alpha_channel = -1;
+
+	pass_channels.clear();
+	num_channels = 0;
+
+	for(size_t i = 0; i < params.passes.size(); i++) {
+		const char *name, *channels;
+		if(!pass_file_channels(params.passes[i].type, &name, &channels)) {
+			continue;
+		}
+
+		PassChannels pass;
+		pass.type = params.passes[i].type;
+		pass.components = strlen(channels);
+		pass.offset = num_channels;
+		pass_channels.push_back(pass);
+
+		for(int c = 0; c < pass.components; c++) {
+			if(pass.type == PASS_COMBINED && channels[c] == 'A') {
+				alpha_channel = num_channels + c;
+			}
+			channel_names.push_back(string_printf("%s.%s.%c",
+			                                      layer_name.c_str(),
+			                                      name,
+			                                      channels[c]));
+		}
+
+		num_channels += pass.components;
+	}
+
+	if(num_channels == 0) {
+		error = "No passes to write";
+		return false;
+	}
+
+	out = ImageOutput::create("exr");
+	if(out == NULL) {
+		error = "OpenEXR output is not supported";
+		return false;
+	}
+
+	if(!out->supports("tiles")) {
+		error = "OpenEXR output does not support tiles";
+		delete out;
+		out = NULL;
+		return false;
+	}
+
+	/* Cycles buffers are stored bottom to top, file is top to bottom. The
+	 * data window is the rendered region, for border renders. */
+	spec = ImageSpec(params.width, params.height, num_channels, TypeDesc::FLOAT);
+	spec.x = params.full_x;
+	spec.y = params.full_height - (params.full_y + params.height);
+	spec.full_x = 0;
+	spec.full_y = 0;
+	spec.full_width = params.full_width;
+	spec.full_height = params.full_height;
+	spec.tile_width = tile_size.x;
+	spec.tile_height = tile_size.y;
+	spec.channelnames = channel_names;
+	spec.alpha_channel = alpha_channel;
+	spec.attribute("compression", "zip");
+	/* Tiles finish in any order, without this OpenEXR keeps out of order
+	 * tiles in memory until the preceding ones were written. */
+	spec.attribute("openexr:lineOrder", "randomY");
+
+	if(!out->open(filepath, spec)) {
+		error = out->geterror();
+		delete out;
+		out = NULL;
+		return false;
+	}
+
+	VLOG(1) << "Streaming " << params.width << "x" << params.height
+	        << " tiles with " << num_channels << " channels to " << filepath;
+
+	return true;
+}
+
+bool TileWriter::get_tile_pixels(RenderTile& rtile, vector<float>& pixels)
+{
+	RenderBuffers *buffers = rtile.buffers;
+
+	/* Only tiles with their own buffers are supported, not full frame ones. */
+	assert(buffers->params.width == rtile.w && buffers->params.height == rtile.h);
+
+	if(!buffers->copy_from_device()) {
+		return false;
+	}
+
+	const int num_pixels = rtile.w * rtile.h;
+	pixels.resize(num_pixels * num_channels);
+
+	vector<float> pass_pixels;
+	foreach(const PassChannels& pass, pass_channels) {
+		pass_pixels.resize(num_pixels * pass.components);
+		if(!buffers->get_pass_rect(pass.type,
+		                           exposure,
+		                           rtile.sample,
+		                           pass.components,
+		                           &pass_pixels[0]))
+		{
+			memset(&pass_pixels[0], 0, sizeof(float) * pass_pixels.size());
+		}
+
+		/* Interleave passes. */
+		for(int i = 0; i < num_pixels; i++) {
+			memcpy(&pixels[i * num_channels + pass.offset],
+			       &pass_pixels[i * pass.components],
+			       sizeof(float) * pass.components);
+		}
+	}
+
+	return true;
+}
+
+void TileWriter::add_to_tile(int tile_x, int tile_y, RenderTile& rtile, const vector<float>& pixels)
+{
+	const int tile_width = spec.tile_width;
+	const int tile_height = spec.tile_height;
+
+	/* Tile rectangle in file coordinates, clipped to the data window. */
+	const int x0 = spec.x + tile_x * tile_width;
+	const int y0 = spec.y + tile_y * tile_height;
+	const int x1 = min(x0 + tile_width, spec.x + spec.width);
+	const int y1 = min(y0 + tile_height, spec.y + spec.height);
+
+	/* Render tile rectangle in file coordinates. */
+	const int rx0 = rtile.x;
+	const int rx1 = rtile.x + rtile.w;
+	const int ry0 = params.full_height - (rtile.y + rtile.h);
+	const int ry1 = params.full_height - rtile.y;
+
+	const int ox0 = max(x0, rx0), ox1 = min(x1, rx1);
+	const int oy0 = max(y0, ry0), oy1 = min(y1, ry1);
+	if(ox0 >= ox1 || oy0 >= oy1) {
+		return;
+	}
+
+	const int tile_index = tile_y * divide_up(spec.width, tile_width) + tile_x;
+	map<int, PendingTile>::iterator it = pending_tiles.find(tile_index);
+
+	if(it == pending_tiles.end()) {
+		/* File tiles are always written at full size, also at the edges. */
+		PendingTile tile;
+		it = pending_tiles.insert(std::make_pair(tile_index, tile)).first;
+		it->second.pixels.resize(tile_width * tile_height * num_channels, 0.0f);
+		it->second.num_missing_pixels = (x1 - x0) * (y1 - y0);
+
+		pending_memory += it->second.pixels.size() * sizeof(float);
+		stats.peak_pending_memory = max(stats.peak_pending_memory, pending_memory);
+	}
+
+	PendingTile& tile = it->second;
+	const size_t row_size = sizeof(float) * num_channels * (ox1 - ox0);
+
+	for(int y = oy0; y < oy1; y++) {
+		/* Flip rows, render tile rows are stored bottom to top. */
+		const int render_row = (ry1 - 1) - y;
+		const float *src = &pixels[(render_row * rtile.w + (ox0 - rx0)) * num_channels];
+		float *dst = &tile.pixels[((y - y0) * tile_width + (ox0 - x0)) * num_channels];
+		memcpy(dst, src, row_size);
+	}
+
+	tile.num_missing_pixels -= (ox1 - ox0) * (oy1 - oy0);
+	assert(tile.num_missing_pixels >= 0);
+
+	if(tile.num_missing_pixels == 0) {
+		if(!out->write_tile(x0, y0, 0, TypeDesc::FLOAT, &tile.pixels[0])) {
+			error = out->geterror();
+		}
+		else {
+			stats.num_written_tiles++;
+		}
+
+		pending_memory -= tile.pixels.size() * sizeof(float);
+		pending_tiles.erase(it);
+	}
+}
+
+bool TileWriter::write_tile(RenderTile& rtile)
+{
+	if(out == NULL) {
+		return false;
+	}
+
+	vector<float> pixels;
+	if(!get_tile_pixels(rtile, pixels)) {
+		error = "Failed to read tile buffers from device";
+		return false;
+	}
+
+	/* Distribute pixels over the file tiles overlapping the render tile. */
+	const int fx0 = (rtile.x - spec.x) / spec.tile_width;
+	const int fx1 = (rtile.x + rtile.w - 1 - spec.x) / spec.tile_width;
+	const int fy0 = (params.full_height - (rtile.y + rtile.h) - spec.y) / spec.tile_height;
+	const int fy1 = (params.full_height - rtile.y - 1 - spec.y) / spec.tile_height;
+
+	for(int tile_y = fy0; tile_y <= fy1; tile_y++) {
+		for(int tile_x = fx0; tile_x <= fx1; tile_x++) {
+			add_to_tile(tile_x, tile_y, rtile, pixels);
+		}
+	}
+
+	return error.empty();
+}
+
+bool TileWriter::close()
+{
+	if(out == NULL) {
+		return false;
+	}
+
+	stats.num_missing_tiles = pending_tiles.size();
+	pending_tiles.clear();
+	pending_memory = 0;
+
+	bool success = out->close();
+	if(!success) {
+		error = out->geterror();
+	}
+
+	delete out;
+	out = NULL;
+
+	VLOG(1) << "Tile output statistics for " << filepath << ":\n"
+	        << stats.full_report();
+
+	return success && error.empty();
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,104 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __TILE_WRITER_H__
+#define __TILE_WRITER_H__
+
+#include "render/buffers.h"
+
+#include "util/util_image.h"
+#include "util/util_map.h"
+#include "util/util_string.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Tile Writer
+ *
+ * Streams finished render tiles into a tiled multilayer OpenEXR file, so the
+ * full frame never has to be kept in memory. Render tiles do not need to line
+ * up with the tiles of the file: pixels are collected per file tile, which is
+ * written and freed as soon as all of its pixels were rendered. */
+
+class TileWriter {
+public:
+	TileWriter();
+	~TileWriter();
+
+	/* Create the file for the image described by the buffer parameters,
+	 * with one channel per component of every pass. */
+	bool open(const string& filepath,
+	          const BufferParams& params,
+	          int2 tile_size,
+	          float exposure,
+	          const string& layer_name = "RenderLayer");
+
+	/* Copy a finished tile into the file. Tile buffers can be freed after
+	 * this returns. */
+	bool write_tile(RenderTile& rtile);
+
+	/* Finish the file, tiles which did not get all their pixels (for example
+	 * when rendering was canceled) are left out. */
+	bool close();
+
+	bool is_open() const { return out != NULL; }
+	const string& get_error() const { return error; }
+
+	struct Stats {
+		Stats();
+
+		string full_report() const;
+
+		int num_written_tiles;
+		int num_missing_tiles;
+		size_t peak_pending_memory;
+	} stats;
+
+protected:
+	/* File tile which is still missing some pixels. */
+	struct PendingTile {
+		vector<float> pixels;
+		int num_missing_pixels;
+	};
+
+	/* Pass as stored in the file, channels start at the given offset. */
+	struct PassChannels {
+		PassType type;
+		int components;
+		int offset;
+	};
+
+	bool get_tile_pixels(RenderTile& rtile, vector<float>& pixels);
+	void add_to_tile(int tile_x, int tile_y, RenderTile& rtile, const vector<float>& pixels);
+
+	ImageOutput *out;
+	ImageSpec spec;
+	string filepath;
+
+	BufferParams params;
+	vector<PassChannels> pass_channels;
+	int num_channels;
+	float exposure;
+
+	map<int, PendingTile> pending_tiles;
+	size_t pending_memory;
+
+	string error;
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __TILE_WRITER_H__ */
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "subd/subd_cache.h"
+#include "subd/subd_split.h"
+
+#include "util/util_foreach.h"
+#include "util/util_math.h"
+
+CCL_NAMESPACE_BEGIN
+
+static bool subpatches_equal(const QuadDice::SubPatch& a, const QuadDice::SubPatch& b)
+{
+	return a.P00 == b.P00 && a.P10 == b.P10 && a.P01 == b.P01 && a.P11 == b.P11;
+}
+
+static bool edgefactors_equal(const QuadDice::EdgeFactors& a, const QuadDice::EdgeFactors& b)
+{
+	return a.tu0 == b.tu0 && a.tu1 == b.tu1 && a.tv0 == b.tv0 && a.tv1 == b.tv1;
+}
+
+SubdCache::SubdCache()
+{
+}
+
+void SubdCache::begin(const string& control_hash_, size_t num_patches)
+{
+	if(control_hash != control_hash_ || entries.size() != num_patches) {
+		entries.clear();
+		entries.resize(num_patches);
+		control_hash = control_hash_;
+	}
+}
+
+bool SubdCache::update(size_t patch, const DiagSplit& split)
+{
+	Entry& entry = entries[patch];
+	const size_t num_subpatches = split.subpatches_quad.size();
+
+	if(entry.subpatches.size() == num_subpatches && entry.grid.num_verts() != 0) {
+		bool equal = true;
+
+		for(size_t i = 0; i < num_subpatches && equal; i++) {
+			equal = subpatches_equal(entry.subpatches[i], split.subpatches_quad[i]) &&
+			        edgefactors_equal(entry.edgefactors[i], split.edgefactors_quad[i]);
+		}
+
+		if(equal) {
+			return true;
+		}
+	}
+
+	entry.subpatches = split.subpatches_quad;
+	entry.edgefactors = split.edgefactors_quad;
+	entry.grid.clear();
+
+	return false;
+}
+
+void SubdCache::clear()
+{
+	entries.clear();
+	control_hash = "";
+}
+
+size_t SubdCache::memory_size() const
+{
+	size_t size = entries.capacity()*sizeof(Entry);
+
+	foreach(const Entry& entry, entries) {
+		size += entry.subpatches.capacity()*sizeof(QuadDice::SubPatch) +
+		        entry.edgefactors.capacity()*sizeof(QuadDice::EdgeFactors) +
+		        entry.grid.memory_size();
+	}
+
+	return size;
+}
+
+CCL_NAMESPACE_END
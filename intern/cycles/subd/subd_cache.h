@@ -0,0 +1,68 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __SUBD_CACHE_H__
+#define __SUBD_CACHE_H__
+
+/* Cache of diced grids, for meshes that are tessellated repeatedly as in
+ * viewport renders where every camera change updates the dicing. The grid of a
+ * patch is reused when the control mesh is unchanged and splitting the patch
+ * gives the same subpatches and edge factors as the previous time, in which
+ * case dicing would give the exact same result. */
+
+#include "subd/subd_dice.h"
+
+#include "util/util_string.h"
+#include "util/util_types.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+class DiagSplit;
+
+class SubdCache {
+public:
+	SubdCache();
+
+	/* Start a tessellation with the given number of patches, grids are only
+	 * kept when the hash of the control mesh is unchanged. */
+	void begin(const string& control_hash, size_t num_patches);
+
+	/* Returns true if the grid of the patch is still valid for the split,
+	 * otherwise the split is stored and the grid must be diced again. Can be
+	 * called from multiple threads for different patches. */
+	bool update(size_t patch, const DiagSplit& split);
+
+	DicedGrid& grid(size_t patch) { return entries[patch].grid; }
+
+	void clear();
+
+	size_t memory_size() const;
+
+protected:
+	struct Entry {
+		vector<QuadDice::SubPatch> subpatches;
+		vector<QuadDice::EdgeFactors> edgefactors;
+		DicedGrid grid;
+	};
+
+	string control_hash;
+	vector<Entry> entries;
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __SUBD_CACHE_H__ */
@@ -22,41 +22,38 @@
 
 CCL_NAMESPACE_BEGIN
 
-/* EdgeDice Base */
+/* Diced Grid */
 
-EdgeDice::EdgeDice(const SubdParams& params_)
-: params(params_)
+void DicedGrid::clear()
 {
-	mesh_P = NULL;
-	mesh_N = NULL;
-	vert_offset = 0;
-
-	params.mesh->attributes.add(ATTR_STD_VERTEX_NORMAL);
-
-	if(params.ptex) {
-		params.mesh->attributes.add(ATTR_STD_PTEX_UV);
-		params.mesh->attributes.add(ATTR_STD_PTEX_FACE_ID);
-	}
+	P.clear();
+	N.clear();
+	uv.clear();
+	triangles.clear();
 }
 
-void EdgeDice::reserve(int num_verts)
+size_t DicedGrid::memory_size() const
 {
-	Mesh *mesh = params.mesh;
-
-	vert_offset = mesh->verts.size();
-	tri_offset = mesh->num_triangles();
+	return P.capacity()*sizeof(float3) +
+	       N.capacity()*sizeof(float3) +
+	       uv.capacity()*sizeof(float2) +
+	       triangles.capacity()*sizeof(int);
+}
 
-	/* todo: optimize so we can reserve in advance, this is like push_back_slow() */
-	if(vert_offset + num_verts > mesh->verts.capacity()) {
-		mesh->reserve_mesh(size_t((vert_offset + num_verts) * 1.2), mesh->num_triangles());
-	}
+/* EdgeDice Base */
 
-	mesh->resize_mesh(vert_offset + num_verts, tri_offset);
+EdgeDice::EdgeDice(const SubdParams& params_, DicedGrid *grid_)
+: params(params_), grid(grid_)
+{
+}
 
-	Attribute *attr_vN = mesh->attributes.add(ATTR_STD_VERTEX_NORMAL);
+void EdgeDice::reserve(int num_verts)
+{
+	size_t total_verts = grid->num_verts() + num_verts;
 
-	mesh_P = mesh->verts.data();
-	mesh_N = attr_vN->data_float3();
+	grid->P.reserve(total_verts);
+	grid->N.reserve(total_verts);
+	grid->uv.reserve(total_verts);
 }
 
 int EdgeDice::add_vert(Patch *patch, float2 uv)
@@ -65,48 +62,21 @@ int EdgeDice::add_vert(Patch *patch, float2 uv)
 
 	patch->eval(&P, NULL, NULL, &N, uv.x, uv.y);
 
-	assert(vert_offset < params.mesh->verts.size());
-
-	mesh_P[vert_offset] = P;
-	mesh_N[vert_offset] = N;
-	params.mesh->vert_patch_uv[vert_offset] = make_float2(uv.x, uv.y);
-
-	if(params.ptex) {
-		Attribute *attr_ptex_uv = params.mesh->attributes.add(ATTR_STD_PTEX_UV);
-		params.mesh->attributes.resize();
-
-		float3 *ptex_uv = attr_ptex_uv->data_float3();
-		ptex_uv[vert_offset] = make_float3(uv.x, uv.y, 0.0f);
-	}
-
-	params.mesh->num_subd_verts++;
+	grid->P.push_back(P);
+	grid->N.push_back(N);
+	grid->uv.push_back(uv);
 
-	return vert_offset++;
+	return grid->num_verts() - 1;
 }
 
-void EdgeDice::add_triangle(Patch *patch, int v0, int v1, int v2)
+void EdgeDice::add_triangle(int v0, int v1, int v2)
 {
-	Mesh *mesh = params.mesh;
-
-	/* todo: optimize so we can reserve in advance, this is like push_back_slow() */
-	if(mesh->triangles.size() == mesh->triangles.capacity())
-		mesh->reserve_mesh(mesh->verts.size(), size_t(max(mesh->num_triangles() + 1, 1) * 1.2));
-
-	mesh->add_triangle(v0, v1, v2, patch->shader, true);
-	params.mesh->triangle_patch[params.mesh->num_triangles()-1] = patch->patch_index;
-
-	if(params.ptex) {
-		Attribute *attr_ptex_face_id = params.mesh->attributes.add(ATTR_STD_PTEX_FACE_ID);
-		params.mesh->attributes.resize();
-
-		float *ptex_face_id = attr_ptex_face_id->data_float();
-		ptex_face_id[tri_offset] = (float)patch->ptex_face_id();
-	}
-
-	tri_offset++;
+	grid->triangles.push_back(v0);
+	grid->triangles.push_back(v1);
+	grid->triangles.push_back(v2);
 }
 
-void EdgeDice::stitch_triangles(Patch *patch, vector<int>& outer, vector<int>& inner)
+void EdgeDice::stitch_triangles(vector<int>& outer, vector<int>& inner)
 {
 	if(inner.size() == 0 || outer.size() == 0)
 		return; // XXX avoid crashes for Mu or Mv == 1, missing polygons
@@ -129,8 +99,8 @@ void EdgeDice::stitch_triangles(Patch *patch, vector<int>& outer, vector<int>& i
 		}
 		else {
 			/* length of diagonals */
-			float len1 = len_squared(mesh_P[inner[i]] - mesh_P[outer[j+1]]);
-			float len2 = len_squared(mesh_P[outer[j]] - mesh_P[inner[i+1]]);
+			float len1 = len_squared(grid->P[inner[i]] - grid->P[outer[j+1]]);
+			float len2 = len_squared(grid->P[outer[j]] - grid->P[inner[i+1]]);
 
 			/* use smallest diagonal */
 			if(len1 < len2)
@@ -139,14 +109,14 @@ void EdgeDice::stitch_triangles(Patch *patch, vector<int>& outer, vector<int>& i
 				v2 = inner[++i];
 		}
 
-		add_triangle(patch, v0, v1, v2);
+		add_triangle(v0, v1, v2);
 	}
 }
 
 /* QuadDice */
 
-QuadDice::QuadDice(const SubdParams& params_)
-: EdgeDice(params_)
+QuadDice::QuadDice(const SubdParams& params_, DicedGrid *grid_)
+: EdgeDice(params_, grid_)
 {
 }
 
@@ -296,8 +266,8 @@ void QuadDice::add_grid(SubPatch& sub, int Mu, int Mv, int offset)
 				int i3 = offset + 4 + i + j*(Mu-1);
 				int i4 = offset + 4 + (i-1) + j*(Mu-1);
 
-				add_triangle(sub.patch, i1, i2, i3);
-				add_triangle(sub.patch, i1, i3, i4);
+				add_triangle(i1, i2, i3);
+				add_triangle(i1, i3, i4);
 			}
 		}
 	}
@@ -319,7 +289,7 @@ void QuadDice::dice(SubPatch& sub, EdgeFactors& ef)
 	Mv = max((int)ceil(S*Mv), 2); // XXX handle 0 & 1?
 
 	/* reserve space for new verts */
-	int offset = params.mesh->verts.size();
+	int offset = grid->num_verts();
 	reserve(ef, Mu, Mv);
 
 	/* corners and inner grid */
@@ -330,21 +300,21 @@ void QuadDice::dice(SubPatch& sub, EdgeFactors& ef)
 	vector<int> outer, inner;
 
 	add_side_u(sub, outer, inner, Mu, Mv, ef.tu0, 0, offset);
-	stitch_triangles(sub.patch, outer, inner);
+	stitch_triangles(outer, inner);
 
 	/* top side */
 	add_side_u(sub, outer, inner, Mu, Mv, ef.tu1, 1, offset);
-	stitch_triangles(sub.patch, inner, outer);
+	stitch_triangles(inner, outer);
 
 	/* left side */
 	add_side_v(sub, outer, inner, Mu, Mv, ef.tv0, 0, offset);
-	stitch_triangles(sub.patch, inner, outer);
+	stitch_triangles(inner, outer);
 
 	/* right side */
 	add_side_v(sub, outer, inner, Mu, Mv, ef.tv1, 1, offset);
-	stitch_triangles(sub.patch, outer, inner);
+	stitch_triangles(outer, inner);
 
-	assert(vert_offset == params.mesh->verts.size());
+	assert(grid->num_verts() == offset + (ef.tu0 + ef.tu1 + ef.tv0 + ef.tv1) + (Mu - 1)*(Mv - 1));
 }
 
 CCL_NAMESPACE_END
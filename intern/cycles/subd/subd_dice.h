@@ -22,6 +22,7 @@
  * DiagSplit. For more algorithm details, see the DiagSplit paper or the
  * ARB_tessellation_shader OpenGL extension, Section 2.X.2. */
 
+#include "util/util_transform.h"
 #include "util/util_types.h"
 #include "util/util_vector.h"
 
@@ -42,6 +43,9 @@ struct SubdParams {
 	Camera *camera;
 	Transform objecttoworld;
 
+	/* Keep diced grids to reuse them when tessellating again, see SubdCache. */
+	bool use_cache;
+
 	SubdParams(Mesh *mesh_, bool ptex_ = false)
 	{
 		mesh = mesh_;
@@ -52,28 +56,45 @@ struct SubdParams {
 		dicing_rate = 1.0f;
 		max_level = 12;
 		camera = NULL;
+		use_cache = false;
 	}
 
 };
 
+/* Diced Grid
+ *
+ * Vertices and triangles diced from a patch, with vertex indices local to the
+ * grid. Dicing does not touch the mesh, so patches can be diced in parallel
+ * and their grids appended to the mesh afterwards. */
+
+struct DicedGrid {
+	vector<float3> P;
+	vector<float3> N;
+	vector<float2> uv;
+	vector<int> triangles;
+
+	size_t num_verts() const { return P.size(); }
+	size_t num_triangles() const { return triangles.size() / 3; }
+
+	void clear();
+	size_t memory_size() const;
+};
+
 /* EdgeDice Base */
 
 class EdgeDice {
 public:
 	SubdParams params;
-	float3 *mesh_P;
-	float3 *mesh_N;
-	size_t vert_offset;
-	size_t tri_offset;
+	DicedGrid *grid;
 
-	explicit EdgeDice(const SubdParams& params);
+	EdgeDice(const SubdParams& params, DicedGrid *grid);
 
 	void reserve(int num_verts);
 
 	int add_vert(Patch *patch, float2 uv);
-	void add_triangle(Patch *patch, int v0, int v1, int v2);
+	void add_triangle(int v0, int v1, int v2);
 
-	void stitch_triangles(Patch *patch, vector<int>& outer, vector<int>& inner);
+	void stitch_triangles(vector<int>& outer, vector<int>& inner);
 };
 
 /* Quad EdgeDice
@@ -107,7 +128,7 @@ public:
 		int tv1;
 	};
 
-	explicit QuadDice(const SubdParams& params);
+	QuadDice(const SubdParams& params, DicedGrid *grid);
 
 	void reserve(EdgeFactors& ef, int Mu, int Mv);
 	float3 eval_projected(SubPatch& sub, float u, float v);
@@ -35,6 +35,11 @@ DiagSplit::DiagSplit(const SubdParams& params_)
 
 void DiagSplit::dispatch(QuadDice::SubPatch& sub, QuadDice::EdgeFactors& ef)
 {
+	ef.tu0 = max(ef.tu0, 1);
+	ef.tu1 = max(ef.tu1, 1);
+	ef.tv0 = max(ef.tv0, 1);
+	ef.tv1 = max(ef.tv1, 1);
+
 	subpatches_quad.push_back(sub);
 	edgefactors_quad.push_back(ef);
 }
@@ -238,21 +243,19 @@ void DiagSplit::split_quad(Patch *patch, QuadDice::SubPatch *subpatch)
 	limit_edge_factors(sub_split, ef_split, 1 << params.max_level);
 
 	split(sub_split, ef_split);
+}
 
-	QuadDice dice(params);
+void DiagSplit::dice(DicedGrid *grid)
+{
+	QuadDice dice(params, grid);
 
 	for(size_t i = 0; i < subpatches_quad.size(); i++) {
-		QuadDice::SubPatch& sub = subpatches_quad[i];
-		QuadDice::EdgeFactors& ef = edgefactors_quad[i];
-
-		ef.tu0 = max(ef.tu0, 1);
-		ef.tu1 = max(ef.tu1, 1);
-		ef.tv0 = max(ef.tv0, 1);
-		ef.tv1 = max(ef.tv1, 1);
-
-		dice.dice(sub, ef);
+		dice.dice(subpatches_quad[i], edgefactors_quad[i]);
 	}
+}
 
+void DiagSplit::clear()
+{
 	subpatches_quad.clear();
 	edgefactors_quad.clear();
 }
@@ -51,7 +51,14 @@ public:
 	void dispatch(QuadDice::SubPatch& sub, QuadDice::EdgeFactors& ef);
 	void split(QuadDice::SubPatch& sub, QuadDice::EdgeFactors& ef, int depth=0);
 
+	/* Split the patch into subpatches, which are added to subpatches_quad
+	 * along with their edge factors. */
 	void split_quad(Patch *patch, QuadDice::SubPatch *subpatch=NULL);
+
+	/* Dice the subpatches into the grid. */
+	void dice(DicedGrid *grid);
+
+	void clear();
 };
 
 CCL_NAMESPACE_END
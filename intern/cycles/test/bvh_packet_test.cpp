@@ -0,0 +1,270 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "bvh/bvh.h"
+#include "bvh/bvh_params.h"
+
+#include "kernel/kernel.h"
+#include "kernel/kernel_compat_cpu.h"
+#include "kernel/kernel_types.h"
+#include "kernel/split/kernel_split_data.h"
+#include "kernel/kernel_globals.h"
+
+#include "render/mesh.h"
+#include "render/object.h"
+
+#include "util/util_progress.h"
+#include "util/util_system.h"
+#include "util/util_time.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+typedef uint (*IntersectPacketFunction)(KernelGlobals *kg,
+                                        const Ray *rays,
+                                        Intersection *isects,
+                                        int num_rays,
+                                        uint visibility);
+
+/* Packet traversal is only compiled into the AVX and AVX2 kernels. */
+IntersectPacketFunction intersect_packet_function(BVHLayout *bvh_layout)
+{
+#ifdef WITH_CYCLES_OPTIMIZED_KERNEL_AVX2
+	if(system_cpu_support_avx2()) {
+		*bvh_layout = BVH_LAYOUT_BVH8;
+		return kernel_cpu_avx2_intersect_packet;
+	}
+#endif
+#ifdef WITH_CYCLES_OPTIMIZED_KERNEL_AVX
+	if(system_cpu_support_avx()) {
+		*bvh_layout = BVH_LAYOUT_BVH4;
+		return kernel_cpu_avx_intersect_packet;
+	}
+#endif
+	(void)bvh_layout;
+	return NULL;
+}
+
+/* Height field with enough triangles for traversal to dominate. */
+void build_height_field(Mesh *mesh, int resolution)
+{
+	mesh->reserve_mesh((resolution + 1) * (resolution + 1),
+	                   resolution * resolution * 2);
+
+	for(int y = 0; y <= resolution; y++) {
+		for(int x = 0; x <= resolution; x++) {
+			float u = (float)x / resolution * 2.0f - 1.0f;
+			float v = (float)y / resolution * 2.0f - 1.0f;
+			float h = 0.1f * sinf(u * 12.0f) * cosf(v * 9.0f);
+			mesh->add_vertex(make_float3(u, v, h));
+		}
+	}
+
+	for(int y = 0; y < resolution; y++) {
+		for(int x = 0; x < resolution; x++) {
+			int v0 = y * (resolution + 1) + x;
+			int v1 = v0 + 1;
+			int v2 = v0 + resolution + 1;
+			int v3 = v2 + 1;
+			mesh->add_triangle(v0, v1, v3, 0, false);
+			mesh->add_triangle(v0, v3, v2, 0, false);
+		}
+	}
+}
+
+Ray make_ray(float3 P, float3 D, float t)
+{
+	Ray ray;
+	memset(&ray, 0, sizeof(ray));
+	ray.P = P;
+	ray.D = D;
+	ray.t = t;
+	return ray;
+}
+
+class BVHPacketTest : public ::testing::Test {
+protected:
+	virtual void SetUp()
+	{
+		intersect_packet = intersect_packet_function(&bvh_layout);
+		if(intersect_packet == NULL) {
+			return;
+		}
+
+		mesh.transform_applied = true;
+		build_height_field(&mesh, 512);
+		mesh.compute_bounds();
+
+		object.mesh = &mesh;
+		object.compute_bounds(false);
+
+		vector<Object*> objects;
+		objects.push_back(&object);
+
+		BVHParams params;
+		params.top_level = true;
+		params.bvh_layout = bvh_layout;
+
+		Progress progress;
+		bvh = BVH::create(params, objects);
+		bvh->build(progress);
+
+		PackedBVH& pack = bvh->pack;
+		kg = new KernelGlobals();
+		kernel_tex_copy(kg, "__bvh_nodes", pack.nodes.data(), pack.nodes.size());
+		kernel_tex_copy(kg, "__bvh_leaf_nodes", pack.leaf_nodes.data(), pack.leaf_nodes.size());
+		kernel_tex_copy(kg, "__object_node", pack.object_node.data(), pack.object_node.size());
+		kernel_tex_copy(kg, "__prim_tri_index", pack.prim_tri_index.data(), pack.prim_tri_index.size());
+		kernel_tex_copy(kg, "__prim_tri_verts", pack.prim_tri_verts.data(), pack.prim_tri_verts.size());
+		kernel_tex_copy(kg, "__prim_type", pack.prim_type.data(), pack.prim_type.size());
+		kernel_tex_copy(kg, "__prim_visibility", pack.prim_visibility.data(), pack.prim_visibility.size());
+		kernel_tex_copy(kg, "__prim_index", pack.prim_index.data(), pack.prim_index.size());
+		kernel_tex_copy(kg, "__prim_object", pack.prim_object.data(), pack.prim_object.size());
+
+		KernelData data;
+		memset(&data, 0, sizeof(data));
+		data.bvh.root = pack.root_index;
+		data.bvh.bvh_layout = bvh_layout;
+		kernel_const_copy(kg, "__data", &data, sizeof(data));
+
+		/* Camera rays of a pinhole camera looking down at the height field,
+		 * packets are spans of pixels in a row as in the CPU device. */
+		const int resolution = 512;
+		const float3 camera = make_float3(0.0f, 0.0f, 3.0f);
+		for(int y = 0; y < resolution; y++) {
+			for(int x = 0; x < resolution; x++) {
+				float3 target = make_float3((x + 0.5f) / resolution * 2.4f - 1.2f,
+				                            (y + 0.5f) / resolution * 2.4f - 1.2f,
+				                            0.0f);
+				camera_rays.push_back_slow(make_ray(camera, normalize(target - camera), FLT_MAX));
+			}
+		}
+	}
+
+	virtual void TearDown()
+	{
+		delete kg;
+		delete bvh;
+	}
+
+	/* Trace rays one by one or in packets, returns rays per second. */
+	double trace(const array<Ray>& rays,
+	             array<Intersection>& isects,
+	             uint visibility,
+	             int packet_size)
+	{
+		const int num_iterations = 4;
+		isects.resize(rays.size());
+
+		double start_time = time_dt();
+		for(int iteration = 0; iteration < num_iterations; iteration++) {
+			for(size_t i = 0; i < rays.size(); i += packet_size) {
+				int num_rays = min(packet_size, (int)(rays.size() - i));
+				intersect_packet(kg, &rays[i], &isects[i], num_rays, visibility);
+			}
+		}
+		double elapsed = time_dt() - start_time;
+
+		return (double)rays.size() * num_iterations / max(elapsed, 1e-9);
+	}
+
+	/* Shadow rays from the camera ray hits towards a point light. */
+	void make_shadow_rays(const array<Intersection>& isects, array<Ray>& shadow_rays)
+	{
+		const float3 light = make_float3(0.7f, 0.5f, 2.0f);
+		shadow_rays.clear();
+		for(size_t i = 0; i < isects.size(); i++) {
+			if(isects[i].prim == PRIM_NONE) {
+				continue;
+			}
+			float3 P = camera_rays[i].P + camera_rays[i].D * isects[i].t;
+			P.z += 1e-3f;
+			float3 D = light - P;
+			float t = len(D);
+			shadow_rays.push_back_slow(make_ray(P, D / t, t));
+		}
+	}
+
+	IntersectPacketFunction intersect_packet;
+	BVHLayout bvh_layout;
+	Mesh mesh;
+	Object object;
+	BVH *bvh;
+	KernelGlobals *kg;
+	array<Ray> camera_rays;
+};
+
+}  // namespace
+
+TEST_F(BVHPacketTest, camera_rays)
+{
+	if(intersect_packet == NULL) {
+		printf("Packet traversal is not supported on this CPU, skipping.\n");
+		return;
+	}
+
+	array<Intersection> single_isects, packet_isects;
+	double single_rate = trace(camera_rays, single_isects, PATH_RAY_CAMERA, 1);
+	double packet_rate = trace(camera_rays, packet_isects, PATH_RAY_CAMERA, BVH_PACKET_SIZE);
+
+	printf("Camera rays (%s): single %.2f Mrays/s, packet %.2f Mrays/s\n",
+	       bvh_layout_name(bvh_layout),
+	       single_rate * 1e-6,
+	       packet_rate * 1e-6);
+
+	/* Ties on shared edges may pick either triangle, so compare distances. */
+	for(size_t i = 0; i < camera_rays.size(); i++) {
+		ASSERT_EQ(single_isects[i].prim == PRIM_NONE, packet_isects[i].prim == PRIM_NONE);
+		if(single_isects[i].prim != PRIM_NONE) {
+			EXPECT_NEAR(single_isects[i].t, packet_isects[i].t, 1e-5f);
+		}
+	}
+}
+
+TEST_F(BVHPacketTest, shadow_rays)
+{
+	if(intersect_packet == NULL) {
+		printf("Packet traversal is not supported on this CPU, skipping.\n");
+		return;
+	}
+
+	array<Intersection> camera_isects;
+	trace(camera_rays, camera_isects, PATH_RAY_CAMERA, 1);
+
+	array<Ray> shadow_rays;
+	make_shadow_rays(camera_isects, shadow_rays);
+	ASSERT_GT(shadow_rays.size(), 0);
+
+	array<Intersection> single_isects, packet_isects;
+	double single_rate = trace(shadow_rays, single_isects, PATH_RAY_SHADOW_OPAQUE, 1);
+	double packet_rate = trace(shadow_rays, packet_isects, PATH_RAY_SHADOW_OPAQUE, BVH_PACKET_SIZE);
+
+	printf("Shadow rays (%s): single %.2f Mrays/s, packet %.2f Mrays/s\n",
+	       bvh_layout_name(bvh_layout),
+	       single_rate * 1e-6,
+	       packet_rate * 1e-6);
+
+	/* Any hit terminates shadow rays, only occlusion has to match. */
+	for(size_t i = 0; i < shadow_rays.size(); i++) {
+		EXPECT_EQ(single_isects[i].prim == PRIM_NONE, packet_isects[i].prim == PRIM_NONE);
+	}
+}
+
+CCL_NAMESPACE_END
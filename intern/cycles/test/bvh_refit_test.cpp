@@ -0,0 +1,179 @@
+/*
+ * Copyright 2011-2018 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "bvh/bvh.h"
+#include "bvh/bvh_params.h"
+
+#include "render/mesh.h"
+#include "render/object.h"
+
+#include "util/util_algorithm.h"
+#include "util/util_boundbox.h"
+#include "util/util_progress.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+void build_grid(Mesh *mesh, int resolution)
+{
+	mesh->reserve_mesh((resolution + 1) * (resolution + 1),
+	                   resolution * resolution * 2);
+
+	for(int y = 0; y <= resolution; y++) {
+		for(int x = 0; x <= resolution; x++) {
+			float u = (float)x / resolution * 2.0f - 1.0f;
+			float v = (float)y / resolution * 2.0f - 1.0f;
+			mesh->add_vertex(make_float3(u, v, 0.1f * sinf(u * 7.0f)));
+		}
+	}
+
+	for(int y = 0; y < resolution; y++) {
+		for(int x = 0; x < resolution; x++) {
+			int v0 = y * (resolution + 1) + x;
+			int v1 = v0 + 1;
+			int v2 = v0 + resolution + 1;
+			int v3 = v2 + 1;
+			mesh->add_triangle(v0, v1, v3, 0, false);
+			mesh->add_triangle(v0, v3, v2, 0, false);
+		}
+	}
+}
+
+/* Union of both child bounds of a BVH2 inner node. */
+BoundBox bvh2_node_bounds(const PackedBVH& pack, int idx)
+{
+	const int4 *data = &pack.nodes[idx];
+	BoundBox bounds = BoundBox::empty;
+	for(int i = 0; i < 2; i++) {
+		bounds.grow(make_float3(__int_as_float(data[1][i]),
+		                        __int_as_float(data[2][i]),
+		                        __int_as_float(data[3][i])));
+		bounds.grow(make_float3(__int_as_float(data[1][i + 2]),
+		                        __int_as_float(data[2][i + 2]),
+		                        __int_as_float(data[3][i + 2])));
+	}
+	return bounds;
+}
+
+class BVHRefitTest : public ::testing::Test {
+protected:
+	virtual void SetUp()
+	{
+		mesh.transform_applied = true;
+		build_grid(&mesh, 32);
+		mesh.compute_bounds();
+
+		object.mesh = &mesh;
+		object.compute_bounds(false);
+
+		objects.push_back(&object);
+
+		params.top_level = true;
+		params.bvh_layout = BVH_LAYOUT_BVH2;
+
+		bvh = BVH::create(params, objects);
+		bvh->build(progress);
+	}
+
+	virtual void TearDown()
+	{
+		delete bvh;
+	}
+
+	Mesh mesh;
+	Object object;
+	vector<Object*> objects;
+	BVHParams params;
+	Progress progress;
+	BVH *bvh;
+};
+
+}  // namespace
+
+TEST_F(BVHRefitTest, translate)
+{
+	ASSERT_GE(bvh->pack.root_index, 0);
+	EXPECT_EQ(bvh->num_refits, 0);
+
+	const float3 offset = make_float3(0.5f, -2.0f, 1.0f);
+	for(size_t i = 0; i < mesh.verts.size(); i++) {
+		mesh.verts[i] += offset;
+	}
+	mesh.compute_bounds();
+
+	bvh->refit(progress);
+	EXPECT_EQ(bvh->num_refits, 1);
+
+	/* Rigid motion keeps the quality of the tree. */
+	EXPECT_NEAR(bvh->refit_cost_ratio(), 1.0f, 1e-3f);
+
+	/* Root bounds follow the mesh. */
+	BoundBox bounds = bvh2_node_bounds(bvh->pack, bvh->pack.root_index);
+	EXPECT_NEAR(bounds.min.x, mesh.bounds.min.x, 1e-5f);
+	EXPECT_NEAR(bounds.min.y, mesh.bounds.min.y, 1e-5f);
+	EXPECT_NEAR(bounds.min.z, mesh.bounds.min.z, 1e-5f);
+	EXPECT_NEAR(bounds.max.x, mesh.bounds.max.x, 1e-5f);
+	EXPECT_NEAR(bounds.max.y, mesh.bounds.max.y, 1e-5f);
+	EXPECT_NEAR(bounds.max.z, mesh.bounds.max.z, 1e-5f);
+
+	/* Triangle vertices are repacked from the deformed mesh. */
+	const PackedBVH& pack = bvh->pack;
+	for(size_t i = 0; i < pack.prim_index.size(); i++) {
+		Mesh::Triangle t = mesh.get_triangle(pack.prim_index[i]);
+		const float4 *tri_verts = &pack.prim_tri_verts[pack.prim_tri_index[i]];
+		for(int j = 0; j < 3; j++) {
+			float3 P = mesh.verts[t.v[j]];
+			EXPECT_EQ(tri_verts[j].x, P.x);
+			EXPECT_EQ(tri_verts[j].y, P.y);
+			EXPECT_EQ(tri_verts[j].z, P.z);
+		}
+	}
+}
+
+TEST_F(BVHRefitTest, scramble)
+{
+	/* Moving vertices far away from their neighbours makes nodes overlap,
+	 * the tree has to report the degraded quality so it gets rebuilt.
+	 */
+	const size_t num_verts = mesh.verts.size();
+	for(size_t i = 0; i < num_verts / 2; i++) {
+		swap(mesh.verts[i], mesh.verts[num_verts - 1 - (i * 7) % num_verts]);
+	}
+	mesh.compute_bounds();
+
+	bvh->refit(progress);
+	EXPECT_EQ(bvh->num_refits, 1);
+	EXPECT_GT(bvh->refit_cost_ratio(), 2.0f);
+
+	/* Root bounds still contain every vertex. */
+	BoundBox bounds = bvh2_node_bounds(bvh->pack, bvh->pack.root_index);
+	for(size_t i = 0; i < num_verts; i++) {
+		const float3 P = mesh.verts[i];
+		EXPECT_TRUE(P.x >= bounds.min.x && P.y >= bounds.min.y && P.z >= bounds.min.z);
+		EXPECT_TRUE(P.x <= bounds.max.x && P.y <= bounds.max.y && P.z <= bounds.max.z);
+	}
+
+	/* A fresh build recovers the quality. */
+	bvh->build(progress);
+	EXPECT_EQ(bvh->num_refits, 0);
+	EXPECT_FLOAT_EQ(bvh->refit_cost_ratio(), 1.0f);
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,145 @@
+/*
+ * Copyright 2011-2018 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "device/device.h"
+#include "device/device_network.h"
+
+#include "util/util_string.h"
+#include "util/util_vector.h"
+
+#ifdef WITH_NETWORK
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+/* Device keeping its buffers in shared memory segments, the way the network
+ * device does with a server on the same host. */
+class SharedMemoryDevice : public Device {
+public:
+	SharedMemoryDevice(DeviceInfo& info, Stats& stats)
+	: Device(info, stats, true), mem_counter(0)
+	{
+	}
+
+	~SharedMemoryDevice()
+	{
+		foreach(SharedMemoryMap::value_type& it, shared_buffers)
+			delete it.second;
+	}
+
+	void mem_alloc(device_memory& mem)
+	{
+		mem.device_pointer = ++mem_counter;
+
+		SharedMemoryBuffer *shared = new SharedMemoryBuffer();
+		string name = string_printf("cycles_test_%p_%llu",
+		                            (void*)this,
+		                            (unsigned long long)mem.device_pointer);
+		if(!shared->create(name, mem.memory_size())) {
+			delete shared;
+			return;
+		}
+
+		shared_buffers[mem.device_pointer] = shared;
+		shared->map_host(mem);
+	}
+
+	void mem_copy_to(device_memory& mem)
+	{
+		if(!mem.device_pointer)
+			mem_alloc(mem);
+	}
+
+	void mem_copy_from(device_memory& /*mem*/, int /*y*/, int /*w*/, int /*h*/, int /*elem*/)
+	{
+	}
+
+	void mem_zero(device_memory& /*mem*/)
+	{
+	}
+
+	void mem_free(device_memory& mem)
+	{
+		SharedMemoryMap::iterator i = shared_buffers.find(mem.device_pointer);
+		if(i != shared_buffers.end()) {
+			i->second->unmap_host(mem);
+			delete i->second;
+			shared_buffers.erase(i);
+		}
+		mem.device_pointer = 0;
+	}
+
+	void const_copy_to(const char * /*name*/, void * /*host*/, size_t /*size*/)
+	{
+	}
+
+	int get_split_task_count(DeviceTask& /*task*/)
+	{
+		return 1;
+	}
+
+	void task_add(DeviceTask& /*task*/)
+	{
+	}
+
+	void task_wait()
+	{
+	}
+
+	void task_cancel()
+	{
+	}
+
+	device_ptr mem_counter;
+	SharedMemoryMap shared_buffers;
+};
+
+}  // namespace
+
+TEST(device_network, shared_memory_give_data) {
+	DeviceInfo info;
+	Stats stats;
+	SharedMemoryDevice device(info, stats);
+
+	const int num = 1000;
+	device_vector<int> vec(&device, "test", MEM_READ_ONLY);
+	int *data = vec.alloc(num);
+	for(int i = 0; i < num; i++) {
+		data[i] = i * 7;
+	}
+	vec.copy_to_device();
+
+	/* The host memory is replaced with the segment. */
+	ASSERT_EQ(device.shared_buffers.size(), 1);
+	EXPECT_EQ(vec.host_pointer, device.shared_buffers.begin()->second->data);
+
+	array<int> result;
+	vec.give_data(result);
+
+	EXPECT_EQ(device.shared_buffers.size(), 0);
+	ASSERT_EQ(result.size(), num);
+	ASSERT_TRUE(result.data() != NULL);
+	for(int i = 0; i < num; i++) {
+		EXPECT_EQ(result[i], i * 7);
+	}
+}
+
+CCL_NAMESPACE_END
+
+#endif  /* WITH_NETWORK */
@@ -0,0 +1,279 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "kernel/filter/filter.h"
+
+#include "util/util_math.h"
+#include "util/util_math_fast.h"
+#include "util/util_system.h"
+#include "util/util_time.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+struct NLMFunctions {
+	const char *name;
+	void (*calc_difference)(int, int, float*, float*, float*, int*, int, int, float, float);
+	void (*blur)(float*, float*, int*, int, int);
+	void (*calc_weight)(float*, float*, int*, int, int);
+	void (*update_output)(int, int, float*, float*, float*, float*, int*, int, int);
+	void (*normalize)(float*, float*, int*, int);
+};
+
+#define NLM_FUNCTIONS(arch) { \
+	#arch, \
+	kernel_##arch##_filter_nlm_calc_difference, \
+	kernel_##arch##_filter_nlm_blur, \
+	kernel_##arch##_filter_nlm_calc_weight, \
+	kernel_##arch##_filter_nlm_update_output, \
+	kernel_##arch##_filter_nlm_normalize, \
+}
+
+/* Same selection as the CPU device. */
+NLMFunctions nlm_functions()
+{
+#ifdef WITH_CYCLES_OPTIMIZED_KERNEL_AVX2
+	if(system_cpu_support_avx2()) {
+		NLMFunctions functions = NLM_FUNCTIONS(cpu_avx2);
+		return functions;
+	}
+#endif
+#ifdef WITH_CYCLES_OPTIMIZED_KERNEL_AVX
+	if(system_cpu_support_avx()) {
+		NLMFunctions functions = NLM_FUNCTIONS(cpu_avx);
+		return functions;
+	}
+#endif
+#ifdef WITH_CYCLES_OPTIMIZED_KERNEL_SSE41
+	if(system_cpu_support_sse41()) {
+		NLMFunctions functions = NLM_FUNCTIONS(cpu_sse41);
+		return functions;
+	}
+#endif
+	NLMFunctions functions = NLM_FUNCTIONS(cpu);
+	return functions;
+}
+
+/* Noisy image with edges, a guide with the same structure and its variance. */
+struct NLMImages {
+	NLMImages(int w, int h)
+	: w(w), h(h), stride(align_up(w, 4))
+	{
+		const size_t size = stride*h;
+		image.resize(size);
+		variance.resize(size);
+		out.resize(size);
+		accum.resize(size);
+		temporary_1.resize(size);
+		temporary_2.resize(size);
+
+		uint seed = 12345;
+		for(int y = 0; y < h; y++) {
+			for(int x = 0; x < w; x++) {
+				seed = seed * 1103515245u + 12345u;
+				float noise = (float)(seed >> 8) / (float)(1 << 24) - 0.5f;
+				float base = ((x / 16 + y / 24) % 2)? 1.0f: 0.2f;
+				image[y*stride + x] = base + 0.3f * noise;
+				variance[y*stride + x] = 0.01f + 0.02f * base;
+			}
+		}
+	}
+
+	int w, h, stride;
+	vector<float> image, variance, out, accum, temporary_1, temporary_2;
+};
+
+/* Same sequence of kernels as CPUDevice::denoising_non_local_means(). */
+void nlm_filter(const NLMFunctions& functions, NLMImages& images, int r, int f, float a, float k_2)
+{
+	const int w = images.stride;
+	float *image = &images.image[0];
+	float *variance = &images.variance[0];
+	float *out = &images.out[0];
+	float *accum = &images.accum[0];
+	float *difference = &images.temporary_1[0];
+	float *blur_difference = &images.temporary_2[0];
+
+	memset(accum, 0, sizeof(float)*images.accum.size());
+	memset(out, 0, sizeof(float)*images.out.size());
+
+	for(int i = 0; i < (2*r+1)*(2*r+1); i++) {
+		int dy = i / (2*r+1) - r;
+		int dx = i % (2*r+1) - r;
+
+		int local_rect[4] = {max(0, -dx), max(0, -dy), images.w - max(0, dx), images.h - max(0, dy)};
+		functions.calc_difference(dx, dy, image, variance, difference, local_rect, w, 0, a, k_2);
+		functions.blur(difference, blur_difference, local_rect, w, f);
+		functions.calc_weight(blur_difference, difference, local_rect, w, f);
+		functions.blur(difference, blur_difference, local_rect, w, f);
+		functions.update_output(dx, dy, blur_difference, image, out, accum, local_rect, w, f);
+	}
+
+	int local_rect[4] = {0, 0, images.w, images.h};
+	functions.normalize(out, accum, local_rect, w);
+}
+
+/* Scalar implementation of the NLM kernels, as reference for the vectorized
+ * CPU kernels. */
+void reference_calc_difference(int dx, int dy,
+                               float *weight_image,
+                               float *variance_image,
+                               float *difference_image,
+                               int *rect,
+                               int stride,
+                               int /*channel_offset*/,
+                               float a,
+                               float k_2)
+{
+	for(int y = rect[1]; y < rect[3]; y++) {
+		for(int x = rect[0]; x < rect[2]; x++) {
+			float cdiff = weight_image[y*stride + x] - weight_image[(y+dy)*stride + (x+dx)];
+			float pvar = variance_image[y*stride + x];
+			float qvar = variance_image[(y+dy)*stride + (x+dx)];
+			difference_image[y*stride + x] = (cdiff*cdiff - a*(pvar + min(pvar, qvar))) / (1e-8f + k_2*(pvar+qvar));
+		}
+	}
+}
+
+void reference_blur(float *difference_image, float *out_image, int *rect, int stride, int f)
+{
+	for(int y = rect[1]; y < rect[3]; y++) {
+		const int low = max(rect[1], y-f);
+		const int high = min(rect[3], y+f+1);
+		for(int x = rect[0]; x < rect[2]; x++) {
+			float sum = 0.0f;
+			for(int y1 = low; y1 < high; y1++) {
+				sum += difference_image[y1*stride + x];
+			}
+			out_image[y*stride + x] = sum * (1.0f/(high - low));
+		}
+	}
+}
+
+float reference_window_average(const float *row, int x, int *rect, int f)
+{
+	const int low = max(rect[0], x-f);
+	const int high = min(rect[2], x+f+1);
+	float sum = 0.0f;
+	for(int x1 = low; x1 < high; x1++) {
+		sum += row[x1];
+	}
+	return sum * (1.0f/(high - low));
+}
+
+void reference_calc_weight(float *difference_image, float *out_image, int *rect, int stride, int f)
+{
+	for(int y = rect[1]; y < rect[3]; y++) {
+		for(int x = rect[0]; x < rect[2]; x++) {
+			float average = reference_window_average(difference_image + y*stride, x, rect, f);
+			out_image[y*stride + x] = expf(-max(average, 0.0f));
+		}
+	}
+}
+
+void reference_update_output(int dx, int dy,
+                             float *difference_image,
+                             float *image,
+                             float *out_image,
+                             float *accum_image,
+                             int *rect,
+                             int stride,
+                             int f)
+{
+	for(int y = rect[1]; y < rect[3]; y++) {
+		for(int x = rect[0]; x < rect[2]; x++) {
+			float weight = reference_window_average(difference_image + y*stride, x, rect, f);
+			accum_image[y*stride + x] += weight;
+			out_image[y*stride + x] += weight*image[(y+dy)*stride + (x+dx)];
+		}
+	}
+}
+
+void reference_normalize(float *out_image, float *accum_image, int *rect, int stride)
+{
+	for(int y = rect[1]; y < rect[3]; y++) {
+		for(int x = rect[0]; x < rect[2]; x++) {
+			out_image[y*stride + x] /= accum_image[y*stride + x];
+		}
+	}
+}
+
+const NLMFunctions reference_functions = {
+	"reference",
+	reference_calc_difference,
+	reference_blur,
+	reference_calc_weight,
+	reference_update_output,
+	reference_normalize,
+};
+
+/* Run the filter on the image, returns the time per run in seconds. */
+double nlm_time(const NLMFunctions& functions, NLMImages& images, int r, int f, int num_iterations)
+{
+	double start_time = time_dt();
+	for(int i = 0; i < num_iterations; i++) {
+		nlm_filter(functions, images, r, f, 1.0f, 0.25f);
+	}
+	return (time_dt() - start_time) / num_iterations;
+}
+
+}  // namespace
+
+TEST(filter_nlm, match_reference)
+{
+	const NLMFunctions functions = nlm_functions();
+
+	/* Sizes which are not a multiple of four, for the border pixels. */
+	const int params[][2] = {{2, 2}, {4, 2}, {6, 3}};
+	for(int i = 0; i < 3; i++) {
+		const int r = params[i][0], f = params[i][1];
+		NLMImages expected(67, 45), result(67, 45);
+
+		nlm_filter(reference_functions, expected, r, f, 1.0f, 0.25f);
+		nlm_filter(functions, result, r, f, 1.0f, 0.25f);
+
+		for(int y = 0; y < expected.h; y++) {
+			for(int x = 0; x < expected.w; x++) {
+				const float value = expected.out[y*expected.stride + x];
+				ASSERT_NEAR(result.out[y*result.stride + x], value, 1e-4f * fabsf(value) + 1e-5f)
+				        << "r " << r << " f " << f << " pixel " << x << ", " << y;
+			}
+		}
+	}
+}
+
+/* Only reports timings, run with --gtest_also_run_disabled_tests. */
+TEST(filter_nlm, DISABLED_benchmark)
+{
+	const NLMFunctions functions = nlm_functions();
+	NLMImages images(256, 256);
+
+	/* Parameters of the shadow feature prefilter. */
+	const double reference_time = nlm_time(reference_functions, images, 6, 3, 2);
+	const double time = nlm_time(functions, images, 6, 3, 4);
+
+	printf("Denoise NLM 256x256 (%s): reference %.2f ms, optimized %.2f ms, %.2fx\n",
+	       functions.name,
+	       reference_time * 1e3,
+	       time * 1e3,
+	       reference_time / max(time, 1e-9));
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,166 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "render/light_tree.h"
+
+#include "util/util_math.h"
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+/* Check that the cone contains the direction, with some tolerance for the
+ * rotation of the axis. */
+bool cone_contains(const LightTreeCone& cone, const float3& dir)
+{
+	return safe_acosf(dot(cone.axis, dir)) <= cone.theta_o + 1e-4f;
+}
+
+LightTreePrimitive make_prim(const float3& P, float size, const LightTreeCone& cone, int index)
+{
+	LightTreePrimitive prim;
+	prim.bounds = BoundBox(P - make_float3(size, size, size), P + make_float3(size, size, size));
+	prim.cone = cone;
+	prim.energy = 1.0f + (index % 3);
+	prim.distribution_index = index;
+	return prim;
+}
+
+/* Validate the node layout used by the kernel, returns the number of leaves
+ * below the node. */
+int check_subtree(const LightTree& tree, int index, float *energy)
+{
+	const KernelLightTreeNode& knode = tree.nodes[index];
+
+	if(knode.child < 0) {
+		EXPECT_EQ(tree.leaves[~knode.child], index);
+		*energy = knode.energy;
+		return 1;
+	}
+
+	EXPECT_EQ(tree.nodes[knode.child].parent, index);
+	EXPECT_EQ(tree.nodes[knode.child + 1].parent, index);
+
+	float energy0, energy1;
+	int num_leaves = check_subtree(tree, knode.child, &energy0) +
+	                 check_subtree(tree, knode.child + 1, &energy1);
+
+	if(knode.num_infinite == 0) {
+		EXPECT_NEAR(knode.energy, energy0 + energy1, 1e-3f*knode.energy);
+
+		for(int child = knode.child; child < knode.child + 2; child++) {
+			for(int i = 0; i < 3; i++) {
+				EXPECT_LE(knode.bbox_min[i], tree.nodes[child].bbox_min[i]);
+				EXPECT_GE(knode.bbox_max[i], tree.nodes[child].bbox_max[i]);
+			}
+		}
+	}
+
+	*energy = knode.energy;
+	return num_leaves;
+}
+
+}  // namespace
+
+TEST(render_light_tree, cone_merge)
+{
+	const float3 x = make_float3(1.0f, 0.0f, 0.0f);
+	const float3 y = make_float3(0.0f, 1.0f, 0.0f);
+
+	LightTreeCone a(x, 0.1f, 0.0f);
+	LightTreeCone b(y, 0.2f, M_PI_2_F);
+
+	LightTreeCone merged = LightTreeCone::merge(a, b);
+	EXPECT_TRUE(cone_contains(merged, x));
+	EXPECT_TRUE(cone_contains(merged, y));
+	EXPECT_NEAR(merged.theta_o, 0.5f*(0.1f + M_PI_2_F + 0.2f), 1e-5f);
+	EXPECT_EQ(merged.theta_e, M_PI_2_F);
+
+	/* Empty cones do not affect the result. */
+	LightTreeCone empty;
+	EXPECT_TRUE(empty.is_empty());
+	EXPECT_EQ(LightTreeCone::merge(empty, a).theta_o, a.theta_o);
+
+	/* Cones inside the other one. */
+	LightTreeCone wide(x, 1.0f, 0.0f);
+	EXPECT_EQ(LightTreeCone::merge(a, wide).theta_o, 1.0f);
+
+	/* Opposite directions cover everything. */
+	LightTreeCone opposite(-x, 0.1f, 0.0f);
+	EXPECT_EQ(LightTreeCone::merge(a, opposite).theta_o, M_PI_F);
+}
+
+TEST(render_light_tree, build)
+{
+	vector<LightTreePrimitive> prims;
+	vector<int> infinite;
+
+	/* A grid of emitters with different orientations, and a few infinite
+	 * lights interleaved in the distribution. */
+	const int num_distribution = 1000;
+	for(int i = 0; i < num_distribution; i++) {
+		if(i % 100 == 7) {
+			infinite.push_back(i);
+			continue;
+		}
+
+		float3 P = make_float3((float)(i % 10), (float)((i / 10) % 10), (float)(i / 100));
+		LightTreeCone cone = (i % 2)? LightTreeCone::omnidirectional():
+		                              LightTreeCone(make_float3(0.0f, 0.0f, 1.0f), 0.0f, M_PI_2_F);
+		prims.push_back(make_prim(P, 0.1f, cone, i));
+	}
+
+	LightTree tree;
+	tree.build(prims, infinite, num_distribution);
+
+	ASSERT_GT(tree.nodes.size(), 0);
+	EXPECT_EQ(tree.nodes[0].parent, -1);
+	EXPECT_EQ(tree.nodes[0].num_infinite, infinite.size());
+
+	/* Infinite lights and the rest of the tree below the root. */
+	EXPECT_EQ(tree.nodes[tree.nodes[0].child].num_infinite, infinite.size());
+	EXPECT_EQ(tree.nodes[tree.nodes[0].child + 1].num_infinite, 0);
+
+	float energy;
+	EXPECT_EQ(check_subtree(tree, 0, &energy), num_distribution);
+	EXPECT_EQ(tree.stats.num_leaves, num_distribution);
+	EXPECT_EQ(tree.stats.num_nodes, 2*num_distribution - 1);
+
+	for(int i = 0; i < num_distribution; i++) {
+		EXPECT_NE(tree.leaves[i], LIGHT_TREE_NONE);
+	}
+}
+
+TEST(render_light_tree, coincident_emitters)
+{
+	/* Emitters in the same place can not be split spatially. */
+	vector<LightTreePrimitive> prims;
+	for(int i = 0; i < 100; i++) {
+		prims.push_back(make_prim(make_float3(1.0f, 2.0f, 3.0f), 0.0f, LightTreeCone::omnidirectional(), i));
+	}
+
+	LightTree tree;
+	tree.build(prims, vector<int>(), 101);
+
+	float energy;
+	EXPECT_EQ(check_subtree(tree, 0, &energy), 100);
+	EXPECT_LE(tree.stats.max_depth, 7);
+	EXPECT_EQ(tree.leaves[100], LIGHT_TREE_NONE);
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,302 @@
+/*
+ * Copyright 2011-2018 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "device/device.h"
+
+#include "render/graph.h"
+#include "render/image.h"
+#include "render/nodes.h"
+#include "render/scene.h"
+#include "render/shader.h"
+#include "render/svm.h"
+
+#include "kernel/kernel.h"
+#include "kernel/kernel_compat_cpu.h"
+#include "kernel/kernel_math.h"
+#include "kernel/kernel_types.h"
+#include "kernel/split/kernel_split_data.h"
+#include "kernel/kernel_globals.h"
+#include "kernel/kernels/cpu/kernel_cpu_image.h"
+#include "kernel/kernel_path.h"
+
+#include "util/util_foreach.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+const int image_size = 8;
+const int num_prims = 64;
+
+/* Compile and evaluate the same surface shader with and without batched
+ * constants and fused UV image lookups, on a single object with an UV per
+ * face and a float image passed as builtin image. */
+class RenderSVMFusion : public testing::Test {
+protected:
+	Stats stats;
+	DeviceInfo device_info;
+	Device *device_cpu;
+	SceneParams scene_params;
+	Scene *scene;
+
+	KernelGlobals *kg;
+	array<float4> pixels;
+	array<TextureInfo> texture_info;
+	array<KernelObject> objects;
+	array<uint4> attributes_map;
+	array<float4> attributes_float3;
+	array<uint> tri_patch;
+
+	virtual void SetUp()
+	{
+		device_cpu = Device::create(device_info, stats, true);
+		scene = new Scene(scene_params, device_cpu);
+		scene->image_manager->builtin_image_info_cb = function_bind(&RenderSVMFusion::image_info,
+		                                                            this,
+		                                                            _1, _2, _3);
+
+		for(int i = 0; i < image_size * image_size; i++) {
+			pixels.push_back_slow(make_float4((i % image_size) * 0.1f,
+			                                  (i / image_size) * 0.05f,
+			                                  0.25f + (i % 3) * 0.2f,
+			                                  1.0f));
+		}
+
+		/* UVs outside of 0..1 and on texel centers and borders. */
+		for(int i = 0; i < num_prims; i++) {
+			attributes_float3.push_back_slow(make_float4(i * 0.037f - 0.3f,
+			                                             (i % 7) * 0.19f,
+			                                             0.0f,
+			                                             0.0f));
+			tri_patch.push_back_slow(~0);
+		}
+
+		kg = new KernelGlobals();
+
+		KernelData data;
+		memset(&data, 0, sizeof(data));
+		kernel_const_copy(kg, "__data", &data, sizeof(data));
+	}
+
+	virtual void TearDown()
+	{
+		delete kg;
+		delete scene;
+		delete device_cpu;
+	}
+
+	void image_info(const string& /*filename*/, void * /*data*/, ImageMetaData& metadata)
+	{
+		metadata.is_float = true;
+		metadata.channels = 4;
+		metadata.width = image_size;
+		metadata.height = image_size;
+		metadata.depth = 1;
+	}
+
+	/* Texture and attributes of the slot and attributes ids the shaders were
+	 * compiled with. */
+	void setup_kernel_data(int slot, const vector<uint>& uv_ids)
+	{
+		TextureInfo info;
+		memset(&info, 0, sizeof(info));
+		info.data = (uint64_t)pixels.data();
+		info.interpolation = INTERPOLATION_LINEAR;
+		info.extension = EXTENSION_REPEAT;
+		info.width = image_size;
+		info.height = image_size;
+		info.depth = 1;
+		texture_info.resize(slot + 1);
+		texture_info[slot] = info;
+
+		KernelObject object;
+		memset(&object, 0, sizeof(object));
+		object.attribute_map_offset = 0;
+		objects.push_back_slow(object);
+
+		/* All UV maps use the same per face data. */
+		foreach(uint id, uv_ids) {
+			for(int i = 0; i < ATTR_PRIM_TYPES; i++) {
+				attributes_map.push_back_slow(make_uint4(id, ATTR_ELEMENT_FACE, 0, NODE_ATTR_FLOAT3));
+			}
+		}
+		for(int i = 0; i < ATTR_PRIM_TYPES; i++) {
+			attributes_map.push_back_slow(make_uint4(ATTR_STD_NONE, 0, 0, 0));
+		}
+
+		kernel_tex_copy(kg, "__texture_info", texture_info.data(), texture_info.size());
+		kernel_tex_copy(kg, "__objects", objects.data(), objects.size());
+		kernel_tex_copy(kg, "__attributes_map", attributes_map.data(), attributes_map.size());
+		kernel_tex_copy(kg, "__attributes_float3", attributes_float3.data(), attributes_float3.size());
+		kernel_tex_copy(kg, "__tri_patch", tri_patch.data(), tri_patch.size());
+	}
+
+	/* Image texture with the given texture coordinate node, mixed with a
+	 * constant color and used for both emission and diffuse, so most inputs
+	 * are constants loaded onto the stack. */
+	Shader *create_shader(ShaderNode *texco, const char *uv_output)
+	{
+		ShaderGraph *graph = new ShaderGraph();
+
+		ImageTextureNode *image = new ImageTextureNode();
+		image->builtin_data = (void*)this;
+		image->filename = ustring("fusion_test_image");
+		MixNode *mix = new MixNode();
+		mix->type = NODE_MIX_MUL;
+		mix->fac = 0.7f;
+		mix->color2 = make_float3(0.9f, 0.4f, 0.6f);
+		EmissionNode *emission = new EmissionNode();
+		emission->strength = 2.5f;
+		DiffuseBsdfNode *diffuse = new DiffuseBsdfNode();
+		diffuse->roughness = 0.3f;
+		AddClosureNode *add = new AddClosureNode();
+
+		graph->add(texco);
+		graph->add(image);
+		graph->add(mix);
+		graph->add(emission);
+		graph->add(diffuse);
+		graph->add(add);
+
+		graph->connect(texco->output(uv_output), image->input("Vector"));
+		graph->connect(image->output("Color"), mix->input("Color1"));
+		graph->connect(mix->output("Color"), emission->input("Color"));
+		graph->connect(mix->output("Color"), diffuse->input("Color"));
+		graph->connect(emission->output("Emission"), add->input("Closure1"));
+		graph->connect(diffuse->output("BSDF"), add->input("Closure2"));
+		graph->connect(add->output("Closure"), graph->output()->input("Surface"));
+
+		Shader *shader = new Shader();
+		shader->set_graph(graph);
+		shader->used = true;
+		scene->shaders.push_back(shader);
+		return shader;
+	}
+
+	/* Returns the number of instructions the kernel executes. */
+	int compile(Shader *shader, bool use_node_fusion, array<int4>& svm_nodes)
+	{
+		SVMCompiler compiler(scene->shader_manager, scene->image_manager);
+		SVMCompiler::Summary summary;
+		compiler.use_node_fusion = use_node_fusion;
+		svm_nodes.push_back_slow(make_int4(NODE_SHADER_JUMP, 0, 0, 0));
+		compiler.compile(scene, shader, svm_nodes, 0, &summary);
+		return summary.num_svm_instructions;
+	}
+
+	static bool has_node(const array<int4>& svm_nodes, ShaderNodeType type)
+	{
+		/* Also visits data nodes, their first component is a float constant
+		 * or the node type here, which never matches the types tested. */
+		for(size_t i = 1; i < svm_nodes.size(); i++) {
+			if(svm_nodes[i].x == type) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void eval(const array<int4>& svm_nodes, int prim, ShaderData *sd)
+	{
+		kernel_tex_copy(kg, "__svm_nodes", (void*)svm_nodes.data(), svm_nodes.size());
+
+		memset(sd, 0, sizeof(ShaderData));
+		sd->shader = 0;
+		sd->object = 0;
+		sd->prim = prim;
+		sd->type = PRIMITIVE_TRIANGLE;
+		sd->lamp = LAMP_NONE;
+		sd->N = make_float3(0.0f, 0.0f, 1.0f);
+		sd->Ng = sd->N;
+		sd->I = sd->N;
+		sd->num_closure_left = MAX_CLOSURE;
+
+		PathState state;
+		memset(&state, 0, sizeof(state));
+
+		svm_eval_nodes(kg, sd, &state, SHADER_TYPE_SURFACE, PATH_RAY_CAMERA);
+	}
+
+	void expect_same_result(Shader *fused, Shader *unfused)
+	{
+		array<int4> fused_nodes, unfused_nodes;
+		int fused_instructions = compile(fused, true, fused_nodes);
+		int unfused_instructions = compile(unfused, false, unfused_nodes);
+
+		EXPECT_TRUE(has_node(fused_nodes, NODE_VALUES));
+		EXPECT_TRUE(has_node(fused_nodes, NODE_TEX_IMAGE_UV));
+		EXPECT_FALSE(has_node(unfused_nodes, NODE_VALUES));
+		EXPECT_FALSE(has_node(unfused_nodes, NODE_TEX_IMAGE_UV));
+		EXPECT_LT(fused_instructions, unfused_instructions);
+
+		ImageTextureNode *image = NULL;
+		foreach(ShaderNode *node, fused->graph->nodes) {
+			if(node->type == ImageTextureNode::node_type) {
+				image = (ImageTextureNode*)node;
+			}
+		}
+		ASSERT_TRUE(image != NULL);
+		ASSERT_GE(image->slot, 0);
+
+		vector<uint> uv_ids;
+		uv_ids.push_back(scene->shader_manager->get_attribute_id(ATTR_STD_UV));
+		uv_ids.push_back(scene->shader_manager->get_attribute_id(ustring("UVMap")));
+		setup_kernel_data(image->slot, uv_ids);
+
+		for(int prim = 0; prim < num_prims; prim++) {
+			ShaderData fused_sd, unfused_sd;
+			eval(fused_nodes, prim, &fused_sd);
+			eval(unfused_nodes, prim, &unfused_sd);
+
+			EXPECT_TRUE(fused_sd.flag & SD_EMISSION);
+			EXPECT_EQ(fused_sd.flag, unfused_sd.flag);
+			EXPECT_EQ(fused_sd.closure_emission_background.x, unfused_sd.closure_emission_background.x);
+			EXPECT_EQ(fused_sd.closure_emission_background.y, unfused_sd.closure_emission_background.y);
+			EXPECT_EQ(fused_sd.closure_emission_background.z, unfused_sd.closure_emission_background.z);
+
+			ASSERT_EQ(fused_sd.num_closure, 1);
+			ASSERT_EQ(unfused_sd.num_closure, 1);
+			EXPECT_EQ(fused_sd.closure[0].type, unfused_sd.closure[0].type);
+			EXPECT_EQ(fused_sd.closure[0].weight.x, unfused_sd.closure[0].weight.x);
+			EXPECT_EQ(fused_sd.closure[0].weight.y, unfused_sd.closure[0].weight.y);
+			EXPECT_EQ(fused_sd.closure[0].weight.z, unfused_sd.closure[0].weight.z);
+		}
+	}
+};
+
+}  // namespace
+
+TEST_F(RenderSVMFusion, texture_coordinate_uv)
+{
+	expect_same_result(create_shader(new TextureCoordinateNode(), "UV"),
+	                   create_shader(new TextureCoordinateNode(), "UV"));
+}
+
+TEST_F(RenderSVMFusion, uv_map)
+{
+	UVMapNode *fused_uv = new UVMapNode();
+	fused_uv->attribute = ustring("UVMap");
+	UVMapNode *unfused_uv = new UVMapNode();
+	unfused_uv->attribute = ustring("UVMap");
+
+	expect_same_result(create_shader(fused_uv, "UV"),
+	                   create_shader(unfused_uv, "UV"));
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,131 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "render/tile.h"
+
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+/* Final render tile manager as used for background renders on the CPU. */
+TileManager *create_tile_manager(int width, int height, int tile_size, int num_threads)
+{
+	TileManager *tile_manager = new TileManager(false, 1, make_int2(tile_size, tile_size), INT_MAX,
+	                                            false, true, TILE_BOTTOM_TO_TOP);
+	tile_manager->set_num_threads(num_threads);
+
+	BufferParams params;
+	params.width = params.full_width = width;
+	params.height = params.full_height = height;
+	tile_manager->reset(params, 1);
+	tile_manager->next();
+
+	return tile_manager;
+}
+
+/* Acquire tiles round robin from all threads until every thread ran dry,
+ * returns how often each pixel got rendered. */
+vector<int> render_all_tiles(TileManager *tile_manager, int num_threads)
+{
+	const BufferParams& params = tile_manager->params;
+	vector<int> coverage(params.width * params.height, 0);
+	vector<bool> thread_done(num_threads, false);
+	int num_done = 0;
+
+	while(num_done < num_threads) {
+		for(int thread = 0; thread < num_threads; thread++) {
+			if(thread_done[thread]) {
+				continue;
+			}
+
+			Tile *tile;
+			if(!tile_manager->next_tile(tile, 0, thread)) {
+				thread_done[thread] = true;
+				num_done++;
+				continue;
+			}
+
+			for(int y = tile->y; y < tile->y + tile->h; y++) {
+				for(int x = tile->x; x < tile->x + tile->w; x++) {
+					coverage[y * params.width + x]++;
+				}
+			}
+
+			bool delete_tile;
+			tile_manager->finish_tile(tile->index, delete_tile);
+		}
+	}
+
+	return coverage;
+}
+
+}  // namespace
+
+TEST(render_tile, work_stealing_covers_image)
+{
+	TileManager *tile_manager = create_tile_manager(300, 200, 64, 4);
+	vector<int> coverage = render_all_tiles(tile_manager, 4);
+
+	for(size_t i = 0; i < coverage.size(); i++) {
+		ASSERT_EQ(coverage[i], 1);
+	}
+	EXPECT_EQ(tile_manager->state.num_tiles, (int)tile_manager->state.tiles.size());
+
+	delete tile_manager;
+}
+
+TEST(render_tile, work_stealing_splits_tail)
+{
+	/* A single tile would leave all but one thread idle. */
+	TileManager *tile_manager = create_tile_manager(256, 256, 256, 8);
+	vector<int> coverage = render_all_tiles(tile_manager, 8);
+
+	for(size_t i = 0; i < coverage.size(); i++) {
+		ASSERT_EQ(coverage[i], 1);
+	}
+	EXPECT_GE(tile_manager->stats.num_split_tiles, 7);
+	EXPECT_GT(tile_manager->stats.num_stolen_tiles, 0);
+
+	delete tile_manager;
+}
+
+TEST(render_tile, no_splitting_with_denoising)
+{
+	TileManager *tile_manager = new TileManager(false, 1, make_int2(256, 256), INT_MAX,
+	                                            false, true, TILE_BOTTOM_TO_TOP);
+	tile_manager->set_num_threads(8);
+	tile_manager->schedule_denoising = true;
+
+	BufferParams params;
+	params.width = params.full_width = 256;
+	params.height = params.full_height = 256;
+	tile_manager->reset(params, 1);
+	tile_manager->next();
+
+	Tile *tile;
+	ASSERT_TRUE(tile_manager->next_tile(tile, 0, 0));
+	EXPECT_EQ(tile->w, 256);
+	EXPECT_EQ(tile->h, 256);
+	EXPECT_EQ(tile_manager->stats.num_split_tiles, 0);
+
+	delete tile_manager;
+}
+
+CCL_NAMESPACE_END
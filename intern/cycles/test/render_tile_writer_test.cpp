@@ -0,0 +1,144 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include <OpenImageIO/filesystem.h>
+
+#include "device/device.h"
+
+#include "render/buffers.h"
+#include "render/tile_writer.h"
+
+#include "util/util_image.h"
+#include "util/util_path.h"
+#include "util/util_stats.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+/* Combined pass value encoding the pixel position in the full image. */
+float4 pixel_value(int x, int y)
+{
+	return make_float4((float)x, (float)y, 0.5f, 1.0f);
+}
+
+/* Render tile with its own buffers, as used for background renders. */
+RenderTile make_tile(Device *device, const BufferParams& params, int x, int y, int w, int h)
+{
+	BufferParams tile_params = params;
+	tile_params.full_x = x;
+	tile_params.full_y = y;
+	tile_params.width = w;
+	tile_params.height = h;
+
+	RenderBuffers *buffers = new RenderBuffers(device);
+	buffers->reset(tile_params);
+
+	int pass_stride = tile_params.get_passes_size();
+	float *data = buffers->buffer.data();
+	for(int j = 0; j < h; j++) {
+		for(int i = 0; i < w; i++) {
+			float4 value = pixel_value(x + i, y + j);
+			float *pixel = data + (j * w + i) * pass_stride;
+			pixel[0] = value.x;
+			pixel[1] = value.y;
+			pixel[2] = value.z;
+			pixel[3] = value.w;
+		}
+	}
+	buffers->buffer.copy_to_device();
+
+	RenderTile rtile;
+	rtile.x = x;
+	rtile.y = y;
+	rtile.w = w;
+	rtile.h = h;
+	rtile.sample = 1;
+	rtile.buffers = buffers;
+	rtile.buffer = buffers->buffer.device_pointer;
+	return rtile;
+}
+
+}  // namespace
+
+TEST(render_tile_writer, unaligned_tiles)
+{
+	Stats stats;
+	DeviceInfo device_info;
+	Device *device = Device::create(device_info, stats, true);
+
+	BufferParams params;
+	params.width = params.full_width = 100;
+	params.height = params.full_height = 70;
+
+	string filename = path_join(OIIO::Filesystem::temp_directory_path(),
+	                            OIIO::Filesystem::unique_path() + ".exr");
+
+	/* Render tiles smaller than the file tiles and in reverse order, so file
+	 * tiles are assembled from several render tiles. */
+	TileWriter writer;
+	ASSERT_TRUE(writer.open(filename, params, make_int2(32, 32), 1.0f));
+
+	const int tile_size = 24;
+	for(int y = params.height - 1; y >= 0; y -= tile_size) {
+		int y0 = max(y - tile_size + 1, 0);
+		for(int x = 0; x < params.width; x += tile_size) {
+			RenderTile rtile = make_tile(device, params, x, y0,
+			                             min(tile_size, params.width - x),
+			                             y - y0 + 1);
+			EXPECT_TRUE(writer.write_tile(rtile));
+			delete rtile.buffers;
+		}
+	}
+
+	ASSERT_TRUE(writer.close());
+	EXPECT_EQ(writer.stats.num_written_tiles, 4 * 3);
+	EXPECT_EQ(writer.stats.num_missing_tiles, 0);
+
+	/* Read back, file is stored top to bottom. */
+	ImageInput *in = ImageInput::open(filename);
+	ASSERT_TRUE(in != NULL);
+
+	const ImageSpec& spec = in->spec();
+	ASSERT_EQ(spec.width, params.width);
+	ASSERT_EQ(spec.height, params.height);
+	ASSERT_EQ(spec.nchannels, 4);
+	EXPECT_EQ(spec.tile_width, 32);
+	EXPECT_EQ(spec.channelnames[0], "RenderLayer.Combined.R");
+
+	vector<float> pixels(params.width * params.height * 4);
+	ASSERT_TRUE(in->read_image(TypeDesc::FLOAT, &pixels[0]));
+	in->close();
+	delete in;
+
+	for(int y = 0; y < params.height; y++) {
+		for(int x = 0; x < params.width; x++) {
+			float4 expected = pixel_value(x, params.height - 1 - y);
+			const float *pixel = &pixels[(y * params.width + x) * 4];
+			ASSERT_EQ(pixel[0], expected.x);
+			ASSERT_EQ(pixel[1], expected.y);
+		}
+	}
+
+	string error;
+	OIIO::Filesystem::remove(filename, error);
+	delete device;
+}
+
+CCL_NAMESPACE_END
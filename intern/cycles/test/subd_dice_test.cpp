@@ -0,0 +1,123 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "subd/subd_cache.h"
+#include "subd/subd_dice.h"
+#include "subd/subd_patch.h"
+#include "subd/subd_split.h"
+
+#include "util/util_math.h"
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+/* Unit square in the XY plane. */
+void make_square_patch(LinearQuadPatch *patch)
+{
+	patch->hull[0] = make_float3(0.0f, 0.0f, 0.0f);
+	patch->hull[1] = make_float3(1.0f, 0.0f, 0.0f);
+	patch->hull[2] = make_float3(0.0f, 1.0f, 0.0f);
+	patch->hull[3] = make_float3(1.0f, 1.0f, 0.0f);
+
+	for(int i = 0; i < 4; i++) {
+		patch->normals[i] = make_float3(0.0f, 0.0f, 1.0f);
+	}
+
+	patch->patch_index = 0;
+	patch->shader = 0;
+}
+
+SubdParams make_params(float dicing_rate)
+{
+	SubdParams params(NULL);
+	params.dicing_rate = dicing_rate;
+	return params;
+}
+
+}  // namespace
+
+TEST(subd_dice, grid)
+{
+	LinearQuadPatch patch;
+	make_square_patch(&patch);
+
+	DiagSplit split(make_params(0.1f));
+	split.split_quad(&patch);
+	ASSERT_GT(split.subpatches_quad.size(), 0);
+
+	DicedGrid grid;
+	split.dice(&grid);
+
+	EXPECT_EQ(grid.P.size(), grid.N.size());
+	EXPECT_EQ(grid.P.size(), grid.uv.size());
+	ASSERT_GT(grid.num_triangles(), 0);
+
+	/* Triangles cover the square exactly once. */
+	float area = 0.0f;
+	for(size_t t = 0; t < grid.num_triangles(); t++) {
+		int v[3];
+		for(int k = 0; k < 3; k++) {
+			v[k] = grid.triangles[t*3 + k];
+			ASSERT_GE(v[k], 0);
+			ASSERT_LT(v[k], (int)grid.num_verts());
+		}
+		area += triangle_area(grid.P[v[0]], grid.P[v[1]], grid.P[v[2]]);
+	}
+	EXPECT_NEAR(area, 1.0f, 1e-4f);
+
+	/* Vertices are evaluated at their patch coordinates. */
+	for(size_t i = 0; i < grid.num_verts(); i++) {
+		EXPECT_NEAR(grid.P[i].x, grid.uv[i].x, 1e-6f);
+		EXPECT_NEAR(grid.P[i].y, grid.uv[i].y, 1e-6f);
+	}
+}
+
+TEST(subd_cache, update)
+{
+	LinearQuadPatch patch;
+	make_square_patch(&patch);
+
+	SubdCache cache;
+	cache.begin("a", 1);
+
+	/* First tessellation dices. */
+	DiagSplit split(make_params(0.1f));
+	split.split_quad(&patch);
+	EXPECT_FALSE(cache.update(0, split));
+	split.dice(&cache.grid(0));
+	const size_t num_verts = cache.grid(0).num_verts();
+
+	/* Same split reuses the grid. */
+	cache.begin("a", 1);
+	EXPECT_TRUE(cache.update(0, split));
+	EXPECT_EQ(cache.grid(0).num_verts(), num_verts);
+
+	/* Different edge factors dice again. */
+	DiagSplit coarse_split(make_params(0.5f));
+	coarse_split.split_quad(&patch);
+	EXPECT_FALSE(cache.update(0, coarse_split));
+	EXPECT_EQ(cache.grid(0).num_verts(), 0);
+	coarse_split.dice(&cache.grid(0));
+
+	/* Changed control mesh dices again. */
+	cache.begin("b", 1);
+	EXPECT_FALSE(cache.update(0, coarse_split));
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,63 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "util/util_math.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* ******** Tests for octahedral normal encoding ******** */
+
+TEST(util_math_oct16, axes)
+{
+	const float3 axes[6] = {make_float3(1.0f, 0.0f, 0.0f),
+	                        make_float3(-1.0f, 0.0f, 0.0f),
+	                        make_float3(0.0f, 1.0f, 0.0f),
+	                        make_float3(0.0f, -1.0f, 0.0f),
+	                        make_float3(0.0f, 0.0f, 1.0f),
+	                        make_float3(0.0f, 0.0f, -1.0f)};
+
+	for(int i = 0; i < 6; i++) {
+		const float3 n = oct16_to_float3(float3_to_oct16(axes[i]));
+		EXPECT_NEAR(dot(n, axes[i]), 1.0f, 1e-6f);
+	}
+}
+
+TEST(util_math_oct16, round_trip)
+{
+	/* Directions spread over the sphere, including the folded hemisphere. */
+	float max_angle = 0.0f;
+	for(int i = 0; i < 64; i++) {
+		for(int j = 0; j < 128; j++) {
+			const float theta = (i + 0.5f) * M_PI_F / 64.0f;
+			const float phi = j * M_2PI_F / 128.0f;
+			const float3 n = make_float3(sinf(theta) * cosf(phi),
+			                             sinf(theta) * sinf(phi),
+			                             cosf(theta));
+
+			const float3 decoded = oct16_to_float3(float3_to_oct16(n));
+			EXPECT_NEAR(len(decoded), 1.0f, 1e-5f);
+			/* Sine of the angle, acos is too imprecise close to one. */
+			max_angle = max(max_angle, len(cross(n, decoded)));
+		}
+	}
+
+	/* Well below a hundredth of a degree. */
+	EXPECT_LT(max_angle, 1e-4f);
+}
+
+CCL_NAMESPACE_END
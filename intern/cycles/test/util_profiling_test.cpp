@@ -0,0 +1,81 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "util/util_profiling.h"
+#include "util/util_time.h"
+
+CCL_NAMESPACE_BEGIN
+
+TEST(util_profiling, samples_current_state)
+{
+	Profiler profiler;
+	profiler.reset(4, 2);
+
+	ProfilingState state;
+	profiler.add_state(&state);
+	profiler.start();
+
+	{
+		ProfilingHelper helper(&state, PROFILING_SHADER_EVAL);
+		helper.set_shader(1);
+		helper.set_object(0);
+		time_sleep(0.1);
+	}
+	EXPECT_EQ(state.event, PROFILING_UNKNOWN);
+
+	profiler.stop();
+	profiler.remove_state(&state);
+
+	/* Sleeping may overshoot, but the state was sampled at least once. */
+	EXPECT_GT(profiler.get_event(PROFILING_SHADER_EVAL), 0);
+	EXPECT_EQ(profiler.get_event(PROFILING_INTERSECT), 0);
+
+	uint64_t samples, hits;
+	ASSERT_TRUE(profiler.get_shader(1, samples, hits));
+	EXPECT_GT(samples, 0);
+	EXPECT_EQ(hits, 1);
+	EXPECT_FALSE(profiler.get_shader(0, samples, hits));
+
+	ASSERT_TRUE(profiler.get_object(0, samples, hits));
+	EXPECT_EQ(hits, 1);
+	EXPECT_FALSE(profiler.get_object(1, samples, hits));
+}
+
+TEST(util_profiling, ignores_removed_state)
+{
+	Profiler profiler;
+	profiler.reset(1, 1);
+
+	ProfilingState state;
+	profiler.add_state(&state);
+	profiler.remove_state(&state);
+
+	profiler.start();
+	{
+		ProfilingHelper helper(&state, PROFILING_SHADER_EVAL);
+		helper.set_shader(0);
+		time_sleep(0.02);
+	}
+	profiler.stop();
+
+	uint64_t samples, hits;
+	EXPECT_EQ(profiler.get_event(PROFILING_SHADER_EVAL), 0);
+	EXPECT_FALSE(profiler.get_shader(0, samples, hits));
+}
+
+CCL_NAMESPACE_END
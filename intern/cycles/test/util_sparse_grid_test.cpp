@@ -0,0 +1,162 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "util/util_sparse_grid.h"
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+/* Dense grid with two small blobs of density, everything else is empty. */
+void make_dense_grid(int width, int height, int depth, vector<float> *voxels)
+{
+	voxels->clear();
+	voxels->resize(((size_t)width)*height*depth, 0.0f);
+
+	for(int z = 0; z < depth; z++) {
+		for(int y = 0; y < height; y++) {
+			for(int x = 0; x < width; x++) {
+				float value = 0.0f;
+				if(x < 5 && y < 5 && z < 5) {
+					value = 0.5f;
+				}
+				else if(x >= 30 && y >= 12 && z >= 20) {
+					value = 0.01f * (x + y + z);
+				}
+				(*voxels)[((size_t)z*height + y)*width + x] = value;
+			}
+		}
+	}
+}
+
+}  // namespace
+
+TEST(util_sparse_grid, build)
+{
+	/* Not a multiple of the brick size, to test the border bricks. */
+	const int width = 37, height = 19, depth = 27;
+	vector<float> voxels;
+	make_dense_grid(width, height, depth, &voxels);
+
+	SparseGrid grid;
+	const size_t num_active = grid.build(&voxels[0], width, height, depth);
+
+	EXPECT_EQ(grid.bricks_x, 5);
+	EXPECT_EQ(grid.bricks_y, 3);
+	EXPECT_EQ(grid.bricks_z, 4);
+	EXPECT_EQ(grid.num_bricks(), 5*3*4);
+	EXPECT_EQ(grid.tiles_x, 2);
+	EXPECT_EQ(grid.tiles_y, 1);
+	EXPECT_EQ(grid.tiles_z, 1);
+
+	/* One brick for the first blob, bricks x 3..4, y 1..2, z 2..3 for the
+	 * second one. */
+	EXPECT_EQ(num_active, 1 + 2*2*2);
+	EXPECT_EQ(grid.num_active_bricks(), num_active);
+
+	EXPECT_EQ(grid.brick_max(0, 0, 0), 0.5f);
+	EXPECT_EQ(grid.brick_max(1, 0, 0), 0.0f);
+	EXPECT_FLOAT_EQ(grid.brick_max(4, 2, 3), 0.01f * (36 + 18 + 26));
+	/* First tile also covers the start of the second blob. */
+	EXPECT_FLOAT_EQ(grid.tile_max(0, 0, 0), 0.01f * (31 + 18 + 26));
+	EXPECT_FLOAT_EQ(grid.tile_max(1, 0, 0), 0.01f * (36 + 18 + 26));
+}
+
+TEST(util_sparse_grid, lookup)
+{
+	const int width = 37, height = 19, depth = 27;
+	vector<float> voxels;
+	make_dense_grid(width, height, depth, &voxels);
+
+	SparseGrid grid;
+	grid.build(&voxels[0], width, height, depth);
+
+	vector<float> packed(grid.num_active_bricks() * SparseGrid::BRICK_VOXELS);
+	grid.pack(&voxels[0], &packed[0]);
+
+	/* Every voxel must read back the same, with no data for empty bricks. */
+	for(int z = 0; z < depth; z++) {
+		for(int y = 0; y < height; y++) {
+			for(int x = 0; x < width; x++) {
+				const float value = voxels[((size_t)z*height + y)*width + x];
+				const float *voxel = grid.voxel(&packed[0], x, y, z);
+
+				if(voxel) {
+					EXPECT_EQ(*voxel, value);
+				}
+				else {
+					EXPECT_EQ(value, 0.0f);
+				}
+			}
+		}
+	}
+
+	EXPECT_TRUE(grid.voxel(&packed[0], 20, 10, 10) == NULL);
+}
+
+TEST(util_sparse_grid, build_slab)
+{
+	const int width = 37, height = 19, depth = 27;
+	vector<float> voxels;
+	make_dense_grid(width, height, depth, &voxels);
+
+	SparseGrid dense_grid;
+	dense_grid.build(&voxels[0], width, height, depth);
+	vector<float> dense_packed(dense_grid.num_active_bricks() * SparseGrid::BRICK_VOXELS);
+	dense_grid.pack(&voxels[0], &dense_packed[0]);
+
+	/* Only one layer of bricks is passed at a time. */
+	SparseGrid grid;
+	array<float> packed;
+	grid.reset(width, height, depth);
+	for(int bz = 0; bz < grid.bricks_z; bz++) {
+		const int z0 = bz * SparseGrid::BRICK_SIZE;
+		const int z1 = min(z0 + SparseGrid::BRICK_SIZE, depth);
+		vector<float> slab(voxels.begin() + (size_t)z0 * height * width,
+		                   voxels.begin() + (size_t)z1 * height * width);
+		grid.build_slab(&slab[0], bz, packed);
+	}
+	grid.build_tiles();
+
+	EXPECT_EQ(grid.num_active_bricks(), dense_grid.num_active_bricks());
+	ASSERT_EQ(packed.size(), dense_packed.size());
+	for(size_t i = 0; i < packed.size(); i++) {
+		EXPECT_EQ(packed[i], dense_packed[i]);
+	}
+	EXPECT_EQ(grid.tile_max(0, 0, 0), dense_grid.tile_max(0, 0, 0));
+	EXPECT_EQ(grid.tile_max(1, 0, 0), dense_grid.tile_max(1, 0, 0));
+
+	/* Unpacking gives back the dense voxels. */
+	vector<float> unpacked(voxels.size(), -1.0f);
+	grid.unpack(packed.data(), &unpacked[0]);
+	for(size_t i = 0; i < voxels.size(); i++) {
+		EXPECT_EQ(unpacked[i], voxels[i]);
+	}
+}
+
+TEST(util_sparse_grid, empty)
+{
+	vector<float> voxels(16*16*16, 0.0f);
+
+	SparseGrid grid;
+	EXPECT_EQ(grid.build(&voxels[0], 16, 16, 16), 0);
+	EXPECT_EQ(grid.tile_max(0, 0, 0), 0.0f);
+	EXPECT_TRUE(grid.voxel((const float*)NULL, 15, 15, 15) == NULL);
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,201 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include <OpenImageIO/filesystem.h>
+
+#include "util/util_image.h"
+#include "util/util_path.h"
+#include "util/util_texture_cache.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+/* Write float RGBA image, with pixel values encoding their position in the
+ * file, which is stored top to bottom. */
+string write_test_image(int width, int height)
+{
+	string filename = path_join(OIIO::Filesystem::temp_directory_path(),
+	                            OIIO::Filesystem::unique_path() + ".tif");
+
+	vector<float> pixels((size_t)width * height * 4);
+	for(int y = 0; y < height; y++) {
+		for(int x = 0; x < width; x++) {
+			float *pixel = &pixels[((size_t)y * width + x) * 4];
+			pixel[0] = (float)x;
+			pixel[1] = (float)y;
+			pixel[2] = 0.5f;
+			pixel[3] = 1.0f;
+		}
+	}
+
+	ImageOutput *out = ImageOutput::create(filename);
+	if(!out) {
+		return "";
+	}
+	ImageSpec spec(width, height, 4, TypeDesc::FLOAT);
+	if(!out->open(filename, spec) ||
+	   !out->write_image(TypeDesc::FLOAT, &pixels[0]))
+	{
+		delete out;
+		return "";
+	}
+	out->close();
+	delete out;
+
+	return filename;
+}
+
+void remove_test_image(const string& filename)
+{
+	string error;
+	OIIO::Filesystem::remove(filename, error);
+}
+
+}  /* namespace */
+
+TEST(util_texture_cache, fetch)
+{
+	const int width = 300, height = 200;
+	string filename = write_test_image(width, height);
+	ASSERT_NE(filename, "");
+
+	TextureCache cache(64 * 1024 * 1024);
+	TextureCache::Image *image = cache.add_image(filename,
+	                                             IMAGE_DATA_TYPE_FLOAT4,
+	                                             true,
+	                                             0);
+	ASSERT_TRUE(image != NULL);
+	EXPECT_EQ(image->width, width);
+	EXPECT_EQ(image->height, height);
+
+	/* Images are stored bottom to top on the device. */
+	for(int y = 0; y < height; y += 7) {
+		for(int x = 0; x < width; x += 11) {
+			float4 texel = image->fetch<float4>(x, y);
+			EXPECT_EQ(texel.x, (float)x);
+			EXPECT_EQ(texel.y, (float)(height - 1 - y));
+			EXPECT_EQ(texel.z, 0.5f);
+			EXPECT_EQ(texel.w, 1.0f);
+		}
+	}
+
+	cache.remove_image(image);
+	remove_test_image(filename);
+}
+
+TEST(util_texture_cache, eviction)
+{
+	/* 16 MB of float texels, with a budget of 4 MB. */
+	const int width = 1024, height = 1024;
+	string filename = write_test_image(width, height);
+	ASSERT_NE(filename, "");
+
+	TextureCache cache(4 * 1024 * 1024);
+	TextureCache::Image *image = cache.add_image(filename,
+	                                             IMAGE_DATA_TYPE_FLOAT4,
+	                                             true,
+	                                             0);
+	ASSERT_TRUE(image != NULL);
+
+	for(int pass = 0; pass < 2; pass++) {
+		for(int y = 0; y < height; y += 13) {
+			for(int x = 0; x < width; x += 17) {
+				float4 texel = image->fetch<float4>(x, y);
+				EXPECT_EQ(texel.x, (float)x);
+				EXPECT_EQ(texel.y, (float)(height - 1 - y));
+			}
+		}
+	}
+
+	TextureCache::Stats stats;
+	cache.get_stats(&stats);
+	EXPECT_LE(stats.mem_peak, cache.memory_budget());
+	EXPECT_GT(stats.tiles_evicted, 0);
+	EXPECT_EQ(stats.tiles_loaded, stats.tiles_evicted + stats.tiles_resident);
+
+	cache.remove_image(image);
+	remove_test_image(filename);
+}
+
+TEST(util_texture_cache, texture_limit_mip_level)
+{
+	const int width = 256, height = 128;
+	string filename = write_test_image(width, height);
+	ASSERT_NE(filename, "");
+
+	TextureCache cache(64 * 1024 * 1024);
+	TextureCache::Image *image = cache.add_image(filename,
+	                                             IMAGE_DATA_TYPE_FLOAT4,
+	                                             true,
+	                                             64);
+	ASSERT_TRUE(image != NULL);
+	EXPECT_EQ(image->width, 64);
+	EXPECT_EQ(image->height, 32);
+
+	/* Box filtered from 4x4 texels of the finest level. */
+	for(int y = 0; y < image->height; y += 3) {
+		for(int x = 0; x < image->width; x += 5) {
+			float4 texel = image->fetch<float4>(x, y);
+			EXPECT_FLOAT_EQ(texel.x, x * 4 + 1.5f);
+			EXPECT_FLOAT_EQ(texel.y, (height - 1 - y * 4) - 1.5f);
+			EXPECT_FLOAT_EQ(texel.z, 0.5f);
+		}
+	}
+
+	cache.remove_image(image);
+	remove_test_image(filename);
+}
+
+TEST(util_texture_cache, coarse_mip_level)
+{
+	/* Coarse levels are filtered level by level through the cache, which
+	 * must work with a budget much smaller than the finest level. */
+	const int width = 1024, height = 512;
+	string filename = write_test_image(width, height);
+	ASSERT_NE(filename, "");
+
+	TextureCache cache(4 * 1024 * 1024);
+	TextureCache::Image *image = cache.add_image(filename,
+	                                             IMAGE_DATA_TYPE_FLOAT4,
+	                                             true,
+	                                             4);
+	ASSERT_TRUE(image != NULL);
+	EXPECT_EQ(image->width, 4);
+	EXPECT_EQ(image->height, 2);
+
+	/* Box filtered from 256x256 texels of the finest level. */
+	for(int y = 0; y < image->height; y++) {
+		for(int x = 0; x < image->width; x++) {
+			float4 texel = image->fetch<float4>(x, y);
+			EXPECT_FLOAT_EQ(texel.x, x * 256 + 127.5f);
+			EXPECT_FLOAT_EQ(texel.y, (height - 1 - y * 256) - 127.5f);
+			EXPECT_FLOAT_EQ(texel.z, 0.5f);
+		}
+	}
+
+	TextureCache::Stats stats;
+	cache.get_stats(&stats);
+	EXPECT_LE(stats.mem_peak, cache.memory_budget());
+
+	cache.remove_image(image);
+	remove_test_image(filename);
+}
+
+CCL_NAMESPACE_END
@@ -73,6 +73,8 @@ struct avxf
 		m256 = _mm256_insertf128_ps(foo, b, 1);
 	}
 
+	__forceinline const float& operator [](const size_t i) const { assert(i < 8); return f[i]; }
+	__forceinline       float& operator [](const size_t i)       { assert(i < 8); return f[i]; }
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -107,6 +109,18 @@ __forceinline const avxf operator^(const avxf& a, const avxf& b) { return _mm256
 
 __forceinline const avxf operator&(const avxf& a, const avxf& b) { return _mm256_and_ps(a.m256,b.m256); }
 
+__forceinline const avxf max(const avxf& a, const avxf& b) { return _mm256_max_ps(a.m256, b.m256); }
+__forceinline const avxf min(const avxf& a, const avxf& b) { return _mm256_min_ps(a.m256, b.m256); }
+
+////////////////////////////////////////////////////////////////////////////////
+/// Comparison Operators
+////////////////////////////////////////////////////////////////////////////////
+
+__forceinline const avxb operator <=(const avxf& a, const avxf& b) { return _mm256_cmp_ps(a.m256, b.m256, _CMP_LE_OS); }
+__forceinline const avxb operator < (const avxf& a, const avxf& b) { return _mm256_cmp_ps(a.m256, b.m256, _CMP_LT_OS); }
+__forceinline const avxb operator >=(const avxf& a, const avxf& b) { return _mm256_cmp_ps(a.m256, b.m256, _CMP_NLT_US); }
+__forceinline const avxb operator > (const avxf& a, const avxf& b) { return _mm256_cmp_ps(a.m256, b.m256, _CMP_NLE_US); }
+
 ////////////////////////////////////////////////////////////////////////////////
 /// Movement/Shifting/Shuffling Functions
 ////////////////////////////////////////////////////////////////////////////////
@@ -178,6 +192,14 @@ __forceinline const avxf nmadd(const avxf& a, const avxf& b, const avxf& c) {
 	return c-(a*b);
 #endif
 }
+
+__forceinline const avxf msub(const avxf& a, const avxf& b, const avxf& c) {
+#ifdef __KERNEL_AVX2__
+	return _mm256_fmsub_ps(a, b, c);
+#else
+	return (a*b) - c;
+#endif
+}
 #endif
 
 #ifndef _mm256_set_m128
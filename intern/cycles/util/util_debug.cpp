@@ -32,7 +32,10 @@ DebugFlags::CPU::CPU()
     sse3(true),
     sse2(true),
     bvh_layout(BVH_LAYOUT_DEFAULT),
-    split_kernel(false)
+    split_kernel(false),
+    packet_traversal(false),
+    numa_pinning(false),
+    numa_replication(false)
 {
 	reset();
 }
@@ -59,6 +62,9 @@ void DebugFlags::CPU::reset()
 
 	bvh_layout = BVH_LAYOUT_DEFAULT;
 	split_kernel = false;
+	packet_traversal = false;
+	numa_pinning = (getenv("CYCLES_CPU_NUMA_PINNING") != NULL);
+	numa_replication = (getenv("CYCLES_CPU_NUMA_REPLICATION") != NULL);
 }
 
 DebugFlags::CUDA::CUDA()
@@ -147,7 +153,10 @@ std::ostream& operator <<(std::ostream &os,
 	   << "  SSE3       : " << string_from_bool(debug_flags.cpu.sse3) << "\n"
 	   << "  SSE2       : " << string_from_bool(debug_flags.cpu.sse2) << "\n"
 	   << "  BVH layout : " << bvh_layout_name(debug_flags.cpu.bvh_layout) << "\n"
-	   << "  Split      : " << string_from_bool(debug_flags.cpu.split_kernel) << "\n";
+	   << "  Split      : " << string_from_bool(debug_flags.cpu.split_kernel) << "\n"
+	   << "  Packets    : " << string_from_bool(debug_flags.cpu.packet_traversal) << "\n"
+	   << "  NUMA pins  : " << string_from_bool(debug_flags.cpu.numa_pinning) << "\n"
+	   << "  NUMA copies: " << string_from_bool(debug_flags.cpu.numa_replication) << "\n";
 
 	os << "CUDA flags:\n"
 	   << " Adaptive Compile: " << string_from_bool(debug_flags.cuda.adaptive_compile) << "\n";
@@ -56,6 +56,10 @@ public:
 		bool has_sse3()  { return has_sse2()  && sse3; }
 		bool has_sse2()  { return sse2; }
 
+		/* Replicated scene data is only local to threads which stay on the
+		 * node they copied it to, so replication implies pinning. */
+		bool use_numa_pinning() { return numa_pinning || numa_replication; }
+
 		/* Requested BVH size.
 		 *
 		 * Rendering will use widest possible BVH which is below or equal
@@ -65,6 +69,15 @@ public:
 
 		/* Whether split kernel is used */
 		bool split_kernel;
+
+		/* Whether camera rays are traced in packets */
+		bool packet_traversal;
+
+		/* Whether worker threads are pinned to NUMA nodes */
+		bool numa_pinning;
+
+		/* Whether scene data is copied to each NUMA node */
+		bool numa_replication;
 	};
 
 	/* Descriptor of CUDA feature-set to be used. */
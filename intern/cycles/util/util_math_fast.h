@@ -438,6 +438,34 @@ ccl_device_inline float fast_expf(float x)
 	return fast_exp2f(x / M_LN2_F);
 }
 
+#ifndef __KERNEL_GPU__
+/* Four values at once, same results as fast_exp2f() and fast_expf(). */
+ccl_device_inline float4 fast_exp2f4(float4 x)
+{
+#ifdef __KERNEL_SSE__
+	x = min(max(x, make_float4(-126.0f)), make_float4(126.0f));
+	const __m128i m = _mm_cvttps_epi32(x);
+	x = x - float4(_mm_cvtepi32_ps(m));
+	x = make_float4(1.0f) - (make_float4(1.0f) - x);
+	float4 r = make_float4(1.33336498402e-3f);
+	r = x * r + make_float4(9.810352697968e-3f);
+	r = x * r + make_float4(5.551834031939e-2f);
+	r = x * r + make_float4(0.2401793301105f);
+	r = x * r + make_float4(0.693144857883f);
+	r = x * r + make_float4(1.0f);
+	return float4(_mm_castsi128_ps(_mm_add_epi32(_mm_castps_si128(r),
+	                                             _mm_slli_epi32(m, 23))));
+#else
+	return make_float4(fast_exp2f(x.x), fast_exp2f(x.y), fast_exp2f(x.z), fast_exp2f(x.w));
+#endif
+}
+
+ccl_device_inline float4 fast_expf4(const float4& x)
+{
+	return fast_exp2f4(x / make_float4(M_LN2_F));
+}
+#endif  /* __KERNEL_GPU__ */
+
 ccl_device_inline float fast_exp10(float x)
 {
 	/* Examined 2217701018 values of exp10 on [-37.9290009,37.9290009]:
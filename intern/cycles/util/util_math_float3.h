@@ -390,6 +390,43 @@ ccl_device_inline float3 ensure_finite3(float3 v)
 	return v;
 }
 
+/* Octahedral encoding of unit vectors, projecting them onto an octahedron
+ * which is unfolded into a square, with 16 bits per coordinate. */
+
+ccl_device_inline uint float3_to_oct16(float3 n)
+{
+	const float inv_len = 1.0f / max(fabsf(n.x) + fabsf(n.y) + fabsf(n.z), 1e-20f);
+	float u = n.x * inv_len;
+	float v = n.y * inv_len;
+
+	if(n.z < 0.0f) {
+		const float fold_u = (1.0f - fabsf(v)) * ((u >= 0.0f)? 1.0f: -1.0f);
+		const float fold_v = (1.0f - fabsf(u)) * ((v >= 0.0f)? 1.0f: -1.0f);
+		u = fold_u;
+		v = fold_v;
+	}
+
+	const uint qu = (uint)(clamp(u * 0.5f + 0.5f, 0.0f, 1.0f) * 65535.0f + 0.5f);
+	const uint qv = (uint)(clamp(v * 0.5f + 0.5f, 0.0f, 1.0f) * 65535.0f + 0.5f);
+	return qu | (qv << 16);
+}
+
+ccl_device_inline float3 oct16_to_float3(uint packed)
+{
+	float u = (float)(packed & 0xFFFF) * (2.0f / 65535.0f) - 1.0f;
+	float v = (float)(packed >> 16) * (2.0f / 65535.0f) - 1.0f;
+	const float z = 1.0f - fabsf(u) - fabsf(v);
+
+	if(z < 0.0f) {
+		const float fold_u = (1.0f - fabsf(v)) * ((u >= 0.0f)? 1.0f: -1.0f);
+		const float fold_v = (1.0f - fabsf(u)) * ((v >= 0.0f)? 1.0f: -1.0f);
+		u = fold_u;
+		v = fold_v;
+	}
+
+	return normalize(make_float3(u, v, z));
+}
+
 CCL_NAMESPACE_END
 
 #endif /* __UTIL_MATH_FLOAT3_H__ */
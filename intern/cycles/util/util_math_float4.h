@@ -441,6 +441,18 @@ ccl_device_inline float4 load_float4(const float *v)
 #endif
 }
 
+ccl_device_inline void store_float4(float *v, const float4& a)
+{
+#ifdef __KERNEL_SSE__
+	_mm_storeu_ps(v, a);
+#else
+	v[0] = a.x;
+	v[1] = a.y;
+	v[2] = a.z;
+	v[3] = a.w;
+#endif
+}
+
 #endif  /* !__KERNEL_GPU__ */
 
 CCL_NAMESPACE_END
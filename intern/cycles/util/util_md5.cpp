@@ -387,5 +387,18 @@ string util_md5_string(const string& str)
 	return md5.get_hex();
 }
 
+void md5_append_data(MD5Hash& md5, const void *data, size_t size)
+{
+	const uint8_t *bytes = (const uint8_t*)data;
+	const size_t chunk_size = 1 << 30;
+
+	while(size > 0) {
+		const size_t chunk = (size < chunk_size)? size: chunk_size;
+		md5.append(bytes, (int)chunk);
+		bytes += chunk;
+		size -= chunk;
+	}
+}
+
 CCL_NAMESPACE_END
 
@@ -32,6 +32,7 @@
 
 #include "util/util_string.h"
 #include "util/util_types.h"
+#include "util/util_vector.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -56,6 +57,26 @@ protected:
 
 string util_md5_string(const string& str);
 
+/* Hashing of binary data, for cache keys. Sizes are appended along with
+ * arrays so that different splits of the same data hash differently. */
+
+void md5_append_data(MD5Hash& md5, const void *data, size_t size);
+
+template<typename T>
+inline void md5_append_value(MD5Hash& md5, const T& value)
+{
+	md5_append_data(md5, &value, sizeof(T));
+}
+
+template<typename T>
+inline void md5_append_array(MD5Hash& md5, const array<T>& data)
+{
+	md5_append_value(md5, data.size());
+	if(data.size()) {
+		md5_append_data(md5, data.data(), data.size() * sizeof(T));
+	}
+}
+
 CCL_NAMESPACE_END
 
 #endif /* __UTIL_MD5_H__ */
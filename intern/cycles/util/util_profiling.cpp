@@ -0,0 +1,233 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "util/util_algorithm.h"
+#include "util/util_foreach.h"
+#include "util/util_function.h"
+#include "util/util_profiling.h"
+#include "util/util_time.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Interval between two samples, in seconds. */
+static const double PROFILING_INTERVAL = 0.001;
+
+Profiler::Profiler()
+: do_stop_worker(true),
+  worker(NULL)
+{
+	event_samples.resize(PROFILING_NUM_EVENTS, 0);
+}
+
+Profiler::~Profiler()
+{
+	stop();
+}
+
+void Profiler::run()
+{
+	double last_time = time_dt();
+	while(!do_stop_worker) {
+		{
+			thread_scoped_lock lock(mutex);
+			foreach(ProfilingState *state, states) {
+				uint32_t cur_event = state->event;
+				int32_t cur_shader = state->shader;
+				int32_t cur_object = state->object;
+
+				if(cur_event < PROFILING_NUM_EVENTS) {
+					event_samples[cur_event]++;
+				}
+
+				if(cur_shader >= 0 && cur_shader < (int)shader_samples.size()) {
+					shader_samples[cur_shader]++;
+				}
+
+				if(cur_object >= 0 && cur_object < (int)object_samples.size()) {
+					object_samples[cur_object]++;
+				}
+			}
+		}
+
+		/* Sleep until the next sample is due, keeping the average rate
+		 * stable even when the sleep overshoots. */
+		last_time += PROFILING_INTERVAL;
+		double delay = last_time - time_dt();
+		if(delay > 0.0) {
+			time_sleep(delay);
+		}
+		else {
+			last_time = time_dt();
+		}
+	}
+}
+
+void Profiler::reset(int num_shaders, int num_objects)
+{
+	bool running = (worker != NULL);
+	if(running) {
+		stop();
+	}
+
+	/* Resize and clear the counters. */
+	event_samples.clear();
+	event_samples.resize(PROFILING_NUM_EVENTS, 0);
+
+	shader_samples.clear();
+	shader_samples.resize(num_shaders, 0);
+	shader_hits.clear();
+	shader_hits.resize(num_shaders, 0);
+
+	object_samples.clear();
+	object_samples.resize(num_objects, 0);
+	object_hits.clear();
+	object_hits.resize(num_objects, 0);
+
+	/* Also reset the states of threads that are still registered. */
+	thread_scoped_lock lock(mutex);
+	foreach(ProfilingState *state, states) {
+		state->shader_hits.clear();
+		state->shader_hits.resize(num_shaders, 0);
+		state->object_hits.clear();
+		state->object_hits.resize(num_objects, 0);
+	}
+	lock.unlock();
+
+	if(running) {
+		start();
+	}
+}
+
+void Profiler::start()
+{
+	assert(worker == NULL);
+	do_stop_worker = false;
+	worker = new thread(function_bind(&Profiler::run, this));
+}
+
+void Profiler::stop()
+{
+	if(worker != NULL) {
+		do_stop_worker = true;
+
+		worker->join();
+		delete worker;
+		worker = NULL;
+	}
+}
+
+void Profiler::add_state(ProfilingState *state)
+{
+	thread_scoped_lock lock(mutex);
+
+	/* Add the ProfilingState to the list of sampled states. */
+	assert(std::find(states.begin(), states.end(), state) == states.end());
+	states.push_back(state);
+
+	/* Resize thread-local hit counters. */
+	state->shader_hits.clear();
+	state->shader_hits.resize(shader_samples.size(), 0);
+	state->object_hits.clear();
+	state->object_hits.resize(object_samples.size(), 0);
+
+	/* Initialize the state. */
+	state->event = PROFILING_UNKNOWN;
+	state->shader = -1;
+	state->object = -1;
+	state->active = true;
+}
+
+void Profiler::remove_state(ProfilingState *state)
+{
+	thread_scoped_lock lock(mutex);
+
+	/* Remove the ProfilingState from the list of sampled states. */
+	states.erase(std::remove(states.begin(), states.end(), state), states.end());
+	state->active = false;
+
+	/* Merge thread-local hit counters. */
+	assert(shader_hits.size() == state->shader_hits.size());
+	for(size_t i = 0; i < shader_hits.size(); i++) {
+		shader_hits[i] += state->shader_hits[i];
+	}
+
+	assert(object_hits.size() == state->object_hits.size());
+	for(size_t i = 0; i < object_hits.size(); i++) {
+		object_hits[i] += state->object_hits[i];
+	}
+}
+
+uint64_t Profiler::get_event(ProfilingEvent event)
+{
+	assert(worker == NULL);
+	return event_samples[event];
+}
+
+bool Profiler::get_shader(int shader, uint64_t &samples, uint64_t &hits)
+{
+	assert(worker == NULL);
+	if(shader_samples[shader] == 0) {
+		return false;
+	}
+	samples = shader_samples[shader];
+	hits = shader_hits[shader];
+	return true;
+}
+
+bool Profiler::get_object(int object, uint64_t &samples, uint64_t &hits)
+{
+	assert(worker == NULL);
+	if(object_samples[object] == 0) {
+		return false;
+	}
+	samples = object_samples[object];
+	hits = object_hits[object];
+	return true;
+}
+
+const char *Profiler::event_name(ProfilingEvent event)
+{
+	switch(event) {
+		case PROFILING_UNKNOWN: return "Unknown";
+		case PROFILING_RAY_SETUP: return "Ray setup";
+		case PROFILING_PATH_INTEGRATE: return "Path integration";
+		case PROFILING_SCENE_INTERSECT: return "Scene intersection";
+		case PROFILING_INDIRECT_EMISSION: return "Indirect emission";
+		case PROFILING_VOLUME: return "Volumes";
+		case PROFILING_SHADER_SETUP: return "Shader setup";
+		case PROFILING_SHADER_EVAL: return "Shader eval";
+		case PROFILING_SHADER_APPLY: return "Shader apply";
+		case PROFILING_AO: return "Ambient occlusion";
+		case PROFILING_SUBSURFACE: return "Subsurface";
+		case PROFILING_CONNECT_LIGHT: return "Connect light";
+		case PROFILING_SURFACE_BOUNCE: return "Surface bounce";
+		case PROFILING_WRITE_RESULT: return "Write result";
+		case PROFILING_INTERSECT: return "Intersect closest";
+		case PROFILING_INTERSECT_LOCAL: return "Intersect local";
+		case PROFILING_INTERSECT_SHADOW_ALL: return "Intersect shadow all";
+		case PROFILING_INTERSECT_VOLUME: return "Intersect volume";
+		case PROFILING_INTERSECT_VOLUME_ALL: return "Intersect volume all";
+		case PROFILING_CLOSURE_EVAL: return "Closure eval";
+		case PROFILING_CLOSURE_SAMPLE: return "Closure sample";
+		case PROFILING_CLOSURE_VOLUME_EVAL: return "Closure volume eval";
+		case PROFILING_CLOSURE_VOLUME_SAMPLE: return "Closure volume sample";
+		case PROFILING_LIGHT_SAMPLE: return "Light sample";
+		case PROFILING_NUM_EVENTS: break;
+	}
+	return "";
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,173 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __UTIL_PROFILING_H__
+#define __UTIL_PROFILING_H__
+
+#include <assert.h>
+
+#include "util/util_thread.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Note: keep in sync with the names in Profiler::event_name(). */
+enum ProfilingEvent {
+	PROFILING_UNKNOWN = 0,
+	PROFILING_RAY_SETUP,
+	PROFILING_PATH_INTEGRATE,
+	PROFILING_SCENE_INTERSECT,
+	PROFILING_INDIRECT_EMISSION,
+	PROFILING_VOLUME,
+	PROFILING_SHADER_SETUP,
+	PROFILING_SHADER_EVAL,
+	PROFILING_SHADER_APPLY,
+	PROFILING_AO,
+	PROFILING_SUBSURFACE,
+	PROFILING_CONNECT_LIGHT,
+	PROFILING_SURFACE_BOUNCE,
+	PROFILING_WRITE_RESULT,
+
+	PROFILING_INTERSECT,
+	PROFILING_INTERSECT_LOCAL,
+	PROFILING_INTERSECT_SHADOW_ALL,
+	PROFILING_INTERSECT_VOLUME,
+	PROFILING_INTERSECT_VOLUME_ALL,
+
+	PROFILING_CLOSURE_EVAL,
+	PROFILING_CLOSURE_SAMPLE,
+	PROFILING_CLOSURE_VOLUME_EVAL,
+	PROFILING_CLOSURE_VOLUME_SAMPLE,
+
+	PROFILING_LIGHT_SAMPLE,
+
+	PROFILING_NUM_EVENTS,
+};
+
+/* Current state of a render thread, written by the thread while it renders
+ * and read by the profiler thread which periodically samples it.
+ *
+ * No atomics are used: the render thread only writes aligned 32 bit values,
+ * and at worst the profiler reads a stale value for a single sample. */
+struct ProfilingState {
+	ProfilingState()
+	: event(PROFILING_UNKNOWN),
+	  shader(-1),
+	  object(-1),
+	  active(false) {}
+
+	volatile uint32_t event;
+	volatile int32_t shader;
+	volatile int32_t object;
+	volatile bool active;
+
+	/* Number of times the thread set up shading for each shader or object,
+	 * only counted while the state is registered with a profiler. */
+	vector<uint64_t> shader_hits;
+	vector<uint64_t> object_hits;
+};
+
+/* Sampling profiler of render threads.
+ *
+ * While running, a worker thread wakes up every millisecond and counts the
+ * event, shader and object every registered render thread is in. Sample
+ * counts are therefore approximately milliseconds of thread time. */
+class Profiler {
+public:
+	Profiler();
+	~Profiler();
+
+	/* Clear counters, sized for the shaders and objects of the scene. */
+	void reset(int num_shaders, int num_objects);
+
+	void start();
+	void stop();
+
+	void add_state(ProfilingState *state);
+	void remove_state(ProfilingState *state);
+
+	uint64_t get_event(ProfilingEvent event);
+	bool get_shader(int shader, uint64_t &samples, uint64_t &hits);
+	bool get_object(int object, uint64_t &samples, uint64_t &hits);
+
+	static const char *event_name(ProfilingEvent event);
+
+protected:
+	void run();
+
+	/* Samples per event, shader and object. */
+	vector<uint64_t> event_samples;
+	vector<uint64_t> shader_samples;
+	vector<uint64_t> object_samples;
+
+	/* Hits of states that were removed already. */
+	vector<uint64_t> shader_hits;
+	vector<uint64_t> object_hits;
+
+	volatile bool do_stop_worker;
+	thread *worker;
+
+	thread_mutex mutex;
+	vector<ProfilingState*> states;
+};
+
+/* Scoped event of a render thread, restores the previous event when leaving
+ * the scope so nested code is attributed correctly. */
+class ProfilingHelper {
+public:
+	ProfilingHelper(ProfilingState *state, ProfilingEvent event)
+	: state(state)
+	{
+		previous_event = state->event;
+		state->event = event;
+	}
+
+	~ProfilingHelper()
+	{
+		state->event = previous_event;
+	}
+
+	inline void set_event(ProfilingEvent event)
+	{
+		state->event = event;
+	}
+
+	inline void set_shader(int shader)
+	{
+		state->shader = shader;
+		if(state->active) {
+			assert(shader < (int)state->shader_hits.size());
+			state->shader_hits[shader]++;
+		}
+	}
+
+	inline void set_object(int object)
+	{
+		state->object = object;
+		if(state->active) {
+			assert(object < (int)state->object_hits.size());
+			state->object_hits[object]++;
+		}
+	}
+
+private:
+	ProfilingState *state;
+	uint32_t previous_event;
+};
+
+CCL_NAMESPACE_END
+
+#endif  /* __UTIL_PROFILING_H__ */
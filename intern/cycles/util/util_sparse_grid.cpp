@@ -0,0 +1,75 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "util/util_sparse_grid.h"
+
+CCL_NAMESPACE_BEGIN
+
+SparseGrid::SparseGrid()
+: width(0), height(0), depth(0),
+  bricks_x(0), bricks_y(0), bricks_z(0),
+  tiles_x(0), tiles_y(0), tiles_z(0),
+  active_bricks(0)
+{
+}
+
+void SparseGrid::reset(int width_, int height_, int depth_)
+{
+	width = width_;
+	height = height_;
+	depth = depth_;
+
+	bricks_x = (int)divide_up(width, BRICK_SIZE);
+	bricks_y = (int)divide_up(height, BRICK_SIZE);
+	bricks_z = (int)divide_up(depth, BRICK_SIZE);
+
+	tiles_x = (int)divide_up(bricks_x, TILE_SIZE);
+	tiles_y = (int)divide_up(bricks_y, TILE_SIZE);
+	tiles_z = (int)divide_up(bricks_z, TILE_SIZE);
+
+	const size_t num_bricks = (size_t)bricks_x * bricks_y * bricks_z;
+	bricks.clear();
+	bricks.resize(num_bricks, (int)EMPTY);
+	brick_max_values.clear();
+	brick_max_values.resize(num_bricks, 0.0f);
+	active_bricks = 0;
+}
+
+void SparseGrid::build_tiles()
+{
+	tile_max_values.clear();
+	tile_max_values.resize((size_t)tiles_x * tiles_y * tiles_z, -FLT_MAX);
+
+	for(int bz = 0; bz < bricks_z; bz++) {
+		for(int by = 0; by < bricks_y; by++) {
+			for(int bx = 0; bx < bricks_x; bx++) {
+				float& tile_max_value = tile_max_values[tile_index(bx >> TILE_SIZE_LOG2,
+				                                                   by >> TILE_SIZE_LOG2,
+				                                                   bz >> TILE_SIZE_LOG2)];
+				tile_max_value = max(tile_max_value, brick_max(bx, by, bz));
+			}
+		}
+	}
+}
+
+size_t SparseGrid::memory_size() const
+{
+	return bricks.size() * sizeof(int) +
+	       brick_max_values.size() * sizeof(float) +
+	       tile_max_values.size() * sizeof(float);
+}
+
+CCL_NAMESPACE_END
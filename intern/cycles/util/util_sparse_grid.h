@@ -0,0 +1,304 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __UTIL_SPARSE_GRID_H__
+#define __UTIL_SPARSE_GRID_H__
+
+#include "util/util_half.h"
+#include "util/util_types.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Sparse voxel grid for the CPU device.
+ *
+ * Volume grids are mostly empty space, so instead of storing all voxels they
+ * are split into bricks of BRICK_SIZE^3 voxels and only bricks containing a
+ * non-zero voxel are stored, packed one after the other in a single buffer.
+ * The grid itself only holds the brick table with the offset of each brick in
+ * that buffer, the voxel data stays in device memory like any other image.
+ *
+ * On top of the bricks there is an occupancy hierarchy with the maximum voxel
+ * value per brick and per tile of TILE_SIZE^3 bricks. It lets code searching
+ * for voxels above a threshold, like the volume bounds mesh, skip large empty
+ * regions without touching any voxel data. */
+
+class SparseGrid {
+public:
+	static const int BRICK_SIZE_LOG2 = 3;
+	static const int BRICK_SIZE = (1 << BRICK_SIZE_LOG2);
+	static const int BRICK_MASK = (BRICK_SIZE - 1);
+	static const int BRICK_VOXELS = (BRICK_SIZE * BRICK_SIZE * BRICK_SIZE);
+
+	/* Tile size in bricks. */
+	static const int TILE_SIZE_LOG2 = 2;
+	static const int TILE_SIZE = (1 << TILE_SIZE_LOG2);
+
+	/* Brick table entry for bricks with only zero voxels. */
+	static const int EMPTY = -1;
+
+	SparseGrid();
+
+	/* Build brick table and occupancy from dense voxels, returns the number of
+	 * active bricks. */
+	template<typename T>
+	size_t build(const T *voxels, int width, int height, int depth);
+
+	/* Copy the active bricks from dense voxels, packed must have room for
+	 * num_active_bricks() * BRICK_VOXELS voxels. */
+	template<typename T>
+	void pack(const T *voxels, T *packed) const;
+
+	/* Build without a dense copy of the whole grid: after reset(), build each
+	 * layer of bricks in order from a slab of voxels starting at its first
+	 * slice, which appends its active bricks to packed, then build_tiles(). */
+	void reset(int width, int height, int depth);
+	template<typename T>
+	void build_slab(const T *slab, int bz, array<T>& packed);
+	void build_tiles();
+
+	/* Copy packed bricks back to dense voxels, with zeros for empty bricks. */
+	template<typename T>
+	void unpack(const T *packed, T *voxels) const;
+
+	/* Voxel lookup in packed data, coordinates must be inside the grid.
+	 * Returns NULL for voxels in empty bricks. */
+	template<typename T>
+	ccl_always_inline const T *voxel(const T *packed, int x, int y, int z) const
+	{
+		const int brick = bricks[brick_index(x >> BRICK_SIZE_LOG2,
+		                                     y >> BRICK_SIZE_LOG2,
+		                                     z >> BRICK_SIZE_LOG2)];
+		if(brick == EMPTY) {
+			return NULL;
+		}
+		return packed + (size_t)brick * BRICK_VOXELS + voxel_index(x, y, z);
+	}
+
+	ccl_always_inline int brick_index(int bx, int by, int bz) const
+	{
+		return bx + (by + bz * bricks_y) * bricks_x;
+	}
+
+	ccl_always_inline int tile_index(int tx, int ty, int tz) const
+	{
+		return tx + (ty + tz * tiles_y) * tiles_x;
+	}
+
+	/* Maximum voxel value over all channels, zero for empty bricks. */
+	float brick_max(int bx, int by, int bz) const { return brick_max_values[brick_index(bx, by, bz)]; }
+	float tile_max(int tx, int ty, int tz) const { return tile_max_values[tile_index(tx, ty, tz)]; }
+
+	size_t num_active_bricks() const { return active_bricks; }
+	size_t num_bricks() const { return bricks.size(); }
+
+	/* Memory used by the brick table and occupancy, without the voxels. */
+	size_t memory_size() const;
+
+	/* Dimensions in voxels, bricks and tiles. */
+	int width, height, depth;
+	int bricks_x, bricks_y, bricks_z;
+	int tiles_x, tiles_y, tiles_z;
+
+protected:
+	static ccl_always_inline int voxel_index(int x, int y, int z)
+	{
+		return (x & BRICK_MASK) +
+		       (((y & BRICK_MASK) + ((z & BRICK_MASK) << BRICK_SIZE_LOG2)) << BRICK_SIZE_LOG2);
+	}
+
+	static ccl_always_inline bool is_zero(const uchar *bytes, size_t size)
+	{
+		for(size_t i = 0; i < size; i++) {
+			if(bytes[i]) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	static ccl_always_inline float voxel_max(float f) { return f; }
+	static ccl_always_inline float voxel_max(float4 f) { return max(max(f.x, f.y), max(f.z, f.w)); }
+	static ccl_always_inline float voxel_max(uchar c) { return c * (1.0f/255.0f); }
+	static ccl_always_inline float voxel_max(uchar4 c) { return max(max(c.x, c.y), max(c.z, c.w)) * (1.0f/255.0f); }
+	static ccl_always_inline float voxel_max(half h) { return half_to_float(h); }
+	static ccl_always_inline float voxel_max(half4 h) { return voxel_max(half4_to_float4(h)); }
+
+	/* Brick table and occupancy of a layer of bricks. */
+	template<typename T>
+	void build_layer(const T *slab, int bz);
+
+	/* Copy voxels between a brick and a slab of dense voxels starting at
+	 * slice zbegin. */
+	template<typename T>
+	void copy_brick(const T *slab, int zbegin, int bx, int by, int bz, T *brick_voxels) const;
+	template<typename T>
+	void copy_brick_back(const T *brick_voxels, int zbegin, int bx, int by, int bz, T *slab) const;
+
+	vector<int> bricks;
+	vector<float> brick_max_values;
+	vector<float> tile_max_values;
+	size_t active_bricks;
+};
+
+template<typename T>
+size_t SparseGrid::build(const T *voxels, int width, int height, int depth)
+{
+	reset(width, height, depth);
+
+	for(int bz = 0; bz < bricks_z; bz++) {
+		build_layer(voxels + (size_t)bz * BRICK_SIZE * height * width, bz);
+	}
+
+	build_tiles();
+
+	return active_bricks;
+}
+
+template<typename T>
+void SparseGrid::build_layer(const T *slab, int bz)
+{
+	const int z0 = bz * BRICK_SIZE, z1 = min(z0 + BRICK_SIZE, depth);
+
+	for(int by = 0; by < bricks_y; by++) {
+		for(int bx = 0; bx < bricks_x; bx++) {
+			const int x0 = bx * BRICK_SIZE, x1 = min(x0 + BRICK_SIZE, width);
+			const int y0 = by * BRICK_SIZE, y1 = min(y0 + BRICK_SIZE, height);
+
+			bool empty = true;
+			float max_value = -FLT_MAX;
+
+			for(int z = z0; z < z1; z++) {
+				for(int y = y0; y < y1; y++) {
+					const T *row = slab + ((size_t)(z - z0) * height + y) * width;
+					for(int x = x0; x < x1; x++) {
+						if(empty && !is_zero((const uchar*)&row[x], sizeof(T))) {
+							empty = false;
+						}
+						max_value = max(max_value, voxel_max(row[x]));
+					}
+				}
+			}
+
+			const int index = brick_index(bx, by, bz);
+			if(empty) {
+				brick_max_values[index] = 0.0f;
+			}
+			else {
+				bricks[index] = (int)active_bricks++;
+				brick_max_values[index] = max_value;
+			}
+		}
+	}
+}
+
+template<typename T>
+void SparseGrid::build_slab(const T *slab, int bz, array<T>& packed)
+{
+	build_layer(slab, bz);
+
+	packed.resize(active_bricks * BRICK_VOXELS);
+	for(int by = 0; by < bricks_y; by++) {
+		for(int bx = 0; bx < bricks_x; bx++) {
+			const int brick = bricks[brick_index(bx, by, bz)];
+			if(brick != EMPTY) {
+				copy_brick(slab, bz * BRICK_SIZE, bx, by, bz,
+				           packed.data() + (size_t)brick * BRICK_VOXELS);
+			}
+		}
+	}
+}
+
+template<typename T>
+void SparseGrid::pack(const T *voxels, T *packed) const
+{
+	for(int bz = 0; bz < bricks_z; bz++) {
+		for(int by = 0; by < bricks_y; by++) {
+			for(int bx = 0; bx < bricks_x; bx++) {
+				const int brick = bricks[brick_index(bx, by, bz)];
+				if(brick != EMPTY) {
+					copy_brick(voxels, 0, bx, by, bz, packed + (size_t)brick * BRICK_VOXELS);
+				}
+			}
+		}
+	}
+}
+
+template<typename T>
+void SparseGrid::unpack(const T *packed, T *voxels) const
+{
+	for(int bz = 0; bz < bricks_z; bz++) {
+		for(int by = 0; by < bricks_y; by++) {
+			for(int bx = 0; bx < bricks_x; bx++) {
+				const int brick = bricks[brick_index(bx, by, bz)];
+				if(brick != EMPTY) {
+					copy_brick_back(packed + (size_t)brick * BRICK_VOXELS, 0, bx, by, bz, voxels);
+					continue;
+				}
+
+				const int x0 = bx * BRICK_SIZE, x1 = min(x0 + BRICK_SIZE, width);
+				const int y0 = by * BRICK_SIZE, y1 = min(y0 + BRICK_SIZE, height);
+				const int z0 = bz * BRICK_SIZE, z1 = min(z0 + BRICK_SIZE, depth);
+
+				for(int z = z0; z < z1; z++) {
+					for(int y = y0; y < y1; y++) {
+						memset(voxels + ((size_t)z * height + y) * width + x0, 0, sizeof(T) * (x1 - x0));
+					}
+				}
+			}
+		}
+	}
+}
+
+template<typename T>
+void SparseGrid::copy_brick(const T *slab, int zbegin, int bx, int by, int bz, T *brick_voxels) const
+{
+	/* Voxels of bricks on the border of the grid which are outside of it are
+	 * never read, but zero them for determinism. */
+	memset(brick_voxels, 0, sizeof(T) * BRICK_VOXELS);
+
+	const int x0 = bx * BRICK_SIZE, x1 = min(x0 + BRICK_SIZE, width);
+	const int y0 = by * BRICK_SIZE, y1 = min(y0 + BRICK_SIZE, height);
+	const int z0 = bz * BRICK_SIZE, z1 = min(z0 + BRICK_SIZE, depth);
+
+	for(int z = z0; z < z1; z++) {
+		for(int y = y0; y < y1; y++) {
+			memcpy(brick_voxels + voxel_index(x0, y, z),
+			       slab + ((size_t)(z - zbegin) * height + y) * width + x0,
+			       sizeof(T) * (x1 - x0));
+		}
+	}
+}
+
+template<typename T>
+void SparseGrid::copy_brick_back(const T *brick_voxels, int zbegin, int bx, int by, int bz, T *slab) const
+{
+	const int x0 = bx * BRICK_SIZE, x1 = min(x0 + BRICK_SIZE, width);
+	const int y0 = by * BRICK_SIZE, y1 = min(y0 + BRICK_SIZE, height);
+	const int z0 = bz * BRICK_SIZE, z1 = min(z0 + BRICK_SIZE, depth);
+
+	for(int z = z0; z < z1; z++) {
+		for(int y = y0; y < y1; y++) {
+			memcpy(slab + ((size_t)(z - zbegin) * height + y) * width + x0,
+			       brick_voxels + voxel_index(x0, y, z),
+			       sizeof(T) * (x1 - x0));
+		}
+	}
+}
+
+CCL_NAMESPACE_END
+
+#endif /* __UTIL_SPARSE_GRID_H__ */
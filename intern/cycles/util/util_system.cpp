@@ -16,9 +16,11 @@
 
 #include "util/util_system.h"
 
+#include "util/util_foreach.h"
 #include "util/util_logging.h"
 #include "util/util_types.h"
 #include "util/util_string.h"
+#include "util/util_vector.h"
 
 #ifdef _WIN32
 #  if(!defined(FREE_WINDOWS))
@@ -32,6 +34,13 @@
 #  include <unistd.h>
 #endif
 
+#ifdef __linux__
+#  include <pthread.h>
+#  include <sched.h>
+#  include <stdio.h>
+#  include <stdlib.h>
+#endif
+
 CCL_NAMESPACE_BEGIN
 
 int system_cpu_group_count()
@@ -104,6 +113,158 @@ unsigned short system_cpu_process_groups(unsigned short max_groups,
 #endif
 }
 
+#ifdef __linux__
+/* Parse processor or node lists like "0-7,16-23" used by sysfs. */
+static vector<int> system_parse_list(const char *list)
+{
+	vector<int> result;
+
+	while(*list) {
+		char *end;
+		int first = strtol(list, &end, 10);
+		if(end == list) {
+			break;
+		}
+		int last = first;
+		if(*end == '-') {
+			list = end + 1;
+			last = strtol(list, &end, 10);
+		}
+		for(int i = first; i <= last; i++) {
+			result.push_back(i);
+		}
+		list = (*end == ',')? end + 1: end;
+	}
+
+	return result;
+}
+
+static vector<int> system_read_list(const string& filename)
+{
+	char line[4096] = "";
+	FILE *f = fopen(filename.c_str(), "r");
+	if(f) {
+		if(!fgets(line, sizeof(line), f)) {
+			line[0] = '\0';
+		}
+		fclose(f);
+	}
+	return system_parse_list(line);
+}
+
+struct NUMATopology {
+	/* Processors of each node, limited to the process affinity so that
+	 * restrictions from taskset or cgroups are respected. */
+	vector<vector<int> > node_processors;
+	/* Node of each processor, or -1. */
+	vector<int> processor_node;
+};
+
+/* Read from sysfs rather than using libnuma, to avoid the dependency. */
+static NUMATopology system_numa_topology_detect()
+{
+	NUMATopology topology;
+
+	if(getenv("CYCLES_CPU_NO_NUMA") != NULL) {
+		VLOG(1) << "NUMA node detection disabled.";
+		return topology;
+	}
+
+	cpu_set_t process_set;
+	CPU_ZERO(&process_set);
+	if(sched_getaffinity(0, sizeof(process_set), &process_set) != 0) {
+		return topology;
+	}
+
+	vector<int> nodes = system_read_list("/sys/devices/system/node/online");
+	foreach(int node, nodes) {
+		vector<int> processors = system_read_list(string_printf(
+		        "/sys/devices/system/node/node%d/cpulist", node));
+		vector<int> available;
+		foreach(int processor, processors) {
+			if(processor < CPU_SETSIZE && CPU_ISSET(processor, &process_set)) {
+				available.push_back(processor);
+			}
+		}
+		/* Skip nodes with only memory. */
+		if(available.empty()) {
+			continue;
+		}
+		foreach(int processor, available) {
+			if(processor >= topology.processor_node.size()) {
+				topology.processor_node.resize(processor + 1, -1);
+			}
+			topology.processor_node[processor] = topology.node_processors.size();
+		}
+		VLOG(1) << "NUMA node " << node << " has " << available.size() << " processors.";
+		topology.node_processors.push_back(available);
+	}
+
+	return topology;
+}
+
+static const NUMATopology& system_numa_topology()
+{
+	static const NUMATopology topology = system_numa_topology_detect();
+	return topology;
+}
+#endif
+
+int system_cpu_num_numa_nodes()
+{
+#ifdef __linux__
+	const int num_nodes = system_numa_topology().node_processors.size();
+	return (num_nodes > 1)? num_nodes: 1;
+#else
+	return 1;
+#endif
+}
+
+int system_cpu_num_numa_node_processors(int node)
+{
+#ifdef __linux__
+	const NUMATopology& topology = system_numa_topology();
+	if(node >= 0 && node < topology.node_processors.size()) {
+		return topology.node_processors[node].size();
+	}
+#else
+	(void)node;
+#endif
+	return system_cpu_thread_count();
+}
+
+bool system_cpu_run_thread_on_numa_node(int node)
+{
+#ifdef __linux__
+	const NUMATopology& topology = system_numa_topology();
+	if(node < 0 || node >= topology.node_processors.size()) {
+		return false;
+	}
+
+	cpu_set_t node_set;
+	CPU_ZERO(&node_set);
+	foreach(int processor, topology.node_processors[node]) {
+		CPU_SET(processor, &node_set);
+	}
+	return pthread_setaffinity_np(pthread_self(), sizeof(node_set), &node_set) == 0;
+#else
+	(void)node;
+	return false;
+#endif
+}
+
+int system_cpu_current_numa_node()
+{
+#ifdef __linux__
+	const NUMATopology& topology = system_numa_topology();
+	int processor = sched_getcpu();
+	if(processor >= 0 && processor < topology.processor_node.size()) {
+		return topology.processor_node[processor];
+	}
+#endif
+	return -1;
+}
+
 #if !defined(_WIN32) || defined(FREE_WINDOWS)
 static void __cpuid(int data[4], int selector)
 {
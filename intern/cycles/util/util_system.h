@@ -34,6 +34,20 @@ int system_cpu_thread_count();
 unsigned short system_cpu_process_groups(unsigned short max_groups,
                                          unsigned short *grpups);
 
+/* Get number of NUMA nodes with processors this process can run on. Nodes
+ * are only detected on Linux, and not when CYCLES_CPU_NO_NUMA is set.
+ * Threads are only pinned to them when the numa_pinning debug flag is set. */
+int system_cpu_num_numa_nodes();
+
+/* Get number of processors in the specified NUMA node. */
+int system_cpu_num_numa_node_processors(int node);
+
+/* Restrict the calling thread to the processors of the NUMA node. */
+bool system_cpu_run_thread_on_numa_node(int node);
+
+/* Get NUMA node of the processor the calling thread runs on, or -1. */
+int system_cpu_current_numa_node();
+
 string system_cpu_brand_string();
 int system_cpu_bits();
 bool system_cpu_support_sse2();
@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include "util/util_debug.h"
 #include "util/util_foreach.h"
 #include "util/util_logging.h"
 #include "util/util_system.h"
@@ -217,6 +218,29 @@ void TaskScheduler::init(int num_threads)
 			}
 		}
 		int thread_index = 0;
+		if(num_groups == 1 &&
+		   DebugFlags().cpu.use_numa_pinning() &&
+		   system_cpu_num_numa_nodes() > 1)
+		{
+			/* Pin threads to NUMA nodes, filling one node after the other so
+			 * threads of a node share its caches and memory. Threads beyond
+			 * the number of processors are created below without affinity. */
+			const int num_nodes = system_cpu_num_numa_nodes();
+			for(int node = 0; node < num_nodes; ++node) {
+				const int num_node_threads = system_cpu_num_numa_node_processors(node);
+				for(int node_thread = 0;
+				    node_thread < num_node_threads && thread_index < threads.size();
+				    ++node_thread, ++thread_index)
+				{
+					threads[thread_index] = new thread(function_bind(&TaskScheduler::thread_run,
+					                                                 thread_index + 1),
+					                                   -1,
+					                                   node);
+				}
+			}
+			VLOG(1) << "Pinned " << thread_index << " threads to "
+			        << num_nodes << " NUMA nodes.";
+		}
 		for(int group = 0; group < num_groups; ++group) {
 			/* NOTE: That's not really efficient from threading point of view,
 			 * but it is simple to read and it doesn't make sense to use more
@@ -83,6 +83,10 @@ typedef struct TextureInfo {
 	uint interpolation, extension;
 	/* Dimensions. */
 	uint width, height, depth;
+	/* Out-of-core texture cache image on the CPU, data is unused when set. */
+	uint64_t cache;
+	/* Sparse voxel grid on the CPU, data holds the packed bricks when set. */
+	uint64_t sparse;
 } TextureInfo;
 
 CCL_NAMESPACE_END
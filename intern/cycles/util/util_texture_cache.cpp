@@ -0,0 +1,771 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "util/util_texture_cache.h"
+
+#include "util/util_aligned_malloc.h"
+#include "util/util_atomic.h"
+#include "util/util_foreach.h"
+#include "util/util_half.h"
+#include "util/util_image.h"
+#include "util/util_logging.h"
+#include "util/util_math.h"
+#include "util/util_path.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Texel conversion helpers. */
+
+template<typename T> static T texel_from_float(float f);
+
+template<> float texel_from_float<float>(float f)
+{
+	return f;
+}
+
+template<> uchar texel_from_float<uchar>(float f)
+{
+	return (uchar)(clamp(f, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+template<> half texel_from_float<half>(float f)
+{
+	return float_to_half(f);
+}
+
+static float texel_to_float(float f)
+{
+	return f;
+}
+
+static float texel_to_float(uchar f)
+{
+	return f * (1.0f/255.0f);
+}
+
+static float texel_to_float(half f)
+{
+	return half_to_float(f);
+}
+
+static bool texel_is_finite(float f)
+{
+	return isfinite(f);
+}
+
+static bool texel_is_finite(uchar /*f*/)
+{
+	return true;
+}
+
+static bool texel_is_finite(half /*f*/)
+{
+	return true;
+}
+
+template<typename T> static TypeDesc texel_format();
+
+template<> TypeDesc texel_format<float>()
+{
+	return TypeDesc::FLOAT;
+}
+
+template<> TypeDesc texel_format<uchar>()
+{
+	return TypeDesc::UINT8;
+}
+
+template<> TypeDesc texel_format<half>()
+{
+	return TypeDesc::HALF;
+}
+
+static int image_data_type_channels(ImageDataType type)
+{
+	switch(type) {
+		case IMAGE_DATA_TYPE_FLOAT4:
+		case IMAGE_DATA_TYPE_BYTE4:
+		case IMAGE_DATA_TYPE_HALF4:
+			return 4;
+		default:
+			return 1;
+	}
+}
+
+static int image_data_type_texel_size_log2(ImageDataType type)
+{
+	switch(type) {
+		case IMAGE_DATA_TYPE_FLOAT4: return 4;
+		case IMAGE_DATA_TYPE_HALF4: return 3;
+		case IMAGE_DATA_TYPE_BYTE4: return 2;
+		case IMAGE_DATA_TYPE_FLOAT: return 2;
+		case IMAGE_DATA_TYPE_HALF: return 1;
+		case IMAGE_DATA_TYPE_BYTE: return 0;
+		default:
+			assert(0);
+			return 4;
+	}
+}
+
+static ImageInput *texture_cache_open_file(const string& filename,
+                                           bool use_alpha)
+{
+	ImageInput *in = ImageInput::create(filename);
+	if(!in) {
+		return NULL;
+	}
+
+	ImageSpec spec = ImageSpec();
+	ImageSpec config = ImageSpec();
+
+	if(use_alpha == false) {
+		config.attribute("oiio:UnassociatedAlpha", 1);
+	}
+
+	if(!in->open(filename, spec, config)) {
+		delete in;
+		return NULL;
+	}
+
+	return in;
+}
+
+/* Stats */
+
+string TextureCache::Stats::full_report() const
+{
+	string report = "";
+	report += string_printf("Tiles loaded:     %s\n", string_human_readable_number(tiles_loaded).c_str());
+	report += string_printf("Tiles evicted:    %s\n", string_human_readable_number(tiles_evicted).c_str());
+	report += string_printf("Tiles resident:   %s\n", string_human_readable_number(tiles_resident).c_str());
+	report += string_printf("Memory used:      %s\n", string_human_readable_size(mem_used).c_str());
+	report += string_printf("Memory peak:      %s\n", string_human_readable_size(mem_peak).c_str());
+	report += string_printf("File bytes read:  %s\n", string_human_readable_size(file_bytes_read).c_str());
+	return report;
+}
+
+/* Texture Cache */
+
+TextureCache::TextureCache(size_t memory_budget)
+{
+	/* Always keep a few tiles, so that every thread can load one. */
+	max_tiles = max(memory_budget / TILE_BYTES, (size_t)64);
+	clock_hand = 0;
+	next_key = 1;
+	num_open_files = 0;
+
+	VLOG(1) << "Texture cache memory budget "
+	        << string_human_readable_size(memory_budget) << ".";
+}
+
+TextureCache::~TextureCache()
+{
+	foreach(Tile *tile, tiles) {
+		assert(tile->image == NULL);
+		util_aligned_free(tile->data);
+		delete tile;
+	}
+}
+
+TextureCache::Image *TextureCache::add_image(const string& filename,
+                                             ImageDataType type,
+                                             bool use_alpha,
+                                             int texture_limit)
+{
+	if(filename == "" || !path_exists(filename) || path_is_directory(filename)) {
+		return NULL;
+	}
+
+	ImageInput *in = texture_cache_open_file(filename, use_alpha);
+	if(!in) {
+		return NULL;
+	}
+
+	ImageSpec spec = in->spec();
+	const int components = spec.nchannels;
+
+	/* Volumes and images we can not convert are fully loaded instead. */
+	if(spec.depth > 1 || spec.width <= 0 || spec.height <= 0 ||
+	   !(components >= 1 && components <= 4))
+	{
+		in->close();
+		delete in;
+		return NULL;
+	}
+
+	Image *image = new Image();
+	image->cache = this;
+	image->filename = filename;
+	image->type = type;
+	image->use_alpha = use_alpha;
+	image->cmyk = strcmp(in->format_name(), "jpeg") == 0 && components == 4;
+	image->components = components;
+	image->input = NULL;
+	image->input_level = -1;
+
+	/* Tiles of all data types use the same amount of memory. */
+	const int tile_size_log2 = TILE_BYTES_LOG2 - image_data_type_texel_size_log2(type);
+	image->tile_width_log2 = (tile_size_log2 + 1) / 2;
+	image->tile_height_log2 = tile_size_log2 / 2;
+	image->tile_width_mask = (1 << image->tile_width_log2) - 1;
+	image->tile_height_mask = (1 << image->tile_height_log2) - 1;
+
+	/* Mip levels, as stored in the file as long as available. */
+	int width = spec.width;
+	int height = spec.height;
+	bool has_file_level = true;
+
+	for(int level = 0; ; level++) {
+		if(level > 0) {
+			width = max(width / 2, 1);
+			height = max(height / 2, 1);
+
+			ImageSpec level_spec;
+			has_file_level = has_file_level &&
+			                 in->seek_subimage(0, level, level_spec) &&
+			                 level_spec.width == width &&
+			                 level_spec.height == height &&
+			                 level_spec.nchannels == components;
+		}
+
+		Image::Level info;
+		info.width = width;
+		info.height = height;
+		info.tiles_x = (width + image->tile_width_mask) >> image->tile_width_log2;
+		info.tiles_y = (height + image->tile_height_mask) >> image->tile_height_log2;
+		info.file_level = (has_file_level)? level: -1;
+		info.key_offset = 0;
+
+		const size_t num_tiles = (size_t)info.tiles_x * info.tiles_y;
+		info.tiles = new Tile*[num_tiles];
+		memset((void*)info.tiles, 0, sizeof(Tile*) * num_tiles);
+
+		image->levels.push_back(info);
+
+		if(width == 1 && height == 1) {
+			break;
+		}
+	}
+
+	in->close();
+	delete in;
+
+	/* Use coarser mip level instead of scaling down the image. */
+	image->base_level = 0;
+	if(texture_limit > 0) {
+		while(image->base_level + 1 < (int)image->levels.size()) {
+			const Image::Level& level = image->levels[image->base_level];
+			if(max(level.width, level.height) <= texture_limit) {
+				break;
+			}
+			image->base_level++;
+		}
+	}
+
+	image->width = image->levels[image->base_level].width;
+	image->height = image->levels[image->base_level].height;
+
+	/* Assign unique keys to every tile of the image. */
+	{
+		thread_scoped_lock tiles_lock(tiles_mutex);
+		for(size_t i = 0; i < image->levels.size(); i++) {
+			Image::Level& level = image->levels[i];
+			level.key_offset = next_key;
+			next_key += (uint64_t)level.tiles_x * level.tiles_y;
+		}
+	}
+
+	VLOG(1) << "Texture cache added " << filename << ", "
+	        << spec.width << "x" << spec.height << ", "
+	        << image->levels.size() << " mip levels, rendering level "
+	        << image->base_level << ".";
+
+	return image;
+}
+
+void TextureCache::remove_image(Image *image)
+{
+	{
+		thread_scoped_lock tiles_lock(tiles_mutex);
+		foreach(Tile *tile, tiles) {
+			if(tile->image == image) {
+				assert(!tile->locked && tile->pins == 0);
+				tile->key = 0;
+				tile->used = 0;
+				tile->image = NULL;
+				tile->slot = NULL;
+				free_tiles.push_back(tile);
+				stats.tiles_resident--;
+			}
+		}
+	}
+
+	{
+		thread_scoped_lock image_lock(image->mutex);
+		close_input(image);
+	}
+
+	for(size_t i = 0; i < image->levels.size(); i++) {
+		delete [] image->levels[i].tiles;
+	}
+
+	delete image;
+}
+
+void TextureCache::get_stats(Stats *stats)
+{
+	thread_scoped_lock tiles_lock(tiles_mutex);
+	*stats = this->stats;
+}
+
+void TextureCache::load_tile(Image *image, int level, int index)
+{
+	const Image::Level& info = image->levels[level];
+	Tile * volatile *slot = &info.tiles[index];
+	const uint64_t key = info.key_offset + index;
+
+	Tile *resident = *slot;
+	if(resident && resident->key == key) {
+		return;
+	}
+
+	/* Generated levels are filtered from the 2x2 tiles of the next finer
+	 * level covering the same area. Pin them before taking the image lock,
+	 * since loading them might need it as well. */
+	Tile *parents[4] = {NULL, NULL, NULL, NULL};
+	if(info.file_level == -1) {
+		const Image::Level& parent = image->levels[level - 1];
+		const int tile_x = (index % info.tiles_x) * 2;
+		const int tile_y = (index / info.tiles_x) * 2;
+		for(int j = 0; j < 2; j++) {
+			for(int i = 0; i < 2; i++) {
+				if(tile_x + i < parent.tiles_x && tile_y + j < parent.tiles_y) {
+					parents[j * 2 + i] = pin_tile(image,
+					                              level - 1,
+					                              (tile_y + j) * parent.tiles_x + tile_x + i);
+				}
+			}
+		}
+	}
+
+	{
+		thread_scoped_lock image_lock(image->mutex);
+
+		/* Another thread might have loaded the tile while we waited. */
+		resident = *slot;
+		if(!(resident && resident->key == key)) {
+			Tile *tile = acquire_tile();
+			if(!read_tile(image, level, index, parents, tile->data)) {
+				VLOG(1) << "Texture cache failed to read tile " << index
+				        << " of level " << level << " from " << image->filename << ".";
+			}
+			release_tile(tile, image, slot, key);
+
+			/* Don't keep too many files open, the image will be reopened on
+			 * the next tile miss. */
+			if(num_open_files > MAX_OPEN_FILES) {
+				close_input(image);
+			}
+		}
+	}
+
+	for(int i = 0; i < 4; i++) {
+		if(parents[i]) {
+			unpin_tile(parents[i]);
+		}
+	}
+}
+
+TextureCache::Tile *TextureCache::pin_tile(Image *image, int level, int index)
+{
+	const Image::Level& info = image->levels[level];
+	const uint64_t key = info.key_offset + index;
+
+	for(;;) {
+		{
+			thread_scoped_lock tiles_lock(tiles_mutex);
+			Tile *tile = info.tiles[index];
+			if(tile && tile->key == key) {
+				tile->pins++;
+				tile->used = 1;
+				return tile;
+			}
+		}
+		load_tile(image, level, index);
+	}
+}
+
+void TextureCache::unpin_tile(Tile *tile)
+{
+	thread_scoped_lock tiles_lock(tiles_mutex);
+	assert(tile->pins > 0);
+	tile->pins--;
+}
+
+TextureCache::Tile *TextureCache::acquire_tile()
+{
+	thread_scoped_lock tiles_lock(tiles_mutex);
+
+	Tile *tile = NULL;
+
+	if(!free_tiles.empty()) {
+		tile = free_tiles.back();
+		free_tiles.pop_back();
+	}
+	else if(tiles.size() < max_tiles) {
+		tile = NULL;
+	}
+	else {
+		/* Clock sweep, tiles used since the last pass get a second chance.
+		 * Two full passes are enough to find a tile unless all of them are
+		 * being loaded by other threads. */
+		const size_t num_tiles = tiles.size();
+		for(size_t i = 0; i < num_tiles * 2; i++) {
+			Tile *candidate = tiles[clock_hand];
+			clock_hand = (clock_hand + 1) % num_tiles;
+
+			if(candidate->locked || candidate->pins > 0) {
+				continue;
+			}
+			if(candidate->used) {
+				candidate->used = 0;
+				continue;
+			}
+
+			/* Invalidate key first, so lookups holding on to the tile
+			 * will notice the change. */
+			candidate->key = 0;
+			TEXTURE_CACHE_BARRIER();
+			if(*candidate->slot == candidate) {
+				*candidate->slot = NULL;
+			}
+			candidate->image = NULL;
+			candidate->slot = NULL;
+
+			stats.tiles_evicted++;
+			stats.tiles_resident--;
+
+			tile = candidate;
+			break;
+		}
+
+		if(!tile) {
+			VLOG(2) << "Texture cache exceeding memory budget, all tiles are being loaded or filtered.";
+		}
+	}
+
+	if(!tile) {
+		tile = new Tile();
+		tile->key = 0;
+		tile->pins = 0;
+		tile->image = NULL;
+		tile->slot = NULL;
+		tile->data = (uchar*)util_aligned_malloc(TILE_BYTES, 16);
+		tiles.push_back(tile);
+
+		stats.mem_used += TILE_BYTES;
+		stats.mem_peak = max(stats.mem_peak, stats.mem_used);
+	}
+
+	tile->used = 1;
+	tile->locked = true;
+
+	return tile;
+}
+
+void TextureCache::release_tile(Tile *tile,
+                                Image *image,
+                                Tile * volatile *slot,
+                                uint64_t key)
+{
+	thread_scoped_lock tiles_lock(tiles_mutex);
+
+	tile->image = image;
+	tile->slot = slot;
+	TEXTURE_CACHE_BARRIER();
+	tile->key = key;
+	TEXTURE_CACHE_BARRIER();
+	*slot = tile;
+	tile->locked = false;
+
+	stats.tiles_loaded++;
+	stats.tiles_resident++;
+}
+
+bool TextureCache::open_input(Image *image, int file_level)
+{
+	ImageInput *in = (ImageInput*)image->input;
+
+	if(!in) {
+		in = texture_cache_open_file(image->filename, image->use_alpha);
+		if(!in) {
+			return false;
+		}
+		image->input = in;
+		image->input_level = 0;
+		atomic_fetch_and_add_int32(&num_open_files, 1);
+	}
+
+	if(image->input_level != file_level) {
+		ImageSpec spec;
+		if(!in->seek_subimage(0, file_level, spec)) {
+			return false;
+		}
+		image->input_level = file_level;
+	}
+
+	return true;
+}
+
+void TextureCache::close_input(Image *image)
+{
+	ImageInput *in = (ImageInput*)image->input;
+
+	if(in) {
+		in->close();
+		delete in;
+		image->input = NULL;
+		image->input_level = -1;
+		atomic_fetch_and_add_int32(&num_open_files, -1);
+	}
+}
+
+/* Read pixels of a mip level stored in the file, converting them to the
+ * number of channels of the image data type. Coordinates are bottom to top
+ * like the images on the device. */
+template<typename StorageType>
+bool TextureCache::read_file_pixels(Image *image,
+                                    int file_level,
+                                    int x, int y, int w, int h,
+                                    StorageType *pixels,
+                                    size_t row_stride)
+{
+	if(!open_input(image, file_level)) {
+		return false;
+	}
+
+	ImageInput *in = (ImageInput*)image->input;
+	const ImageSpec& spec = in->spec();
+	const int components = image->components;
+	const int channels = image_data_type_channels(image->type);
+
+	/* Flip to the top to bottom order of the file. */
+	int fx_begin = x, fx_end = x + w;
+	int fy_begin = spec.height - (y + h), fy_end = spec.height - y;
+
+	vector<StorageType> buffer;
+	bool success;
+
+	if(spec.tile_width > 0 && spec.tile_height > 0) {
+		/* Tiled file, read only the file tiles overlapping the region. */
+		fx_begin = (fx_begin / spec.tile_width) * spec.tile_width;
+		fy_begin = (fy_begin / spec.tile_height) * spec.tile_height;
+		fx_end = min(((fx_end + spec.tile_width - 1) / spec.tile_width) * spec.tile_width, spec.width);
+		fy_end = min(((fy_end + spec.tile_height - 1) / spec.tile_height) * spec.tile_height, spec.height);
+
+		buffer.resize((size_t)(fx_end - fx_begin) * (fy_end - fy_begin) * components);
+		success = in->read_tiles(spec.x + fx_begin, spec.x + fx_end,
+		                         spec.y + fy_begin, spec.y + fy_end,
+		                         spec.z, spec.z + 1,
+		                         texel_format<StorageType>(),
+		                         &buffer[0]);
+	}
+	else {
+		/* Scanline file, read full rows. */
+		fx_begin = 0;
+		fx_end = spec.width;
+
+		buffer.resize((size_t)(fx_end - fx_begin) * (fy_end - fy_begin) * components);
+		success = in->read_scanlines(spec.y + fy_begin, spec.y + fy_end,
+		                             spec.z,
+		                             texel_format<StorageType>(),
+		                             &buffer[0]);
+	}
+
+	if(!success) {
+		return false;
+	}
+
+	atomic_add_and_fetch_z(&stats.file_bytes_read, buffer.size() * sizeof(StorageType));
+
+	const StorageType one = texel_from_float<StorageType>(1.0f);
+	const size_t buffer_width = fx_end - fx_begin;
+
+	for(int j = 0; j < h; j++) {
+		const int fy = spec.height - 1 - (y + j);
+		const StorageType *src_row = &buffer[((fy - fy_begin) * buffer_width + (x - fx_begin)) * components];
+		StorageType *dst_row = pixels + j * row_stride;
+
+		for(int i = 0; i < w; i++) {
+			const StorageType *src = src_row + i * components;
+			StorageType *dst = dst_row + i * channels;
+
+			if(channels == 1) {
+				dst[0] = texel_is_finite(src[0])? src[0]: texel_from_float<StorageType>(0.0f);
+				continue;
+			}
+
+			if(components == 1) {
+				dst[0] = dst[1] = dst[2] = src[0];
+				dst[3] = one;
+			}
+			else if(components == 2) {
+				dst[0] = dst[1] = dst[2] = src[0];
+				dst[3] = src[1];
+			}
+			else if(components == 3) {
+				dst[0] = src[0];
+				dst[1] = src[1];
+				dst[2] = src[2];
+				dst[3] = one;
+			}
+			else if(image->cmyk) {
+				const float k = texel_to_float(src[3]);
+				dst[0] = texel_from_float<StorageType>(texel_to_float(src[0]) * k);
+				dst[1] = texel_from_float<StorageType>(texel_to_float(src[1]) * k);
+				dst[2] = texel_from_float<StorageType>(texel_to_float(src[2]) * k);
+				dst[3] = one;
+			}
+			else {
+				dst[0] = src[0];
+				dst[1] = src[1];
+				dst[2] = src[2];
+				dst[3] = src[3];
+			}
+
+			if(image->use_alpha == false) {
+				dst[3] = one;
+			}
+
+			/* Set all channels to 0 if either of them is not finite,
+			 * same as for fully loaded images. */
+			if(!texel_is_finite(dst[0]) || !texel_is_finite(dst[1]) ||
+			   !texel_is_finite(dst[2]) || !texel_is_finite(dst[3]))
+			{
+				dst[0] = dst[1] = dst[2] = dst[3] = texel_from_float<StorageType>(0.0f);
+			}
+		}
+	}
+
+	return true;
+}
+
+/* Generate pixels of a mip level that is not stored in the file, box
+ * filtering 2x2 texels of the next finer level from its pinned tiles. */
+template<typename StorageType>
+void TextureCache::filter_tile_pixels(Image *image,
+                                      int level,
+                                      int x, int y, int w, int h,
+                                      Tile * const *parents,
+                                      StorageType *pixels,
+                                      size_t row_stride)
+{
+	const Image::Level& parent = image->levels[level - 1];
+	const int channels = image_data_type_channels(image->type);
+
+	/* First of the 2x2 parent tiles, all tiles have the same resolution. */
+	const int tile_x = (2 * x) >> image->tile_width_log2;
+	const int tile_y = (2 * y) >> image->tile_height_log2;
+
+	for(int j = 0; j < h; j++) {
+		/* Odd sizes drop the last row and column, except for levels that
+		 * are only one texel wide or high. */
+		const int py_begin = 2 * (y + j);
+		const int py_end = min(py_begin + 2, parent.height);
+		StorageType *dst_row = pixels + j * row_stride;
+
+		for(int i = 0; i < w; i++) {
+			const int px_begin = 2 * (x + i);
+			const int px_end = min(px_begin + 2, parent.width);
+
+			float sum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+
+			for(int py = py_begin; py < py_end; py++) {
+				for(int px = px_begin; px < px_end; px++) {
+					const int t = ((py >> image->tile_height_log2) - tile_y) * 2 +
+					              ((px >> image->tile_width_log2) - tile_x);
+					const size_t offset = (((size_t)(py & image->tile_height_mask)) << image->tile_width_log2) +
+					                      (px & image->tile_width_mask);
+					const StorageType *src = (const StorageType*)parents[t]->data + offset * channels;
+					for(int c = 0; c < channels; c++) {
+						sum[c] += texel_to_float(src[c]);
+					}
+				}
+			}
+
+			const float inv_num = 1.0f / ((px_end - px_begin) * (py_end - py_begin));
+			for(int c = 0; c < channels; c++) {
+				dst_row[i * channels + c] = texel_from_float<StorageType>(sum[c] * inv_num);
+			}
+		}
+	}
+}
+
+bool TextureCache::read_tile(Image *image,
+                             int level,
+                             int index,
+                             Tile * const *parents,
+                             uchar *data)
+{
+	const Image::Level& info = image->levels[level];
+	const int tile_width = 1 << image->tile_width_log2;
+	const int tile_height = 1 << image->tile_height_log2;
+	const int x = (index % info.tiles_x) * tile_width;
+	const int y = (index / info.tiles_x) * tile_height;
+	const int w = min(tile_width, info.width - x);
+	const int h = min(tile_height, info.height - y);
+	const size_t row_stride = (size_t)tile_width * image_data_type_channels(image->type);
+
+	/* Texels outside the image are never read, clear them anyway. */
+	memset(data, 0, TILE_BYTES);
+
+	if(info.file_level == -1) {
+		switch(image->type) {
+			case IMAGE_DATA_TYPE_FLOAT4:
+			case IMAGE_DATA_TYPE_FLOAT:
+				filter_tile_pixels(image, level, x, y, w, h, parents, (float*)data, row_stride);
+				return true;
+			case IMAGE_DATA_TYPE_BYTE4:
+			case IMAGE_DATA_TYPE_BYTE:
+				filter_tile_pixels(image, level, x, y, w, h, parents, (uchar*)data, row_stride);
+				return true;
+			case IMAGE_DATA_TYPE_HALF4:
+			case IMAGE_DATA_TYPE_HALF:
+				filter_tile_pixels(image, level, x, y, w, h, parents, (half*)data, row_stride);
+				return true;
+			default:
+				assert(0);
+				return false;
+		}
+	}
+
+	switch(image->type) {
+		case IMAGE_DATA_TYPE_FLOAT4:
+		case IMAGE_DATA_TYPE_FLOAT:
+			return read_file_pixels(image, info.file_level, x, y, w, h, (float*)data, row_stride);
+		case IMAGE_DATA_TYPE_BYTE4:
+		case IMAGE_DATA_TYPE_BYTE:
+			return read_file_pixels(image, info.file_level, x, y, w, h, (uchar*)data, row_stride);
+		case IMAGE_DATA_TYPE_HALF4:
+		case IMAGE_DATA_TYPE_HALF:
+			return read_file_pixels(image, info.file_level, x, y, w, h, (half*)data, row_stride);
+		default:
+			assert(0);
+			return false;
+	}
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,226 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __UTIL_TEXTURE_CACHE_H__
+#define __UTIL_TEXTURE_CACHE_H__
+
+#include "util/util_string.h"
+#include "util/util_texture.h"
+#include "util/util_thread.h"
+#include "util/util_types.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Out-of-core texture cache for the CPU device.
+ *
+ * Images are split into tiles of a fixed number of bytes, which are loaded
+ * from file on first access and evicted again once the memory budget is used
+ * up. Eviction uses the clock algorithm, an approximation of least recently
+ * used which does not require any locking on lookup.
+ *
+ * Lookups from the kernel are lock-free. A tile buffer is never freed while
+ * the cache exists, only reused for another tile, and every tile carries the
+ * key of the image tile it holds. Readers validate the key before and after
+ * reading a texel, which is enough to detect a tile that was evicted in the
+ * meantime. Loading tiles is done on the thread that missed, with a lock per
+ * image for file access.
+ *
+ * Mip levels are read from file when it contains them, and are otherwise
+ * generated on demand with a 2x2 box filter from the tiles of the next finer
+ * level. Those tiles are pinned in the cache while filtering, so a coarse
+ * level never needs more than a few tiles of the finer levels in memory. */
+
+#if defined(_MSC_VER)
+#  define TEXTURE_CACHE_BARRIER() _ReadWriteBarrier()
+#elif defined(__i386__) || defined(__x86_64__)
+#  define TEXTURE_CACHE_BARRIER() __asm__ __volatile__("" ::: "memory")
+#else
+#  define TEXTURE_CACHE_BARRIER() __sync_synchronize()
+#endif
+
+class TextureCache {
+public:
+	/* Every tile occupies the same amount of memory, 64 KB. The tile
+	 * resolution depends on the size of the texel data type. */
+	static const int TILE_BYTES_LOG2 = 16;
+	static const size_t TILE_BYTES = ((size_t)1 << TILE_BYTES_LOG2);
+
+	/* Images are kept open for faster tile loading, up to this number. */
+	static const int MAX_OPEN_FILES = 100;
+
+	struct Tile;
+	class Image;
+
+	struct Stats {
+		Stats()
+		: tiles_loaded(0),
+		  tiles_evicted(0),
+		  tiles_resident(0),
+		  mem_used(0),
+		  mem_peak(0),
+		  file_bytes_read(0) {}
+
+		size_t tiles_loaded;
+		size_t tiles_evicted;
+		size_t tiles_resident;
+		size_t mem_used;
+		size_t mem_peak;
+		size_t file_bytes_read;
+
+		string full_report() const;
+	};
+
+	explicit TextureCache(size_t memory_budget);
+	~TextureCache();
+
+	/* Add image file to the cache, returns NULL if the image can not be
+	 * cached. The texture limit selects the mip level used for rendering,
+	 * same as it scales down images that are fully loaded. */
+	Image *add_image(const string& filename,
+	                 ImageDataType type,
+	                 bool use_alpha,
+	                 int texture_limit);
+	void remove_image(Image *image);
+
+	size_t memory_budget() const { return max_tiles * TILE_BYTES; }
+	void get_stats(Stats *stats);
+
+	struct Tile {
+		/* Key of the image tile stored in data, 0 while free or loading. */
+		volatile uint64_t key;
+		/* Set on lookup, cleared again by the clock sweep. */
+		volatile int used;
+		/* Tile is being loaded and must not be evicted. */
+		bool locked;
+		/* Number of coarser tiles being filtered from this tile, which must
+		 * not be evicted either. Only modified while holding tiles_mutex. */
+		int pins;
+
+		uchar *data;
+		Image *image;
+		Tile * volatile *slot;
+	};
+
+	class Image {
+	public:
+		/* Dimensions of the mip level used for rendering. */
+		int width, height;
+
+		/* Texel fetch, coordinates must be inside the image. */
+		template<typename T>
+		ccl_always_inline T fetch(int x, int y)
+		{
+			const Level& level = levels[base_level];
+			const int index = (y >> tile_height_log2) * level.tiles_x + (x >> tile_width_log2);
+			const size_t offset = (((size_t)(y & tile_height_mask)) << tile_width_log2) +
+			                      (x & tile_width_mask);
+			const uint64_t key = level.key_offset + index;
+
+			for(;;) {
+				Tile *tile = level.tiles[index];
+				if(tile && tile->key == key) {
+					TEXTURE_CACHE_BARRIER();
+					T value = ((const T*)tile->data)[offset];
+					TEXTURE_CACHE_BARRIER();
+					if(tile->key == key) {
+						if(!tile->used) {
+							tile->used = 1;
+						}
+						return value;
+					}
+				}
+				cache->load_tile(this, base_level, index);
+			}
+		}
+
+	protected:
+		friend class TextureCache;
+
+		struct Level {
+			int width, height;
+			int tiles_x, tiles_y;
+			/* Level stored in the file, or -1 if it is generated. */
+			int file_level;
+			uint64_t key_offset;
+			Tile * volatile *tiles;
+		};
+
+		TextureCache *cache;
+		string filename;
+		ImageDataType type;
+		bool use_alpha;
+		bool cmyk;
+
+		int components;
+		int tile_width_log2, tile_height_log2;
+		int tile_width_mask, tile_height_mask;
+		int base_level;
+		vector<Level> levels;
+
+		/* File access, only while holding the mutex. */
+		thread_mutex mutex;
+		void *input;
+		int input_level;
+	};
+
+protected:
+	void load_tile(Image *image, int level, int index);
+	Tile *pin_tile(Image *image, int level, int index);
+	void unpin_tile(Tile *tile);
+
+	Tile *acquire_tile();
+	void release_tile(Tile *tile,
+	                  Image *image,
+	                  Tile * volatile *slot,
+	                  uint64_t key);
+
+	bool open_input(Image *image, int file_level);
+	void close_input(Image *image);
+
+	template<typename StorageType>
+	bool read_file_pixels(Image *image,
+	                      int file_level,
+	                      int x, int y, int w, int h,
+	                      StorageType *pixels,
+	                      size_t row_stride);
+	template<typename StorageType>
+	void filter_tile_pixels(Image *image,
+	                        int level,
+	                        int x, int y, int w, int h,
+	                        Tile * const *parents,
+	                        StorageType *pixels,
+	                        size_t row_stride);
+	bool read_tile(Image *image,
+	               int level,
+	               int index,
+	               Tile * const *parents,
+	               uchar *data);
+
+	thread_mutex tiles_mutex;
+	vector<Tile*> tiles;
+	vector<Tile*> free_tiles;
+	size_t max_tiles;
+	size_t clock_hand;
+	uint64_t next_key;
+	int num_open_files;
+
+	Stats stats;
+};
+
+CCL_NAMESPACE_END
+
+#endif  /* __UTIL_TEXTURE_CACHE_H__ */
@@ -21,10 +21,11 @@
 
 CCL_NAMESPACE_BEGIN
 
-thread::thread(function<void(void)> run_cb, int group)
+thread::thread(function<void(void)> run_cb, int group, int node)
   : run_cb_(run_cb),
     joined_(false),
-	group_(group)
+	group_(group),
+	node_(node)
 {
 #if (__cplusplus > 199711L) || (defined(_MSC_VER) && _MSC_VER >= 1800)
 	thread_ = std::thread(&thread::run, this);
@@ -57,6 +58,11 @@ void *thread::run(void *arg)
 		}
 #endif
 	}
+	if(self->node_ != -1) {
+		if(!system_cpu_run_thread_on_numa_node(self->node_)) {
+			fprintf(stderr, "Error setting thread affinity.\n");
+		}
+	}
 	self->run_cb_();
 	return NULL;
 }
@@ -58,7 +58,9 @@ typedef boost::condition_variable thread_condition_variable;
 
 class thread {
 public:
-	thread(function<void(void)> run_cb, int group = -1);
+	/* Group is a Windows processor group, node a NUMA node to restrict the
+	 * thread to. Use -1 for default affinity. */
+	thread(function<void(void)> run_cb, int group = -1, int node = -1);
 	~thread();
 
 	static void *run(void *arg);
@@ -73,6 +75,7 @@ protected:
 #endif
 	bool joined_;
 	int group_;
+	int node_;
 };
 
 /* Own wrapper around pthread's spin lock to make it's use easier. */
@@ -182,6 +182,15 @@ public:
 		}
 	}
 
+	/* Take ownership of memory allocated with the same allocator. */
+	void set_data(T *ptr_, size_t datasize)
+	{
+		clear();
+		data_ = ptr_;
+		datasize_ = datasize;
+		capacity_ = datasize;
+	}
+
 	T *steal_pointer()
 	{
 		T *ptr = data_;
@@ -229,6 +229,10 @@ extern "C" {
  * for a specific Device.
  * the work-scheduler will find work for the device and the device will be asked to execute the WorkPackage
  *
+ * Every CPU thread has its own queue, ordered by the priority of the WorkPackage. The priority follows the order of
+ * the chunks of the output ExecutionGroup, so the chunks in view of the viewer are calculated first. A thread takes
+ * the most important WorkPackage of all queues. When the node tree is cancelled the queued work is dropped.
+ *
  * @subsection singlethread Single threaded
  * For debugging reasons the multi-threading can be disabled. This is done by changing the COM_CURRENT_THREADING_MODEL
  * to COM_TM_NOTHREAD. When compiling the work-scheduler
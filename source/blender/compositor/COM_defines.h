@@ -72,7 +72,7 @@ typedef enum CompositorPriority {
 
 // workscheduler threading models
 /**
- * COM_TM_QUEUE is a multithreaded model, which uses the BLI_thread_queue pattern. This is the default option.
+ * COM_TM_QUEUE is a multithreaded model, which uses a work queue per thread. This is the default option.
  */
 #define COM_TM_QUEUE 1
 
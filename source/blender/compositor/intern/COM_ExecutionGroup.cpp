@@ -320,7 +320,9 @@ void ExecutionGroup::execute(ExecutionSystem *graph)
 			int xChunk = chunkNumber - (yChunk * this->m_numberOfXChunks);
 			const ChunkExecutionState state = this->m_chunkExecutionStates[chunkNumber];
 			if (state == COM_ES_NOT_SCHEDULED) {
-				scheduleChunkWhenPossible(graph, xChunk, yChunk);
+				/* Chunks early in chunkOrder (the visible area of the viewer first)
+				 * run before later ones, the chunks they depend on inherit this. */
+				scheduleChunkWhenPossible(graph, xChunk, yChunk, index);
 				finished = false;
 				startEvaluated = true;
 				numberEvaluated++;
@@ -448,10 +450,10 @@ MemoryBuffer *ExecutionGroup::allocateOutputBuffer(int /*chunkNumber*/,
 }
 
 
-bool ExecutionGroup::scheduleAreaWhenPossible(ExecutionSystem *graph, rcti *area)
+bool ExecutionGroup::scheduleAreaWhenPossible(ExecutionSystem *graph, rcti *area, unsigned int priority)
 {
 	if (this->m_singleThreaded) {
-		return scheduleChunkWhenPossible(graph, 0, 0);
+		return scheduleChunkWhenPossible(graph, 0, 0, priority);
 	}
 	// find all chunks inside the rect
 	// determine minxchunk, minychunk, maxxchunk, maxychunk where x and y are chunknumbers
@@ -473,7 +475,7 @@ bool ExecutionGroup::scheduleAreaWhenPossible(ExecutionSystem *graph, rcti *area
 	bool result = true;
 	for (indexx = minxchunk; indexx < maxxchunk; indexx++) {
 		for (indexy = minychunk; indexy < maxychunk; indexy++) {
-			if (!scheduleChunkWhenPossible(graph, indexx, indexy)) {
+			if (!scheduleChunkWhenPossible(graph, indexx, indexy, priority)) {
 				result = false;
 			}
 		}
@@ -482,17 +484,17 @@ bool ExecutionGroup::scheduleAreaWhenPossible(ExecutionSystem *graph, rcti *area
 	return result;
 }
 
-bool ExecutionGroup::scheduleChunk(unsigned int chunkNumber)
+bool ExecutionGroup::scheduleChunk(unsigned int chunkNumber, unsigned int priority)
 {
 	if (this->m_chunkExecutionStates[chunkNumber] == COM_ES_NOT_SCHEDULED) {
 		this->m_chunkExecutionStates[chunkNumber] = COM_ES_SCHEDULED;
-		WorkScheduler::schedule(this, chunkNumber);
+		WorkScheduler::schedule(this, chunkNumber, priority);
 		return true;
 	}
 	return false;
 }
 
-bool ExecutionGroup::scheduleChunkWhenPossible(ExecutionSystem *graph, int xChunk, int yChunk)
+bool ExecutionGroup::scheduleChunkWhenPossible(ExecutionSystem *graph, int xChunk, int yChunk, unsigned int priority)
 {
 	if (xChunk < 0 || xChunk >= (int)this->m_numberOfXChunks) {
 		return true;
@@ -529,7 +531,7 @@ bool ExecutionGroup::scheduleChunkWhenPossible(ExecutionSystem *graph, int xChun
 		ExecutionGroup *group = memoryProxy->getExecutor();
 
 		if (group != NULL) {
-			if (!group->scheduleAreaWhenPossible(graph, &area)) {
+			if (!group->scheduleAreaWhenPossible(graph, &area, priority)) {
 				canBeExecuted = false;
 			}
 		}
@@ -539,7 +541,7 @@ bool ExecutionGroup::scheduleChunkWhenPossible(ExecutionSystem *graph, int xChun
 	}
 
 	if (canBeExecuted) {
-		scheduleChunk(chunkNumber);
+		scheduleChunk(chunkNumber, priority);
 	}
 
 	return false;
@@ -213,11 +213,12 @@ private:
 	 * @param graph
 	 * @param xChunk
 	 * @param yChunk
+	 * @param priority priority of the packages, also used for the chunks it depends on
 	 * @return [true:false]
 	 * true: package(s) are scheduled
 	 * false: scheduling is deferred (depending workpackages are scheduled)
 	 */
-	bool scheduleChunkWhenPossible(ExecutionSystem *graph, int xChunk, int yChunk);
+	bool scheduleChunkWhenPossible(ExecutionSystem *graph, int xChunk, int yChunk, unsigned int priority);
 
 	/**
 	 * @brief try to schedule a specific area.
@@ -225,17 +226,19 @@ private:
 	 * @note This method is called from other ExecutionGroup's.
 	 * @param graph
 	 * @param rect
+	 * @param priority priority of the packages
 	 * @return [true:false]
 	 * true: package(s) are scheduled
 	 * false: scheduling is deferred (depending workpackages are scheduled)
 	 */
-	bool scheduleAreaWhenPossible(ExecutionSystem *graph, rcti *rect);
+	bool scheduleAreaWhenPossible(ExecutionSystem *graph, rcti *rect, unsigned int priority);
 
 	/**
 	 * @brief add a chunk to the WorkScheduler.
 	 * @param chunknumber
+	 * @param priority priority of the package
 	 */
-	bool scheduleChunk(unsigned int chunkNumber);
+	bool scheduleChunk(unsigned int chunkNumber, unsigned int priority);
 	
 	/**
 	 * @brief determine the area of interest of a certain input area
@@ -34,6 +34,7 @@ extern "C" {
 #include "COM_NodeOperationBuilder.h"
 #include "COM_NodeOperation.h"
 #include "COM_ExecutionGroup.h"
+#include "COM_FullFrameExecution.h"
 #include "COM_WorkScheduler.h"
 #include "COM_ReadBufferOperation.h"
 #include "COM_Debug.h"
@@ -132,6 +133,12 @@ void ExecutionSystem::execute()
 	editingtree->stats_draw(editingtree->sdh, IFACE_("Compositing | Initializing execution"));
 
 	DebugInfo::execute_started(this);
+
+	if (this->m_context.isFullFrameEnabled()) {
+		FullFrameExecution execution(this->m_context, this->m_operations);
+		execution.execute();
+		return;
+	}
 	
 	unsigned int order = 0;
 	for (vector<NodeOperation *>::iterator iter = this->m_operations.begin(); iter != this->m_operations.end(); ++iter) {
@@ -166,6 +166,8 @@ public:
 	 *  - initialize the NodeOperation's and ExecutionGroup's
 	 *  - schedule the output ExecutionGroup's based on their priority
 	 *  - deinitialize the ExecutionGroup's and NodeOperation's
+	 * or execute the operations on full frames when enabled in the bNodeTree
+	 * @see FullFrameExecution
 	 */
 	void execute();
 
@@ -0,0 +1,642 @@
+/*
+ * Copyright 2018, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include <string.h>
+
+#include "COM_FFTConvolution.h"
+#include "COM_MemoryBuffer.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#  include "BLI_math.h"
+#  include "BLI_task.h"
+#  include "BLI_utildefines.h"
+}
+
+/* Largest prime factor of the transform sizes. */
+#define FFT_MAX_RADIX 5
+/* Room for the factorization of any int, as pairs of radix and remaining length. */
+#define FFT_MAX_FACTORS 32
+/* Rows or columns transformed by a single task. */
+#define FFT_LINES_PER_TASK 16
+
+struct FFTComplex {
+	float re, im;
+};
+
+static inline FFTComplex complex_add(const FFTComplex a, const FFTComplex b)
+{
+	FFTComplex r = {a.re + b.re, a.im + b.im};
+	return r;
+}
+
+static inline FFTComplex complex_sub(const FFTComplex a, const FFTComplex b)
+{
+	FFTComplex r = {a.re - b.re, a.im - b.im};
+	return r;
+}
+
+static inline FFTComplex complex_mul(const FFTComplex a, const FFTComplex b)
+{
+	FFTComplex r = {a.re * b.re - a.im * b.im, a.re * b.im + a.im * b.re};
+	return r;
+}
+
+static inline FFTComplex complex_conj(const FFTComplex a)
+{
+	FFTComplex r = {a.re, -a.im};
+	return r;
+}
+
+/* -------------------------------------------------------------------- */
+/* 1D mixed radix transform */
+
+struct FFTPlan {
+	int size;
+	bool inverse;
+	/* Pairs of radix and length of the sub-transforms, outer stage first. */
+	int factors[2 * FFT_MAX_FACTORS];
+	FFTComplex *twiddles;
+};
+
+static bool fft_is_good_size(int n)
+{
+	const int primes[3] = {2, 3, 5};
+	for (int i = 0; i < 3; i++) {
+		while (n % primes[i] == 0) {
+			n /= primes[i];
+		}
+	}
+	return n == 1;
+}
+
+/* Smallest size of at least n that the transform handles. */
+static int fft_good_size(int n)
+{
+	while (!fft_is_good_size(n)) {
+		n++;
+	}
+	return n;
+}
+
+static FFTPlan *fft_plan_create(int size, bool inverse)
+{
+	FFTPlan *plan = (FFTPlan *)MEM_callocN(sizeof(FFTPlan), "FFTPlan");
+	plan->size = size;
+	plan->inverse = inverse;
+
+	plan->twiddles = (FFTComplex *)MEM_mallocN(sizeof(FFTComplex) * size, "FFTPlan twiddles");
+	const double sign = inverse ? 1.0 : -1.0;
+	for (int i = 0; i < size; i++) {
+		const double phase = sign * 2.0 * M_PI * (double)i / (double)size;
+		plan->twiddles[i].re = (float)cos(phase);
+		plan->twiddles[i].im = (float)sin(phase);
+	}
+
+	/* Radix 4 first, it has the fastest butterfly. */
+	int *factors = plan->factors;
+	int n = size, p = 4;
+	if (n == 1) {
+		factors[0] = 1;
+		factors[1] = 1;
+	}
+	while (n > 1) {
+		while (n % p) {
+			p = (p == 4) ? 2 : (p == 2) ? 3 : p + 2;
+		}
+		n /= p;
+		*factors++ = p;
+		*factors++ = n;
+	}
+
+	return plan;
+}
+
+static void fft_plan_free(FFTPlan *plan)
+{
+	MEM_freeN(plan->twiddles);
+	MEM_freeN(plan);
+}
+
+static void fft_butterfly2(FFTComplex *out, const int fstride, const FFTPlan *plan, const int m)
+{
+	FFTComplex *out2 = out + m;
+	const FFTComplex *tw = plan->twiddles;
+
+	for (int k = 0; k < m; k++, tw += fstride) {
+		const FFTComplex t = complex_mul(out2[k], *tw);
+		out2[k] = complex_sub(out[k], t);
+		out[k] = complex_add(out[k], t);
+	}
+}
+
+static void fft_butterfly4(FFTComplex *out, const int fstride, const FFTPlan *plan, const int m)
+{
+	const FFTComplex *tw1 = plan->twiddles, *tw2 = tw1, *tw3 = tw1;
+	const int m2 = 2 * m, m3 = 3 * m;
+
+	for (int k = 0; k < m; k++, out++) {
+		const FFTComplex s0 = complex_mul(out[m], *tw1);
+		const FFTComplex s1 = complex_mul(out[m2], *tw2);
+		const FFTComplex s2 = complex_mul(out[m3], *tw3);
+		const FFTComplex s3 = complex_add(s0, s2);
+		const FFTComplex s4 = complex_sub(s0, s2);
+		const FFTComplex s5 = complex_sub(out[0], s1);
+		const FFTComplex s6 = complex_add(out[0], s1);
+
+		tw1 += fstride;
+		tw2 += 2 * fstride;
+		tw3 += 3 * fstride;
+
+		out[0] = complex_add(s6, s3);
+		out[m2] = complex_sub(s6, s3);
+		if (plan->inverse) {
+			out[m].re = s5.re - s4.im;
+			out[m].im = s5.im + s4.re;
+			out[m3].re = s5.re + s4.im;
+			out[m3].im = s5.im - s4.re;
+		}
+		else {
+			out[m].re = s5.re + s4.im;
+			out[m].im = s5.im - s4.re;
+			out[m3].re = s5.re - s4.im;
+			out[m3].im = s5.im + s4.re;
+		}
+	}
+}
+
+static void fft_butterfly_generic(FFTComplex *out, const int fstride, const FFTPlan *plan, const int m, const int p)
+{
+	FFTComplex scratch[FFT_MAX_RADIX];
+	const int n = plan->size;
+
+	BLI_assert(p <= FFT_MAX_RADIX);
+
+	for (int u = 0; u < m; u++) {
+		for (int q = 0, k = u; q < p; q++, k += m) {
+			scratch[q] = out[k];
+		}
+		for (int q1 = 0, k = u; q1 < p; q1++, k += m) {
+			FFTComplex sum = scratch[0];
+			int twiddle = 0;
+			for (int q = 1; q < p; q++) {
+				twiddle += fstride * k;
+				if (twiddle >= n) {
+					twiddle -= n;
+				}
+				sum = complex_add(sum, complex_mul(scratch[q], plan->twiddles[twiddle]));
+			}
+			out[k] = sum;
+		}
+	}
+}
+
+/* Decimation in time, the sub-transforms of every stage are computed recursively. */
+static void fft_work(FFTComplex *out, const FFTComplex *in, const int fstride, const int *factors, const FFTPlan *plan)
+{
+	const int p = factors[0];
+	const int m = factors[1];
+
+	if (m == 1) {
+		for (int i = 0; i < p; i++, in += fstride) {
+			out[i] = *in;
+		}
+	}
+	else {
+		for (int i = 0; i < p; i++, in += fstride) {
+			fft_work(out + i * m, in, fstride * p, factors + 2, plan);
+		}
+	}
+
+	switch (p) {
+		case 2:
+			fft_butterfly2(out, fstride, plan, m);
+			break;
+		case 4:
+			fft_butterfly4(out, fstride, plan, m);
+			break;
+		default:
+			fft_butterfly_generic(out, fstride, plan, m, p);
+			break;
+	}
+}
+
+/* Unnormalized transform of plan->size values, in and out must not overlap. */
+static void fft_execute(const FFTPlan *plan, const FFTComplex *in, FFTComplex *out)
+{
+	fft_work(out, in, 1, plan->factors, plan);
+}
+
+/* -------------------------------------------------------------------- */
+/* Parallel tasks */
+
+typedef struct FFTTransformData {
+	FFTComplex *data;
+	const FFTPlan *plan;
+	int width;
+	int num_lines;
+} FFTTransformData;
+
+static void fft_rows_task(void *__restrict userdata,
+                          const int index,
+                          const ParallelRangeTLS *__restrict /*tls*/)
+{
+	const FFTTransformData *task = (const FFTTransformData *)userdata;
+	const int width = task->width;
+	const int end = min_ii((index + 1) * FFT_LINES_PER_TASK, task->num_lines);
+	FFTComplex *line = (FFTComplex *)MEM_mallocN(sizeof(FFTComplex) * width, __func__);
+
+	for (int y = index * FFT_LINES_PER_TASK; y < end; y++) {
+		FFTComplex *row = task->data + (size_t)y * width;
+		bool is_zero = true;
+		for (int x = 0; x < width && is_zero; x++) {
+			is_zero = (row[x].re == 0.0f && row[x].im == 0.0f);
+		}
+		/* Rows of padding stay zero. */
+		if (is_zero) {
+			continue;
+		}
+		memcpy(line, row, sizeof(FFTComplex) * width);
+		fft_execute(task->plan, line, row);
+	}
+
+	MEM_freeN(line);
+}
+
+static void fft_columns_task(void *__restrict userdata,
+                             const int index,
+                             const ParallelRangeTLS *__restrict /*tls*/)
+{
+	const FFTTransformData *task = (const FFTTransformData *)userdata;
+	const int width = task->width;
+	const int height = task->plan->size;
+	const int xmin = index * FFT_LINES_PER_TASK;
+	const int xmax = min_ii(xmin + FFT_LINES_PER_TASK, task->num_lines);
+	FFTComplex *columns = (FFTComplex *)MEM_mallocN(sizeof(FFTComplex) * height * FFT_LINES_PER_TASK, __func__);
+	FFTComplex *line = (FFTComplex *)MEM_mallocN(sizeof(FFTComplex) * height, __func__);
+
+	/* Gather a block of columns, so every row is read in one go. */
+	for (int y = 0; y < height; y++) {
+		const FFTComplex *row = task->data + (size_t)y * width;
+		for (int x = xmin; x < xmax; x++) {
+			columns[(x - xmin) * height + y] = row[x];
+		}
+	}
+
+	for (int x = xmin; x < xmax; x++) {
+		FFTComplex *column = columns + (x - xmin) * height;
+		fft_execute(task->plan, column, line);
+		memcpy(column, line, sizeof(FFTComplex) * height);
+	}
+
+	for (int y = 0; y < height; y++) {
+		FFTComplex *row = task->data + (size_t)y * width;
+		for (int x = xmin; x < xmax; x++) {
+			row[x] = columns[(x - xmin) * height + y];
+		}
+	}
+
+	MEM_freeN(line);
+	MEM_freeN(columns);
+}
+
+typedef struct FFTMultiplyData {
+	FFTComplex *result;
+	const FFTComplex *spectrum;
+	const FFTComplex *kernel;
+	int width;
+	int height;
+	bool separate_channels;
+	float scale;
+} FFTMultiplyData;
+
+/**
+ * Product of two spectra that each hold two real signals, in the real and
+ * imaginary part. Uses the symmetry of the spectra of real signals, X(-f) =
+ * conj(X(f)), to multiply the first signals with each other and the second
+ * signals with each other.
+ */
+static inline FFTComplex fft_multiply_separate(const FFTComplex z, const FFTComplex nz,
+                                               const FFTComplex k, const FFTComplex nk)
+{
+	const FFTComplex p = complex_mul(complex_add(z, complex_conj(nz)), complex_add(k, complex_conj(nk)));
+	const FFTComplex q = complex_mul(complex_sub(z, complex_conj(nz)), complex_sub(k, complex_conj(nk)));
+	FFTComplex r = {0.25f * (p.re + q.im), 0.25f * (p.im - q.re)};
+	return r;
+}
+
+static inline FFTComplex fft_scale(const FFTComplex a, const float scale)
+{
+	FFTComplex r = {a.re * scale, a.im * scale};
+	return r;
+}
+
+/* Multiplies row ky together with row -ky, which holds the mirrored frequencies. */
+static void fft_multiply_task(void *__restrict userdata,
+                              const int ky,
+                              const ParallelRangeTLS *__restrict /*tls*/)
+{
+	const FFTMultiplyData *task = (const FFTMultiplyData *)userdata;
+	const int width = task->width;
+	const int nky = (task->height - ky) % task->height;
+	const size_t row_offset = (size_t)ky * width;
+	const size_t nrow_offset = (size_t)nky * width;
+	const FFTComplex *row = task->spectrum + row_offset, *nrow = task->spectrum + nrow_offset;
+	const FFTComplex *krow = task->kernel + row_offset, *knrow = task->kernel + nrow_offset;
+	FFTComplex *result = task->result + row_offset, *nresult = task->result + nrow_offset;
+
+	if (!task->separate_channels) {
+		for (int kx = 0; kx < width; kx++) {
+			result[kx] = fft_scale(complex_mul(row[kx], krow[kx]), task->scale);
+		}
+		if (nky != ky) {
+			for (int kx = 0; kx < width; kx++) {
+				nresult[kx] = fft_scale(complex_mul(nrow[kx], knrow[kx]), task->scale);
+			}
+		}
+		return;
+	}
+
+	for (int kx = 0; kx < width; kx++) {
+		const int nkx = (width - kx) % width;
+		if (nky == ky && nkx < kx) {
+			continue;
+		}
+		const FFTComplex z = row[kx], nz = nrow[nkx];
+		const FFTComplex k = krow[kx], nk = knrow[nkx];
+		result[kx] = fft_scale(fft_multiply_separate(z, nz, k, nk), task->scale);
+		nresult[nkx] = fft_scale(fft_multiply_separate(nz, z, nk, k), task->scale);
+	}
+}
+
+typedef struct FFTImageData {
+	FFTComplex *data;
+	int width;
+	int image_width;
+	/* Channels in the real and imaginary part, NULL for none. When filling,
+	 * a NULL real part fills the area of the image with ones. */
+	float *channels[2];
+	int stride;
+	/* Normalization weights of the channels, NULL for none. */
+	const float *weights[2];
+	float min_weight;
+} FFTImageData;
+
+static void fft_fill_row_task(void *__restrict userdata,
+                              const int y,
+                              const ParallelRangeTLS *__restrict /*tls*/)
+{
+	const FFTImageData *task = (const FFTImageData *)userdata;
+	FFTComplex *row = task->data + (size_t)y * task->width;
+	const size_t offset = (size_t)y * task->image_width * task->stride;
+
+	for (int x = 0; x < task->image_width; x++) {
+		const size_t index = offset + (size_t)x * task->stride;
+		row[x].re = task->channels[0] ? task->channels[0][index] : 1.0f;
+		row[x].im = task->channels[1] ? task->channels[1][index] : 0.0f;
+	}
+	memset(row + task->image_width, 0, sizeof(FFTComplex) * (task->width - task->image_width));
+}
+
+static void fft_extract_row_task(void *__restrict userdata,
+                                 const int y,
+                                 const ParallelRangeTLS *__restrict /*tls*/)
+{
+	const FFTImageData *task = (const FFTImageData *)userdata;
+	const FFTComplex *row = task->data + (size_t)y * task->width;
+
+	for (int part = 0; part < 2; part++) {
+		if (task->channels[part] == NULL) {
+			continue;
+		}
+		float *channel = task->channels[part] + (size_t)y * task->image_width * task->stride;
+		const float *weights = task->weights[part] ? task->weights[part] + (size_t)y * task->image_width : NULL;
+		for (int x = 0; x < task->image_width; x++) {
+			float value = part ? row[x].im : row[x].re;
+			if (weights) {
+				value = (weights[x] > task->min_weight) ? value / weights[x] : 0.0f;
+			}
+			channel[(size_t)x * task->stride] = value;
+		}
+	}
+}
+
+/* -------------------------------------------------------------------- */
+/* FFTConvolution */
+
+FFTConvolution::FFTConvolution(MemoryBuffer *kernel, int kernelChannels, int imageWidth, int imageHeight)
+{
+	const int kernelWidth = kernel->getWidth();
+	const int kernelHeight = kernel->getHeight();
+	const int kernelStride = kernel->get_num_channels();
+	const float *kernelBuffer = kernel->getBuffer();
+
+	BLI_assert(kernelChannels >= 1 && kernelChannels <= kernelStride);
+
+	this->m_imageWidth = imageWidth;
+	this->m_imageHeight = imageHeight;
+	/* Padding keeps the cyclic convolution of the transforms from wrapping around. */
+	this->m_width = fft_good_size(imageWidth + kernelWidth - 1);
+	this->m_height = fft_good_size(imageHeight + kernelHeight - 1);
+
+	this->m_rowPlan = fft_plan_create(this->m_width, false);
+	this->m_rowPlanInverse = fft_plan_create(this->m_width, true);
+	this->m_columnPlan = fft_plan_create(this->m_height, false);
+	this->m_columnPlanInverse = fft_plan_create(this->m_height, true);
+
+	this->m_kernelChannels = kernelChannels;
+	const int numSpectra = (kernelChannels + 1) / 2;
+	this->m_kernelSpectra = (FFTComplex **)MEM_mallocN(sizeof(FFTComplex *) * numSpectra, "FFTConvolution kernel spectra");
+
+	/* The center of the kernel goes to the origin, the rest wraps around. */
+	const int centerX = kernelWidth / 2;
+	const int centerY = kernelHeight / 2;
+	float maxSum = 0.0f;
+	for (int index = 0; index < numSpectra; index++) {
+		const int channel = 2 * index;
+		FFTComplex *spectrum = (FFTComplex *)MEM_callocN(sizeof(FFTComplex) * this->m_width * this->m_height,
+		                                                 "FFTConvolution kernel spectrum");
+		float sum[2] = {0.0f, 0.0f};
+		for (int y = 0; y < kernelHeight; y++) {
+			const int row = (y - centerY + this->m_height) % this->m_height;
+			for (int x = 0; x < kernelWidth; x++) {
+				const int column = (x - centerX + this->m_width) % this->m_width;
+				const float *pixel = kernelBuffer + ((size_t)y * kernelWidth + x) * kernelStride + channel;
+				FFTComplex *value = &spectrum[(size_t)row * this->m_width + column];
+				value->re = pixel[0];
+				value->im = (channel + 1 < kernelChannels) ? pixel[1] : 0.0f;
+				sum[0] += fabsf(value->re);
+				sum[1] += fabsf(value->im);
+			}
+		}
+		maxSum = max_fff(maxSum, sum[0], sum[1]);
+		transform(spectrum, this->m_height, false);
+		this->m_kernelSpectra[index] = spectrum;
+	}
+
+	/* Well above the rounding errors of the transforms. */
+	this->m_minWeight = maxSum * 1e-5f;
+}
+
+FFTConvolution::~FFTConvolution()
+{
+	const int numSpectra = (this->m_kernelChannels + 1) / 2;
+	for (int index = 0; index < numSpectra; index++) {
+		MEM_freeN(this->m_kernelSpectra[index]);
+	}
+	MEM_freeN(this->m_kernelSpectra);
+
+	fft_plan_free(this->m_rowPlan);
+	fft_plan_free(this->m_rowPlanInverse);
+	fft_plan_free(this->m_columnPlan);
+	fft_plan_free(this->m_columnPlanInverse);
+}
+
+void FFTConvolution::transform(FFTComplex *data, int numRows, bool inverse)
+{
+	ParallelRangeSettings settings;
+	BLI_parallel_range_settings_defaults(&settings);
+	settings.scheduling_mode = TASK_SCHEDULING_DYNAMIC;
+
+	FFTTransformData rows;
+	rows.data = data;
+	rows.plan = inverse ? this->m_rowPlanInverse : this->m_rowPlan;
+	rows.width = this->m_width;
+	rows.num_lines = numRows;
+
+	FFTTransformData columns;
+	columns.data = data;
+	columns.plan = inverse ? this->m_columnPlanInverse : this->m_columnPlan;
+	columns.width = this->m_width;
+	columns.num_lines = this->m_width;
+
+	const int numRowTasks = (numRows + FFT_LINES_PER_TASK - 1) / FFT_LINES_PER_TASK;
+	const int numColumnTasks = (this->m_width + FFT_LINES_PER_TASK - 1) / FFT_LINES_PER_TASK;
+
+	/* Only the first rows hold data, the transform of the others is only needed
+	 * after the columns are transformed back. */
+	if (inverse) {
+		BLI_task_parallel_range(0, numColumnTasks, &columns, fft_columns_task, &settings);
+		BLI_task_parallel_range(0, numRowTasks, &rows, fft_rows_task, &settings);
+	}
+	else {
+		BLI_task_parallel_range(0, numRowTasks, &rows, fft_rows_task, &settings);
+		BLI_task_parallel_range(0, numColumnTasks, &columns, fft_columns_task, &settings);
+	}
+}
+
+void FFTConvolution::multiply(FFTComplex *result, const FFTComplex *spectrum, int kernelSpectrum, bool separateChannels)
+{
+	ParallelRangeSettings settings;
+	BLI_parallel_range_settings_defaults(&settings);
+
+	FFTMultiplyData data;
+	data.result = result;
+	data.spectrum = spectrum;
+	data.kernel = this->m_kernelSpectra[kernelSpectrum];
+	data.width = this->m_width;
+	data.height = this->m_height;
+	data.separate_channels = separateChannels;
+	/* Normalization of the inverse transform. */
+	data.scale = 1.0f / ((float)this->m_width * (float)this->m_height);
+
+	BLI_task_parallel_range(0, this->m_height / 2 + 1, &data, fft_multiply_task, &settings);
+}
+
+void FFTConvolution::convolve(MemoryBuffer *input, MemoryBuffer *output, int numChannels, bool normalize)
+{
+	BLI_assert(input->getWidth() == this->m_imageWidth && input->getHeight() == this->m_imageHeight);
+	BLI_assert(output->getWidth() == this->m_imageWidth && output->getHeight() == this->m_imageHeight);
+	BLI_assert(input->get_num_channels() == output->get_num_channels());
+	BLI_assert(this->m_kernelChannels == 1 || numChannels <= this->m_kernelChannels);
+
+	const size_t imageSize = (size_t)this->m_imageWidth * this->m_imageHeight;
+	const size_t size = (size_t)this->m_width * this->m_height;
+	const size_t paddingOffset = (size_t)this->m_imageHeight * this->m_width;
+	FFTComplex *data = (FFTComplex *)MEM_mallocN(sizeof(FFTComplex) * size, "FFTConvolution data");
+
+	ParallelRangeSettings settings;
+	BLI_parallel_range_settings_defaults(&settings);
+
+	FFTImageData image;
+	image.width = this->m_width;
+	image.image_width = this->m_imageWidth;
+	image.min_weight = this->m_minWeight;
+
+	float *weights = NULL;
+	if (normalize) {
+		/* The sum of the kernel weights inside of the image is the
+		 * convolution of the kernel with the area of the image. */
+		FFTComplex *mask = (FFTComplex *)MEM_mallocN(sizeof(FFTComplex) * size, "FFTConvolution mask");
+		image.data = mask;
+		image.channels[0] = image.channels[1] = NULL;
+		image.weights[0] = image.weights[1] = NULL;
+		image.stride = 1;
+		BLI_task_parallel_range(0, this->m_imageHeight, &image, fft_fill_row_task, &settings);
+		memset(mask + paddingOffset, 0, sizeof(FFTComplex) * (size - paddingOffset));
+		transform(mask, this->m_imageHeight, false);
+
+		weights = (float *)MEM_mallocN(sizeof(float) * imageSize * this->m_kernelChannels, "FFTConvolution weights");
+		image.data = data;
+		for (int channel = 0; channel < this->m_kernelChannels; channel += 2) {
+			multiply(data, mask, channel / 2, false);
+			transform(data, this->m_imageHeight, true);
+			image.channels[0] = weights + channel * imageSize;
+			image.channels[1] = (channel + 1 < this->m_kernelChannels) ? weights + (channel + 1) * imageSize : NULL;
+			BLI_task_parallel_range(0, this->m_imageHeight, &image, fft_extract_row_task, &settings);
+		}
+		MEM_freeN(mask);
+	}
+
+	image.data = data;
+	image.stride = input->get_num_channels();
+	for (int channel = 0; channel < numChannels; channel += 2) {
+		const bool pair = (channel + 1 < numChannels);
+
+		image.channels[0] = input->getBuffer() + channel;
+		image.channels[1] = pair ? input->getBuffer() + channel + 1 : NULL;
+		image.weights[0] = image.weights[1] = NULL;
+		BLI_task_parallel_range(0, this->m_imageHeight, &image, fft_fill_row_task, &settings);
+		memset(data + paddingOffset, 0, sizeof(FFTComplex) * (size - paddingOffset));
+
+		transform(data, this->m_imageHeight, false);
+		if (this->m_kernelChannels == 1) {
+			multiply(data, data, 0, false);
+		}
+		else {
+			multiply(data, data, channel / 2, true);
+		}
+		transform(data, this->m_imageHeight, true);
+
+		image.channels[0] = output->getBuffer() + channel;
+		image.channels[1] = pair ? output->getBuffer() + channel + 1 : NULL;
+		if (weights) {
+			const int weightChannel = (this->m_kernelChannels == 1) ? 0 : channel;
+			image.weights[0] = weights + weightChannel * imageSize;
+			image.weights[1] = pair ? weights + (weightChannel + (this->m_kernelChannels == 1 ? 0 : 1)) * imageSize : NULL;
+		}
+		BLI_task_parallel_range(0, this->m_imageHeight, &image, fft_extract_row_task, &settings);
+	}
+
+	if (weights) {
+		MEM_freeN(weights);
+	}
+	MEM_freeN(data);
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright 2018, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef __COM_FFTCONVOLUTION_H__
+#define __COM_FFTCONVOLUTION_H__
+
+class MemoryBuffer;
+struct FFTComplex;
+struct FFTPlan;
+
+/**
+ * Number of kernel pixels (width * height) from which convolution through
+ * FFTConvolution is faster than summing the kernel for every pixel.
+ */
+#define COM_FFT_CONVOLUTION_MIN_KERNEL_SIZE (33 * 33)
+
+/**
+ * @brief Convolution of images with a fixed kernel through the fast Fourier transform.
+ *
+ * The cost of the convolution does not depend on the size of the kernel, so it
+ * replaces direct convolution for large blur radii. Images are padded to sizes
+ * with only 2, 3 and 5 as prime factors instead of powers of two, and the rows
+ * and columns of the transforms are computed in parallel.
+ *
+ * The spectrum of the kernel is computed once by the constructor, an instance
+ * can then convolve any number of images of the given size.
+ *
+ * @ingroup Execution
+ */
+class FFTConvolution {
+private:
+	int m_imageWidth;
+	int m_imageHeight;
+
+	/**
+	 * @brief padded size of the transforms
+	 */
+	int m_width;
+	int m_height;
+
+	FFTPlan *m_rowPlan;
+	FFTPlan *m_rowPlanInverse;
+	FFTPlan *m_columnPlan;
+	FFTPlan *m_columnPlanInverse;
+
+	/**
+	 * @brief spectra of the kernel channels, two channels packed in each spectrum
+	 */
+	FFTComplex **m_kernelSpectra;
+	int m_kernelChannels;
+
+	/**
+	 * @brief weights below this value are treated as no coverage when normalizing
+	 */
+	float m_minWeight;
+
+	void transform(FFTComplex *data, int numRows, bool inverse);
+	void multiply(FFTComplex *result, const FFTComplex *spectrum, int kernelSpectrum, bool separateChannels);
+
+public:
+	/**
+	 * @brief compute the spectrum of the kernel for images of the given size
+	 * @param kernel: buffer of the kernel, the pixel at (width / 2, height / 2) is its center
+	 * @param kernelChannels: number of channels of the kernel to use, 1 to use the
+	 * first channel for all channels of the images
+	 */
+	FFTConvolution(MemoryBuffer *kernel, int kernelChannels, int imageWidth, int imageHeight);
+	~FFTConvolution();
+
+	/**
+	 * @brief convolve the first channels of an image with the kernel
+	 * @param input: image of the size given to the constructor
+	 * @param output: buffer of the same size, other channels are left untouched
+	 * @param numChannels: number of channels to convolve
+	 * @param normalize: divide by the sum of the kernel weights that fall inside of
+	 * the image, so borders are not darkened by the pixels outside of it
+	 */
+	void convolve(MemoryBuffer *input, MemoryBuffer *output, int numChannels, bool normalize);
+};
+
+#endif
@@ -0,0 +1,388 @@
+/*
+ * Copyright 2018, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <typeinfo>
+
+#include "COM_FullFrameExecution.h"
+
+#include "COM_BufferOperation.h"
+#include "COM_ReadBufferOperation.h"
+#include "COM_WorkScheduler.h"
+#include "COM_WriteBufferOperation.h"
+
+extern "C" {
+#include "BLI_rect.h"
+#include "BLI_string.h"
+#include "BLI_task.h"
+}
+
+#include "BLT_translation.h"
+
+#ifdef WITH_CXX_GUARDEDALLOC
+#include "MEM_guardedalloc.h"
+#endif
+
+/* Rows of an operation computed by a single task. */
+#define COM_FULL_FRAME_ROWS_PER_TASK 16
+
+FullFrameExecution::FullFrameExecution(const CompositorContext &context, const Operations &operations) :
+	m_context(context),
+	m_operations(operations)
+{
+	/* final renders always execute everything */
+	this->m_useCache = !context.isRendering();
+	this->m_contextKey = (this->m_useCache) ? NodeCache::hashContext(context) : 0;
+}
+
+void FullFrameExecution::execute()
+{
+	const bNodeTree *tree = this->m_context.getbNodeTree();
+
+	Operations order;
+	determineOrder(order);
+
+	for (unsigned int index = 0; index < order.size(); index++) {
+		if (isBreaked()) {
+			break;
+		}
+
+		/* other operations are computed when an operation needs them */
+		NodeOperation *operation = order[index];
+		if (!this->m_useCache || isKeyedByContent(operation) ||
+		    operation->getNumberOfOutputSockets() == 0 ||
+		    operation->isOutputOperation(this->m_context.isRendering()))
+		{
+			computeOperation(operation);
+		}
+		else {
+			determineKey(operation);
+		}
+
+		tree->progress(tree->prh, (float)(index + 1) / order.size());
+
+		char buf[128];
+		BLI_snprintf(buf, sizeof(buf), IFACE_("Compositing | Operation %u-%u"),
+		             index + 1, (unsigned int)order.size());
+		tree->stats_draw(tree->sdh, buf);
+	}
+
+	for (unsigned int index = 0; index < this->m_deferredOperations.size(); index++) {
+		this->m_deferredOperations[index]->deinitExecution();
+	}
+	this->m_deferredOperations.clear();
+
+	/* buffers left when execution was canceled */
+	for (std::map<NodeOperation *, OperationBuffer>::iterator it = this->m_buffers.begin(); it != this->m_buffers.end(); ++it) {
+		if (it->second.buffer) {
+			if (it->second.cached) {
+				NodeCache::release(it->second.key);
+			}
+			else {
+				delete it->second.buffer;
+			}
+		}
+	}
+	this->m_buffers.clear();
+}
+
+void FullFrameExecution::addOperationsRecursive(Operations &order, std::set<NodeOperation *> &visited, NodeOperation *operation)
+{
+	if (visited.find(operation) != visited.end())
+		return;
+	visited.insert(operation);
+
+	for (unsigned int index = 0; index < operation->getNumberOfInputSockets(); index++) {
+		NodeOperationInput *input = operation->getInputSocket(index);
+		if (input->isConnected())
+			addOperationsRecursive(order, visited, &input->getLink()->getOperation());
+	}
+
+	/* buffers of nodes which use them explicitly, like group buffers */
+	if (operation->isReadBufferOperation()) {
+		ReadBufferOperation *read_operation = (ReadBufferOperation *)operation;
+		addOperationsRecursive(order, visited, read_operation->getMemoryProxy()->getWriteBufferOperation());
+	}
+
+	order.push_back(operation);
+}
+
+void FullFrameExecution::determineOrder(Operations &order)
+{
+	const CompositorPriority priorities[3] = {COM_PRIORITY_HIGH, COM_PRIORITY_MEDIUM, COM_PRIORITY_LOW};
+	const int num_priorities = this->m_context.isFastCalculation() ? 1 : 3;
+	std::set<NodeOperation *> visited;
+
+	/* outputs of higher priority are executed first */
+	for (int priority = 0; priority < num_priorities; priority++) {
+		for (unsigned int index = 0; index < this->m_operations.size(); index++) {
+			NodeOperation *operation = this->m_operations[index];
+			if (operation->isOutputOperation(this->m_context.isRendering()) &&
+			    operation->getRenderPriority() == priorities[priority])
+			{
+				addOperationsRecursive(order, visited, operation);
+			}
+		}
+	}
+
+	/* count the readers of each output buffer */
+	for (unsigned int index = 0; index < order.size(); index++) {
+		NodeOperation *operation = order[index];
+		for (unsigned int i = 0; i < operation->getNumberOfInputSockets(); i++) {
+			NodeOperationInput *input = operation->getInputSocket(i);
+			if (input->isConnected())
+				this->m_buffers[&input->getLink()->getOperation()].readers++;
+		}
+	}
+}
+
+bool FullFrameExecution::isKeyedByContent(NodeOperation *operation) const
+{
+	return operation->isInputOperation() || operation->usesExternalData();
+}
+
+bool FullFrameExecution::isCacheable(NodeOperation *operation) const
+{
+	/* simple operations are cheap to compute again from cached inputs */
+	return this->m_useCache && operation->isComplex() && !isKeyedByContent(operation) &&
+	       operation->getNumberOfOutputSockets() > 0;
+}
+
+void FullFrameExecution::determineKey(NodeOperation *operation)
+{
+	const char *type = typeid(*operation).name();
+	const NodeCacheKey settings = operation->getSettingsKey();
+	const unsigned int resolution[2] = {operation->getWidth(), operation->getHeight()};
+	const DataType datatype = operation->getOutputSocket()->getDataType();
+
+	NodeCacheKey key = NodeCache::hashData(this->m_contextKey, type, strlen(type));
+	key = NodeCache::hashData(key, &settings, sizeof(settings));
+	key = NodeCache::hashData(key, resolution, sizeof(resolution));
+	key = NodeCache::hashData(key, &datatype, sizeof(datatype));
+
+	for (unsigned int index = 0; index < operation->getNumberOfInputSockets(); index++) {
+		NodeOperationInput *input = operation->getInputSocket(index);
+		const NodeCacheKey input_key = (input->isConnected()) ? this->m_buffers[&input->getLink()->getOperation()].key : 0;
+		key = NodeCache::hashData(key, &input_key, sizeof(input_key));
+	}
+
+	this->m_buffers[operation].key = key;
+}
+
+void FullFrameExecution::computeOperation(NodeOperation *operation)
+{
+	OperationBuffer &state = this->m_buffers[operation];
+	if (state.done) {
+		return;
+	}
+
+	if (isCacheable(operation)) {
+		MemoryBuffer *buffer = NodeCache::acquire(state.key);
+		if (buffer) {
+			state.buffer = buffer;
+			state.cached = true;
+			state.done = true;
+			releaseInputs(operation);
+			return;
+		}
+	}
+
+	for (unsigned int index = 0; index < operation->getNumberOfInputSockets(); index++) {
+		NodeOperationInput *input = operation->getInputSocket(index);
+		if (input->isConnected())
+			computeOperation(&input->getLink()->getOperation());
+	}
+
+	/* inputs are not complete after canceling */
+	if (isBreaked()) {
+		return;
+	}
+
+	executeOperation(operation);
+}
+
+void FullFrameExecution::executeOperation(NodeOperation *operation)
+{
+	this->m_buffers[operation].done = true;
+
+	const unsigned int num_inputs = operation->getNumberOfInputSockets();
+	std::vector<NodeOperationOutput *> links(num_inputs, (NodeOperationOutput *)NULL);
+	std::vector<BufferOperation *> readers(num_inputs, (BufferOperation *)NULL);
+	std::vector<MemoryBuffer *> inputs(num_inputs, (MemoryBuffer *)NULL);
+
+	/* link the operation to readers of the input buffers, which must happen
+	 * before initialization as operations keep their input readers */
+	for (unsigned int index = 0; index < num_inputs; index++) {
+		NodeOperationInput *input = operation->getInputSocket(index);
+		if (!input->isConnected())
+			continue;
+
+		NodeOperation *input_operation = &input->getLink()->getOperation();
+		links[index] = input->getLink();
+		inputs[index] = this->m_buffers[input_operation].buffer;
+		readers[index] = new BufferOperation(inputs[index], input_operation);
+		input->setLink(readers[index]->getOutputSocket());
+	}
+
+	if (operation->isReadBufferOperation()) {
+		((ReadBufferOperation *)operation)->updateMemoryBuffer();
+	}
+
+	operation->setbNodeTree(this->m_context.getbNodeTree());
+	operation->initExecution();
+
+	MemoryBuffer *output = NULL;
+	if (operation->getNumberOfOutputSockets() > 0) {
+		/* operations without resolution store a single value */
+		rcti rect;
+		BLI_rcti_init(&rect, 0, max(operation->getWidth(), 1u), 0, max(operation->getHeight(), 1u));
+		output = new MemoryBuffer(operation->getOutputSocket()->getDataType(), &rect);
+		this->m_buffers[operation].buffer = output;
+	}
+
+	executeRows(operation, output, (num_inputs) ? &inputs[0] : NULL);
+
+	if (operation->isWriteBufferOperation()) {
+		this->m_deferredOperations.push_back(operation);
+	}
+	else {
+		operation->deinitExecution();
+	}
+
+	if (output && this->m_useCache && !isBreaked()) {
+		OperationBuffer &state = this->m_buffers[operation];
+		if (isKeyedByContent(operation)) {
+			state.key = NodeCache::hashBuffer(output);
+		}
+		else if (isCacheable(operation) && NodeCache::insert(state.key, output)) {
+			state.cached = true;
+		}
+	}
+
+	for (unsigned int index = 0; index < num_inputs; index++) {
+		if (readers[index]) {
+			operation->getInputSocket(index)->setLink(links[index]);
+			delete readers[index];
+		}
+	}
+	releaseInputs(operation);
+
+	if (output && this->m_buffers[operation].readers == 0) {
+		/* output that nothing reads, like previews of unused sockets */
+		this->m_buffers[operation].readers = 1;
+		releaseBuffer(operation);
+	}
+}
+
+typedef struct FullFrameRowsData {
+	NodeOperation *operation;
+	MemoryBuffer *output;
+	MemoryBuffer **inputs;
+	int width;
+	int height;
+	int rows_per_task;
+} FullFrameRowsData;
+
+static void full_frame_rows_task(void *__restrict userdata,
+                                 const int index,
+                                 const ParallelRangeTLS *__restrict tls)
+{
+	FullFrameRowsData *data = (FullFrameRowsData *)userdata;
+
+	WorkScheduler::set_task_thread_id(tls->thread_id);
+
+	if (data->operation->isBreaked()) {
+		return;
+	}
+
+	rcti area;
+	const int ymin = index * data->rows_per_task;
+	BLI_rcti_init(&area, 0, data->width, ymin, min(ymin + data->rows_per_task, data->height));
+
+	if (data->output) {
+		data->operation->updateMemoryBuffer(data->output, &area, data->inputs);
+	}
+	else {
+		data->operation->executeRegion(&area, index);
+	}
+}
+
+void FullFrameExecution::executeRows(NodeOperation *operation, MemoryBuffer *output, MemoryBuffer **inputs)
+{
+	FullFrameRowsData data;
+	data.operation = operation;
+	data.output = output;
+	data.inputs = inputs;
+	data.width = (output) ? output->getWidth() : operation->getWidth();
+	data.height = (output) ? output->getHeight() : operation->getHeight();
+	data.rows_per_task = (operation->isSingleThreaded()) ? data.height : COM_FULL_FRAME_ROWS_PER_TASK;
+
+	if (data.width == 0 || data.height == 0) {
+		return;
+	}
+
+	ParallelRangeSettings settings;
+	BLI_parallel_range_settings_defaults(&settings);
+	settings.scheduling_mode = TASK_SCHEDULING_DYNAMIC;
+
+	const int num_tasks = (data.height + data.rows_per_task - 1) / data.rows_per_task;
+	BLI_task_parallel_range(0, num_tasks, &data, full_frame_rows_task, &settings);
+
+	if (output) {
+		output->setCreatedState();
+	}
+}
+
+void FullFrameExecution::releaseInputs(NodeOperation *operation)
+{
+	for (unsigned int index = 0; index < operation->getNumberOfInputSockets(); index++) {
+		NodeOperationInput *input = operation->getInputSocket(index);
+		if (input->isConnected())
+			releaseBuffer(&input->getLink()->getOperation());
+	}
+}
+
+void FullFrameExecution::releaseBuffer(NodeOperation *operation)
+{
+	OperationBuffer &buffer = this->m_buffers[operation];
+	buffer.readers--;
+	if (buffer.readers > 0) {
+		return;
+	}
+
+	if (buffer.buffer) {
+		if (buffer.cached) {
+			NodeCache::release(buffer.key);
+		}
+		else {
+			delete buffer.buffer;
+		}
+		buffer.buffer = NULL;
+	}
+
+	/* no reader needed the operation, so neither are its inputs */
+	if (!buffer.done) {
+		buffer.done = true;
+		releaseInputs(operation);
+	}
+}
+
+bool FullFrameExecution::isBreaked() const
+{
+	const bNodeTree *tree = this->m_context.getbNodeTree();
+	return tree->test_break(tree->tbh);
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright 2018, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _COM_FullFrameExecution_h
+#define _COM_FullFrameExecution_h
+
+#include <map>
+#include <set>
+#include <vector>
+
+#include "COM_CompositorContext.h"
+#include "COM_NodeCache.h"
+#include "COM_NodeOperation.h"
+
+/**
+ * @brief Executes the operations of an ExecutionSystem on full frame buffers.
+ *
+ * Instead of pulling every pixel of a chunk through the chain of operations
+ * of an ExecutionGroup, each operation computes its whole output buffer at
+ * once, in dependency order, from the output buffers of its inputs. Buffers
+ * are freed as soon as all operations reading them are done.
+ *
+ * Rows of an operation are computed in parallel, operations that have no
+ * output socket (viewers, composite, write buffers) get executeRegion calls
+ * for those rows instead.
+ *
+ * When editing, every operation gets a key from its settings and the keys of
+ * its inputs. Results of complex operations are kept in the NodeCache, and
+ * operations are only executed when an operation that always executes needs
+ * them. Those are outputs, and operations without settings to hash (inputs,
+ * nodes using data-blocks), which are keyed by the pixels of their result.
+ *
+ * @see NodeOperation.updateMemoryBuffer
+ * @ingroup Execution
+ */
+class FullFrameExecution {
+private:
+	typedef std::vector<NodeOperation *> Operations;
+
+	/**
+	 * @brief output buffer of an operation, and the number of inputs that
+	 * still need to read it
+	 */
+	typedef struct OperationBuffer {
+		MemoryBuffer *buffer;
+		int readers;
+		/** key of the output when the cache is used */
+		NodeCacheKey key;
+		/** the buffer belongs to the cache */
+		bool cached;
+		/** executed, taken from the cache or not needed anymore */
+		bool done;
+	} OperationBuffer;
+
+	const CompositorContext &m_context;
+	const Operations &m_operations;
+
+	bool m_useCache;
+	NodeCacheKey m_contextKey;
+
+	std::map<NodeOperation *, OperationBuffer> m_buffers;
+
+	/**
+	 * @brief write buffer operations keep their memory proxy until all
+	 * operations are executed
+	 */
+	Operations m_deferredOperations;
+
+public:
+	FullFrameExecution(const CompositorContext &context, const Operations &operations);
+
+	/**
+	 * @brief execute all operations needed for the output operations
+	 * @note output operations of low and medium priority are skipped for fast calculations
+	 */
+	void execute();
+
+private:
+	void determineOrder(Operations &order);
+	void addOperationsRecursive(Operations &order, std::set<NodeOperation *> &visited, NodeOperation *operation);
+	bool isKeyedByContent(NodeOperation *operation) const;
+	bool isCacheable(NodeOperation *operation) const;
+	void determineKey(NodeOperation *operation);
+	void computeOperation(NodeOperation *operation);
+	void executeOperation(NodeOperation *operation);
+	void executeRows(NodeOperation *operation, MemoryBuffer *output, MemoryBuffer **inputs);
+	void releaseInputs(NodeOperation *operation);
+	void releaseBuffer(NodeOperation *operation);
+	bool isBreaked() const;
+
+#ifdef WITH_CXX_GUARDEDALLOC
+	MEM_CXX_CLASS_ALLOC_FUNCS("COM:FullFrameExecution")
+#endif
+};
+
+#endif
@@ -0,0 +1,290 @@
+/*
+ * Copyright 2018, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include <map>
+
+#include "COM_NodeCache.h"
+#include "COM_CompositorContext.h"
+#include "COM_MemoryBuffer.h"
+
+#include "MEM_CacheLimiterC-Api.h"
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#  include "BLI_utildefines.h"
+#  include "DNA_camera_types.h"
+#  include "DNA_color_types.h"
+#  include "DNA_genfile.h"
+#  include "DNA_node_types.h"
+#  include "DNA_object_types.h"
+#  include "DNA_scene_types.h"
+#  include "DNA_sdna_types.h"
+#  include "BKE_node.h"
+}
+
+typedef struct NodeCacheEntry {
+	NodeCacheKey key;
+	MemoryBuffer *buffer;
+	MEM_CacheLimiterHandleC *handle;
+} NodeCacheEntry;
+
+typedef std::map<NodeCacheKey, NodeCacheEntry *> NodeCacheEntries;
+
+static MEM_CacheLimiterC *g_limiter = NULL;
+static NodeCacheEntries g_entries;
+
+/* called by the limiter for the entries it frees */
+static void node_cache_destructor(void *data)
+{
+	NodeCacheEntry *entry = (NodeCacheEntry *)data;
+	g_entries.erase(entry->key);
+	delete entry->buffer;
+	delete entry;
+}
+
+static size_t node_cache_entry_size(void *data)
+{
+	NodeCacheEntry *entry = (NodeCacheEntry *)data;
+	MemoryBuffer *buffer = entry->buffer;
+	return sizeof(float) * buffer->getWidth() * buffer->getHeight() * buffer->get_num_channels();
+}
+
+/* MurmurHash64A, by Austin Appleby */
+NodeCacheKey NodeCache::hashData(NodeCacheKey key, const void *data, size_t size)
+{
+	const uint64_t m = 0xc6a4a7935bd1e995ULL;
+	const int r = 47;
+	const unsigned char *bytes = (const unsigned char *)data;
+	const unsigned char *end = bytes + (size & ~(size_t)7);
+	uint64_t h = key ^ (size * m);
+
+	for (; bytes != end; bytes += 8) {
+		uint64_t k;
+		memcpy(&k, bytes, sizeof(k));
+		k *= m;
+		k ^= k >> r;
+		k *= m;
+		h ^= k;
+		h *= m;
+	}
+
+	switch (size & 7) {
+		case 7: h ^= (uint64_t)bytes[6] << 48; ATTR_FALLTHROUGH;
+		case 6: h ^= (uint64_t)bytes[5] << 40; ATTR_FALLTHROUGH;
+		case 5: h ^= (uint64_t)bytes[4] << 32; ATTR_FALLTHROUGH;
+		case 4: h ^= (uint64_t)bytes[3] << 24; ATTR_FALLTHROUGH;
+		case 3: h ^= (uint64_t)bytes[2] << 16; ATTR_FALLTHROUGH;
+		case 2: h ^= (uint64_t)bytes[1] << 8; ATTR_FALLTHROUGH;
+		case 1: h ^= (uint64_t)bytes[0]; h *= m; break;
+	}
+
+	h ^= h >> r;
+	h *= m;
+	h ^= h >> r;
+	return h;
+}
+
+/* Hash the members of a DNA struct, except pointers. These differ between the
+ * copies of the node tree and data-blocks made for every execution, while what
+ * they point to may be the same. */
+static NodeCacheKey node_cache_hash_struct(NodeCacheKey key, const SDNA *sdna, int struct_nr, const char *data)
+{
+	const short *sp = sdna->structs[struct_nr];
+	const int num_members = sp[1];
+
+	sp += 2;
+	for (int a = 0; a < num_members; a++, sp += 2) {
+		const char *type = sdna->types[sp[0]];
+		const char *name = sdna->names[sp[1]];
+		const int array_size = DNA_elem_array_size(name);
+
+		if (name[0] == '*' || (name[0] == '(' && name[1] == '*')) {
+			data += sdna->pointerlen * array_size;
+			continue;
+		}
+
+		const int size = sdna->typelens[sp[0]];
+		const int member_struct_nr = DNA_struct_find_nr(sdna, type);
+
+		if (member_struct_nr != -1) {
+			for (int i = 0; i < array_size; i++) {
+				key = node_cache_hash_struct(key, sdna, member_struct_nr, data + i * size);
+			}
+		}
+		else {
+			key = NodeCache::hashData(key, data, size * array_size);
+		}
+
+		data += size * array_size;
+	}
+
+	return key;
+}
+
+/* Hash a DNA struct by name, or all of its bytes when it is not a DNA struct. */
+static NodeCacheKey node_cache_hash_dna(NodeCacheKey key, const char *struct_name, const void *data, size_t size)
+{
+	const SDNA *sdna = DNA_sdna_current_get();
+	const int struct_nr = DNA_struct_find_nr(sdna, struct_name);
+
+	if (struct_nr == -1) {
+		return NodeCache::hashData(key, data, size);
+	}
+	return node_cache_hash_struct(key, sdna, struct_nr, (const char *)data);
+}
+
+NodeCacheKey NodeCache::hashNode(bNode *node)
+{
+	NodeCacheKey key = hashData(0, &node->type, sizeof(node->type));
+	key = hashData(key, &node->custom1, sizeof(node->custom1));
+	key = hashData(key, &node->custom2, sizeof(node->custom2));
+	key = hashData(key, &node->custom3, sizeof(node->custom3));
+	key = hashData(key, &node->custom4, sizeof(node->custom4));
+
+	if (node->storage) {
+		key = node_cache_hash_dna(key, node->typeinfo->storagename, node->storage, MEM_allocN_len(node->storage));
+
+		/* curves are not stored in the struct itself */
+		if (STREQ(node->typeinfo->storagename, "CurveMapping")) {
+			CurveMapping *cumap = (CurveMapping *)node->storage;
+			for (int a = 0; a < CM_TOT; a++) {
+				if (cumap->cm[a].curve) {
+					key = hashData(key, cumap->cm[a].curve, sizeof(CurveMapPoint) * cumap->cm[a].totpoint);
+				}
+			}
+		}
+	}
+
+	/* values of unconnected inputs, and of value and color nodes */
+	for (bNodeSocket *sock = (bNodeSocket *)node->inputs.first; sock; sock = sock->next) {
+		if (sock->default_value) {
+			key = hashData(key, sock->default_value, MEM_allocN_len(sock->default_value));
+		}
+	}
+	for (bNodeSocket *sock = (bNodeSocket *)node->outputs.first; sock; sock = sock->next) {
+		if (sock->default_value) {
+			key = hashData(key, sock->default_value, MEM_allocN_len(sock->default_value));
+		}
+	}
+
+	return key;
+}
+
+NodeCacheKey NodeCache::hashContext(const CompositorContext &context)
+{
+	const RenderData *rd = context.getRenderData();
+	const Scene *scene = context.getScene();
+	const CompositorQuality quality = context.getQuality();
+	const int framenumber = context.getFramenumber();
+	const bool fast_calculation = context.isFastCalculation();
+	const char *view_name = context.getViewName();
+
+	NodeCacheKey key = hashData(0, &scene, sizeof(scene));
+	key = hashData(key, &quality, sizeof(quality));
+	key = hashData(key, &framenumber, sizeof(framenumber));
+	key = hashData(key, &fast_calculation, sizeof(fast_calculation));
+	key = hashData(key, &rd->xsch, sizeof(rd->xsch));
+	key = hashData(key, &rd->ysch, sizeof(rd->ysch));
+	key = hashData(key, &rd->size, sizeof(rd->size));
+	if (view_name) {
+		key = hashData(key, view_name, strlen(view_name));
+	}
+
+	/* defocus reads the scene camera */
+	if (scene && scene->camera && scene->camera->type == OB_CAMERA) {
+		const Camera *camera = (const Camera *)scene->camera->data;
+		key = node_cache_hash_dna(key, "Camera", camera, sizeof(*camera));
+		key = hashData(key, scene->camera->obmat, sizeof(scene->camera->obmat));
+		if (camera->dof_ob) {
+			key = hashData(key, camera->dof_ob->obmat, sizeof(camera->dof_ob->obmat));
+		}
+	}
+
+	return key;
+}
+
+NodeCacheKey NodeCache::hashBuffer(MemoryBuffer *buffer)
+{
+	const int width = buffer->getWidth();
+	const int height = buffer->getHeight();
+	const int num_channels = buffer->get_num_channels();
+
+	NodeCacheKey key = hashData(0, &width, sizeof(width));
+	key = hashData(key, &height, sizeof(height));
+	key = hashData(key, &num_channels, sizeof(num_channels));
+	return hashData(key, buffer->getBuffer(), sizeof(float) * width * height * num_channels);
+}
+
+MemoryBuffer *NodeCache::acquire(NodeCacheKey key)
+{
+	NodeCacheEntries::iterator it = g_entries.find(key);
+	if (it == g_entries.end()) {
+		return NULL;
+	}
+
+	NodeCacheEntry *entry = it->second;
+	MEM_CacheLimiter_touch(entry->handle);
+	MEM_CacheLimiter_ref(entry->handle);
+	return entry->buffer;
+}
+
+bool NodeCache::insert(NodeCacheKey key, MemoryBuffer *buffer)
+{
+	if (g_entries.find(key) != g_entries.end()) {
+		return false;
+	}
+
+	if (g_limiter == NULL) {
+		g_limiter = new_MEM_CacheLimiter(node_cache_destructor, node_cache_entry_size);
+	}
+
+	NodeCacheEntry *entry = new NodeCacheEntry();
+	entry->key = key;
+	entry->buffer = buffer;
+	entry->handle = MEM_CacheLimiter_insert(g_limiter, entry);
+	g_entries[key] = entry;
+
+	MEM_CacheLimiter_ref(entry->handle);
+	MEM_CacheLimiter_enforce_limits(g_limiter);
+	return true;
+}
+
+void NodeCache::release(NodeCacheKey key)
+{
+	NodeCacheEntries::iterator it = g_entries.find(key);
+	BLI_assert(it != g_entries.end());
+	if (it != g_entries.end()) {
+		MEM_CacheLimiter_unref(it->second->handle);
+	}
+}
+
+void NodeCache::clear()
+{
+	/* the limiter does not call the destructor for remaining entries */
+	if (g_limiter) {
+		delete_MEM_CacheLimiter(g_limiter);
+		g_limiter = NULL;
+	}
+
+	for (NodeCacheEntries::iterator it = g_entries.begin(); it != g_entries.end(); ++it) {
+		delete it->second->buffer;
+		delete it->second;
+	}
+	g_entries.clear();
+}
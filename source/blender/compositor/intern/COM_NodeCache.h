@@ -0,0 +1,99 @@
+/*
+ * Copyright 2018, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef _COM_NodeCache_h
+#define _COM_NodeCache_h
+
+#include <stddef.h>
+
+#include "BLI_sys_types.h"
+
+class CompositorContext;
+class MemoryBuffer;
+struct bNode;
+
+/**
+ * @brief key of a cached operation result
+ * @see NodeCache
+ */
+typedef uint64_t NodeCacheKey;
+
+/**
+ * @brief Keeps results of complex operations between executions.
+ *
+ * Every edit of a node tree executes the whole tree again. Results of complex
+ * operations (blurs, defocus, glare...) are stored with a key that combines
+ * the settings of the operation with the keys of its inputs, so editing the
+ * end of a tree only executes the operations after the edit.
+ *
+ * The memory of the cache is limited by the memory cache limit of the user
+ * preferences, least recently used results are freed first. Executions are
+ * serialized by COM_execute, so the cache has no locking of its own.
+ *
+ * @see FullFrameExecution
+ * @ingroup Execution
+ */
+class NodeCache {
+public:
+	/**
+	 * @brief hash of the settings and socket values of a node
+	 * @note data-blocks used by the node are not included
+	 */
+	static NodeCacheKey hashNode(bNode *node);
+
+	/**
+	 * @brief hash of the render settings operations can depend on
+	 */
+	static NodeCacheKey hashContext(const CompositorContext &context);
+
+	/**
+	 * @brief hash of the pixels of a buffer, for operations without settings to hash
+	 */
+	static NodeCacheKey hashBuffer(MemoryBuffer *buffer);
+
+	/**
+	 * @brief add data to a key
+	 */
+	static NodeCacheKey hashData(NodeCacheKey key, const void *data, size_t size);
+
+	/**
+	 * @brief get a cached buffer
+	 * @return the buffer, which is not freed until released, or NULL when the key is not cached
+	 */
+	static MemoryBuffer *acquire(NodeCacheKey key);
+
+	/**
+	 * @brief add a buffer to the cache, which takes ownership of it
+	 * @return true when added, the buffer is not freed until released.
+	 * false when the key is cached already, the caller keeps ownership
+	 */
+	static bool insert(NodeCacheKey key, MemoryBuffer *buffer);
+
+	/**
+	 * @brief release a buffer that was acquired or inserted
+	 */
+	static void release(NodeCacheKey key);
+
+	/**
+	 * @brief free all cached buffers
+	 */
+	static void clear();
+};
+
+#endif
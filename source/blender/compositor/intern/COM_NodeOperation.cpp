@@ -22,12 +22,21 @@
 
 #include <typeinfo>
 #include <stdio.h>
+#include <string.h>
 
 #include "COM_defines.h"
 #include "COM_ExecutionSystem.h"
 
 #include "COM_NodeOperation.h" /* own include */
 
+extern "C" {
+#  include "BLI_math_base.h"
+}
+
+/* pixels per call of executeRow, and inputs of operations with row kernels */
+#define COM_ROW_SPAN_SIZE 256
+#define COM_ROW_MAX_INPUTS 4
+
 /*******************
  **** NodeOperation ****
  *******************/
@@ -41,6 +50,8 @@ NodeOperation::NodeOperation()
 	this->m_isResolutionSet = false;
 	this->m_openCL = false;
 	this->m_btree = NULL;
+	this->m_settingsKey = 0;
+	this->m_usesExternalData = false;
 }
 
 NodeOperation::~NodeOperation()
@@ -137,6 +148,116 @@ void NodeOperation::deinitExecution()
 {
 	/* pass */
 }
+
+void NodeOperation::updateMemoryBuffer(MemoryBuffer *output,
+                                       const rcti *area,
+                                       MemoryBuffer **inputs)
+{
+	if (!this->isComplex() && this->updateMemoryBufferRows(output, area, inputs)) {
+		return;
+	}
+
+	float *buffer = output->getBuffer();
+	const rcti *rect = output->getRect();
+	const int width = output->getWidth();
+	const int num_channels = output->get_num_channels();
+	float color[4];
+
+	if (this->isComplex()) {
+		rcti tile = *area;
+		void *data = this->initializeTileData(&tile);
+		for (int y = area->ymin; y < area->ymax; y++) {
+			float *pixel = buffer + ((y - rect->ymin) * width + (area->xmin - rect->xmin)) * num_channels;
+			for (int x = area->xmin; x < area->xmax; x++) {
+				this->read(color, x, y, data);
+				memcpy(pixel, color, sizeof(float) * num_channels);
+				pixel += num_channels;
+			}
+		}
+		if (data) {
+			this->deinitializeTileData(&tile, data);
+		}
+	}
+	else {
+		for (int y = area->ymin; y < area->ymax; y++) {
+			float *pixel = buffer + ((y - rect->ymin) * width + (area->xmin - rect->xmin)) * num_channels;
+			for (int x = area->xmin; x < area->xmax; x++) {
+				this->readSampled(color, x, y, COM_PS_NEAREST);
+				memcpy(pixel, color, sizeof(float) * num_channels);
+				pixel += num_channels;
+			}
+		}
+	}
+}
+
+bool NodeOperation::updateMemoryBufferRows(MemoryBuffer *output, const rcti *area, MemoryBuffer **inputs)
+{
+	const unsigned int num_inputs = this->getNumberOfInputSockets();
+	float single_values[COM_ROW_MAX_INPUTS][COM_ROW_SPAN_SIZE * COM_NUM_CHANNELS_COLOR];
+	const float *rows[COM_ROW_MAX_INPUTS];
+	int input_channels[COM_ROW_MAX_INPUTS];
+	bool is_single_value[COM_ROW_MAX_INPUTS];
+
+	if (num_inputs > COM_ROW_MAX_INPUTS) {
+		return false;
+	}
+
+	/* inputs are read in place when they match the output resolution, single
+	 * values are repeated over a span once */
+	for (unsigned int index = 0; index < num_inputs; index++) {
+		NodeOperation *input_operation = this->getInputOperation(index);
+		MemoryBuffer *input = inputs[index];
+		if (input_operation == NULL || input == NULL) {
+			return false;
+		}
+
+		input_channels[index] = input->get_num_channels();
+		is_single_value[index] = (input_operation->getWidth() == 0 || input_operation->getHeight() == 0);
+
+		if (is_single_value[index]) {
+			const float *value = input->getBuffer();
+			for (int i = 0; i < COM_ROW_SPAN_SIZE; i++) {
+				memcpy(&single_values[index][i * input_channels[index]], value, sizeof(float) * input_channels[index]);
+			}
+			rows[index] = single_values[index];
+		}
+		else if (input->getWidth() != output->getWidth() || input->getHeight() != output->getHeight() ||
+		         input->getRect()->xmin != output->getRect()->xmin ||
+		         input->getRect()->ymin != output->getRect()->ymin)
+		{
+			return false;
+		}
+	}
+
+	float *buffer = output->getBuffer();
+	const rcti *rect = output->getRect();
+	const int width = output->getWidth();
+	const int num_channels = output->get_num_channels();
+
+	/* spans keep the rows of all inputs in cache */
+	for (int y = area->ymin; y < area->ymax; y++) {
+		for (int x = area->xmin; x < area->xmax; x += COM_ROW_SPAN_SIZE) {
+			const int length = min_ii(area->xmax - x, COM_ROW_SPAN_SIZE);
+			const int offset = (y - rect->ymin) * width + (x - rect->xmin);
+
+			for (unsigned int index = 0; index < num_inputs; index++) {
+				if (!is_single_value[index]) {
+					rows[index] = inputs[index]->getBuffer() + offset * input_channels[index];
+				}
+			}
+
+			/* operations decide on a row kernel from their settings, so only
+			 * the first span can fall back to per pixel execution */
+			if (!this->executeRow(buffer + offset * num_channels, rows, length)) {
+				BLI_assert(x == area->xmin && y == area->ymin);
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
 SocketReader *NodeOperation::getInputSocketReader(unsigned int inputSocketIndex)
 {
 	return this->getInputSocket(inputSocketIndex)->getReader();
@@ -36,6 +36,7 @@ extern "C" {
 #include "COM_Node.h"
 #include "COM_MemoryBuffer.h"
 #include "COM_MemoryProxy.h"
+#include "COM_NodeCache.h"
 #include "COM_SocketReader.h"
 
 #include "clew.h"
@@ -125,6 +126,18 @@ private:
 	 * @brief set to truth when resolution for this operation is set
 	 */
 	bool m_isResolutionSet;
+
+	/**
+	 * @brief hash of the settings of the node this operation was created for
+	 * @see NodeCache
+	 */
+	NodeCacheKey m_settingsKey;
+
+	/**
+	 * @brief does the node use data-blocks (images, movie clips, render results)
+	 * which are not part of the settings key
+	 */
+	bool m_usesExternalData;
 	
 public:
 	virtual ~NodeOperation();
@@ -216,6 +229,51 @@ public:
 	                           list<cl_kernel> * /*clKernelsToCleanUp*/) {}
 	virtual void deinitExecution();
 
+	/**
+	 * @brief compute an area of the output buffer, when executing full frames
+	 * @ingroup execution
+	 * @param output the output buffer, covering the whole operation
+	 * @param area the area of the output to compute
+	 * @param inputs the buffers of the input sockets
+	 *
+	 * The inputs of the operation are replaced by readers of the input buffers
+	 * during full frame execution, the default implementation computes rows
+	 * with executeRow, or reads every pixel through executePixel when the
+	 * operation has no row kernel. Operations can override this to process
+	 * the buffers directly.
+	 * @see FullFrameExecution
+	 */
+	virtual void updateMemoryBuffer(MemoryBuffer *output,
+	                                const rcti *area,
+	                                MemoryBuffer **inputs);
+
+	/**
+	 * @brief compute a span of pixels of a row, when executing full frames
+	 * @ingroup execution
+	 * @param output the pixels of the output row
+	 * @param inputs the pixels of the input rows, with the channels of the input sockets
+	 * @param length the number of pixels in the span
+	 * @return false when the operation has no row kernel for its settings,
+	 * in which case the pixels are read through executePixel
+	 *
+	 * Only used for simple operations whose inputs have the resolution of the
+	 * output or are single values, the result must not depend on the position.
+	 */
+	virtual bool executeRow(float * /*output*/, const float ** /*inputs*/, int /*length*/) { return false; }
+
+	/**
+	 * @brief set the settings key of the operation
+	 * @param key hash of the node settings and the position of the operation in the node
+	 * @param uses_external_data the result depends on data that is not part of the key
+	 * @see NodeCache
+	 */
+	void setSettingsKey(NodeCacheKey key, bool uses_external_data) {
+		this->m_settingsKey = key;
+		this->m_usesExternalData = uses_external_data;
+	}
+	NodeCacheKey getSettingsKey() const { return this->m_settingsKey; }
+	bool usesExternalData() const { return this->m_usesExternalData; }
+
 	bool isResolutionSet() {
 		return this->m_isResolutionSet;
 	}
@@ -259,6 +317,14 @@ public:
 	 */
 	virtual const bool isWriteBufferOperation() const { return false; }
 
+	/**
+	 * @brief is this operation of type BufferOperation
+	 * the whole output of the operation it reads is computed already
+	 * @return [true:false]
+	 * @see BufferOperation
+	 */
+	virtual const bool isBufferOperation() const { return false; }
+
 	/**
 	 * @brief is this operation the active viewer output
 	 * user can select an ViewerNode to be active (the result of this node will be drawn on the backdrop)
@@ -315,6 +381,8 @@ protected:
 	SocketReader *getInputSocketReader(unsigned int inputSocketindex);
 	NodeOperation *getInputOperation(unsigned int inputSocketindex);
 
+	bool updateMemoryBufferRows(MemoryBuffer *output, const rcti *area, MemoryBuffer **inputs);
+
 	void deinitMutex();
 	void initMutex();
 	void lockMutex();
@@ -45,6 +45,8 @@ extern "C" {
 NodeOperationBuilder::NodeOperationBuilder(const CompositorContext *context, bNodeTree *b_nodetree) :
     m_context(context),
     m_current_node(NULL),
+    m_current_node_key(0),
+    m_current_node_operations(0),
     m_active_viewer(NULL)
 {
 	m_graph.from_bNodeTree(*context, b_nodetree);
@@ -63,6 +65,8 @@ void NodeOperationBuilder::convertToOperations(ExecutionSystem *system)
 		Node *node = (Node *)m_graph.nodes()[index];
 		
 		m_current_node = node;
+		m_current_node_key = (node->getbNode()) ? NodeCache::hashNode(node->getbNode()) : 0;
+		m_current_node_operations = 0;
 		
 		DebugInfo::node_to_operations(node);
 		node->convertToOperations(converter, *m_context);
@@ -109,8 +113,10 @@ void NodeOperationBuilder::convertToOperations(ExecutionSystem *system)
 	
 	determineResolutions();
 	
-	/* surround complex ops with read/write buffer */
-	add_complex_operation_buffers();
+	/* surround complex ops with read/write buffer,
+	 * not needed when every operation gets a buffer in full frame execution */
+	if (!m_context->isFullFrameEnabled())
+		add_complex_operation_buffers();
 	
 	/* links not available from here on */
 	/* XXX make m_links a local variable to avoid confusion! */
@@ -122,7 +128,8 @@ void NodeOperationBuilder::convertToOperations(ExecutionSystem *system)
 	/*sort_operations();*/ /* not needed yet */
 	
 	/* create execution groups */
-	group_operations();
+	if (!m_context->isFullFrameEnabled())
+		group_operations();
 	
 	/* transfer resulting operations to the system */
 	system->set_operations(m_operations, m_groups);
@@ -131,6 +138,14 @@ void NodeOperationBuilder::convertToOperations(ExecutionSystem *system)
 void NodeOperationBuilder::addOperation(NodeOperation *operation)
 {
 	m_operations.push_back(operation);
+
+	/* operations added outside of nodes (conversions, constants) only depend
+	 * on their inputs and resolution */
+	if (m_current_node && m_current_node->getbNode()) {
+		NodeCacheKey key = NodeCache::hashData(m_current_node_key, &m_current_node_operations, sizeof(int));
+		operation->setSettingsKey(key, m_current_node->getbNode()->id != NULL);
+		m_current_node_operations++;
+	}
 }
 
 void NodeOperationBuilder::mapInputSocket(NodeInput *node_socket, NodeOperationInput *operation_socket)
@@ -26,6 +26,7 @@
 #include <set>
 #include <vector>
 
+#include "COM_NodeCache.h"
 #include "COM_NodeGraph.h"
 
 using std::vector;
@@ -87,6 +88,9 @@ private:
 	OutputSocketMap m_output_map;
 	
 	Node *m_current_node;
+	/** Settings key of the current node, and number of operations added for it */
+	NodeCacheKey m_current_node_key;
+	int m_current_node_operations;
 	
 	/** Operation that will be writing to the viewer image
 	 *  Only one operation can occupy this place at a time,
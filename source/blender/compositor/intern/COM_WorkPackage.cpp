@@ -22,8 +22,9 @@
 
 #include "COM_WorkPackage.h"
 
-WorkPackage::WorkPackage(ExecutionGroup *group, unsigned int chunkNumber)
+WorkPackage::WorkPackage(ExecutionGroup *group, unsigned int chunkNumber, unsigned int priority)
 {
 	this->m_executionGroup = group;
 	this->m_chunkNumber = chunkNumber;
+	this->m_priority = priority;
 }
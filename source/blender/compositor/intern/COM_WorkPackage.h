@@ -42,13 +42,19 @@ private:
 	 * @brief number of the chunk to be executed
 	 */
 	unsigned int m_chunkNumber;
+
+	/**
+	 * @brief packages with a lower priority are executed first
+	 */
+	unsigned int m_priority;
 public:
 	/**
 	 * constructor
 	 * @param group the ExecutionGroup
 	 * @param chunkNumber the number of the chunk
+	 * @param priority the position of the chunk in the order of execution
 	 */
-	WorkPackage(ExecutionGroup *group, unsigned int chunkNumber);
+	WorkPackage(ExecutionGroup *group, unsigned int chunkNumber, unsigned int priority);
 
 	/**
 	 * @brief get the ExecutionGroup
@@ -60,6 +66,11 @@ public:
 	 */
 	unsigned int getChunkNumber() const { return this->m_chunkNumber; }
 
+	/**
+	 * @brief get the priority, lower is executed first
+	 */
+	unsigned int getPriority() const { return this->m_priority; }
+
 #ifdef WITH_CXX_GUARDEDALLOC
 	MEM_CXX_CLASS_ALLOC_FUNCS("COM:WorkPackage")
 #endif
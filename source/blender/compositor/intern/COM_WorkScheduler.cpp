@@ -20,6 +20,7 @@
  *		Monique Dewanchand
  */
 
+#include <float.h>
 #include <list>
 #include <stdio.h>
 
@@ -36,6 +37,10 @@
 #include "PIL_time.h"
 #include "BLI_threads.h"
 
+extern "C" {
+#  include "BLI_heap.h"
+}
+
 #include "BKE_global.h"
 
 #if COM_CURRENT_THREADING_MODEL == COM_TM_NOTHREAD
@@ -52,13 +57,30 @@
 /// @brief list of all CPUDevices. for every hardware thread an instance of CPUDevice is created
 static vector<CPUDevice*> g_cpudevices;
 static ThreadLocal(CPUDevice *) g_thread_device;
+/// @brief thread id plus one of task scheduler threads in full frame execution, see current_thread_id
+static ThreadLocal(void *) g_thread_task_id;
 
 #if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
 /// @brief list of all thread for every CPUDevice in cpudevices a thread exists
 static ListBase g_cputhreads;
 static bool g_cpuInitialized = false;
-/// @brief all scheduled work for the cpu
-static ThreadQueue *g_cpuqueue;
+/// @brief scheduled work of a cpu thread, ordered by priority
+typedef struct CPUWorkQueue {
+	ThreadMutex mutex;
+	Heap *packages;
+} CPUWorkQueue;
+/// @brief work queue of every cpu thread, indexed by the thread id of its CPUDevice
+static CPUWorkQueue *g_cpuqueues;
+/// @brief queue that receives the next scheduled package
+static unsigned int g_cpuqueue_next;
+/// @brief guards the counters of scheduled work, idle threads and finish wait on it
+static ThreadMutex g_cpumutex;
+static ThreadCondition g_cpuwork_condition;
+static ThreadCondition g_cpufinish_condition;
+/// @brief number of packages in the queues, and of packages not yet executed
+static int g_cpuqueued;
+static int g_cpupending;
+static bool g_cpustopping;
 static ThreadQueue *g_gpuqueue;
 #ifdef COM_OPENCL_ENABLED
 static cl_context g_context;
@@ -76,16 +98,121 @@ static bool g_openclInitialized = false;
 #endif
 
 #if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
+/**
+ * Execute a package, unless the tree is cancelled. Packages of a cancelled
+ * tree are dropped, so cancelling only waits for the chunks that are running.
+ * The execution group stops scheduling when it sees the break.
+ */
+static void execute_work(Device *device, WorkPackage *work)
+{
+	if (!work->getExecutionGroup()->getOutputOperation()->isBreaked()) {
+		device->execute(work);
+	}
+}
+
+static void cpu_queue_push(WorkPackage *package)
+{
+	/* Packages are only scheduled from the thread executing the tree. */
+	CPUWorkQueue *queue = &g_cpuqueues[g_cpuqueue_next++ % g_cpudevices.size()];
+
+	BLI_mutex_lock(&queue->mutex);
+	BLI_heap_insert(queue->packages, (float)package->getPriority(), package);
+	BLI_mutex_unlock(&queue->mutex);
+
+	BLI_mutex_lock(&g_cpumutex);
+	g_cpuqueued++;
+	g_cpupending++;
+	BLI_condition_notify_one(&g_cpuwork_condition);
+	BLI_mutex_unlock(&g_cpumutex);
+}
+
+/**
+ * Take the package with the lowest priority of all queues. A thread takes from
+ * its own queue on equal priority, and steals from the other threads otherwise.
+ */
+static WorkPackage *cpu_queue_pop(unsigned int thread_id)
+{
+	const unsigned int num_queues = g_cpudevices.size();
+
+	for (;;) {
+		CPUWorkQueue *best_queue = NULL;
+		float best_priority = FLT_MAX;
+
+		for (unsigned int offset = 0; offset < num_queues; offset++) {
+			CPUWorkQueue *queue = &g_cpuqueues[(thread_id + offset) % num_queues];
+			BLI_mutex_lock(&queue->mutex);
+			if (!BLI_heap_is_empty(queue->packages)) {
+				const float priority = BLI_heap_node_value(BLI_heap_top(queue->packages));
+				if (priority < best_priority) {
+					best_queue = queue;
+					best_priority = priority;
+				}
+			}
+			BLI_mutex_unlock(&queue->mutex);
+		}
+
+		if (best_queue == NULL) {
+			return NULL;
+		}
+
+		WorkPackage *work = NULL;
+		BLI_mutex_lock(&best_queue->mutex);
+		if (!BLI_heap_is_empty(best_queue->packages)) {
+			work = (WorkPackage *)BLI_heap_pop_min(best_queue->packages);
+		}
+		BLI_mutex_unlock(&best_queue->mutex);
+
+		/* Otherwise another thread took it first, look again. */
+		if (work) {
+			BLI_mutex_lock(&g_cpumutex);
+			g_cpuqueued--;
+			BLI_mutex_unlock(&g_cpumutex);
+			return work;
+		}
+	}
+}
+
+static void cpu_queue_wait_finish()
+{
+	BLI_mutex_lock(&g_cpumutex);
+	while (g_cpupending > 0) {
+		BLI_condition_wait(&g_cpufinish_condition, &g_cpumutex);
+	}
+	BLI_mutex_unlock(&g_cpumutex);
+}
+
 void *WorkScheduler::thread_execute_cpu(void *data)
 {
 	CPUDevice *device = (CPUDevice *)data;
-	WorkPackage *work;
 	BLI_thread_local_set(g_thread_device, device);
-	while ((work = (WorkPackage *)BLI_thread_queue_pop(g_cpuqueue))) {
-		device->execute(work);
+
+	for (;;) {
+		WorkPackage *work = cpu_queue_pop(device->thread_id());
+
+		if (work == NULL) {
+			/* The counter can be briefly behind the queues, wait until it shows work. */
+			BLI_mutex_lock(&g_cpumutex);
+			while (g_cpuqueued <= 0 && !g_cpustopping) {
+				BLI_condition_wait(&g_cpuwork_condition, &g_cpumutex);
+			}
+			const bool stop = (g_cpuqueued <= 0);
+			BLI_mutex_unlock(&g_cpumutex);
+			if (stop) {
+				break;
+			}
+			continue;
+		}
+
+		execute_work(device, work);
 		delete work;
+
+		BLI_mutex_lock(&g_cpumutex);
+		if (--g_cpupending == 0) {
+			BLI_condition_notify_all(&g_cpufinish_condition);
+		}
+		BLI_mutex_unlock(&g_cpumutex);
 	}
-	
+
 	return NULL;
 }
 
@@ -95,7 +222,7 @@ void *WorkScheduler::thread_execute_gpu(void *data)
 	WorkPackage *work;
 	
 	while ((work = (WorkPackage *)BLI_thread_queue_pop(g_gpuqueue))) {
-		device->execute(work);
+		execute_work(device, work);
 		delete work;
 	}
 	
@@ -105,9 +232,9 @@ void *WorkScheduler::thread_execute_gpu(void *data)
 
 
 
-void WorkScheduler::schedule(ExecutionGroup *group, int chunkNumber)
+void WorkScheduler::schedule(ExecutionGroup *group, int chunkNumber, unsigned int priority)
 {
-	WorkPackage *package = new WorkPackage(group, chunkNumber);
+	WorkPackage *package = new WorkPackage(group, chunkNumber, priority);
 #if COM_CURRENT_THREADING_MODEL == COM_TM_NOTHREAD
 	CPUDevice device(0);
 	device.execute(package);
@@ -118,10 +245,10 @@ void WorkScheduler::schedule(ExecutionGroup *group, int chunkNumber)
 		BLI_thread_queue_push(g_gpuqueue, package);
 	}
 	else {
-		BLI_thread_queue_push(g_cpuqueue, package);
+		cpu_queue_push(package);
 	}
 #else
-	BLI_thread_queue_push(g_cpuqueue, package);
+	cpu_queue_push(package);
 #endif
 #endif
 }
@@ -130,7 +257,18 @@ void WorkScheduler::start(CompositorContext &context)
 {
 #if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
 	unsigned int index;
-	g_cpuqueue = BLI_thread_queue_init();
+	g_cpuqueues = (CPUWorkQueue *)MEM_mallocN(sizeof(CPUWorkQueue) * g_cpudevices.size(), __func__);
+	for (index = 0; index < g_cpudevices.size(); index++) {
+		BLI_mutex_init(&g_cpuqueues[index].mutex);
+		g_cpuqueues[index].packages = BLI_heap_new();
+	}
+	g_cpuqueue_next = 0;
+	BLI_mutex_init(&g_cpumutex);
+	BLI_condition_init(&g_cpuwork_condition);
+	BLI_condition_init(&g_cpufinish_condition);
+	g_cpuqueued = 0;
+	g_cpupending = 0;
+	g_cpustopping = false;
 	BLI_threadpool_init(&g_cputhreads, thread_execute_cpu, g_cpudevices.size());
 	for (index = 0; index < g_cpudevices.size(); index++) {
 		Device *device = g_cpudevices[index];
@@ -158,23 +296,33 @@ void WorkScheduler::finish()
 #ifdef COM_OPENCL_ENABLED
 	if (g_openclActive) {
 		BLI_thread_queue_wait_finish(g_gpuqueue);
-		BLI_thread_queue_wait_finish(g_cpuqueue);
+		cpu_queue_wait_finish();
 	}
 	else {
-		BLI_thread_queue_wait_finish(g_cpuqueue);
+		cpu_queue_wait_finish();
 	}
 #else
-	BLI_thread_queue_wait_finish(cpuqueue);
+	cpu_queue_wait_finish();
 #endif
 #endif
 }
 void WorkScheduler::stop()
 {
 #if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
-	BLI_thread_queue_nowait(g_cpuqueue);
+	BLI_mutex_lock(&g_cpumutex);
+	g_cpustopping = true;
+	BLI_condition_notify_all(&g_cpuwork_condition);
+	BLI_mutex_unlock(&g_cpumutex);
 	BLI_threadpool_end(&g_cputhreads);
-	BLI_thread_queue_free(g_cpuqueue);
-	g_cpuqueue = NULL;
+	for (unsigned int index = 0; index < g_cpudevices.size(); index++) {
+		BLI_heap_free(g_cpuqueues[index].packages, NULL);
+		BLI_mutex_end(&g_cpuqueues[index].mutex);
+	}
+	MEM_freeN(g_cpuqueues);
+	g_cpuqueues = NULL;
+	BLI_condition_end(&g_cpuwork_condition);
+	BLI_condition_end(&g_cpufinish_condition);
+	BLI_mutex_end(&g_cpumutex);
 #ifdef COM_OPENCL_ENABLED
 	if (g_openclActive) {
 		BLI_thread_queue_nowait(g_gpuqueue);
@@ -224,6 +372,7 @@ void WorkScheduler::initialize(bool use_opencl, int num_cpu_threads)
 		}
 		if (g_cpuInitialized) {
 			BLI_thread_local_delete(g_thread_device);
+			BLI_thread_local_delete(g_thread_task_id);
 		}
 		g_cpuInitialized = false;
 	}
@@ -236,6 +385,7 @@ void WorkScheduler::initialize(bool use_opencl, int num_cpu_threads)
 			g_cpudevices.push_back(device);
 		}
 		BLI_thread_local_create(g_thread_device);
+		BLI_thread_local_create(g_thread_task_id);
 		g_cpuInitialized = true;
 	}
 
@@ -322,6 +472,7 @@ void WorkScheduler::deinitialize()
 			delete device;
 		}
 		BLI_thread_local_delete(g_thread_device);
+		BLI_thread_local_delete(g_thread_task_id);
 		g_cpuInitialized = false;
 	}
 
@@ -353,5 +504,16 @@ void WorkScheduler::deinitialize()
 int WorkScheduler::current_thread_id()
 {
 	CPUDevice *device = (CPUDevice *)BLI_thread_local_get(g_thread_device);
-	return device->thread_id();
+	if (device) {
+		return device->thread_id();
+	}
+
+	/* Full frame execution runs on task scheduler threads, which have no device. */
+	intptr_t task_id = (intptr_t)BLI_thread_local_get(g_thread_task_id);
+	return (task_id > 0) ? (int)(task_id - 1) : 0;
+}
+
+void WorkScheduler::set_task_thread_id(int thread_id)
+{
+	BLI_thread_local_set(g_thread_task_id, (void *)(intptr_t)(thread_id + 1));
 }
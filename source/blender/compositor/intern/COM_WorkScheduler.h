@@ -61,10 +61,13 @@ public:
 	 * when ExecutionGroup.isOpenCL is set the work will be handled by a OpenCLDevice
 	 * otherwise the work is scheduled for an CPUDevice
 	 * @see ExecutionGroup.execute
+	 * Every cpu thread has its own queue of work, and executes the package with the
+	 * lowest priority of all queues first, taking it from other threads when needed.
 	 * @param group the execution group
 	 * @param chunkNumber the number of the chunk in the group to be executed
+	 * @param priority packages with a lower priority are executed first
 	 */
-	static void schedule(ExecutionGroup *group, int chunkNumber);
+	static void schedule(ExecutionGroup *group, int chunkNumber, unsigned int priority);
 
 	/**
 	 * @brief initialize the WorkScheduler
@@ -113,8 +116,19 @@ public:
 	 */
 	static bool hasGPUDevices();
 
+	/**
+	 * @brief id of the calling execution thread, for operations keeping data per thread
+	 * Work scheduler threads use the id of their CPUDevice, task scheduler threads of
+	 * full frame execution the id set with set_task_thread_id. Other threads get 0.
+	 */
 	static int current_thread_id();
 
+	/**
+	 * @brief set the id of the calling task scheduler thread
+	 * @see current_thread_id
+	 */
+	static void set_task_thread_id(int thread_id);
+
 #ifdef WITH_CXX_GUARDEDALLOC
 	MEM_CXX_CLASS_ALLOC_FUNCS("COM:WorkScheduler")
 #endif
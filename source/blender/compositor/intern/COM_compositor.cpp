@@ -32,6 +32,7 @@ extern "C" {
 
 #include "COM_compositor.h"
 #include "COM_ExecutionSystem.h"
+#include "COM_NodeCache.h"
 #include "COM_WorkScheduler.h"
 #include "clew.h"
 #include "COM_MovieDistortionOperation.h"
@@ -116,6 +117,7 @@ void COM_deinitialize()
 	if (is_compositorMutex_init) {
 		BLI_mutex_lock(&s_compositorMutex);
 		WorkScheduler::deinitialize();
+		NodeCache::clear();
 		is_compositorMutex_init = false;
 		BLI_mutex_unlock(&s_compositorMutex);
 		BLI_mutex_end(&s_compositorMutex);
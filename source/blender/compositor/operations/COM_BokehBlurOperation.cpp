@@ -22,6 +22,7 @@
 
 #include "COM_BokehBlurOperation.h"
 #include "BLI_math.h"
+#include "COM_FFTConvolution.h"
 #include "COM_OpenCLDevice.h"
 
 extern "C" {
@@ -45,6 +46,9 @@ BokehBlurOperation::BokehBlurOperation() : NodeOperation()
 	this->m_inputBoundingBoxReader = NULL;
 
 	this->m_extend_bounds = false;
+
+	this->m_convolved = NULL;
+	this->m_useFFT = false;
 }
 
 void *BokehBlurOperation::initializeTileData(rcti * /*rect*/)
@@ -54,10 +58,54 @@ void *BokehBlurOperation::initializeTileData(rcti * /*rect*/)
 		updateSize();
 	}
 	void *buffer = getInputOperation(0)->initializeTileData(NULL);
+	if (this->m_useFFT && this->m_convolved == NULL) {
+		updateConvolution((MemoryBuffer *)buffer);
+	}
 	unlockMutex();
 	return buffer;
 }
 
+bool BokehBlurOperation::useFFTConvolution()
+{
+	/* The whole input is needed, which is only known when the size is not an input. */
+	if (!this->m_sizeavailable) {
+		return false;
+	}
+	const float max_dim = max(this->getWidth(), this->getHeight());
+	const int pixelSize = this->m_size * max_dim / 100.0f;
+	const int kernelSize = 2 * pixelSize + 1;
+	return kernelSize * kernelSize >= COM_FFT_CONVOLUTION_MIN_KERNEL_SIZE;
+}
+
+void BokehBlurOperation::updateConvolution(MemoryBuffer *inputBuffer)
+{
+	const float max_dim = max(this->getWidth(), this->getHeight());
+	const int pixelSize = this->m_size * max_dim / 100.0f;
+	const float m = this->m_bokehDimension / pixelSize;
+
+	/* Same samples of the bokeh image as executePixel, mirrored to turn the
+	 * window of executePixel into a convolution kernel. The window ends before
+	 * x + pixelSize, which leaves the first row and column of the kernel empty. */
+	rcti kernelRect;
+	BLI_rcti_init(&kernelRect, 0, 2 * pixelSize + 1, 0, 2 * pixelSize + 1);
+	MemoryBuffer *kernel = new MemoryBuffer(COM_DT_COLOR, &kernelRect);
+	kernel->clear();
+	for (int j = 1; j <= 2 * pixelSize; j++) {
+		const float v = this->m_bokehMidY + (j - pixelSize) * m;
+		for (int i = 1; i <= 2 * pixelSize; i++) {
+			const float u = this->m_bokehMidX + (i - pixelSize) * m;
+			float bokeh[4];
+			this->m_inputBokehProgram->readSampled(bokeh, u, v, COM_PS_NEAREST);
+			kernel->writePixel(i, j, bokeh);
+		}
+	}
+
+	this->m_convolved = new MemoryBuffer(COM_DT_COLOR, inputBuffer->getRect());
+	FFTConvolution fft(kernel, COM_NUM_CHANNELS_COLOR, inputBuffer->getWidth(), inputBuffer->getHeight());
+	fft.convolve(inputBuffer, this->m_convolved, COM_NUM_CHANNELS_COLOR, true);
+	delete kernel;
+}
+
 void BokehBlurOperation::initExecution()
 {
 	initMutex();
@@ -74,6 +122,16 @@ void BokehBlurOperation::initExecution()
 	this->m_bokehMidY = height / 2.0f;
 	this->m_bokehDimension = dimension / 2.0f;
 	QualityStepHelper::initExecution(COM_QH_INCREASE);
+
+	this->m_useFFT = useFFTConvolution();
+
+	/* In full frame execution the input is complete before this operation is
+	 * initialized, convolve it here instead of in the first tile, which holds
+	 * the mutex while other threads wait for it. */
+	NodeOperation *inputOperation = getInputOperation(0);
+	if (this->m_useFFT && inputOperation->isBufferOperation()) {
+		updateConvolution((MemoryBuffer *)inputOperation->initializeTileData(NULL));
+	}
 }
 
 void BokehBlurOperation::executePixel(float output[4], int x, int y, void *data)
@@ -83,7 +141,10 @@ void BokehBlurOperation::executePixel(float output[4], int x, int y, void *data)
 	float bokeh[4];
 
 	this->m_inputBoundingBoxReader->readSampled(tempBoundingBox, x, y, COM_PS_NEAREST);
-	if (tempBoundingBox[0] > 0.0f) {
+	if (tempBoundingBox[0] > 0.0f && this->m_convolved) {
+		this->m_convolved->read(output, x, y);
+	}
+	else if (tempBoundingBox[0] > 0.0f) {
 		float multiplier_accum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
 		MemoryBuffer *inputBuffer = (MemoryBuffer *)data;
 		float *buffer = inputBuffer->getBuffer();
@@ -142,6 +203,10 @@ void BokehBlurOperation::deinitExecution()
 	this->m_inputProgram = NULL;
 	this->m_inputBokehProgram = NULL;
 	this->m_inputBoundingBoxReader = NULL;
+	if (this->m_convolved) {
+		delete this->m_convolved;
+		this->m_convolved = NULL;
+	}
 }
 
 bool BokehBlurOperation::determineDependingAreaOfInterest(rcti *input, ReadBufferOperation *readOperation, rcti *output)
@@ -150,7 +215,13 @@ bool BokehBlurOperation::determineDependingAreaOfInterest(rcti *input, ReadBuffe
 	rcti bokehInput;
 	const float max_dim = max(this->getWidth(), this->getHeight());
 
-	if (this->m_sizeavailable) {
+	if (this->m_useFFT) {
+		newInput.xmin = 0;
+		newInput.ymin = 0;
+		newInput.xmax = getInputOperation(0)->getWidth();
+		newInput.ymax = getInputOperation(0)->getHeight();
+	}
+	else if (this->m_sizeavailable) {
 		newInput.xmax = input->xmax + (this->m_size * max_dim / 100.0f);
 		newInput.xmin = input->xmin - (this->m_size * max_dim / 100.0f);
 		newInput.ymax = input->ymax + (this->m_size * max_dim / 100.0f);
@@ -38,6 +38,14 @@ private:
 	float m_bokehMidY;
 	float m_bokehDimension;
 	bool m_extend_bounds;
+
+	/**
+	 * @brief whole blurred image, when the blur is done through FFTConvolution
+	 */
+	MemoryBuffer *m_convolved;
+	bool m_useFFT;
+	bool useFFTConvolution();
+	void updateConvolution(MemoryBuffer *inputBuffer);
 public:
 	BokehBlurOperation();
 
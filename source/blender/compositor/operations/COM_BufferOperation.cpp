@@ -0,0 +1,58 @@
+/*
+ * Copyright 2018, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "COM_BufferOperation.h"
+
+BufferOperation::BufferOperation(MemoryBuffer *buffer, NodeOperation *operation) : NodeOperation()
+{
+	this->addOutputSocket(operation->getOutputSocket()->getDataType());
+	this->m_buffer = buffer;
+	this->m_single_value = (operation->getWidth() == 0 || operation->getHeight() == 0);
+	this->setWidth(operation->getWidth());
+	this->setHeight(operation->getHeight());
+}
+
+void *BufferOperation::initializeTileData(rcti * /*rect*/)
+{
+	return this->m_buffer;
+}
+
+void BufferOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
+{
+	if (this->m_single_value) {
+		this->m_buffer->read(output, 0, 0);
+	}
+	else if (sampler == COM_PS_NEAREST) {
+		this->m_buffer->read(output, x, y);
+	}
+	else {
+		this->m_buffer->readBilinear(output, x, y);
+	}
+}
+
+void BufferOperation::executePixelFiltered(float output[4], float x, float y, float dx[2], float dy[2])
+{
+	if (this->m_single_value) {
+		this->m_buffer->read(output, 0, 0);
+	}
+	else {
+		const float uv[2] = { x, y };
+		const float deriv[2][2] = { {dx[0], dx[1]}, {dy[0], dy[1]} };
+		this->m_buffer->readEWA(output, uv, deriv);
+	}
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright 2018, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _COM_BufferOperation_h
+#define _COM_BufferOperation_h
+
+#include "COM_NodeOperation.h"
+#include "COM_MemoryBuffer.h"
+
+/**
+ * @brief Reads the computed output buffer of another operation.
+ *
+ * Used by full frame execution to temporarily replace the inputs of an
+ * operation, so it reads the buffers of its inputs instead of pulling pixels
+ * through them.
+ * @ingroup Operation
+ * @see FullFrameExecution
+ */
+class BufferOperation : public NodeOperation {
+private:
+	MemoryBuffer *m_buffer;
+	bool m_single_value; /* single value stored at (0,0), for operations without resolution */
+public:
+	/**
+	 * @param buffer the output buffer of the operation
+	 * @param operation the operation the buffer was computed for, its resolution and data type are used
+	 */
+	BufferOperation(MemoryBuffer *buffer, NodeOperation *operation);
+	MemoryBuffer *getBuffer() { return this->m_buffer; }
+	const bool isBufferOperation() const { return true; }
+
+	void *initializeTileData(rcti *rect);
+	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executePixelFiltered(float output[4], float x, float y, float dx[2], float dy[2]);
+};
+
+#endif
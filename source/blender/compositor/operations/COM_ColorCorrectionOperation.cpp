@@ -50,7 +50,21 @@ void ColorCorrectionOperation::executePixelSampled(float output[4], float x, flo
 	float inputMask[4];
 	this->m_inputImage->readSampled(inputImageColor, x, y, sampler);
 	this->m_inputMask->readSampled(inputMask, x, y, sampler);
-	
+	correctPixel(output, inputImageColor, inputMask[0]);
+}
+
+bool ColorCorrectionOperation::executeRow(float *output, const float **inputs, int length)
+{
+	const float *inputImageColor = inputs[0];
+	const float *inputMask = inputs[1];
+	for (int i = 0; i < length; i++, output += 4, inputImageColor += 4) {
+		correctPixel(output, inputImageColor, inputMask[i]);
+	}
+	return true;
+}
+
+inline void ColorCorrectionOperation::correctPixel(float output[4], const float inputImageColor[4], float mask)
+{
 	float level = (inputImageColor[0] + inputImageColor[1] + inputImageColor[2]) / 3.0f;
 	float contrast = this->m_data->master.contrast;
 	float saturation = this->m_data->master.saturation;
@@ -59,8 +73,7 @@ void ColorCorrectionOperation::executePixelSampled(float output[4], float x, flo
 	float lift = this->m_data->master.lift;
 	float r, g, b;
 	
-	float value = inputMask[0];
-	value = min(1.0f, value);
+	float value = min(1.0f, mask);
 	const float mvalue = 1.0f - value;
 	
 	float levelShadows = 0.0;
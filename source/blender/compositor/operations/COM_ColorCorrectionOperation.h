@@ -38,6 +38,8 @@ private:
 	bool m_greenChannelEnabled;
 	bool m_blueChannelEnabled;
 
+	void correctPixel(float output[4], const float inputImageColor[4], float mask);
+
 public:
 	ColorCorrectionOperation();
 	
@@ -45,6 +47,7 @@ public:
 	 * the inner loop of this program
 	 */
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	bool executeRow(float *output, const float **inputs, int length);
 	
 	/**
 	 * Initialize the execution
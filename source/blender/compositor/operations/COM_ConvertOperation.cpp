@@ -58,6 +58,16 @@ void ConvertValueToColorOperation::executePixelSampled(float output[4], float x,
 	output[3] = 1.0f;
 }
 
+bool ConvertValueToColorOperation::executeRow(float *output, const float **inputs, int length)
+{
+	const float *value = inputs[0];
+	for (int i = 0; i < length; i++, output += 4) {
+		output[0] = output[1] = output[2] = value[i];
+		output[3] = 1.0f;
+	}
+	return true;
+}
+
 
 /* ******** Color to Value ******** */
 
@@ -74,6 +84,15 @@ void ConvertColorToValueOperation::executePixelSampled(float output[4], float x,
 	output[0] = (inputColor[0] + inputColor[1] + inputColor[2]) / 3.0f;
 }
 
+bool ConvertColorToValueOperation::executeRow(float *output, const float **inputs, int length)
+{
+	const float *color = inputs[0];
+	for (int i = 0; i < length; i++, color += 4) {
+		output[i] = (color[0] + color[1] + color[2]) / 3.0f;
+	}
+	return true;
+}
+
 
 /* ******** Color to BW ******** */
 
@@ -90,6 +109,15 @@ void ConvertColorToBWOperation::executePixelSampled(float output[4], float x, fl
 	output[0] = IMB_colormanagement_get_luminance(inputColor);
 }
 
+bool ConvertColorToBWOperation::executeRow(float *output, const float **inputs, int length)
+{
+	const float *color = inputs[0];
+	for (int i = 0; i < length; i++, color += 4) {
+		output[i] = IMB_colormanagement_get_luminance(color);
+	}
+	return true;
+}
+
 
 /* ******** Color to Vector ******** */
 
@@ -105,6 +133,15 @@ void ConvertColorToVectorOperation::executePixelSampled(float output[4], float x
 	this->m_inputOperation->readSampled(color, x, y, sampler);
 	copy_v3_v3(output, color);}
 
+bool ConvertColorToVectorOperation::executeRow(float *output, const float **inputs, int length)
+{
+	const float *color = inputs[0];
+	for (int i = 0; i < length; i++, output += 3, color += 4) {
+		copy_v3_v3(output, color);
+	}
+	return true;
+}
+
 
 /* ******** Value to Vector ******** */
 
@@ -121,6 +158,15 @@ void ConvertValueToVectorOperation::executePixelSampled(float output[4], float x
 	output[0] = output[1] = output[2] = value;
 }
 
+bool ConvertValueToVectorOperation::executeRow(float *output, const float **inputs, int length)
+{
+	const float *value = inputs[0];
+	for (int i = 0; i < length; i++, output += 3) {
+		output[0] = output[1] = output[2] = value[i];
+	}
+	return true;
+}
+
 
 /* ******** Vector to Color ******** */
 
@@ -136,6 +182,16 @@ void ConvertVectorToColorOperation::executePixelSampled(float output[4], float x
 	output[3] = 1.0f;
 }
 
+bool ConvertVectorToColorOperation::executeRow(float *output, const float **inputs, int length)
+{
+	const float *vector = inputs[0];
+	for (int i = 0; i < length; i++, output += 4, vector += 3) {
+		copy_v3_v3(output, vector);
+		output[3] = 1.0f;
+	}
+	return true;
+}
+
 
 /* ******** Vector to Value ******** */
 
@@ -152,6 +208,15 @@ void ConvertVectorToValueOperation::executePixelSampled(float output[4], float x
 	output[0] = (input[0] + input[1] + input[2]) / 3.0f;
 }
 
+bool ConvertVectorToValueOperation::executeRow(float *output, const float **inputs, int length)
+{
+	const float *vector = inputs[0];
+	for (int i = 0; i < length; i++, vector += 3) {
+		output[i] = (vector[0] + vector[1] + vector[2]) / 3.0f;
+	}
+	return true;
+}
+
 
 /* ******** RGB to YCC ******** */
 
@@ -43,6 +43,7 @@ public:
 	ConvertValueToColorOperation();
 	
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	bool executeRow(float *output, const float **inputs, int length);
 };
 
 
@@ -51,6 +52,7 @@ public:
 	ConvertColorToValueOperation();
 	
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	bool executeRow(float *output, const float **inputs, int length);
 };
 
 
@@ -59,6 +61,7 @@ public:
 	ConvertColorToBWOperation();
 	
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	bool executeRow(float *output, const float **inputs, int length);
 };
 
 
@@ -67,6 +70,7 @@ public:
 	ConvertColorToVectorOperation();
 	
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	bool executeRow(float *output, const float **inputs, int length);
 };
 
 
@@ -75,6 +79,7 @@ public:
 	ConvertValueToVectorOperation();
 	
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	bool executeRow(float *output, const float **inputs, int length);
 };
 
 
@@ -83,6 +88,7 @@ public:
 	ConvertVectorToColorOperation();
 	
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	bool executeRow(float *output, const float **inputs, int length);
 };
 
 
@@ -91,6 +97,7 @@ public:
 	ConvertVectorToValueOperation();
 	
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	bool executeRow(float *output, const float **inputs, int length);
 };
 
 
@@ -21,6 +21,7 @@
  */
 
 #include "COM_GaussianBokehBlurOperation.h"
+#include "COM_FFTConvolution.h"
 #include "BLI_math.h"
 #include "MEM_guardedalloc.h"
 extern "C" {
@@ -30,6 +31,8 @@ extern "C" {
 GaussianBokehBlurOperation::GaussianBokehBlurOperation() : BlurBaseOperation(COM_DT_COLOR)
 {
 	this->m_gausstab = NULL;
+	this->m_convolved = NULL;
+	this->m_useFFT = false;
 }
 
 void *GaussianBokehBlurOperation::initializeTileData(rcti * /*rect*/)
@@ -39,10 +42,35 @@ void *GaussianBokehBlurOperation::initializeTileData(rcti * /*rect*/)
 		updateGauss();
 	}
 	void *buffer = getInputOperation(0)->initializeTileData(NULL);
+	if (this->m_useFFT && this->m_convolved == NULL) {
+		updateConvolution((MemoryBuffer *)buffer);
+	}
 	unlockMutex();
 	return buffer;
 }
 
+void GaussianBokehBlurOperation::updateConvolution(MemoryBuffer *inputBuffer)
+{
+	const int kernelWidth = 2 * this->m_radx + 1;
+	const int kernelHeight = 2 * this->m_rady + 1;
+	const int n = kernelWidth * kernelHeight;
+
+	/* executePixel weights the offsets from the pixel, the convolution kernel
+	 * is the filter mirrored in both directions. */
+	rcti kernelRect;
+	BLI_rcti_init(&kernelRect, 0, kernelWidth, 0, kernelHeight);
+	MemoryBuffer *kernel = new MemoryBuffer(COM_DT_VALUE, &kernelRect);
+	float *kernelBuffer = kernel->getBuffer();
+	for (int i = 0; i < n; i++) {
+		kernelBuffer[n - 1 - i] = this->m_gausstab[i];
+	}
+
+	this->m_convolved = new MemoryBuffer(COM_DT_COLOR, inputBuffer->getRect());
+	FFTConvolution fft(kernel, 1, inputBuffer->getWidth(), inputBuffer->getHeight());
+	fft.convolve(inputBuffer, this->m_convolved, COM_NUM_CHANNELS_COLOR, true);
+	delete kernel;
+}
+
 void GaussianBokehBlurOperation::initExecution()
 {
 	BlurBaseOperation::initExecution();
@@ -51,6 +79,16 @@ void GaussianBokehBlurOperation::initExecution()
 
 	if (this->m_sizeavailable) {
 		updateGauss();
+
+		/* The whole input is requested once the filter is known. */
+		const int kernelSize = (2 * this->m_radx + 1) * (2 * this->m_rady + 1);
+		this->m_useFFT = kernelSize >= COM_FFT_CONVOLUTION_MIN_KERNEL_SIZE;
+	}
+
+	/* In full frame execution the input is complete already, see BokehBlurOperation. */
+	NodeOperation *inputOperation = getInputOperation(0);
+	if (this->m_useFFT && inputOperation->isBufferOperation()) {
+		updateConvolution((MemoryBuffer *)inputOperation->initializeTileData(NULL));
 	}
 }
 
@@ -116,6 +154,11 @@ void GaussianBokehBlurOperation::updateGauss()
 
 void GaussianBokehBlurOperation::executePixel(float output[4], int x, int y, void *data)
 {
+	if (this->m_convolved) {
+		this->m_convolved->read(output, x, y);
+		return;
+	}
+
 	float tempColor[4];
 	tempColor[0] = 0;
 	tempColor[1] = 0;
@@ -163,6 +206,11 @@ void GaussianBokehBlurOperation::deinitExecution()
 		this->m_gausstab = NULL;
 	}
 
+	if (this->m_convolved) {
+		delete this->m_convolved;
+		this->m_convolved = NULL;
+	}
+
 	deinitMutex();
 }
 
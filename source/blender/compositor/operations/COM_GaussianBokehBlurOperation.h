@@ -32,6 +32,13 @@ private:
 	int m_radx, m_rady;
 	void updateGauss();
 
+	/**
+	 * @brief whole blurred image, when the blur is done through FFTConvolution
+	 */
+	MemoryBuffer *m_convolved;
+	bool m_useFFT;
+	void updateConvolution(MemoryBuffer *inputBuffer);
+
 public:
 	GaussianBokehBlurOperation();
 	void initExecution();
@@ -25,6 +25,100 @@ extern "C" {
 #include "BLI_math.h"
 }
 
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
+/* Row kernels process four values per register, the functors also have a
+ * scalar version for the end of the row and builds without SSE. */
+template<typename Math>
+static inline void math_row(float *output, const float **inputs, int length, bool use_clamp)
+{
+	const float *value1 = inputs[0];
+	const float *value2 = inputs[1];
+	int i = 0;
+
+#ifdef __SSE2__
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	for (; i + 4 <= length; i += 4) {
+		__m128 result = Math::sse(_mm_loadu_ps(value1 + i), _mm_loadu_ps(value2 + i));
+		if (use_clamp) {
+			result = _mm_min_ps(_mm_max_ps(result, zero), one);
+		}
+		_mm_storeu_ps(output + i, result);
+	}
+#endif
+
+	for (; i < length; i++) {
+		float result = Math::scalar(value1[i], value2[i]);
+		if (use_clamp) {
+			CLAMP(result, 0.0f, 1.0f);
+		}
+		output[i] = result;
+	}
+}
+
+struct MathAdd {
+#ifdef __SSE2__
+	static inline __m128 sse(__m128 a, __m128 b) { return _mm_add_ps(a, b); }
+#endif
+	static inline float scalar(float a, float b) { return a + b; }
+};
+
+struct MathSubtract {
+#ifdef __SSE2__
+	static inline __m128 sse(__m128 a, __m128 b) { return _mm_sub_ps(a, b); }
+#endif
+	static inline float scalar(float a, float b) { return a - b; }
+};
+
+struct MathMultiply {
+#ifdef __SSE2__
+	static inline __m128 sse(__m128 a, __m128 b) { return _mm_mul_ps(a, b); }
+#endif
+	static inline float scalar(float a, float b) { return a * b; }
+};
+
+struct MathDivide {
+	/* We don't want to divide by zero. */
+#ifdef __SSE2__
+	static inline __m128 sse(__m128 a, __m128 b)
+	{
+		return _mm_and_ps(_mm_cmpneq_ps(b, _mm_setzero_ps()), _mm_div_ps(a, b));
+	}
+#endif
+	static inline float scalar(float a, float b) { return (b == 0.0f) ? 0.0f : a / b; }
+};
+
+struct MathMinimum {
+#ifdef __SSE2__
+	static inline __m128 sse(__m128 a, __m128 b) { return _mm_min_ps(a, b); }
+#endif
+	static inline float scalar(float a, float b) { return min(a, b); }
+};
+
+struct MathMaximum {
+#ifdef __SSE2__
+	static inline __m128 sse(__m128 a, __m128 b) { return _mm_max_ps(a, b); }
+#endif
+	static inline float scalar(float a, float b) { return max(a, b); }
+};
+
+struct MathLessThan {
+#ifdef __SSE2__
+	static inline __m128 sse(__m128 a, __m128 b) { return _mm_and_ps(_mm_cmplt_ps(a, b), _mm_set1_ps(1.0f)); }
+#endif
+	static inline float scalar(float a, float b) { return a < b ? 1.0f : 0.0f; }
+};
+
+struct MathGreaterThan {
+#ifdef __SSE2__
+	static inline __m128 sse(__m128 a, __m128 b) { return _mm_and_ps(_mm_cmpgt_ps(a, b), _mm_set1_ps(1.0f)); }
+#endif
+	static inline float scalar(float a, float b) { return a > b ? 1.0f : 0.0f; }
+};
+
 MathBaseOperation::MathBaseOperation() : NodeOperation()
 {
 	this->addInputSocket(COM_DT_VALUE);
@@ -85,6 +179,12 @@ void MathAddOperation::executePixelSampled(float output[4], float x, float y, Pi
 	clampIfNeeded(output);
 }
 
+bool MathAddOperation::executeRow(float *output, const float **inputs, int length)
+{
+	math_row<MathAdd>(output, inputs, length, this->m_useClamp);
+	return true;
+}
+
 void MathSubtractOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
 {
 	float inputValue1[4];
@@ -98,6 +198,12 @@ void MathSubtractOperation::executePixelSampled(float output[4], float x, float
 	clampIfNeeded(output);
 }
 
+bool MathSubtractOperation::executeRow(float *output, const float **inputs, int length)
+{
+	math_row<MathSubtract>(output, inputs, length, this->m_useClamp);
+	return true;
+}
+
 void MathMultiplyOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
 {
 	float inputValue1[4];
@@ -111,6 +217,12 @@ void MathMultiplyOperation::executePixelSampled(float output[4], float x, float
 	clampIfNeeded(output);
 }
 
+bool MathMultiplyOperation::executeRow(float *output, const float **inputs, int length)
+{
+	math_row<MathMultiply>(output, inputs, length, this->m_useClamp);
+	return true;
+}
+
 void MathDivideOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
 {
 	float inputValue1[4];
@@ -127,6 +239,12 @@ void MathDivideOperation::executePixelSampled(float output[4], float x, float y,
 	clampIfNeeded(output);
 }
 
+bool MathDivideOperation::executeRow(float *output, const float **inputs, int length)
+{
+	math_row<MathDivide>(output, inputs, length, this->m_useClamp);
+	return true;
+}
+
 void MathSineOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
 {
 	float inputValue1[4];
@@ -265,6 +383,12 @@ void MathMinimumOperation::executePixelSampled(float output[4], float x, float y
 	clampIfNeeded(output);
 }
 
+bool MathMinimumOperation::executeRow(float *output, const float **inputs, int length)
+{
+	math_row<MathMinimum>(output, inputs, length, this->m_useClamp);
+	return true;
+}
+
 void MathMaximumOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
 {
 	float inputValue1[4];
@@ -278,6 +402,12 @@ void MathMaximumOperation::executePixelSampled(float output[4], float x, float y
 	clampIfNeeded(output);
 }
 
+bool MathMaximumOperation::executeRow(float *output, const float **inputs, int length)
+{
+	math_row<MathMaximum>(output, inputs, length, this->m_useClamp);
+	return true;
+}
+
 void MathRoundOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
 {
 	float inputValue1[4];
@@ -304,6 +434,12 @@ void MathLessThanOperation::executePixelSampled(float output[4], float x, float
 	clampIfNeeded(output);
 }
 
+bool MathLessThanOperation::executeRow(float *output, const float **inputs, int length)
+{
+	math_row<MathLessThan>(output, inputs, length, this->m_useClamp);
+	return true;
+}
+
 void MathGreaterThanOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
 {
 	float inputValue1[4];
@@ -317,6 +453,12 @@ void MathGreaterThanOperation::executePixelSampled(float output[4], float x, flo
 	clampIfNeeded(output);
 }
 
+bool MathGreaterThanOperation::executeRow(float *output, const float **inputs, int length)
+{
+	math_row<MathGreaterThan>(output, inputs, length, this->m_useClamp);
+	return true;
+}
+
 void MathModuloOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
 {
 	float inputValue1[4];
@@ -74,21 +74,25 @@ class MathAddOperation : public MathBaseOperation {
 public:
 	MathAddOperation() : MathBaseOperation() {}
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	bool executeRow(float *output, const float **inputs, int length);
 };
 class MathSubtractOperation : public MathBaseOperation {
 public:
 	MathSubtractOperation() : MathBaseOperation() {}
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	bool executeRow(float *output, const float **inputs, int length);
 };
 class MathMultiplyOperation : public MathBaseOperation {
 public:
 	MathMultiplyOperation() : MathBaseOperation() {}
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	bool executeRow(float *output, const float **inputs, int length);
 };
 class MathDivideOperation : public MathBaseOperation {
 public:
 	MathDivideOperation() : MathBaseOperation() {}
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	bool executeRow(float *output, const float **inputs, int length);
 };
 class MathSineOperation : public MathBaseOperation {
 public:
@@ -135,11 +139,13 @@ class MathMinimumOperation : public MathBaseOperation {
 public:
 	MathMinimumOperation() : MathBaseOperation() {}
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	bool executeRow(float *output, const float **inputs, int length);
 };
 class MathMaximumOperation : public MathBaseOperation {
 public:
 	MathMaximumOperation() : MathBaseOperation() {}
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	bool executeRow(float *output, const float **inputs, int length);
 };
 class MathRoundOperation : public MathBaseOperation {
 public:
@@ -150,11 +156,13 @@ class MathLessThanOperation : public MathBaseOperation {
 public:
 	MathLessThanOperation() : MathBaseOperation() {}
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	bool executeRow(float *output, const float **inputs, int length);
 };
 class MathGreaterThanOperation : public MathBaseOperation {
 public:
 	MathGreaterThanOperation() : MathBaseOperation() {}
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	bool executeRow(float *output, const float **inputs, int length);
 };
 
 class MathModuloOperation : public MathBaseOperation {
@@ -24,8 +24,100 @@
 
 extern "C" {
 #  include "BLI_math.h"
+#  include "BLI_utildefines.h"
+}
+
+#ifdef __SSE2__
+#  include <emmintrin.h>
+
+/* Row kernels process a pixel per register, the functors blend the RGB of the
+ * colors with the mix factor while the alpha of the first color is kept. */
+template<typename Mix>
+static inline void mix_row_sse(float *output, const float **inputs, int length,
+                               bool value_alpha_multiply, bool use_clamp)
+{
+	const float *value = inputs[0];
+	const float *color1 = inputs[1];
+	const float *color2 = inputs[2];
+	const __m128 alpha_mask = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+
+	for (int i = 0; i < length; i++, output += 4, color1 += 4, color2 += 4) {
+		const __m128 c1 = _mm_loadu_ps(color1);
+		const __m128 c2 = _mm_loadu_ps(color2);
+		const __m128 fac = _mm_set1_ps((value_alpha_multiply) ? value[i] * color2[3] : value[i]);
+
+		__m128 result = Mix::mix(fac, _mm_sub_ps(one, fac), c1, c2);
+		result = _mm_or_ps(_mm_andnot_ps(alpha_mask, result), _mm_and_ps(alpha_mask, c1));
+		if (use_clamp) {
+			result = _mm_min_ps(_mm_max_ps(result, zero), one);
+		}
+		_mm_storeu_ps(output, result);
+	}
 }
 
+struct MixAddSSE {
+	static inline __m128 mix(__m128 fac, __m128 /*facm*/, __m128 c1, __m128 c2)
+	{
+		return _mm_add_ps(c1, _mm_mul_ps(fac, c2));
+	}
+};
+
+struct MixBlendSSE {
+	static inline __m128 mix(__m128 fac, __m128 facm, __m128 c1, __m128 c2)
+	{
+		return _mm_add_ps(_mm_mul_ps(facm, c1), _mm_mul_ps(fac, c2));
+	}
+};
+
+struct MixDarkenSSE {
+	static inline __m128 mix(__m128 fac, __m128 facm, __m128 c1, __m128 c2)
+	{
+		return _mm_add_ps(_mm_mul_ps(_mm_min_ps(c1, c2), fac), _mm_mul_ps(c1, facm));
+	}
+};
+
+struct MixDifferenceSSE {
+	static inline __m128 mix(__m128 fac, __m128 facm, __m128 c1, __m128 c2)
+	{
+		const __m128 sign_mask = _mm_set1_ps(-0.0f);
+		const __m128 difference = _mm_andnot_ps(sign_mask, _mm_sub_ps(c1, c2));
+		return _mm_add_ps(_mm_mul_ps(facm, c1), _mm_mul_ps(fac, difference));
+	}
+};
+
+struct MixLightenSSE {
+	static inline __m128 mix(__m128 fac, __m128 /*facm*/, __m128 c1, __m128 c2)
+	{
+		return _mm_max_ps(_mm_mul_ps(fac, c2), c1);
+	}
+};
+
+struct MixMultiplySSE {
+	static inline __m128 mix(__m128 fac, __m128 facm, __m128 c1, __m128 c2)
+	{
+		return _mm_mul_ps(c1, _mm_add_ps(facm, _mm_mul_ps(fac, c2)));
+	}
+};
+
+struct MixScreenSSE {
+	static inline __m128 mix(__m128 fac, __m128 facm, __m128 c1, __m128 c2)
+	{
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 screen = _mm_add_ps(facm, _mm_mul_ps(fac, _mm_sub_ps(one, c2)));
+		return _mm_sub_ps(one, _mm_mul_ps(screen, _mm_sub_ps(one, c1)));
+	}
+};
+
+struct MixSubtractSSE {
+	static inline __m128 mix(__m128 fac, __m128 /*facm*/, __m128 c1, __m128 c2)
+	{
+		return _mm_sub_ps(c1, _mm_mul_ps(fac, c2));
+	}
+};
+#endif  /* __SSE2__ */
+
 /* ******** Mix Base Operation ******** */
 
 MixBaseOperation::MixBaseOperation() : NodeOperation()
@@ -129,6 +221,17 @@ void MixAddOperation::executePixelSampled(float output[4], float x, float y, Pix
 	clampIfNeeded(output);
 }
 
+bool MixAddOperation::executeRow(float *output, const float **inputs, int length)
+{
+#ifdef __SSE2__
+	mix_row_sse<MixAddSSE>(output, inputs, length, this->useValueAlphaMultiply(), this->m_useClamp);
+	return true;
+#else
+	UNUSED_VARS(output, inputs, length);
+	return false;
+#endif
+}
+
 /* ******** Mix Blend Operation ******** */
 
 MixBlendOperation::MixBlendOperation() : MixBaseOperation()
@@ -160,6 +263,17 @@ void MixBlendOperation::executePixelSampled(float output[4], float x, float y, P
 	clampIfNeeded(output);
 }
 
+bool MixBlendOperation::executeRow(float *output, const float **inputs, int length)
+{
+#ifdef __SSE2__
+	mix_row_sse<MixBlendSSE>(output, inputs, length, this->useValueAlphaMultiply(), this->m_useClamp);
+	return true;
+#else
+	UNUSED_VARS(output, inputs, length);
+	return false;
+#endif
+}
+
 /* ******** Mix Burn Operation ******** */
 
 MixBurnOperation::MixBurnOperation() : MixBaseOperation()
@@ -300,6 +414,17 @@ void MixDarkenOperation::executePixelSampled(float output[4], float x, float y,
 	clampIfNeeded(output);
 }
 
+bool MixDarkenOperation::executeRow(float *output, const float **inputs, int length)
+{
+#ifdef __SSE2__
+	mix_row_sse<MixDarkenSSE>(output, inputs, length, this->useValueAlphaMultiply(), this->m_useClamp);
+	return true;
+#else
+	UNUSED_VARS(output, inputs, length);
+	return false;
+#endif
+}
+
 /* ******** Mix Difference Operation ******** */
 
 MixDifferenceOperation::MixDifferenceOperation() : MixBaseOperation()
@@ -330,6 +455,17 @@ void MixDifferenceOperation::executePixelSampled(float output[4], float x, float
 	clampIfNeeded(output);
 }
 
+bool MixDifferenceOperation::executeRow(float *output, const float **inputs, int length)
+{
+#ifdef __SSE2__
+	mix_row_sse<MixDifferenceSSE>(output, inputs, length, this->useValueAlphaMultiply(), this->m_useClamp);
+	return true;
+#else
+	UNUSED_VARS(output, inputs, length);
+	return false;
+#endif
+}
+
 /* ******** Mix Difference Operation ******** */
 
 MixDivideOperation::MixDivideOperation() : MixBaseOperation()
@@ -554,6 +690,17 @@ void MixLightenOperation::executePixelSampled(float output[4], float x, float y,
 	clampIfNeeded(output);
 }
 
+bool MixLightenOperation::executeRow(float *output, const float **inputs, int length)
+{
+#ifdef __SSE2__
+	mix_row_sse<MixLightenSSE>(output, inputs, length, this->useValueAlphaMultiply(), this->m_useClamp);
+	return true;
+#else
+	UNUSED_VARS(output, inputs, length);
+	return false;
+#endif
+}
+
 /* ******** Mix Linear Light Operation ******** */
 
 MixLinearLightOperation::MixLinearLightOperation() : MixBaseOperation()
@@ -623,6 +770,17 @@ void MixMultiplyOperation::executePixelSampled(float output[4], float x, float y
 	clampIfNeeded(output);
 }
 
+bool MixMultiplyOperation::executeRow(float *output, const float **inputs, int length)
+{
+#ifdef __SSE2__
+	mix_row_sse<MixMultiplySSE>(output, inputs, length, this->useValueAlphaMultiply(), this->m_useClamp);
+	return true;
+#else
+	UNUSED_VARS(output, inputs, length);
+	return false;
+#endif
+}
+
 /* ******** Mix Ovelray Operation ******** */
 
 MixOverlayOperation::MixOverlayOperation() : MixBaseOperation()
@@ -740,6 +898,17 @@ void MixScreenOperation::executePixelSampled(float output[4], float x, float y,
 	clampIfNeeded(output);
 }
 
+bool MixScreenOperation::executeRow(float *output, const float **inputs, int length)
+{
+#ifdef __SSE2__
+	mix_row_sse<MixScreenSSE>(output, inputs, length, this->useValueAlphaMultiply(), this->m_useClamp);
+	return true;
+#else
+	UNUSED_VARS(output, inputs, length);
+	return false;
+#endif
+}
+
 /* ******** Mix Soft Light Operation ******** */
 
 MixSoftLightOperation::MixSoftLightOperation() : MixBaseOperation()
@@ -806,6 +975,17 @@ void MixSubtractOperation::executePixelSampled(float output[4], float x, float y
 	clampIfNeeded(output);
 }
 
+bool MixSubtractOperation::executeRow(float *output, const float **inputs, int length)
+{
+#ifdef __SSE2__
+	mix_row_sse<MixSubtractSSE>(output, inputs, length, this->useValueAlphaMultiply(), this->m_useClamp);
+	return true;
+#else
+	UNUSED_VARS(output, inputs, length);
+	return false;
+#endif
+}
+
 /* ******** Mix Value Operation ******** */
 
 MixValueOperation::MixValueOperation() : MixBaseOperation()
@@ -84,12 +84,14 @@ class MixAddOperation : public MixBaseOperation {
 public:
 	MixAddOperation();
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	bool executeRow(float *output, const float **inputs, int length);
 };
 
 class MixBlendOperation : public MixBaseOperation {
 public:
 	MixBlendOperation();
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	bool executeRow(float *output, const float **inputs, int length);
 };
 
 class MixBurnOperation : public MixBaseOperation {
@@ -108,12 +110,14 @@ class MixDarkenOperation : public MixBaseOperation {
 public:
 	MixDarkenOperation();
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	bool executeRow(float *output, const float **inputs, int length);
 };
 
 class MixDifferenceOperation : public MixBaseOperation {
 public:
 	MixDifferenceOperation();
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	bool executeRow(float *output, const float **inputs, int length);
 };
 
 class MixDivideOperation : public MixBaseOperation {
@@ -144,6 +148,7 @@ class MixLightenOperation : public MixBaseOperation {
 public:
 	MixLightenOperation();
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	bool executeRow(float *output, const float **inputs, int length);
 };
 
 class MixLinearLightOperation : public MixBaseOperation {
@@ -156,6 +161,7 @@ class MixMultiplyOperation : public MixBaseOperation {
 public:
 	MixMultiplyOperation();
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	bool executeRow(float *output, const float **inputs, int length);
 };
 
 class MixOverlayOperation : public MixBaseOperation {
@@ -174,6 +180,7 @@ class MixScreenOperation : public MixBaseOperation {
 public:
 	MixScreenOperation();
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	bool executeRow(float *output, const float **inputs, int length);
 };
 
 class MixSoftLightOperation : public MixBaseOperation {
@@ -186,6 +193,7 @@ class MixSubtractOperation : public MixBaseOperation {
 public:
 	MixSubtractOperation();
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	bool executeRow(float *output, const float **inputs, int length);
 };
 
 class MixValueOperation : public MixBaseOperation {